@@ -62,7 +62,7 @@ static int	dispatchEvents(Sdr sdr, Object events, time_t currentTime)
 			return 0;
 		}
 
-		sdr_free(sdr, eventObj);
+		sdr_slab_free(sdr, (getLtpConstants())->eventSlab, eventObj);
 		sdr_list_delete(sdr, elt, NULL, NULL);
 		switch (event.type)
 		{
@@ -134,6 +134,11 @@ static int	manageLinks(Sdr sdr, time_t currentTime)
 	{
 		vspan = (LtpVspan *) psp(ionwm, sm_list_data(ionwm, elt));
 
+		/*	Fold the span's pending statistics tallies
+		 *	into the database.				*/
+
+		ltpFlushSpanStats(vspan);
+
 		/*	Finish aggregation as necessary.		*/
 
 		obj = sdr_list_data(sdr, vspan->spanElt);
@@ -142,7 +147,7 @@ static int	manageLinks(Sdr sdr, time_t currentTime)
 		{
 			span.ageOfBufferedBlock++;
 			sdr_write(sdr, obj, (char *) &span, sizeof(LtpSpan));
-			if (span.ageOfBufferedBlock >= span.aggrTimeLimit)
+			if (span.ageOfBufferedBlock >= vspan->aggrTimeLimit)
 			{
 				sm_SemGive(vspan->bufClosedSemaphore);
 			}
@@ -92,7 +92,7 @@ int	main(int argc, char *argv[])
 		/*	First wait until block aggregation buffer for
 		 *	this span is closed.				*/
 
-		if (span.lengthOfBufferedBlock < span.aggrSizeLimit)
+		if (span.lengthOfBufferedBlock < vspan->aggrSizeLimit)
 		{
 			sdr_exit_xn(sdr);
 			if (sm_SemTake(vspan->bufClosedSemaphore) < 0)
@@ -0,0 +1,747 @@
+/*
+	ltprelay.c:	shard relay daemon for LTP.
+
+	Serves the requests of applications that are attached to
+	the other shards of a sharded node: sends their service
+	data units over the spans of the local shard, forwards the
+	notices of the local shard's client services to the shards
+	at which those services were opened, and tells those shards
+	when the local spans become ready for more data.
+
+									*/
+#include "ltpP.h"
+#include <poll.h>
+
+#ifndef LTP_RELAY_NOTICES
+#define	LTP_RELAY_NOTICES	(64)
+#endif
+
+static void	interruptThread()
+{
+	isignal(SIGTERM, interruptThread);
+	ionKillMainThread("ltprelay");
+}
+
+/*	A forwarder is a thread that holds one client service of the
+ *	local shard open on behalf of an application attached to some
+ *	other shard, the client's "home" shard.				*/
+
+typedef struct
+{
+	pthread_t	thread;
+	int		active;
+	int		running;
+	unsigned int	clientSvcId;
+	unsigned int	homeShard;
+} Forwarder;
+
+/*	A watch relays the readiness of one span of the local shard
+ *	to each of the shards whose applications have asked for it.	*/
+
+typedef struct
+{
+	uvast		engineId;
+	int		fd;
+	char		shards[LTP_MAX_SHARDS];
+} Watch;
+
+typedef struct
+{
+	int		running;
+	unsigned int	shardNbr;
+	int		listenSocket;
+	Forwarder	forwarders[MAX_LTP_CLIENT_NBR + 1];
+	ResourceLock	forwardersLock;
+	Lyst		watches;
+	ResourceLock	watchesLock;
+	int		wakeupPipe[2];
+} RelayState;
+
+static RelayState	*_relayState(RelayState *newState)
+{
+	static RelayState	*state = NULL;
+
+	if (newState)
+	{
+		state = newState;
+	}
+
+	return state;
+}
+
+/*	*	*	Notice forwarding functions	*	*	*/
+
+static void	*forwardNotices(void *parm)
+{
+	Forwarder	*fwd = (Forwarder *) parm;
+	Sdr		sdr = getIonsdr();
+	LtpNotice	*notices;
+	LtpNotice	*notice;
+	LtpRelayMsg	msg;
+	int		noticeCount;
+	int		i;
+
+	notices = (LtpNotice *) MTAKE(LTP_RELAY_NOTICES
+			* sizeof(LtpNotice));
+	if (notices == NULL)
+	{
+		putErrmsg("ltprelay can't allocate notices.", NULL);
+		return NULL;
+	}
+
+	memset((char *) &msg, 0, sizeof msg);
+	msg.type = LTP_RELAY_NOTICE;
+	msg.shardNbr = (_relayState(NULL))->shardNbr;
+	msg.clientSvcId = fwd->clientSvcId;
+	while (fwd->running)
+	{
+		noticeCount = ltp_get_notices(fwd->clientSvcId, notices,
+				LTP_RELAY_NOTICES, 0);
+		if (noticeCount < 0)
+		{
+			putErrmsg("ltprelay can't get notices.",
+					utoa(fwd->clientSvcId));
+			break;
+		}
+
+		for (i = 0, notice = notices; i < noticeCount; i++, notice++)
+		{
+			memcpy((char *) &msg.notice, (char *) notice,
+					sizeof(LtpNotice));
+			msg.dataLength = 0;
+			if (notice->data)
+			{
+				if (sdr_begin_read(sdr) == 0)
+				{
+					break;
+				}
+
+				msg.dataLength = zco_length(sdr,
+						notice->data);
+				sdr_end_read(sdr);
+			}
+
+			/*	A notice that can't be forwarded is lost,
+			 *	as if the client had discarded it.	*/
+
+			if (ltpRelayRequest(fwd->homeShard, &msg,
+					notice->data, NULL) < 0)
+			{
+				writeErrmsgMemos();
+			}
+
+			if (notice->data)
+			{
+				ltp_release_data(notice->data);
+			}
+		}
+	}
+
+	MRELEASE(notices);
+	writeErrmsgMemos();
+	return NULL;
+}
+
+static int	openClient(RelayState *state, LtpRelayMsg *msg)
+{
+	Forwarder	*fwd;
+	int		result = 0;
+
+	if (msg->clientSvcId > MAX_LTP_CLIENT_NBR
+	|| msg->shardNbr >= LTP_MAX_SHARDS)
+	{
+		return -1;
+	}
+
+	lockResource(&state->forwardersLock);
+	fwd = state->forwarders + msg->clientSvcId;
+	if (fwd->active)
+	{
+		if (fwd->homeShard != msg->shardNbr)
+		{
+			putErrmsg("Client service already open at shard.",
+					utoa(fwd->homeShard));
+			result = -1;
+		}
+	}
+	else if (ltpAttachClient(msg->clientSvcId) < 0)
+	{
+		result = -1;
+	}
+	else
+	{
+		fwd->clientSvcId = msg->clientSvcId;
+		fwd->homeShard = msg->shardNbr;
+		fwd->running = 1;
+		if (pthread_begin(&fwd->thread, NULL, forwardNotices, fwd))
+		{
+			putSysErrmsg("ltprelay can't create forwarder thread",
+					NULL);
+			ltpDetachClient(msg->clientSvcId);
+			result = -1;
+		}
+		else
+		{
+			fwd->active = 1;
+		}
+	}
+
+	unlockResource(&state->forwardersLock);
+	return result;
+}
+
+static void	stopForwarder(Forwarder *fwd)
+{
+	fwd->running = 0;
+	ltp_interrupt(fwd->clientSvcId);
+	pthread_join(fwd->thread, NULL);
+	ltpDetachClient(fwd->clientSvcId);
+	fwd->active = 0;
+}
+
+static void	closeClient(RelayState *state, LtpRelayMsg *msg)
+{
+	Forwarder	*fwd;
+
+	if (msg->clientSvcId > MAX_LTP_CLIENT_NBR)
+	{
+		return;
+	}
+
+	lockResource(&state->forwardersLock);
+	fwd = state->forwarders + msg->clientSvcId;
+	if (fwd->active && fwd->homeShard == msg->shardNbr)
+	{
+		stopForwarder(fwd);
+	}
+
+	unlockResource(&state->forwardersLock);
+}
+
+/*	*	*	Span readiness functions	*	*	*/
+
+static int	watchSpan(RelayState *state, LtpRelayMsg *msg)
+{
+	LystElt	elt;
+	Watch	*watch = NULL;
+	char	wakeup = 1;
+	char	engineIdString[32];
+
+	if (msg->shardNbr >= LTP_MAX_SHARDS)
+	{
+		return -1;
+	}
+
+	lockResource(&state->watchesLock);
+	for (elt = lyst_first(state->watches); elt; elt = lyst_next(elt))
+	{
+		watch = (Watch *) lyst_data(elt);
+		if (watch->engineId == msg->engineId)
+		{
+			break;
+		}
+	}
+
+	if (elt == NULL)
+	{
+		watch = (Watch *) MTAKE(sizeof(Watch));
+		if (watch == NULL)
+		{
+			unlockResource(&state->watchesLock);
+			putErrmsg("ltprelay can't allocate watch.", NULL);
+			return -1;
+		}
+
+		memset((char *) watch, 0, sizeof(Watch));
+		watch->engineId = msg->engineId;
+		watch->fd = ltp_span_fd(msg->engineId);
+		if (watch->fd < 0 || lyst_insert_last(state->watches, watch)
+				== NULL)
+		{
+			if (watch->fd >= 0)
+			{
+				ltp_close_span_fd(msg->engineId, watch->fd);
+			}
+
+			MRELEASE(watch);
+			unlockResource(&state->watchesLock);
+			isprintf(engineIdString, sizeof engineIdString,
+					UVAST_FIELDSPEC, msg->engineId);
+			putErrmsg("ltprelay can't watch span.", engineIdString);
+			return -1;
+		}
+	}
+
+	watch->shards[msg->shardNbr] = 1;
+	unlockResource(&state->watchesLock);
+
+	/*	Make the watcher thread poll the new descriptor.	*/
+
+	oK(write(state->wakeupPipe[1], &wakeup, 1));
+	return 0;
+}
+
+static void	*watchSpans(void *parm)
+{
+	RelayState	*state = (RelayState *) parm;
+	struct pollfd	*fds = NULL;
+	int		fdsSize = 0;
+	int		fdCount;
+	LystElt		elt;
+	Watch		*watch;
+	LtpRelayMsg	msg;
+	unsigned int	shardNbr;
+	int		i;
+
+	memset((char *) &msg, 0, sizeof msg);
+	msg.type = LTP_RELAY_READY;
+	msg.shardNbr = state->shardNbr;
+	while (state->running)
+	{
+		lockResource(&state->watchesLock);
+		fdCount = lyst_length(state->watches) + 1;
+		if (fdCount > fdsSize)
+		{
+			if (fds)
+			{
+				MRELEASE(fds);
+			}
+
+			fds = (struct pollfd *) MTAKE(fdCount
+					* sizeof(struct pollfd));
+			if (fds == NULL)
+			{
+				unlockResource(&state->watchesLock);
+				putErrmsg("ltprelay can't allocate poll list.",
+						NULL);
+				ionKillMainThread("ltprelay");
+				return NULL;
+			}
+
+			fdsSize = fdCount;
+		}
+
+		fds[0].fd = state->wakeupPipe[0];
+		fds[0].events = POLLIN;
+		for (i = 1, elt = lyst_first(state->watches); elt;
+				i++, elt = lyst_next(elt))
+		{
+			fds[i].fd = ((Watch *) lyst_data(elt))->fd;
+			fds[i].events = POLLIN;
+		}
+
+		unlockResource(&state->watchesLock);
+		if (poll(fds, fdCount, -1) < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+
+			putSysErrmsg("ltprelay can't poll spans", NULL);
+			ionKillMainThread("ltprelay");
+			break;
+		}
+
+		if (fds[0].revents & POLLIN)
+		{
+			ltp_drain_fd(fds[0].fd);
+		}
+
+		/*	Watches are never removed, so the list still
+		 *	begins with the watches that were polled.	*/
+
+		lockResource(&state->watchesLock);
+		for (i = 1, elt = lyst_first(state->watches);
+				i < fdCount && elt; i++, elt = lyst_next(elt))
+		{
+			if ((fds[i].revents & POLLIN) == 0)
+			{
+				continue;
+			}
+
+			watch = (Watch *) lyst_data(elt);
+			ltp_drain_fd(watch->fd);
+			msg.engineId = watch->engineId;
+			for (shardNbr = 0; shardNbr < LTP_MAX_SHARDS;
+					shardNbr++)
+			{
+				if (watch->shards[shardNbr]
+				&& ltpRelayRequest(shardNbr, &msg, 0, NULL) < 0)
+				{
+					writeErrmsgMemos();
+				}
+			}
+		}
+
+		unlockResource(&state->watchesLock);
+	}
+
+	if (fds)
+	{
+		MRELEASE(fds);
+	}
+
+	writeErrmsgMemos();
+	return NULL;
+}
+
+/*	*	*	Request service functions	*	*	*/
+
+static int	sendSdu(int fd, LtpRelayMsg *msg, ReqAttendant *attendant,
+			LtpRelayReply *reply)
+{
+	Sdr	sdr = getIonsdr();
+	Object	zco;
+
+	zco = ltpRelayReceiveZco(fd, msg->dataLength, ZcoOutbound,
+			(msg->flags & LTP_NONBLOCK) ? NULL : attendant);
+	if (zco == (Object) ERROR)
+	{
+		return -1;		/*	Connection failed.	*/
+	}
+
+	if (zco == 0)
+	{
+		reply->result = -2;	/*	No ZCO space.		*/
+		return 0;
+	}
+
+	reply->result = ltp_send_many(msg->engineId, msg->clientSvcId, &zco,
+			&msg->redPartLength, 1, &reply->sessionId, msg->flags);
+	if (reply->result != 1)
+	{
+		writeErrmsgMemos();
+		if (sdr_begin_xn(sdr))
+		{
+			zco_destroy(sdr, zco);
+			oK(sdr_end_xn(sdr));
+		}
+	}
+
+	return 0;
+}
+
+static int	postNotice(int fd, LtpRelayMsg *msg, ReqAttendant *attendant)
+{
+	Sdr	sdr = getIonsdr();
+
+	msg->notice.data = 0;
+	if (msg->dataLength > 0)
+	{
+		msg->notice.data = ltpRelayReceiveZco(fd, msg->dataLength,
+				ZcoInbound, attendant);
+		if (msg->notice.data == (Object) ERROR)
+		{
+			return -1;	/*	Connection failed.	*/
+		}
+
+		if (msg->notice.data == 0)
+		{
+			return 0;	/*	Interrupted; lost.	*/
+		}
+	}
+
+	if (ltpRelayNotice(msg->clientSvcId, &msg->notice) < 0)
+	{
+		writeErrmsgMemos();
+		if (msg->notice.data && sdr_begin_xn(sdr))
+		{
+			zco_destroy(sdr, msg->notice.data);
+			oK(sdr_end_xn(sdr));
+		}
+	}
+
+	return 0;
+}
+
+static void	*serveConnection(void *parm)
+{
+	RelayState	*state = _relayState(NULL);
+	int		fd = *((int *) parm);
+	ReqAttendant	attendant;
+	LtpRelayMsg	msg;
+	LtpRelayReply	reply;
+	int		result;
+
+	MRELEASE(parm);
+	attendant.semaphore = sm_SemCreate(SM_NO_KEY, SM_SEM_FIFO);
+	if (attendant.semaphore == SM_SEM_NONE)
+	{
+		close(fd);
+		putErrmsg("ltprelay can't create ZCO space semaphore.", NULL);
+		writeErrmsgMemos();
+		return NULL;
+	}
+
+	sm_SemTake(attendant.semaphore);	/*	Lock.	*/
+	while (state->running)
+	{
+		if (ltpRelayRead(fd, (char *) &msg, sizeof msg) < 1)
+		{
+			break;		/*	Connection closed.	*/
+		}
+
+		memset((char *) &reply, 0, sizeof reply);
+		result = 0;
+		switch (msg.type)
+		{
+		case LTP_RELAY_SEND:
+			result = sendSdu(fd, &msg, &attendant, &reply);
+			break;
+
+		case LTP_RELAY_OPEN:
+			reply.result = openClient(state, &msg);
+			break;
+
+		case LTP_RELAY_CLOSE:
+			closeClient(state, &msg);
+			continue;	/*	No reply.		*/
+
+		case LTP_RELAY_NOTICE:
+			if (postNotice(fd, &msg, &attendant) < 0)
+			{
+				result = -1;
+			}
+
+			continue;	/*	No reply.		*/
+
+		case LTP_RELAY_WATCH:
+			reply.result = watchSpan(state, &msg);
+			break;
+
+		case LTP_RELAY_READY:
+			ltpRelaySpanReadiness(msg.engineId);
+			continue;	/*	No reply.		*/
+
+		default:
+			putErrmsg("Invalid LTP relay request.",
+					itoa(msg.type));
+			result = -1;
+		}
+
+		if (result < 0 || ltpRelayWrite(fd, (char *) &reply,
+				sizeof reply) < 0)
+		{
+			break;
+		}
+
+		if (reply.result < 0)
+		{
+			writeErrmsgMemos();
+		}
+	}
+
+	writeErrmsgMemos();
+	sm_SemDelete(attendant.semaphore);
+	close(fd);
+	return NULL;
+}
+
+static void	*acceptConnections(void *parm)
+{
+	RelayState	*state = (RelayState *) parm;
+	int		fd;
+	int		*fdParm;
+	pthread_attr_t	attr;
+	pthread_t	thread;
+
+	pthread_attr_init(&attr);
+	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+	while (state->running)
+	{
+		fd = accept(state->listenSocket, NULL, NULL);
+		if (fd < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+
+			if (state->running)
+			{
+				putSysErrmsg("ltprelay can't accept connection",
+						NULL);
+				ionKillMainThread("ltprelay");
+			}
+
+			break;
+		}
+
+		if (!state->running)
+		{
+			close(fd);
+			break;
+		}
+
+		fdParm = (int *) MTAKE(sizeof(int));
+		if (fdParm == NULL)
+		{
+			close(fd);
+			putErrmsg("ltprelay can't allocate connection.", NULL);
+			writeErrmsgMemos();
+			continue;
+		}
+
+		*fdParm = fd;
+		if (pthread_begin(&thread, &attr, serveConnection, fdParm))
+		{
+			MRELEASE(fdParm);
+			close(fd);
+			putSysErrmsg("ltprelay can't create service thread",
+					NULL);
+			writeErrmsgMemos();
+		}
+	}
+
+	pthread_attr_destroy(&attr);
+	writeErrmsgMemos();
+	return NULL;
+}
+
+/*	*	*	Main thread functions	*	*	*	*/
+
+static int	openListenSocket(LtpDB *db)
+{
+	unsigned short		portBase;
+	int			fd;
+	struct sockaddr_in	relayName;
+
+	portBase = db->relayPortBase;
+	if (portBase == 0)
+	{
+		portBase = LTP_RELAY_PORT_BASE;
+	}
+
+	fd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	if (fd < 0)
+	{
+		putSysErrmsg("ltprelay can't open socket", NULL);
+		return -1;
+	}
+
+	memset((char *) &relayName, 0, sizeof relayName);
+	relayName.sin_family = AF_INET;
+	relayName.sin_port = htons(portBase + db->shardNbr);
+	relayName.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	if (reUseAddress(fd)
+	|| bind(fd, (struct sockaddr *) &relayName, sizeof relayName) < 0
+	|| listen(fd, 5) < 0)
+	{
+		close(fd);
+		putSysErrmsg("ltprelay can't initialize socket",
+				itoa(portBase + db->shardNbr));
+		return -1;
+	}
+
+	return fd;
+}
+
+#if defined (ION_LWT)
+int	ltprelay(int a1, int a2, int a3, int a4, int a5,
+		int a6, int a7, int a8, int a9, int a10)
+{
+#else
+int	main(int argc, char *argv[])
+{
+#endif
+	LtpDB		*db;
+	RelayState	state;
+	pthread_t	acceptThread;
+	pthread_t	watchThread;
+	char		wakeup = 1;
+	int		i;
+	char		txt[128];
+
+	if (ltpInit(0) < 0)
+	{
+		putErrmsg("ltprelay can't initialize LTP.", NULL);
+		return 1;
+	}
+
+	db = getLtpConstants();
+	if (db->shardCount < 2)
+	{
+		putErrmsg("LTP engine isn't sharded; no relay needed.", NULL);
+		return 1;
+	}
+
+	memset((char *) &state, 0, sizeof state);
+	state.shardNbr = db->shardNbr;
+	state.watches = lyst_create();
+	if (state.watches == NULL
+	|| initResourceLock(&state.forwardersLock) < 0
+	|| initResourceLock(&state.watchesLock) < 0
+	|| pipe(state.wakeupPipe) < 0
+	|| fcntl(state.wakeupPipe[0], F_SETFL, O_NONBLOCK) < 0
+	|| fcntl(state.wakeupPipe[1], F_SETFL, O_NONBLOCK) < 0)
+	{
+		putSysErrmsg("ltprelay can't initialize", NULL);
+		return 1;
+	}
+
+	state.listenSocket = openListenSocket(db);
+	if (state.listenSocket < 0)
+	{
+		return 1;
+	}
+
+	oK(_relayState(&state));
+
+	/*	Set up signal handling; SIGTERM is shutdown signal.	*/
+
+	ionNoteMainThread("ltprelay");
+	isignal(SIGTERM, interruptThread);
+
+	/*	Start the threads.					*/
+
+	state.running = 1;
+	if (pthread_begin(&watchThread, NULL, watchSpans, &state))
+	{
+		putSysErrmsg("ltprelay can't create watcher thread", NULL);
+		return 1;
+	}
+
+	if (pthread_begin(&acceptThread, NULL, acceptConnections, &state))
+	{
+		state.running = 0;
+		oK(write(state.wakeupPipe[1], &wakeup, 1));
+		pthread_join(watchThread, NULL);
+		putSysErrmsg("ltprelay can't create listener thread", NULL);
+		return 1;
+	}
+
+	isprintf(txt, sizeof txt, "[i] ltprelay is running for shard %u \
+of %u.", db->shardNbr, db->shardCount);
+	writeMemo(txt);
+
+	/*	Now sleep until interrupted by SIGTERM, at which point
+	 *	it's time to stop the relay.				*/
+
+	ionPauseMainThread(-1);
+
+	/*	Time to shut down.  Connections still being served
+	 *	are simply abandoned.					*/
+
+	state.running = 0;
+	oK(shutdown(state.listenSocket, SHUT_RDWR));
+	oK(write(state.wakeupPipe[1], &wakeup, 1));
+	pthread_join(acceptThread, NULL);
+	pthread_join(watchThread, NULL);
+	lockResource(&state.forwardersLock);
+	for (i = 0; i <= MAX_LTP_CLIENT_NBR; i++)
+	{
+		if (state.forwarders[i].active)
+		{
+			stopForwarder(state.forwarders + i);
+		}
+	}
+
+	unlockResource(&state.forwardersLock);
+	close(state.listenSocket);
+	ltpRelayDisconnect();
+	writeErrmsgMemos();
+	writeMemo("[i] ltprelay has ended.");
+	ionDetach();
+	return 0;
+}
@@ -683,6 +683,16 @@ int	ionAttach()
 		}
 	}
 
+	/*	Cache small blocks of ION working memory, so that the
+	 *	engine's many small allocations seldom contend for
+	 *	the working memory partition lock.			*/
+
+	if (psm_start_cache(ionwm) < 0)
+	{
+		putErrmsg("Can't cache ION memory.", NULL);
+		return -1;
+	}
+
 	if (ionvdb == NULL)
 	{
 		if (_ionvdb(&ionvdbName) == NULL)
@@ -701,7 +711,17 @@ int	ionAttach()
 
 void	ionDetach()
 {
-	Sdr	ionsdr = _ionsdr(NULL);
+	Sdr		ionsdr = _ionsdr(NULL);
+	PsmPartition	ionwm = _ionwm(NULL);
+
+	/*	Return cached blocks to ION working memory.  Blocks
+	 *	cached by a process that doesn't detach (because it
+	 *	crashed) are lost until ION is restarted.		*/
+
+	if (ionwm)
+	{
+		psm_stop_cache(ionwm);
+	}
 
 	if (ionsdr)
 	{
@@ -912,6 +932,13 @@ int	ionLocked()
 	return sdr_in_xn(_ionsdr(NULL));	/*	Boolean.	*/
 }
 
+int	ionReadLocked()
+{
+	Sdr	sdr = _ionsdr(NULL);
+
+	return (sdr_in_xn(sdr) || sdr_in_read(sdr));	/*	Boolean.*/
+}
+
 /*	Functions for signaling the main threads of processes.	*	*/
 
 #define	PROC_NAME_LEN	16
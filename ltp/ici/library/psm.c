@@ -121,6 +121,25 @@ typedef struct
 	PsmAddress	address;
 } PsmCatlgEntry;
 
+/*	A process may cache small blocks in private memory, so that
+ *	most of its small block allocations and frees need not lock
+ *	the partition.  Blocks move between the cache and the
+ *	partition in batches.  A cached block remains in the small
+ *	pool, but its overhead word is set to SMALL_CACHED (no user
+ *	data size), so psm_free rejects it as unallocated.		*/
+
+#define	PSM_CACHE_DEPTH	(32)		/*	Blocks per size.	*/
+#define	PSM_CACHE_BATCH	(16)		/*	Blocks per transfer.	*/
+#define	SMALL_CACHED	(SMALL_IN_USE)
+
+typedef struct psm_cache_str
+{
+	ResourceLock	lock;
+	int		count[SMALL_SIZES];
+	PsmAddress	blocks[SMALL_SIZES][PSM_CACHE_DEPTH];
+	PsmCacheSummary	stats;
+} PsmCache;
+
 static char	*_outOfSpaceMsg()
 {
 	return "Not enough available memory.";
@@ -225,6 +244,7 @@ int	psm_manage(char *start, u_long length, char *name, PsmPartition *psmp,
 
 	partition->space = start;
 	partition->trace = NULL;
+	partition->cache = NULL;
 	map = (PartitionMap *) (partition->space);
 	if (map->status == MANAGED)
 	{
@@ -334,6 +354,11 @@ void	psm_unmanage(PsmPartition partition)
 
 	CHKVOID(partition);
 	map = (PartitionMap *) (partition->space);
+	if (partition->cache)
+	{
+		psm_stop_cache(partition);
+	}
+
 	if (map->status == MANAGED)
 	{
 	/*	Wait for partition to be no longer in use; unmanage.	*/
@@ -807,6 +832,249 @@ static void	traceMemo(const char *file, int line, PsmPartition partition,
 }
 #endif
 
+/*	*	Small block cache functions	*	*	*	*/
+
+static PsmAddress	takeSmallBlock(PartitionMap *map, int i, u_long nbytes)
+{
+	PsmAddress	block;
+	u_long		increment;
+
+	block = map->firstSmallFree[i];
+	if (block)		/*	Found a free block.		*/
+	{
+		map->firstSmallFree[i] = (SMALL(block))->next;
+		return block;
+	}
+
+	increment = nbytes + SMALL_BLOCK_OHD;
+	if (map->unassignedSpace < increment)
+	{
+		return 0;
+	}
+
+	block = map->endOfSmallPool;
+	map->endOfSmallPool += increment;
+	map->unassignedSpace -= increment;
+	return block;
+}
+
+static void	flushBlocks(PsmCache *cache, PartitionMap *map, int i, int n)
+{
+	PsmAddress	block;
+	int		j;
+
+	/*	Return the blocks that have been cached longest.	*/
+
+	lockPartition(map);
+	for (j = 0; j < n; j++)
+	{
+		block = cache->blocks[i][j];
+		(SMALL(block))->next = map->firstSmallFree[i];
+		map->firstSmallFree[i] = block;
+	}
+
+	unlockPartition(map);
+	cache->count[i] -= n;
+	memmove((char *) (cache->blocks[i]), (char *) (cache->blocks[i] + n),
+			cache->count[i] * sizeof(PsmAddress));
+	cache->stats.flushes++;
+}
+
+static PsmAddress	takeCachedBlock(PsmCache *cache, PartitionMap *map,
+				u_long nbytes)
+{
+	int		i;
+	int		n;
+	PsmAddress	block;
+
+	nbytes += (SMALL_BLOCK_OHD - 1);
+	nbytes >>= SPACE_ORDER;
+	i = nbytes - 1;
+	nbytes <<= SPACE_ORDER;
+	lockResource(&(cache->lock));
+	if (cache->count[i] == 0)
+	{
+		lockPartition(map);
+		for (n = 0; n < PSM_CACHE_BATCH; n++)
+		{
+			block = takeSmallBlock(map, i, nbytes);
+			if (block == 0)
+			{
+				break;
+			}
+
+			(SMALL(block))->next = SMALL_CACHED;
+			cache->blocks[i][n] = block;
+		}
+
+		unlockPartition(map);
+		if (n == 0)
+		{
+			cache->stats.bypasses++;
+			unlockResource(&(cache->lock));
+			return 0;
+		}
+
+		cache->count[i] = n;
+		cache->stats.refills++;
+	}
+
+	cache->count[i]--;
+	block = cache->blocks[i][cache->count[i]];
+	(SMALL(block))->next = SMALL_IN_USE + i + 1;
+	cache->stats.cacheHits++;
+	unlockResource(&(cache->lock));
+	return block + SMALL_BLOCK_OHD;
+}
+
+static int	cacheFreedBlock(PsmCache *cache, PartitionMap *map,
+			PsmAddress block)
+{
+	struct small_ohd	*smallBlk = SMALL(block);
+	int			i;
+
+	if (smallBlk->next <= SMALL_IN_USE)
+	{
+		return -1;	/*	Not allocated; let psm_free note it.*/
+	}
+
+	i = (int) (smallBlk->next - SMALL_IN_USE) - 1;
+	lockResource(&(cache->lock));
+	if (cache->count[i] == PSM_CACHE_DEPTH)
+	{
+		flushBlocks(cache, map, i, PSM_CACHE_BATCH);
+	}
+
+	smallBlk->next = SMALL_CACHED;
+	cache->blocks[i][cache->count[i]] = block;
+	cache->count[i]++;
+	cache->stats.cacheFrees++;
+	unlockResource(&(cache->lock));
+	return 0;
+}
+
+int	psm_start_cache(PsmPartition partition)
+{
+	PsmCache	*cache;
+
+	CHKERR(partition);
+	if (partition->cache)
+	{
+		return 0;
+	}
+
+	cache = (PsmCache *) acquireSystemMemory(sizeof(PsmCache));
+	if (cache == NULL)
+	{
+		putErrmsg("Can't allocate small block cache.", NULL);
+		return -1;
+	}
+
+	memset((char *) cache, 0, sizeof(PsmCache));
+	if (initResourceLock(&(cache->lock)) < 0)
+	{
+		TRACK_FREE(cache);
+		free(cache);
+		putErrmsg("Can't initialize small block cache.", NULL);
+		return -1;
+	}
+
+	partition->cache = cache;
+	return 0;
+}
+
+void	psm_cache_usage(PsmPartition partition, PsmCacheSummary *usage)
+{
+	PsmCache	*cache;
+	int		i;
+
+	CHKVOID(partition);
+	CHKVOID(usage);
+	memset((char *) usage, 0, sizeof(PsmCacheSummary));
+	cache = partition->cache;
+	if (cache == NULL)
+	{
+		return;
+	}
+
+	lockResource(&(cache->lock));
+	*usage = cache->stats;
+	for (i = 0; i < SMALL_SIZES; i++)
+	{
+		usage->cachedBlockCount[i] = cache->count[i];
+		usage->cachedBytes += cache->count[i] * (i + 1) * WORD_SIZE;
+	}
+
+	unlockResource(&(cache->lock));
+}
+
+void	psm_cache_report(PsmCacheSummary *usage)
+{
+	int	i;
+	char	textbuf[100];
+
+	CHKVOID(usage);
+	writeMemo("small block cache:");
+	isprintf(textbuf, sizeof textbuf,
+			"    allocs %10lu frees %10lu bypasses %10lu",
+			usage->cacheHits, usage->cacheFrees, usage->bypasses);
+	writeMemo(textbuf);
+	isprintf(textbuf, sizeof textbuf,
+			"    refills %10lu flushes %10lu", usage->refills,
+			usage->flushes);
+	writeMemo(textbuf);
+	for (i = 0; i < SMALL_SIZES; i++)
+	{
+		if (usage->cachedBlockCount[i] > 0)
+		{
+			isprintf(textbuf, sizeof textbuf,
+					"    %10lu of size %10ld",
+					usage->cachedBlockCount[i],
+					(long) ((i + 1) * WORD_SIZE));
+			writeMemo(textbuf);
+		}
+	}
+
+	isprintf(textbuf, sizeof textbuf,
+			"     total cached: %10lu", usage->cachedBytes);
+	writeMemo(textbuf);
+}
+
+void	psm_stop_cache(PsmPartition partition)
+{
+	PartitionMap	*map;
+	PsmCache	*cache;
+	int		i;
+
+	CHKVOID(partition);
+	cache = partition->cache;
+	if (cache == NULL)
+	{
+		return;
+	}
+
+	map = (PartitionMap *) (partition->space);
+	lockResource(&(cache->lock));
+	if (map->status == MANAGED)
+	{
+		for (i = 0; i < SMALL_SIZES; i++)
+		{
+			if (cache->count[i] > 0)
+			{
+				flushBlocks(cache, map, i, cache->count[i]);
+			}
+		}
+	}
+
+	partition->cache = NULL;
+	unlockResource(&(cache->lock));
+	killResourceLock(&(cache->lock));
+	TRACK_FREE(cache);
+	free(cache);
+}
+
+/*	*	Partition allocation functions	*	*	*	*/
+
 void	Psm_free(const char *file, int line, PsmPartition partition,
 		PsmAddress address)
 {
@@ -827,6 +1095,17 @@ void	Psm_free(const char *file, int line, PsmPartition partition,
 	}
 
 	map = (PartitionMap *) (partition->space);
+	if (partition->cache && map->traceSize == 0
+	&& address >= map->startOfSmallPool
+	&& address < map->endOfSmallPool)
+	{
+		if (cacheFreedBlock(partition->cache, map,
+				address - SMALL_BLOCK_OHD) == 0)
+		{
+			return;
+		}
+	}
+
 	lockPartition(map);
 	if (address >= map->startOfSmallPool
 	&& address < map->endOfSmallPool)
@@ -1093,8 +1372,6 @@ PsmAddress	Psm_zalloc(const char *file, int line, PsmPartition partition,
 #endif
 	PsmAddress		block;
 	int			i;
-	int			increment;
-	struct small_ohd	*blk;
 
 	if (!(partition))
 	{
@@ -1114,6 +1391,19 @@ block size %lu", nbytes);
 	}
 
 	map = (PartitionMap *) (partition->space);
+	if (nbytes <= SMALL_BLK_LIMIT && partition->cache
+	&& map->traceSize == 0)
+	{
+		block = takeCachedBlock(partition->cache, map, nbytes);
+		if (block)
+		{
+			return block;
+		}
+
+		/*	Small pool is exhausted; allocate from the
+		 *	large pool instead.				*/
+	}
+
 	lockPartition(map);
 	if (nbytes > SMALL_BLK_LIMIT)
 	{
@@ -1128,29 +1418,14 @@ block size %lu", nbytes);
 		nbytes >>= SPACE_ORDER;	/*	Truncate.		*/
 		i = nbytes - 1;		/*	(gives bucket #)	*/
 		nbytes <<= SPACE_ORDER;	/*	Restore size.		*/
-		block = map->firstSmallFree[i];
+		block = takeSmallBlock(map, i, nbytes);
 		if (block == 0)
 		{
-			increment = nbytes + SMALL_BLOCK_OHD;
-			if (map->unassignedSpace < increment)
-			{
-				block = mallocLarge(map, nbytes);
-			}
-			else
-			{
-				block = map->endOfSmallPool;
-				blk = SMALL(block);
-				map->endOfSmallPool += increment;
-				map->unassignedSpace -= increment;
-				blk->next = SMALL_IN_USE + i + 1;
-				block += SMALL_BLOCK_OHD;
-			}
+			block = mallocLarge(map, nbytes);
 		}
-		else	/*	Found a free block.			*/
+		else
 		{
-			blk = SMALL(block);
-			map->firstSmallFree[i] = blk->next;
-			blk->next = SMALL_IN_USE + i + 1;
+			(SMALL(block))->next = SMALL_IN_USE + i + 1;
 			block += SMALL_BLOCK_OHD;
 		}
 	}
@@ -1296,6 +1571,7 @@ int	psm_start_trace(PsmPartition partition, long shmSize, char *shm)
 	return -1;
 #else
 	PartitionMap	*map;
+	PsmPartition	trace;
 
 	CHKERR(partition);
 	map = (PartitionMap *) (partition->space);
@@ -1315,15 +1591,28 @@ actual.", itoa(map->traceSize));
 		map->traceSize = shmSize;	/*	Enable trace.	*/
 	}
 
-	partition->trace = (PsmView *) (partition->traceArea);
+	/*	The trace episode's space management structure is
+	 *	allocated here rather than by psm_manage, so that it
+	 *	can be released by psm_stop_trace.			*/
 
-	/*	(To prevent dynamic allocation of the trace episode's
-	 *	space management structure.)				*/
+	trace = partition->trace;
+	if (trace == NULL)
+	{
+		trace = (PsmPartition) acquireSystemMemory(sizeof(PsmView));
+		if (trace == NULL)
+		{
+			unlockPartition(map);
+			putErrmsg("Can't allocate psm trace view.", NULL);
+			return -1;
+		}
+	}
 
 	partition->trace = sptrace_start(map->traceKey, map->traceSize, shm,
-			partition->trace, map->name);
+			trace, map->name);
 	if (partition->trace == NULL)
 	{
+		TRACK_FREE(trace);
+		free(trace);
 		unlockPartition(map);
 		putErrmsg("Can't start psm trace.", NULL);
 		return -1;
@@ -1377,8 +1666,14 @@ void	psm_stop_trace(PsmPartition partition)
 	CHKVOID(partition);
 	map = (PartitionMap *) (partition->space);
 	lockPartition(map);
-	sptrace_stop(partition->trace);
-	partition->trace = NULL;
+	if (partition->trace)
+	{
+		sptrace_stop(partition->trace);
+		TRACK_FREE(partition->trace);
+		free(partition->trace);
+		partition->trace = NULL;
+	}
+
 	map->traceSize = 0;			/*	Disable trace.	*/
 	unlockPartition(map);
 #endif
@@ -0,0 +1,1123 @@
+/*
+ *	smbpt.c:	shared memory B+tree management library.
+ *
+ *	Copyright (c) 2011, California Institute of Technology.
+ *	ALL RIGHTS RESERVED.  U.S. Government Sponsorship
+ *	acknowledged.
+ */
+
+#include "platform.h"
+#include "smbpt.h"
+
+/*		Private definitions of shared-memory bpt structures.	*/
+
+/*	All data items are in the leaves, in order; the leaves are
+ *	chained in both directions.  An internal ("branch") node
+ *	with N children has N-1 keys, and key i is always the first
+ *	data item in the subtree rooted at child i+1, so the keys
+ *	need no storage of their own: every key is the address of a
+ *	data item that is currently in the tree and can be passed
+ *	to the compare function.
+ *
+ *	Every node is aligned on a NODE_ALIGN boundary, so that the
+ *	position of a data item -- the "node" of the API -- can be
+ *	the address of its leaf plus the index of the item within
+ *	the leaf.							*/
+
+#define	NODE_ALIGN	(64)
+#define	MAX_HEIGHT	(32)
+
+typedef struct
+{
+	PsmAddress	userData;
+	PsmAddress	root;		/*	root node of the bpt	*/
+	PsmAddress	firstLeaf;
+	PsmAddress	lastLeaf;
+	unsigned long	length;		/*	number of data items	*/
+	int		height;		/*	0 if bpt is empty	*/
+	sm_SemId	lock;		/*	mutex for tree		*/
+} SmBpt;
+
+typedef struct
+{
+	PsmAddress	bpt;		/*	bpt that node is in	*/
+	PsmAddress	block;		/*	as allocated		*/
+	PsmAddress	prev;		/*	prior leaf (leaf only)	*/
+	PsmAddress	next;		/*	next leaf (leaf only)	*/
+	int		isLeaf;		/*	Boolean			*/
+	int		count;		/*	data items or children	*/
+} SmBptNodeHeader;
+
+#define	NODE_ENTRIES	((SM_BPT_NODE_SIZE - sizeof(SmBptNodeHeader)) \
+/ sizeof(PsmAddress))
+
+typedef struct
+{
+	SmBptNodeHeader	hdr;
+	PsmAddress	entry[NODE_ENTRIES];
+} SmBptNode;
+
+#define	LEAF_MAX	(NODE_ENTRIES < NODE_ALIGN ? NODE_ENTRIES \
+: NODE_ALIGN - 1)
+#define	LEAF_MIN	(LEAF_MAX / 2)
+#define	BRANCH_MAX	((NODE_ENTRIES + 1) / 2)
+#define	BRANCH_MIN	((BRANCH_MAX + 1) / 2)
+
+#define	CHILD(node, i)	((node)->entry[i])
+#define	KEY(node, i)	((node)->entry[BRANCH_MAX + (i)])
+#define	LEAF_OF(pos)	((pos) & ~((PsmAddress) (NODE_ALIGN - 1)))
+#define	SLOT_OF(pos)	((int) ((pos) - LEAF_OF(pos)))
+
+/*	*	*	Bpt management functions	*	*	*/
+
+static void	eraseTree(SmBpt *bpt)
+{
+	bpt->userData = 0;
+	bpt->root = 0;
+	bpt->firstLeaf = 0;
+	bpt->lastLeaf = 0;
+	bpt->length = 0;
+	bpt->height = 0;
+	bpt->lock = 0;
+}
+
+static int	lockSmbpt(SmBpt *bpt)
+{
+	int	result;
+
+	result = sm_SemTake(bpt->lock);
+	if (result < 0)
+	{
+		putErrmsg("Can't lock B+tree.", NULL);
+	}
+
+	return result;
+}
+
+static void	unlockSmbpt(SmBpt *bpt)
+{
+	sm_SemGive(bpt->lock);
+}
+
+static PsmAddress	createNode(const char *file, int line,
+				PsmPartition partition, PsmAddress bpt,
+				SmBptNode **nodePtr)
+{
+	PsmAddress	block;
+	PsmAddress	node;
+
+	block = Psm_malloc(file, line, partition,
+			SM_BPT_NODE_SIZE + NODE_ALIGN);
+	if (block == 0)
+	{
+		putErrmsg("Can't allocate space for bpt node.", NULL);
+		return 0;
+	}
+
+	node = LEAF_OF(block + NODE_ALIGN - 1);
+	*nodePtr = (SmBptNode *) psp(partition, node);
+	memset((char *) *nodePtr, 0, sizeof(SmBptNode));
+	(*nodePtr)->hdr.bpt = bpt;
+	(*nodePtr)->hdr.block = block;
+	return node;
+}
+
+static void	destroyNode(const char *file, int line, PsmPartition partition,
+			SmBptNode *nodePtr)
+{
+	PsmAddress	block = nodePtr->hdr.block;
+
+	/*	just in case user mistakenly accesses later...		*/
+	memset((char *) nodePtr, 0, sizeof(SmBptNode));
+	Psm_free(file, line, partition, block);
+}
+
+PsmAddress	Sm_bpt_create(const char *file, int line,
+			PsmPartition partition)
+{
+	sm_SemId	lock;
+	PsmAddress	bpt;
+	SmBpt		*bptPtr;
+
+	lock = sm_SemCreate(SM_NO_KEY, SM_SEM_FIFO);
+	if (lock < 0)
+	{
+		putErrmsg("Can't create semaphore for bpt.", NULL);
+		return 0;
+	}
+
+	bpt = Psm_zalloc(file, line, partition, sizeof(SmBpt));
+	if (bpt == 0)
+	{
+		sm_SemDelete(lock);
+		putErrmsg("Can't allocate space for bpt object.", NULL);
+		return 0;
+	}
+
+	bptPtr = (SmBpt *) psp(partition, bpt);
+	eraseTree(bptPtr);
+	bptPtr->lock = lock;
+	return bpt;
+}
+
+void	sm_bpt_unwedge(PsmPartition partition, PsmAddress bpt, int interval)
+{
+	SmBpt	*bptPtr;
+
+	CHKVOID(partition);
+	CHKVOID(bpt);
+	bptPtr = (SmBpt *) psp(partition, bpt);
+	CHKVOID(bptPtr);
+	sm_SemUnwedge(bptPtr->lock, interval);
+}
+
+static void	destroyBptNodes(const char *file, int line,
+			PsmPartition partition, PsmAddress node,
+			SmBptDeleteFn deleteFn, void *arg)
+{
+	SmBptNode	*nodePtr;
+	int		i;
+
+	nodePtr = (SmBptNode *) psp(partition, node);
+	for (i = 0; i < nodePtr->hdr.count; i++)
+	{
+		if (nodePtr->hdr.isLeaf)
+		{
+			if (deleteFn)
+			{
+				deleteFn(partition, nodePtr->entry[i], arg);
+			}
+		}
+		else
+		{
+			destroyBptNodes(file, line, partition,
+					CHILD(nodePtr, i), deleteFn, arg);
+		}
+	}
+
+	destroyNode(file, line, partition, nodePtr);
+}
+
+static void	clearTree(const char *file, int line, PsmPartition partition,
+			SmBpt *bptPtr, SmBptDeleteFn deleteFn, void *arg)
+{
+	if (bptPtr->root)
+	{
+		destroyBptNodes(file, line, partition, bptPtr->root,
+				deleteFn, arg);
+	}
+
+	bptPtr->root = 0;
+	bptPtr->firstLeaf = 0;
+	bptPtr->lastLeaf = 0;
+	bptPtr->length = 0;
+	bptPtr->height = 0;
+}
+
+void	Sm_bpt_clear(const char *file, int line, PsmPartition partition,
+		PsmAddress bpt, SmBptDeleteFn deleteFn, void *arg)
+{
+	SmBpt	*bptPtr;
+
+	CHKVOID(partition);
+	CHKVOID(bpt);
+	bptPtr = (SmBpt *) psp(partition, bpt);
+	oK(lockSmbpt(bptPtr));
+	clearTree(file, line, partition, bptPtr, deleteFn, arg);
+	unlockSmbpt(bptPtr);
+}
+
+void	Sm_bpt_destroy(const char *file, int line, PsmPartition partition,
+		PsmAddress bpt, SmBptDeleteFn deleteFn, void *arg)
+{
+	SmBpt	*bptPtr;
+
+	CHKVOID(partition);
+	CHKVOID(bpt);
+	bptPtr = (SmBpt *) psp(partition, bpt);
+	oK(lockSmbpt(bptPtr));
+	clearTree(file, line, partition, bptPtr, deleteFn, arg);
+
+	/*	Now destroy the tree itself.				*/
+
+	sm_SemDelete(bptPtr->lock);
+
+	/*	just in case user mistakenly accesses later...		*/
+	eraseTree(bptPtr);
+	Psm_free(file, line, partition, bpt);
+}
+
+PsmAddress	sm_bpt_user_data(PsmPartition partition, PsmAddress bpt)
+{
+	SmBpt		*bptPtr;
+	PsmAddress	userData;
+
+	CHKZERO(partition);
+	CHKZERO(bpt);
+	bptPtr = (SmBpt *) psp(partition, bpt);
+	CHKZERO(bptPtr);
+	if (lockSmbpt(bptPtr) == ERROR)
+	{
+		return 0;
+	}
+
+	userData = bptPtr->userData;
+	unlockSmbpt(bptPtr);
+	return userData;
+}
+
+void	sm_bpt_user_data_set(PsmPartition partition, PsmAddress bpt,
+		PsmAddress data)
+{
+	SmBpt	*bptPtr;
+
+	CHKVOID(partition);
+	CHKVOID(bpt);
+	bptPtr = (SmBpt *) psp(partition, bpt);
+	CHKVOID(bptPtr);
+	if (lockSmbpt(bptPtr) == ERROR)
+	{
+		return;
+	}
+
+	bptPtr->userData = data;
+	unlockSmbpt(bptPtr);
+}
+
+long	sm_bpt_length(PsmPartition partition, PsmAddress bpt)
+{
+	SmBpt	*bptPtr;
+	long	length;
+
+	CHKERR(partition);
+	CHKERR(bpt);
+	bptPtr = (SmBpt *) psp(partition, bpt);
+	CHKERR(bptPtr);
+	if (lockSmbpt(bptPtr) == ERROR)
+	{
+		return ERROR;
+	}
+
+	length = bptPtr->length;
+	unlockSmbpt(bptPtr);
+	return length;
+}
+
+/*	Returns the index of the first data item in the leaf that
+ *	is not less than the argument, noting whether or not that
+ *	item is equal to the argument.					*/
+
+static int	searchLeaf(PsmPartition partition, SmBptNode *leaf,
+			SmBptCompareFn compare, void *dataBuffer, int *found)
+{
+	int	low = 0;
+	int	high = leaf->hdr.count;
+	int	mid;
+	int	result;
+
+	*found = 0;
+	while (low < high)
+	{
+		mid = (low + high) / 2;
+		result = compare(partition, leaf->entry[mid], dataBuffer);
+		if (result == 0)
+		{
+			*found = 1;
+			return mid;
+		}
+
+		if (result < 0)
+		{
+			low = mid + 1;
+		}
+		else
+		{
+			high = mid;
+		}
+	}
+
+	return low;
+}
+
+/*	Returns the index of the child of a branch node in whose
+ *	subtree the argument belongs.					*/
+
+static int	searchBranch(PsmPartition partition, SmBptNode *branch,
+			SmBptCompareFn compare, void *dataBuffer)
+{
+	int	low = 0;
+	int	high = branch->hdr.count - 1;
+	int	mid;
+	int	result;
+
+	while (low < high)
+	{
+		mid = (low + high) / 2;
+		result = compare(partition, KEY(branch, mid), dataBuffer);
+		if (result == 0)
+		{
+			return mid + 1;
+		}
+
+		if (result < 0)
+		{
+			low = mid + 1;
+		}
+		else
+		{
+			high = mid;
+		}
+	}
+
+	return low;
+}
+
+/*	Descends from the root to the leaf in which the argument
+ *	belongs, noting the branch nodes traversed and the index of
+ *	the child taken at each one.  Returns the leaf's address.	*/
+
+static PsmAddress	findLeaf(PsmPartition partition, SmBpt *bptPtr,
+				SmBptCompareFn compare, void *dataBuffer,
+				SmBptNode **path, int *pathIdx, int *depth)
+{
+	PsmAddress	node = bptPtr->root;
+	SmBptNode	*nodePtr;
+	int		i;
+
+	*depth = 0;
+	nodePtr = (SmBptNode *) psp(partition, node);
+	while (!nodePtr->hdr.isLeaf)
+	{
+		i = searchBranch(partition, nodePtr, compare, dataBuffer);
+		if (path)
+		{
+			path[*depth] = nodePtr;
+			pathIdx[*depth] = i;
+		}
+
+		(*depth)++;
+		node = CHILD(nodePtr, i);
+		nodePtr = (SmBptNode *) psp(partition, node);
+	}
+
+	return node;
+}
+
+static void	splitLeaf(PsmPartition partition, SmBpt *bptPtr,
+			PsmAddress leaf, SmBptNode *leafPtr, int i,
+			PsmAddress data, PsmAddress right,
+			SmBptNode *rightPtr)
+{
+	PsmAddress	items[LEAF_MAX + 1];
+	int		leftCount = (LEAF_MAX + 1) / 2;
+	SmBptNode	*nextPtr;
+
+	memcpy((char *) items, (char *) (leafPtr->entry),
+			i * sizeof(PsmAddress));
+	items[i] = data;
+	memcpy((char *) (items + i + 1), (char *) (leafPtr->entry + i),
+			(LEAF_MAX - i) * sizeof(PsmAddress));
+	memcpy((char *) (leafPtr->entry), (char *) items,
+			leftCount * sizeof(PsmAddress));
+	leafPtr->hdr.count = leftCount;
+	rightPtr->hdr.isLeaf = 1;
+	memcpy((char *) (rightPtr->entry), (char *) (items + leftCount),
+			(LEAF_MAX + 1 - leftCount) * sizeof(PsmAddress));
+	rightPtr->hdr.count = LEAF_MAX + 1 - leftCount;
+
+	/*	Link the new leaf into the chain of leaves.		*/
+
+	rightPtr->hdr.prev = leaf;
+	rightPtr->hdr.next = leafPtr->hdr.next;
+	if (leafPtr->hdr.next)
+	{
+		nextPtr = (SmBptNode *) psp(partition, leafPtr->hdr.next);
+		nextPtr->hdr.prev = right;
+	}
+	else
+	{
+		bptPtr->lastLeaf = right;
+	}
+
+	leafPtr->hdr.next = right;
+}
+
+/*	Inserts child, whose first data item is key, into the branch
+ *	node immediately after child i, splitting the branch node
+ *	into the new branch node "right" if it is full.  Returns the
+ *	key that must be inserted into the parent of the branch node
+ *	along with "right" in that case, otherwise zero.		*/
+
+static PsmAddress	insertIntoBranch(SmBptNode *branch, int i,
+				PsmAddress key, PsmAddress child,
+				SmBptNode *rightPtr)
+{
+	PsmAddress	children[BRANCH_MAX + 1];
+	PsmAddress	keys[BRANCH_MAX];
+	int		count = branch->hdr.count;
+	int		leftCount = (BRANCH_MAX + 1) / 2;
+	int		j;
+
+	if (count < BRANCH_MAX)
+	{
+		for (j = count; j > i + 1; j--)
+		{
+			CHILD(branch, j) = CHILD(branch, j - 1);
+			KEY(branch, j - 1) = KEY(branch, j - 2);
+		}
+
+		CHILD(branch, i + 1) = child;
+		KEY(branch, i) = key;
+		branch->hdr.count++;
+		return 0;
+	}
+
+	for (j = 0; j < count; j++)
+	{
+		children[j < i + 1 ? j : j + 1] = CHILD(branch, j);
+		if (j < count - 1)
+		{
+			keys[j < i ? j : j + 1] = KEY(branch, j);
+		}
+	}
+
+	children[i + 1] = child;
+	keys[i] = key;
+	for (j = 0; j < leftCount; j++)
+	{
+		CHILD(branch, j) = children[j];
+		if (j < leftCount - 1)
+		{
+			KEY(branch, j) = keys[j];
+		}
+	}
+
+	branch->hdr.count = leftCount;
+	rightPtr->hdr.isLeaf = 0;
+	rightPtr->hdr.count = BRANCH_MAX + 1 - leftCount;
+	for (j = 0; j < rightPtr->hdr.count; j++)
+	{
+		CHILD(rightPtr, j) = children[leftCount + j];
+		if (j < rightPtr->hdr.count - 1)
+		{
+			KEY(rightPtr, j) = keys[leftCount + j];
+		}
+	}
+
+	return keys[leftCount - 1];
+}
+
+PsmAddress	Sm_bpt_insert(const char *file, int line,
+			PsmPartition partition, PsmAddress bpt, PsmAddress data,
+			SmBptCompareFn compare, void *dataBuffer)
+{
+	SmBpt		*bptPtr;
+	SmBptNode	*path[MAX_HEIGHT];
+	int		pathIdx[MAX_HEIGHT];
+	int		depth;
+	PsmAddress	leaf;
+	SmBptNode	*leafPtr;
+	PsmAddress	spare[MAX_HEIGHT + 1];
+	SmBptNode	*sparePtr[MAX_HEIGHT + 1];
+	int		needed;
+	int		level;
+	int		i;
+	int		found;
+	PsmAddress	node;
+	PsmAddress	key;
+	SmBptNode	*rootPtr;
+
+	CHKZERO(partition);
+	CHKZERO(bpt);
+	CHKZERO(compare);
+	bptPtr = (SmBpt *) psp(partition, bpt);
+	CHKZERO(bptPtr);
+	if (lockSmbpt(bptPtr) == ERROR)
+	{
+		return 0;
+	}
+
+	if (bptPtr->root == 0)
+	{
+		leaf = createNode(file, line, partition, bpt, &leafPtr);
+		if (leaf)
+		{
+			leafPtr->hdr.isLeaf = 1;
+			leafPtr->entry[0] = data;
+			leafPtr->hdr.count = 1;
+			bptPtr->root = leaf;
+			bptPtr->firstLeaf = leaf;
+			bptPtr->lastLeaf = leaf;
+			bptPtr->height = 1;
+			bptPtr->length = 1;
+		}
+
+		unlockSmbpt(bptPtr);
+		return leaf;
+	}
+
+	leaf = findLeaf(partition, bptPtr, compare, dataBuffer, path,
+			pathIdx, &depth);
+	leafPtr = (SmBptNode *) psp(partition, leaf);
+	i = searchLeaf(partition, leafPtr, compare, dataBuffer, &found);
+	if (found)		/*	Keys must be unique.		*/
+	{
+		unlockSmbpt(bptPtr);
+		return 0;
+	}
+
+	bptPtr->length += 1;
+	if (leafPtr->hdr.count < LEAF_MAX)
+	{
+		memmove((char *) (leafPtr->entry + i + 1),
+				(char *) (leafPtr->entry + i),
+				(leafPtr->hdr.count - i) * sizeof(PsmAddress));
+		leafPtr->entry[i] = data;
+		leafPtr->hdr.count++;
+		unlockSmbpt(bptPtr);
+		return leaf + i;
+	}
+
+	/*	Must split the leaf and possibly some of its ancestors.
+	 *	Allocate all of the new nodes up front, so that the
+	 *	tree is never left half-split for lack of space.	*/
+
+	needed = 1;
+	for (level = depth - 1; level >= 0; level--)
+	{
+		if (path[level]->hdr.count < BRANCH_MAX)
+		{
+			break;
+		}
+
+		needed++;
+	}
+
+	if (level < 0)		/*	Root will split.		*/
+	{
+		needed++;
+	}
+
+	for (level = 0; level < needed; level++)
+	{
+		spare[level] = createNode(file, line, partition, bpt,
+				&sparePtr[level]);
+		if (spare[level] == 0)
+		{
+			while (level > 0)
+			{
+				level--;
+				destroyNode(file, line, partition,
+						sparePtr[level]);
+			}
+
+			bptPtr->length -= 1;
+			unlockSmbpt(bptPtr);
+			return 0;
+		}
+	}
+
+	splitLeaf(partition, bptPtr, leaf, leafPtr, i, data, spare[0],
+			sparePtr[0]);
+	if (i < leafPtr->hdr.count)
+	{
+		node = leaf + i;
+	}
+	else
+	{
+		node = spare[0] + (i - leafPtr->hdr.count);
+	}
+
+	key = sparePtr[0]->entry[0];
+	for (level = depth - 1, needed = 1; level >= 0; level--, needed++)
+	{
+		key = insertIntoBranch(path[level], pathIdx[level], key,
+				spare[needed - 1], sparePtr[needed]);
+		if (key == 0)
+		{
+			break;
+		}
+	}
+
+	if (level < 0)		/*	Root was split.			*/
+	{
+		rootPtr = sparePtr[needed];
+		rootPtr->hdr.isLeaf = 0;
+		rootPtr->hdr.count = 2;
+		CHILD(rootPtr, 0) = bptPtr->root;
+		CHILD(rootPtr, 1) = spare[needed - 1];
+		KEY(rootPtr, 0) = key;
+		bptPtr->root = spare[needed];
+		bptPtr->height += 1;
+	}
+
+	unlockSmbpt(bptPtr);
+	return node;
+}
+
+static void	removeFromBranch(SmBptNode *branch, int i)
+{
+	int	j;
+
+	/*	Removes key i and child i + 1.				*/
+
+	for (j = i + 1; j < branch->hdr.count - 1; j++)
+	{
+		CHILD(branch, j) = CHILD(branch, j + 1);
+		KEY(branch, j - 1) = KEY(branch, j);
+	}
+
+	branch->hdr.count--;
+}
+
+/*	Restores the minimum occupancy of a leaf, by moving a data
+ *	item into it from a sibling or by merging it with a sibling.
+ *	Returns 1 if the leaves were merged, in which case the parent
+ *	has lost a child.						*/
+
+static int	rebalanceLeaf(const char *file, int line,
+			PsmPartition partition, SmBpt *bptPtr, PsmAddress leaf,
+			SmBptNode *leafPtr, SmBptNode *parent, int i)
+{
+	PsmAddress	left = 0;
+	SmBptNode	*leftPtr = NULL;
+	SmBptNode	*rightPtr = NULL;
+	SmBptNode	*nextPtr;
+
+	if (i > 0)
+	{
+		left = CHILD(parent, i - 1);
+		leftPtr = (SmBptNode *) psp(partition, left);
+		if (leftPtr->hdr.count > LEAF_MIN)
+		{
+			memmove((char *) (leafPtr->entry + 1),
+					(char *) (leafPtr->entry),
+					leafPtr->hdr.count
+					* sizeof(PsmAddress));
+			leafPtr->entry[0] = leftPtr->entry[leftPtr->hdr.count
+					- 1];
+			leftPtr->hdr.count--;
+			leafPtr->hdr.count++;
+			KEY(parent, i - 1) = leafPtr->entry[0];
+			return 0;
+		}
+	}
+
+	if (i < parent->hdr.count - 1)
+	{
+		rightPtr = (SmBptNode *) psp(partition, CHILD(parent, i + 1));
+		if (rightPtr->hdr.count > LEAF_MIN)
+		{
+			leafPtr->entry[leafPtr->hdr.count] = rightPtr->entry[0];
+			leafPtr->hdr.count++;
+			rightPtr->hdr.count--;
+			memmove((char *) (rightPtr->entry),
+					(char *) (rightPtr->entry + 1),
+					rightPtr->hdr.count
+					* sizeof(PsmAddress));
+			KEY(parent, i) = rightPtr->entry[0];
+			return 0;
+		}
+	}
+
+	/*	Neither sibling can spare a data item, so merge the
+	 *	leaf with one of them.  Always merge the right-hand
+	 *	leaf of the pair into the left-hand one.		*/
+
+	if (leftPtr)
+	{
+		rightPtr = leafPtr;
+		leafPtr = leftPtr;
+		leaf = left;
+		i--;
+	}
+
+	memcpy((char *) (leafPtr->entry + leafPtr->hdr.count),
+			(char *) (rightPtr->entry),
+			rightPtr->hdr.count * sizeof(PsmAddress));
+	leafPtr->hdr.count += rightPtr->hdr.count;
+	leafPtr->hdr.next = rightPtr->hdr.next;
+	if (rightPtr->hdr.next)
+	{
+		nextPtr = (SmBptNode *) psp(partition, rightPtr->hdr.next);
+		nextPtr->hdr.prev = leaf;
+	}
+	else
+	{
+		bptPtr->lastLeaf = leaf;
+	}
+
+	destroyNode(file, line, partition, rightPtr);
+	removeFromBranch(parent, i);
+	return 1;
+}
+
+/*	Restores the minimum occupancy of a branch node, in the same
+ *	way.								*/
+
+static int	rebalanceBranch(const char *file, int line,
+			PsmPartition partition, SmBptNode *branch,
+			SmBptNode *parent, int i)
+{
+	SmBptNode	*leftPtr = NULL;
+	SmBptNode	*rightPtr = NULL;
+	int		j;
+
+	if (i > 0)
+	{
+		leftPtr = (SmBptNode *) psp(partition, CHILD(parent, i - 1));
+		if (leftPtr->hdr.count > BRANCH_MIN)
+		{
+			for (j = branch->hdr.count; j > 0; j--)
+			{
+				CHILD(branch, j) = CHILD(branch, j - 1);
+				if (j > 1)
+				{
+					KEY(branch, j - 1) = KEY(branch, j - 2);
+				}
+			}
+
+			CHILD(branch, 0) = CHILD(leftPtr,
+					leftPtr->hdr.count - 1);
+			KEY(branch, 0) = KEY(parent, i - 1);
+			KEY(parent, i - 1) = KEY(leftPtr,
+					leftPtr->hdr.count - 2);
+			leftPtr->hdr.count--;
+			branch->hdr.count++;
+			return 0;
+		}
+	}
+
+	if (i < parent->hdr.count - 1)
+	{
+		rightPtr = (SmBptNode *) psp(partition, CHILD(parent, i + 1));
+		if (rightPtr->hdr.count > BRANCH_MIN)
+		{
+			CHILD(branch, branch->hdr.count) = CHILD(rightPtr, 0);
+			KEY(branch, branch->hdr.count - 1) = KEY(parent, i);
+			branch->hdr.count++;
+			KEY(parent, i) = KEY(rightPtr, 0);
+			for (j = 0; j < rightPtr->hdr.count - 1; j++)
+			{
+				CHILD(rightPtr, j) = CHILD(rightPtr, j + 1);
+				if (j < rightPtr->hdr.count - 2)
+				{
+					KEY(rightPtr, j) = KEY(rightPtr, j + 1);
+				}
+			}
+
+			rightPtr->hdr.count--;
+			return 0;
+		}
+	}
+
+	if (leftPtr)
+	{
+		rightPtr = branch;
+		branch = leftPtr;
+		i--;
+	}
+
+	KEY(branch, branch->hdr.count - 1) = KEY(parent, i);
+	for (j = 0; j < rightPtr->hdr.count; j++)
+	{
+		CHILD(branch, branch->hdr.count + j) = CHILD(rightPtr, j);
+		if (j < rightPtr->hdr.count - 1)
+		{
+			KEY(branch, branch->hdr.count + j) = KEY(rightPtr, j);
+		}
+	}
+
+	branch->hdr.count += rightPtr->hdr.count;
+	destroyNode(file, line, partition, rightPtr);
+	removeFromBranch(parent, i);
+	return 1;
+}
+
+void	Sm_bpt_delete(const char *file, int line, PsmPartition partition,
+		PsmAddress bpt, SmBptCompareFn compare, void *dataBuffer,
+		SmBptDeleteFn deleteFn, void *arg)
+{
+	SmBpt		*bptPtr;
+	SmBptNode	*path[MAX_HEIGHT];
+	int		pathIdx[MAX_HEIGHT];
+	int		depth;
+	PsmAddress	leaf;
+	SmBptNode	*leafPtr;
+	SmBptNode	*rootPtr;
+	PsmAddress	data;
+	int		level;
+	int		i;
+	int		found;
+
+	CHKVOID(partition);
+	CHKVOID(bpt);
+	CHKVOID(compare);
+	bptPtr = (SmBpt *) psp(partition, bpt);
+	CHKVOID(bptPtr);
+	if (lockSmbpt(bptPtr) == ERROR)
+	{
+		return;
+	}
+
+	if (bptPtr->root == 0)
+	{
+		unlockSmbpt(bptPtr);
+		return;
+	}
+
+	leaf = findLeaf(partition, bptPtr, compare, dataBuffer, path,
+			pathIdx, &depth);
+	leafPtr = (SmBptNode *) psp(partition, leaf);
+	i = searchLeaf(partition, leafPtr, compare, dataBuffer, &found);
+	if (!found)
+	{
+		unlockSmbpt(bptPtr);
+		return;
+	}
+
+	data = leafPtr->entry[i];
+	leafPtr->hdr.count--;
+	memmove((char *) (leafPtr->entry + i), (char *) (leafPtr->entry + i
+			+ 1), (leafPtr->hdr.count - i) * sizeof(PsmAddress));
+	bptPtr->length -= 1;
+	if (depth == 0)		/*	Leaf is the root.		*/
+	{
+		if (leafPtr->hdr.count == 0)
+		{
+			clearTree(file, line, partition, bptPtr, NULL, NULL);
+		}
+	}
+	else
+	{
+		/*	If the deleted data item was the first in its
+		 *	leaf, it is also the key for the leaf in some
+		 *	ancestor, which must now be the leaf's new
+		 *	first data item.				*/
+
+		if (i == 0 && leafPtr->hdr.count > 0)
+		{
+			for (level = depth - 1; level >= 0; level--)
+			{
+				if (pathIdx[level] > 0)
+				{
+					KEY(path[level], pathIdx[level] - 1)
+						= leafPtr->entry[0];
+					break;
+				}
+			}
+		}
+
+		level = depth - 1;
+		if (leafPtr->hdr.count < LEAF_MIN
+		&& rebalanceLeaf(file, line, partition, bptPtr, leaf,
+				leafPtr, path[level], pathIdx[level]))
+		{
+			while (level > 0 && path[level]->hdr.count < BRANCH_MIN)
+			{
+				if (rebalanceBranch(file, line, partition,
+						path[level], path[level - 1],
+						pathIdx[level - 1]) == 0)
+				{
+					break;
+				}
+
+				level--;
+			}
+
+			rootPtr = path[0];
+			if (rootPtr->hdr.count == 1)
+			{
+				bptPtr->root = CHILD(rootPtr, 0);
+				bptPtr->height -= 1;
+				destroyNode(file, line, partition, rootPtr);
+			}
+		}
+	}
+
+	if (deleteFn)
+	{
+		deleteFn(partition, data, arg);
+	}
+
+	unlockSmbpt(bptPtr);
+}
+
+PsmAddress	sm_bpt_first(PsmPartition partition, PsmAddress bpt)
+{
+	SmBpt		*bptPtr;
+	PsmAddress	first;
+
+	CHKZERO(partition);
+	CHKZERO(bpt);
+	bptPtr = (SmBpt *) psp(partition, bpt);
+	CHKZERO(bptPtr);
+	if (lockSmbpt(bptPtr) == ERROR)
+	{
+		return 0;
+	}
+
+	first = bptPtr->firstLeaf;
+	unlockSmbpt(bptPtr);
+	return first;
+}
+
+PsmAddress	sm_bpt_last(PsmPartition partition, PsmAddress bpt)
+{
+	SmBpt		*bptPtr;
+	PsmAddress	last = 0;
+	SmBptNode	*leafPtr;
+
+	CHKZERO(partition);
+	CHKZERO(bpt);
+	bptPtr = (SmBpt *) psp(partition, bpt);
+	CHKZERO(bptPtr);
+	if (lockSmbpt(bptPtr) == ERROR)
+	{
+		return 0;
+	}
+
+	if (bptPtr->lastLeaf)
+	{
+		leafPtr = (SmBptNode *) psp(partition, bptPtr->lastLeaf);
+		last = bptPtr->lastLeaf + (leafPtr->hdr.count - 1);
+	}
+
+	unlockSmbpt(bptPtr);
+	return last;
+}
+
+static PsmAddress	traverseBpt(PsmPartition partition,
+				PsmAddress fromNode, int direction)
+{
+	PsmAddress	leaf = LEAF_OF(fromNode);
+	int		slot = SLOT_OF(fromNode);
+	SmBptNode	*leafPtr;
+
+	leafPtr = (SmBptNode *) psp(partition, leaf);
+	if (direction)		/*	Going right.			*/
+	{
+		if (slot + 1 < leafPtr->hdr.count)
+		{
+			return fromNode + 1;
+		}
+
+		return leafPtr->hdr.next;
+	}
+
+	if (slot > 0)
+	{
+		return fromNode - 1;
+	}
+
+	leaf = leafPtr->hdr.prev;
+	if (leaf == 0)
+	{
+		return 0;
+	}
+
+	leafPtr = (SmBptNode *) psp(partition, leaf);
+	return leaf + (leafPtr->hdr.count - 1);
+}
+
+PsmAddress	Sm_bpt_traverse(PsmPartition partition, PsmAddress fromNode,
+			int direction)
+{
+	SmBptNode	*leafPtr;
+	SmBpt		*bptPtr;
+	PsmAddress	nextNode;
+
+	CHKZERO(partition);
+	CHKZERO(fromNode);
+	leafPtr = (SmBptNode *) psp(partition, LEAF_OF(fromNode));
+	CHKZERO(leafPtr);
+	bptPtr = (SmBpt *) psp(partition, leafPtr->hdr.bpt);
+	CHKZERO(bptPtr);
+	if (lockSmbpt(bptPtr) == ERROR)
+	{
+		return 0;
+	}
+
+	nextNode = traverseBpt(partition, fromNode, direction);
+	unlockSmbpt(bptPtr);
+	return nextNode;
+}
+
+PsmAddress	sm_bpt_search(PsmPartition partition, PsmAddress bpt,
+			SmBptCompareFn compare, void *dataBuffer,
+			PsmAddress *successor)
+{
+	SmBpt		*bptPtr;
+	PsmAddress	leaf;
+	SmBptNode	*leafPtr;
+	int		depth;
+	int		i;
+	int		found;
+	PsmAddress	node = 0;
+
+	CHKZERO(partition);
+	CHKZERO(bpt);
+	CHKZERO(compare);
+	bptPtr = (SmBpt *) psp(partition, bpt);
+	CHKZERO(bptPtr);
+	if (lockSmbpt(bptPtr) == ERROR)
+	{
+		return 0;
+	}
+
+	if (successor)
+	{
+		*successor = 0;
+	}
+
+	if (bptPtr->root)
+	{
+		leaf = findLeaf(partition, bptPtr, compare, dataBuffer, NULL,
+				NULL, &depth);
+		leafPtr = (SmBptNode *) psp(partition, leaf);
+		i = searchLeaf(partition, leafPtr, compare, dataBuffer,
+				&found);
+		if (found)
+		{
+			node = leaf + i;
+		}
+		else if (successor)	/*	Note position.		*/
+		{
+			if (i < leafPtr->hdr.count)
+			{
+				*successor = leaf + i;
+			}
+			else
+			{
+				*successor = leafPtr->hdr.next;
+			}
+		}
+	}
+
+	unlockSmbpt(bptPtr);
+	return node;	/*	If zero, didn't find matching item.	*/
+}
+
+PsmAddress	sm_bpt_bpt(PsmPartition partition, PsmAddress node)
+{
+	SmBptNode	*leafPtr;
+
+	CHKZERO(partition);
+	CHKZERO(node);
+	leafPtr = (SmBptNode *) psp(partition, LEAF_OF(node));
+	CHKZERO(leafPtr);
+	return leafPtr->hdr.bpt;
+}
+
+PsmAddress	sm_bpt_data(PsmPartition partition, PsmAddress node)
+{
+	SmBptNode	*leafPtr;
+	int		slot = SLOT_OF(node);
+
+	CHKZERO(partition);
+	CHKZERO(node);
+	leafPtr = (SmBptNode *) psp(partition, LEAF_OF(node));
+	CHKZERO(leafPtr);
+	CHKZERO(slot < leafPtr->hdr.count);
+	return leafPtr->entry[slot];
+}
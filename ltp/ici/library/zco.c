@@ -2547,6 +2547,161 @@ static int	copyFromSource(Sdr sdr, char *buffer, SourceExtent *extent,
 	}
 }
 
+/*	Functions for viewing source data in place.			*/
+
+static int	viewSource(Sdr sdr, ZcoView *view, SourceExtent *extent,
+			vast bytesToSkip, vast bytesAvbl)
+{
+	ZcoObjLien	objLien;
+	ObjRef		objRef;
+#ifdef unix
+	ZcoFileLien	fileLien;
+	FileRef		fileRef;
+	int		fd;
+	struct stat	statbuf;
+	off_t		offset;
+	off_t		mapOffset;
+#endif
+
+	memset((char *) view, 0, sizeof(ZcoView));
+	switch (extent->sourceMedium)
+	{
+	case ZcoObjSource:
+		sdr_read(sdr, (char *) &objLien, extent->location,
+				sizeof(ZcoObjLien));
+		sdr_read(sdr, (char *) &objRef, objLien.location,
+				sizeof(ObjRef));
+		view->text = (char *) sdr_pointer(sdr, objRef.object
+				+ extent->offset + bytesToSkip);
+		if (view->text == NULL)
+		{
+			return 0;	/*	Heap is not in DRAM.	*/
+		}
+
+		view->length = bytesAvbl;
+		return 1;
+
+	case ZcoFileSource:
+#ifdef unix
+		sdr_read(sdr, (char *) &fileLien, extent->location,
+				sizeof(ZcoFileLien));
+		sdr_read(sdr, (char *) &fileRef, fileLien.location,
+				sizeof(FileRef));
+		fd = open(fileRef.pathName, O_RDONLY, 0);
+		if (fd < 0)
+		{
+			return 0;	/*	Can't view file.	*/
+		}
+
+		if (fstat(fd, &statbuf) < 0 || statbuf.st_ino != fileRef.inode
+		|| statbuf.st_size < extent->offset + bytesToSkip + bytesAvbl)
+		{
+			close(fd);	/*	File changed.		*/
+			return 0;
+		}
+
+		/*	Mapping must start on a page boundary.		*/
+
+		offset = extent->offset + bytesToSkip;
+		mapOffset = offset - (offset % sysconf(_SC_PAGESIZE));
+		view->mapLength = bytesAvbl + (offset - mapOffset);
+		view->mapBase = mmap(NULL, view->mapLength, PROT_READ,
+				MAP_SHARED, fd, mapOffset);
+		close(fd);
+		if (view->mapBase == MAP_FAILED)
+		{
+			putSysErrmsg("Can't map ZCO file extent",
+					fileRef.pathName);
+			memset((char *) view, 0, sizeof(ZcoView));
+			return -1;
+		}
+
+		view->text = view->mapBase + (offset - mapOffset);
+		view->length = bytesAvbl;
+		return 1;
+#endif
+	default:		/*	Can't view bulk item in place.	*/
+		return 0;
+	}
+}
+
+int	zco_map_source(Sdr sdr, Object zcoObj, ZcoView *views, int maxViews)
+{
+	Zco		zco;
+	vast		bytesToSkip;
+	vast		bytesToView;
+	vast		bytesAvbl;
+	Object		obj;
+	SourceExtent	extent;
+	int		viewCount = 0;
+
+	CHKERR(sdr);
+	CHKERR(zcoObj);
+	CHKERR(views);
+	CHKERR(maxViews > 0);
+	sdr_read(sdr, (char *) &zco, zcoObj, sizeof(Zco));
+	bytesToSkip = zco.headersLength;
+	bytesToView = zco.sourceLength;
+	for (obj = zco.firstExtent; obj && bytesToView > 0;
+			obj = extent.nextExtent)
+	{
+		sdr_read(sdr, (char *) &extent, obj, sizeof(SourceExtent));
+		bytesAvbl = extent.length;
+		if (bytesToSkip >= bytesAvbl)
+		{
+			bytesToSkip -= bytesAvbl;
+			continue;	/*	View none of this one.	*/
+		}
+
+		bytesAvbl -= bytesToSkip;
+		if (bytesToView < bytesAvbl)
+		{
+			bytesAvbl = bytesToView;
+		}
+
+		if (viewCount == maxViews)
+		{
+			zco_unmap_views(views, viewCount);
+			return 0;	/*	Too many extents.	*/
+		}
+
+		switch (viewSource(sdr, views + viewCount, &extent,
+				bytesToSkip, bytesAvbl))
+		{
+		case -1:
+			zco_unmap_views(views, viewCount);
+			return -1;
+
+		case 0:
+			zco_unmap_views(views, viewCount);
+			return 0;
+		}
+
+		viewCount++;
+		bytesToSkip = 0;
+		bytesToView -= bytesAvbl;
+	}
+
+	return viewCount;
+}
+
+void	zco_unmap_views(ZcoView *views, int viewCount)
+{
+	int	i;
+
+	CHKVOID(views);
+	for (i = 0; i < viewCount; i++)
+	{
+#ifdef unix
+		if (views[i].mapBase)
+		{
+			oK(munmap(views[i].mapBase, views[i].mapLength));
+		}
+#endif
+		memset((char *) (views + i), 0, sizeof(ZcoView));
+	}
+}
+
 /*	Functions for transmission via underlying protocol layer.	*/
 
 void	zco_start_transmitting(Object zco, ZcoReader *reader)
@@ -32,6 +32,56 @@
 #define SDR_SM_KEY	(255 * 256)
 #define SDR_SM_NAME	"sdrwm"
 
+/*	Size of the buffer, in SDR working memory, in which entries
+ *	destined for a transaction log file are accumulated.		*/
+
+#ifndef SDR_LOG_BUFFER_SIZE
+#define	SDR_LOG_BUFFER_SIZE	(16384)
+#endif
+
+/*	A dataspace that is in a file but not in memory is accessed
+ *	through a shared mapping of the file, where available, rather
+ *	than by lseek and read/write.					*/
+
+#if defined (unix) && !defined (SDR_NO_MMAP)
+#define	SDR_MMAP
+#endif
+
+/*	Capacity of the transaction profile: the number of distinct
+ *	sdr_begin_xn call sites tracked, and the number of buckets in
+ *	each histogram of lock wait and hold times.  Histograms are
+ *	log-linear, with four buckets per power of two microseconds,
+ *	so each bucket spans at most 25% of its lower bound.		*/
+
+#ifndef SDR_PROFILE_SITES
+#define	SDR_PROFILE_SITES	(64)
+#endif
+
+#ifndef SDR_PROFILE_BUCKETS
+#define	SDR_PROFILE_BUCKETS	(96)
+#endif
+
+typedef struct
+{
+	char		sourceFileName[SDR_PROFILE_NAME_LEN];
+	int		lineNbr;		/*	0 = unused.	*/
+	unsigned long	xnCount;
+	unsigned long	writeCount;
+	unsigned long	bytesLogged;
+	uvast		totalWait;		/*	Microseconds.	*/
+	uvast		totalHold;		/*	Microseconds.	*/
+	unsigned long	maxWait;
+	unsigned long	maxHold;
+	unsigned int	waits[SDR_PROFILE_BUCKETS];
+	unsigned int	holds[SDR_PROFILE_BUCKETS];
+} SdrProfileSite;
+
+typedef struct
+{
+	unsigned long	xnsUntracked;		/*	Table full.	*/
+	SdrProfileSite	sites[SDR_PROFILE_SITES];
+} SdrProfile;
+
 /*	The structure of an SDR dataspace (DS) is as follows, where:
 		M = sizeof(SdrMap)
 		D = total size of SDR DS (includes map and heap)
@@ -44,6 +94,18 @@
 
 #define	INITIALIZED	(0x99999999)
 
+/*	Version of the format of an SDR's dataspace: the layout of
+ *	the SdrMap and of the structures that the SDR library itself
+ *	maintains in the heap (lists, hash tables, slabs, arenas,
+ *	unrolled lists).  It must be incremented whenever any of
+ *	these layouts changes.  An SDR whose dataspace persists from
+ *	a different format version can't be loaded and must be
+ *	re-initialized.  Version 1 is the original, unversioned
+ *	format; version 2 added slabs, list arenas, open-addressed
+ *	hash tables, and unrolled lists.				*/
+
+#define	SDR_FORMAT_VERSION	(2)
+
 /*	Memory management abstraction.					*/
 #define MTAKE(size)	allocFromSdrMemory(__FILE__, __LINE__, size)
 #define MRELEASE(addr)	releaseToSdrMemory(__FILE__, __LINE__, addr)
@@ -90,6 +152,38 @@ typedef struct sdr_str
 	int		logLength;		/*	All entries.	*/
 	PsmAddress	logEntries;		/*	Offsets in log.	*/
 
+		/*	Shared read transactions.		*/
+
+	sm_SemId	readSemaphore;		/*	Guards readers.	*/
+	sm_SemId	writeGate;		/*	Holds readers.	*/
+	int		readers;		/*	Sharing lock.	*/
+
+		/*	Buffering of log written to file.	*/
+
+	PsmAddress	logBuffer;		/*	In SDR wm.	*/
+	int		logBuffered;		/*	Not yet in file.*/
+	int		logFlushed;		/*	Already in file.*/
+
+		/*	Undo lines logged in transaction.	*/
+
+	PsmAddress	dirtyLines;		/*	Bitmap in wm.	*/
+	long		firstDirtyLine;
+	long		lastDirtyLine;		/*	-1 if none.	*/
+
+		/*	Group commit of dataspace file.		*/
+
+	sm_SemId	syncSemaphore;
+	unsigned long	xnsCommitted;		/*	Written to file.*/
+	unsigned long	xnsSynced;		/*	Synced to disk.	*/
+
+		/*	Transaction profiling.			*/
+
+	PsmAddress	profile;		/*	0 = disabled	*/
+	int		xnSite;			/*	-1 if none.	*/
+	struct timeval	xnStartTime;
+	unsigned long	xnWrites;
+	unsigned long	xnBytesLogged;
+
 		/*	SDR trace data access.			*/
 
 	int		traceKey;		/*	trace shmKey	*/
@@ -122,6 +216,7 @@ typedef struct	/*	Non-volatile state at front of SDR.		*/
 {
 	Object		catalogue;		/*	partition root	*/
 	unsigned long	status;			/*	INITIALIZED?	*/
+	unsigned long	formatVersion;		/*	See above.	*/
 	long		dsSize;			/*	Map + heap.	*/
 	long		heapSize;
 
@@ -134,6 +229,10 @@ typedef struct	/*	Non-volatile state at front of SDR.		*/
 	Address		endOfLargePool;
 	Address		firstLargeFree[LARGE_ORDERS];
 	long		unassignedSpace;
+
+		/*	Registry of slabs of fixed-size objects.	*/
+
+	Object		firstSlabCache;
 } SdrMap;
 
 /*	SdrView is an object that encapsulates a single process's
@@ -147,6 +246,9 @@ typedef struct sdrv_str
 	SdrState	*sdr;		/*	Local SDR state access.	*/
 
 	int		dsfile;		/*	DS in file (fd).	*/
+	char		*dsmap;		/*	DS file mapped (mmap).	*/
+	Address		dirtyStart;	/*	Written in map in xn.	*/
+	Address		dirtyEnd;
 	char		*dssm;		/*	DS in shared memory.	*/
 	uaddr		dssmId;		/*	DS shmId if applicable.	*/
 
@@ -156,6 +258,8 @@ typedef struct sdrv_str
 
 	Lyst		knownObjects;	/*	ObjectExtents.		*/
 	int		modified;	/*	Boolean.		*/
+	pthread_key_t	readDepthKey;	/*	Read xns in thread.	*/
+	unsigned long	xnToSync;	/*	0 unless group commit.	*/
 
 	PsmView		traceArea;	/*	local access to trace	*/
 	PsmView		*trace;		/*	local access to trace	*/
@@ -163,7 +267,7 @@ typedef struct sdrv_str
 	int		currentSourceFileLine;	/*	for tracing	*/
 } SdrView;
 
-typedef enum { UserPut = 0, SystemPut } PutSrc;
+typedef enum { UserPut = 0, SystemPut, ScratchPut } PutSrc;
 
 extern int		takeSdr(SdrState *sdr);
 extern void		releaseSdr(SdrState *sdr);
@@ -198,6 +302,8 @@ extern void		sdr_read(Sdr, char *, Address, long);
 extern Object		_sdrzalloc(Sdr, unsigned long);
 extern Object		_sdrmalloc(Sdr, unsigned long);
 extern void		_sdrfree(Sdr, Object, PutSrc);
+extern Object		_sdrarenamalloc(Sdr, Object, unsigned long);
+extern void		_sdrarenafree(Sdr, Object, Object, unsigned long);
 #define sdrFree(Obj)	_sdrfree(sdrv, Obj, SystemPut)
 
 extern int		sdrBoundaryViolated(Sdr, Address, long);
@@ -11,153 +11,431 @@
  */
 
 #include "sdrP.h"
-#include "sdrlist.h"
-#include "sdrtable.h"
 #include "sdrhash.h"
 
+/*	An SDR hash table is an array of slots, each of which holds
+ *	one key/value pair inline, searched by linear probing.  When
+ *	the occupied and deleted slots in the array would exceed
+ *	three quarters of the array, a new array is allocated and
+ *	the entries in the old array are moved into it a few at a
+ *	time, in the course of subsequent insertions and removals,
+ *	so that no single transaction bears the whole cost of the
+ *	rehash.  Until the old array is drained, lookups search both
+ *	arrays.								*/
+
+#ifndef SDR_HASH_REHASH_BATCH
+#define	SDR_HASH_REHASH_BATCH	(32)	/*	Old slots per update.	*/
+#endif
+
+#define	MIN_CAPACITY	(16)		/*	Must be a power of 2.	*/
+#define	MAX_CAPACITY	(1 << 30)
+#define	PROBE_WINDOW	(8)		/*	Slots read at once.	*/
+
+#define	SLOT_EMPTY	(0)
+#define	SLOT_FULL	(1)
+#define	SLOT_DELETED	(2)
+
 typedef struct
 {
-	Address	value;
-	char	key[255];
-} KvPair;
+	Address		value;
+	unsigned char	state;
+	char		key[255];
+} HashSlot;
 
-/*	*	*	Table management functions	*	*	*/
+#define	SLOT_LENGTH(keyLength)	((((sizeof(Address) + 1 + (keyLength)) \
++ sizeof(Address) - 1) / sizeof(Address)) * sizeof(Address))
 
-Object	Sdr_hash_create(const char *file, int line, Sdr sdrv, int keyLength,
-		int estNbrOfEntries, int meanSearchLength)
+#define	STATE_OFFSET	(sizeof(Address))
+
+typedef struct
 {
-	/*	Each row of an SDR hash table contains a linked list of 
- 	*	key/value pairs.  Given a key, we look up the corresponding
- 	*	value by hashing from the key to a row number and then
- 	*	searching through the key/value pairs in the linked list at
- 	*	that row.  Minimizing the lengths of the lists in the table
- 	*	minimizes lookup time, but in so doing it either increases
- 	*	the number of rows in the table (increasing the table's fixed
- 	*	size) or limits the number of entries.  We try to strike a
- 	*	balance by computing the number of rows automatically from
- 	*	A = the estimated total number of entries in the table and
- 	*	B = the desired mean list length:
- 	*
- 	*		1.	Raw preferred row count C = A / B.
- 	*
- 	*		2.	Actual row count must be a prime number
- 	*			in order for the hash function to work
- 	*			properly, so search the hash dimensions
- 	*			table for the smallest row count that is
- 	*			greater than or equal to C.		*/
-
-	static const int	hashDimensions[] =
-			{ 71, 131, 257, 521, 1031, 2053, 4099, 8209, 16411 };
-
-	/*	Each of the predefined possible hash table dimensions is the
- 	*	smallest prime number greater than some power of 2, starting
- 	*	with 2**6 = 64.  16411 is the maximum hash table dimension,
- 	*	used for any value of C that is greater than 8209; on a 32-bit
- 	*	machine, this limit assures that the table itself (excluding
- 	*	the lists at its rows) will occupy no more than 65644 bytes
- 	*	plus the table header size.				*/
-
-	int	rawRowCount;
-	int	i;
-	int	rowCount;
-	Object	table;
-	Address	rowAddr;
-	Object	listAddr;
+	int	keyLength;
+	int	slotLength;
+	int	minCapacity;
+	int	capacity;	/*	Slots in current array.		*/
+	int	count;		/*	Entries in current array.	*/
+	int	tombstones;	/*	Deleted slots in current array.	*/
+	Object	slots;		/*	Current array.			*/
+	int	oldCapacity;	/*	Zero unless rehash in progress.	*/
+	int	oldCount;	/*	Entries not yet rehashed.	*/
+	Object	oldSlots;	/*	Array being drained.		*/
+	int	rehashed;	/*	Old slots already drained.	*/
+	int	resizes;	/*	Since creation.			*/
+} SdrHash;
+
+/*	*	*	Slot array management functions	*	*	*/
+
+static unsigned int	hashKey(char *key, int keyLength)
+{
+	unsigned int	h = 2166136261U;	/*	FNV-1a		*/
+	int		i;
 
-	if (!(sdr_in_xn(sdrv)))
+	for (i = 0; i < keyLength; i++)
 	{
-		oK(_iEnd(file, line, _notInXnMsg()));
-		return 0;
+		h ^= (unsigned char) key[i];
+		h *= 16777619U;
 	}
 
-	joinTrace(sdrv, file, line);
-	if (keyLength < 1 || keyLength > 255 || meanSearchLength < 1)
+	/*	Mix the high-order bits down, because the slot number
+	 *	is taken from the low-order bits.			*/
+
+	h ^= h >> 16;
+	h *= 0x85ebca6bU;
+	h ^= h >> 13;
+	h *= 0xc2b2ae35U;
+	h ^= h >> 16;
+	return h;
+}
+
+static Object	createSlots(const char *file, int line, Sdr sdrv,
+			int capacity, int slotLength)
+{
+	char	zeroes[1024];
+	long	length = (long) capacity * slotLength;
+	Object	slots;
+	long	offset;
+	long	chunk;
+
+	slots = _sdrmalloc(sdrv, length);
+	if (slots == 0)
 	{
-		oK(_xniEnd(file, line, _apiErrMsg(), sdrv));
+		oK(_iEnd(file, line, "slots"));
 		return 0;
 	}
 
-	rawRowCount = estNbrOfEntries / meanSearchLength;
-	i = 0;
-	while (1)
+	memset(zeroes, 0, sizeof zeroes);
+	for (offset = 0; offset < length; offset += chunk)
 	{
-		rowCount = hashDimensions[i];
-		i++;
-		if (rowCount <= rawRowCount
-		&& i < (sizeof hashDimensions / sizeof(int)))
+		chunk = length - offset;
+		if (chunk > sizeof zeroes)
 		{
-			continue;
+			chunk = sizeof zeroes;
 		}
 
-		break;
+		_sdrput(file, line, sdrv, slots + offset, zeroes, chunk,
+				SystemPut);
 	}
 
-	table = Sdr_table_create(file, line, sdrv, sizeof(Object), rowCount);
-	if (table == 0)
+	return slots;
+}
+
+/*	Searches one slot array for the key.  If the key is found,
+ *	returns 1 and notes the slot number and the slot's content.
+ *	Otherwise returns 0 and notes the number and state (empty or
+ *	deleted) of the slot at which the key could be inserted.	*/
+
+static int	findSlot(Sdr sdrv, SdrHash *hash, Object slots, int capacity,
+			char *key, int *slotNbr, HashSlot *slot)
+{
+	char		window[PROBE_WINDOW * sizeof(HashSlot)];
+	int		mask = capacity - 1;
+	int		i = hashKey(key, hash->keyLength) & mask;
+	int		vacancy = -1;
+	int		probes = 0;
+	int		windowSlots;
+	int		j;
+	HashSlot	*candidate;
+
+	while (probes < capacity)
 	{
-		oK(_iEnd(file, line, itoa(rowCount)));
-		return 0;
+		windowSlots = capacity - i;
+		if (windowSlots > PROBE_WINDOW)
+		{
+			windowSlots = PROBE_WINDOW;
+		}
+
+		sdr_read(sdrv, window, slots + ((Address) i * hash->slotLength),
+				windowSlots * hash->slotLength);
+		for (j = 0; j < windowSlots; j++, i++, probes++)
+		{
+			candidate = (HashSlot *) (window
+					+ (j * hash->slotLength));
+			switch (candidate->state)
+			{
+			case SLOT_EMPTY:
+				if (vacancy < 0)
+				{
+					*slotNbr = i;
+					slot->state = SLOT_EMPTY;
+				}
+				else
+				{
+					*slotNbr = vacancy;
+					slot->state = SLOT_DELETED;
+				}
+
+				return 0;
+
+			case SLOT_DELETED:
+				if (vacancy < 0)
+				{
+					vacancy = i;
+				}
+
+				continue;
+
+			default:
+				if (memcmp(candidate->key, key,
+						hash->keyLength) == 0)
+				{
+					*slotNbr = i;
+					memcpy((char *) slot,
+							(char *) candidate,
+							hash->slotLength);
+					return 1;
+				}
+			}
+		}
+
+		i &= mask;
 	}
 
-	/*	Save key length for hash function.			*/
+	*slotNbr = vacancy;
+	slot->state = SLOT_DELETED;
+	return 0;
+}
+
+static void	putSlot(const char *file, int line, Sdr sdrv, SdrHash *hash,
+			Object slots, int slotNbr, HashSlot *slot)
+{
+	_sdrput(file, line, sdrv, slots + ((Address) slotNbr
+			* hash->slotLength), (char *) slot, hash->slotLength,
+			SystemPut);
+}
+
+/*	Removes the entry at the indicated slot.  A slot that is
+ *	followed by an empty slot can itself be made empty, since
+ *	no probe sequence can pass through it; any other slot must
+ *	be marked deleted.  Returns 1 if the slot was marked deleted.	*/
 
-	Sdr_table_user_data_set(file, line, sdrv, table, (Address) keyLength);
+static int	clearSlot(const char *file, int line, Sdr sdrv, SdrHash *hash,
+			Object slots, int capacity, int slotNbr)
+{
+	unsigned char	state;
+	int		nextSlotNbr = (slotNbr + 1) & (capacity - 1);
+
+	sdr_read(sdrv, (char *) &state, slots + ((Address) nextSlotNbr
+			* hash->slotLength) + STATE_OFFSET, 1);
+	state = (state == SLOT_EMPTY ? SLOT_EMPTY : SLOT_DELETED);
+	_sdrput(file, line, sdrv, slots + ((Address) slotNbr
+			* hash->slotLength) + STATE_OFFSET, (char *) &state, 1,
+			SystemPut);
+	return (state == SLOT_DELETED);
+}
 
-	/*	Create linked lists for all rows of the hash table.	*/
+/*	Moves up to "limit" slots' worth of entries from the old
+ *	array into the current array, freeing the old array once
+ *	it is drained.							*/
 
-	for (i = 0; i < rowCount; i++)
+static void	rehashSlots(const char *file, int line, Sdr sdrv,
+			SdrHash *hash, int limit)
+{
+	char		window[PROBE_WINDOW * sizeof(HashSlot)];
+	int		windowSlots;
+	int		j;
+	HashSlot	*slot;
+	HashSlot	found;
+	int		slotNbr;
+	unsigned char	state = SLOT_DELETED;
+
+	while (hash->oldSlots && limit > 0)
 	{
-		rowAddr = sdr_table_row(sdrv, table, i);
-		listAddr = Sdr_list_create(file, line, sdrv);
-		if (listAddr == 0)
+		windowSlots = hash->oldCapacity - hash->rehashed;
+		if (windowSlots > PROBE_WINDOW)
 		{
-			oK(_iEnd(file, line, "listAddr"));
-			return 0;
+			windowSlots = PROBE_WINDOW;
 		}
 
-		_sdrput(file, line, sdrv, rowAddr, (char *) &listAddr,
-				sizeof(Object), SystemPut);
+		if (windowSlots > limit)
+		{
+			windowSlots = limit;
+		}
+
+		sdr_read(sdrv, window, hash->oldSlots + ((Address)
+				hash->rehashed * hash->slotLength),
+				windowSlots * hash->slotLength);
+		for (j = 0; j < windowSlots; j++)
+		{
+			slot = (HashSlot *) (window + (j * hash->slotLength));
+			if (slot->state != SLOT_FULL)
+			{
+				continue;
+			}
+
+			oK(findSlot(sdrv, hash, hash->slots, hash->capacity,
+					slot->key, &slotNbr, &found));
+			if (found.state == SLOT_DELETED)
+			{
+				hash->tombstones--;
+			}
+
+			putSlot(file, line, sdrv, hash, hash->slots, slotNbr,
+					slot);
+			hash->count++;
+			hash->oldCount--;
+
+			/*	Lookups in the old array must no longer
+			 *	find the entry.				*/
+
+			_sdrput(file, line, sdrv, hash->oldSlots + ((Address)
+					(hash->rehashed + j) * hash->slotLength)
+					+ STATE_OFFSET, (char *) &state, 1,
+					SystemPut);
+		}
+
+		hash->rehashed += windowSlots;
+		limit -= windowSlots;
+		if (hash->rehashed == hash->oldCapacity)
+		{
+			sdrFree(hash->oldSlots);
+			hash->oldSlots = 0;
+			hash->oldCapacity = 0;
+			hash->oldCount = 0;
+			hash->rehashed = 0;
+		}
+	}
+}
+
+/*	Replaces the current array with a new one that has room for
+ *	twice the number of entries in the table.  The entries in
+ *	the old array are moved into the new array incrementally.	*/
+
+static int	resizeTable(const char *file, int line, Sdr sdrv,
+			SdrHash *hash)
+{
+	int	newCapacity = hash->minCapacity;
+	Object	newSlots;
+
+	/*	Finish any rehash that is already in progress.		*/
+
+	rehashSlots(file, line, sdrv, hash, hash->oldCapacity);
+	while (newCapacity < MAX_CAPACITY
+	&& newCapacity < 4 * (hash->count + 1))
+	{
+		newCapacity <<= 1;
+	}
+
+	newSlots = createSlots(file, line, sdrv, newCapacity,
+			hash->slotLength);
+	if (newSlots == 0)
+	{
+		return -1;
 	}
 
-	return table;
+	hash->oldSlots = hash->slots;
+	hash->oldCapacity = hash->capacity;
+	hash->oldCount = hash->count;
+	hash->rehashed = 0;
+	hash->slots = newSlots;
+	hash->capacity = newCapacity;
+	hash->count = 0;
+	hash->tombstones = 0;
+	hash->resizes++;
+	return 0;
 }
 
-static int	computeRowNbr(int rowCount, int keyLength, char *key)
+/*	Locates the key in whichever array it currently resides in.	*/
+
+static Object	locateEntry(Sdr sdrv, SdrHash *hash, char *key, int *slotNbr,
+			HashSlot *slot)
 {
-	int		i;
-	unsigned int	h = 0;
-	unsigned int	g;
+	if (findSlot(sdrv, hash, hash->slots, hash->capacity, key, slotNbr,
+			slot))
+	{
+		return hash->slots;
+	}
 
-	for (i = 0; i < keyLength; i++, key++)
+	if (hash->oldSlots && findSlot(sdrv, hash, hash->oldSlots,
+			hash->oldCapacity, key, slotNbr, slot))
 	{
-		h = (h << 4) + *key;
-		g = h & 0xf0000000;
-		if (g)
-		{
-			h ^= g >> 24;
-		}
+		return hash->oldSlots;
+	}
+
+	return 0;
+}
 
-		h &= ~g;
+static void	removeEntry(const char *file, int line, Sdr sdrv,
+			SdrHash *hash, Object slots, int slotNbr)
+{
+	if (slots == hash->slots)
+	{
+		hash->tombstones += clearSlot(file, line, sdrv, hash, slots,
+				hash->capacity, slotNbr);
+		hash->count--;
 	}
+	else
+	{
+		oK(clearSlot(file, line, sdrv, hash, slots, hash->oldCapacity,
+				slotNbr));
+		hash->oldCount--;
+	}
+}
 
-	return h % rowCount;
+/*	*	*	Table management functions	*	*	*/
+
+Object	Sdr_hash_create(const char *file, int line, Sdr sdrv, int keyLength,
+		int estNbrOfEntries, int meanSearchLength)
+{
+	/*	The table is initially sized to hold the estimated
+	 *	number of entries at a load factor of no more than
+	 *	one half, and it grows as necessary thereafter.  At
+	 *	the maximum load factor of three quarters, the mean
+	 *	number of slots examined by a successful search is
+	 *	2.5, so meanSearchLength is only validated.		*/
+
+	SdrHash	hashBuf;
+	Object	hash;
+
+	if (!(sdr_in_xn(sdrv)))
+	{
+		oK(_iEnd(file, line, _notInXnMsg()));
+		return 0;
+	}
+
+	joinTrace(sdrv, file, line);
+	if (keyLength < 1 || keyLength > 255 || meanSearchLength < 1)
+	{
+		oK(_xniEnd(file, line, _apiErrMsg(), sdrv));
+		return 0;
+	}
+
+	memset((char *) &hashBuf, 0, sizeof(SdrHash));
+	hashBuf.keyLength = keyLength;
+	hashBuf.slotLength = SLOT_LENGTH(keyLength);
+	hashBuf.minCapacity = MIN_CAPACITY;
+	while (hashBuf.minCapacity < MAX_CAPACITY
+	&& hashBuf.minCapacity / 2 < estNbrOfEntries)
+	{
+		hashBuf.minCapacity <<= 1;
+	}
+
+	hashBuf.capacity = hashBuf.minCapacity;
+	hashBuf.slots = createSlots(file, line, sdrv, hashBuf.capacity,
+			hashBuf.slotLength);
+	if (hashBuf.slots == 0)
+	{
+		return 0;
+	}
+
+	hash = _sdrzalloc(sdrv, sizeof(SdrHash));
+	if (hash == 0)
+	{
+		oK(_iEnd(file, line, "hash"));
+		return 0;
+	}
+
+	sdrPut((Address) hash, hashBuf);
+	return hash;
 }
 
 int	Sdr_hash_insert(const char *file, int line, Sdr sdrv, Object hash,
 		char *key, Address value, Object *entry)
 {
-	int	keyLength;
-	int	kvpairLength;
-	int	rowSize;
-	int	rowCount;
-	int	rowNbr;
-	Address	rowAddr;
-	Object	listAddr;
-	Object	elt;
-	Object	kvpairAddr;
-	KvPair	kvpair;
-	int	result;
-	Object	hashElt;
+	SdrHash		hashBuf;
+	HashSlot	slot;
+	int		slotNbr;
+	HashSlot	oldSlot;
+	int		oldSlotNbr;
 
 	if (entry)
 	{
@@ -177,71 +455,56 @@ int	Sdr_hash_insert(const char *file, int line, Sdr sdrv, Object hash,
 		return -1;
 	}
 
-	keyLength = sdr_table_user_data(sdrv, hash);
-	kvpairLength = sizeof(Address) + keyLength;
-	sdr_table_dimensions(sdrv, hash, &rowSize, &rowCount);
-	rowNbr = computeRowNbr(rowCount, keyLength, key);
-	rowAddr = sdr_table_row(sdrv, hash, rowNbr);
-	sdr_read(sdrv, (char *) &listAddr, rowAddr, sizeof(Object));
-	for (elt = sdr_list_first(sdrv, listAddr); elt;
-			elt = sdr_list_next(sdrv, elt))
+	sdrFetch(hashBuf, (Address) hash);
+	rehashSlots(file, line, sdrv, &hashBuf, SDR_HASH_REHASH_BATCH);
+	if (findSlot(sdrv, &hashBuf, hashBuf.slots, hashBuf.capacity, key,
+			&slotNbr, &slot)
+	|| (hashBuf.oldSlots && findSlot(sdrv, &hashBuf, hashBuf.oldSlots,
+			hashBuf.oldCapacity, key, &oldSlotNbr, &oldSlot)))
 	{
-		kvpairAddr = sdr_list_data(sdrv, elt);
-		sdr_read(sdrv, (char *) &kvpair, kvpairAddr, kvpairLength);
-		result = memcmp(kvpair.key, key, keyLength);
-		if (result < 0)
-		{
-			continue;
-		}
-
-		if (result > 0)
-		{
-			break;	/*	Insert before this entry.	*/
-		}
-
+		sdrPut((Address) hash, hashBuf);
 		return 0;	/*	Duplicate key, can't insert.	*/
 	}
 
-	kvpairAddr = Sdr_malloc(file, line, sdrv, kvpairLength);
-	if (kvpairAddr == 0)
+	if (4 * (hashBuf.count + hashBuf.tombstones + 1)
+			> 3 * hashBuf.capacity)
 	{
-		oK(_iEnd(file, line, "kvpairAddr"));
-		return -1;
-	}
+		if (resizeTable(file, line, sdrv, &hashBuf) < 0)
+		{
+			oK(_iEnd(file, line, "resize"));
+			return -1;
+		}
 
-	kvpair.value = value;
-	memcpy(kvpair.key, key, keyLength);
-	_sdrput(file, line, sdrv, kvpairAddr, (char *) &kvpair, kvpairLength,
-			SystemPut);
-	if (elt)
-	{
-		hashElt = Sdr_list_insert_before(file, line, sdrv, elt,
-				kvpairAddr);
-	}
-	else
-	{
-		hashElt = Sdr_list_insert_last(file, line, sdrv, listAddr,
-				kvpairAddr);
+		oK(findSlot(sdrv, &hashBuf, hashBuf.slots, hashBuf.capacity,
+				key, &slotNbr, &slot));
 	}
 
-	if (hashElt == 0)
+	if (slot.state == SLOT_DELETED)
 	{
-		oK(_iEnd(file, line, "elt"));
-		return -1;
+		hashBuf.tombstones--;
 	}
 
+	memset((char *) &slot, 0, hashBuf.slotLength);
+	slot.value = value;
+	slot.state = SLOT_FULL;
+	memcpy(slot.key, key, hashBuf.keyLength);
+	putSlot(file, line, sdrv, &hashBuf, hashBuf.slots, slotNbr, &slot);
+	hashBuf.count++;
+	sdrPut((Address) hash, hashBuf);
 	if (entry)
 	{
-		*entry = hashElt;
+		*entry = hashBuf.slots + ((Address) slotNbr
+				* hashBuf.slotLength);
 	}
 
 	return 1;		/*	Succeeded.			*/
 }
 
 int	Sdr_hash_delete_entry(const char *file, int line, Sdr sdrv,
-		Object entry)
+		Object hash, Object entry)
 {
-	Object	kvpairAddr;
+	SdrHash	hashBuf;
+	Object	slots;
 
 	if (!(sdr_in_xn(sdrv)))
 	{
@@ -250,48 +513,53 @@ int	Sdr_hash_delete_entry(const char *file, int line, Sdr sdrv,
 	}
 
 	joinTrace(sdrv, file, line);
-	if (entry == 0)
+	if (hash == 0 || entry == 0)
 	{
 		oK(_xniEnd(file, line, _apiErrMsg(), sdrv));
 		return -1;
 	}
 
-	kvpairAddr = sdr_list_data(sdrv, entry);
-	Sdr_free(file, line, sdrv, kvpairAddr);
-	Sdr_list_delete(file, line, sdrv, entry, NULL, NULL);
+	sdrFetch(hashBuf, (Address) hash);
+	if (entry >= hashBuf.slots && entry < hashBuf.slots
+			+ ((Address) hashBuf.capacity * hashBuf.slotLength))
+	{
+		slots = hashBuf.slots;
+	}
+	else if (hashBuf.oldSlots && entry >= hashBuf.oldSlots
+			&& entry < hashBuf.oldSlots + ((Address)
+			hashBuf.oldCapacity * hashBuf.slotLength))
+	{
+		slots = hashBuf.oldSlots;
+	}
+	else
+	{
+		oK(_xniEnd(file, line, "entry", sdrv));
+		return -1;
+	}
+
+	removeEntry(file, line, sdrv, &hashBuf, slots,
+			(entry - slots) / hashBuf.slotLength);
+	sdrPut((Address) hash, hashBuf);
 	return 1;
 }
 
 Address	sdr_hash_entry_value(Sdr sdrv, Object hash, Object entry)
 {
-	int	keyLength;
-	int	kvpairLength;
-	Object	kvpairAddr;
-	KvPair	kvpair;
+	Address	value;
 
 	CHKERR(sdrFetchSafe(sdrv));
 	CHKERR(entry);
-	keyLength = sdr_table_user_data(sdrv, hash);
-	kvpairLength = sizeof(Address) + keyLength;
-	kvpairAddr = sdr_list_data(sdrv, entry);
-	sdr_read(sdrv, (char *) &kvpair, kvpairAddr, kvpairLength);
-	return kvpair.value;
+	sdr_read(sdrv, (char *) &value, entry, sizeof(Address));
+	return value;
 }
 
 int	sdr_hash_retrieve(Sdr sdrv, Object hash, char *key, Address *value,
 		Object *entry)
 {
-	int		keyLength;
-	int		kvpairLength;
-	int		rowSize;
-	int		rowCount;
-	int		rowNbr;
-	Address		rowAddr;
-	Object		listAddr;
-	Object		elt;
-	Address		kvpairAddr;
-	KvPair		kvpair;
-	int		result;
+	SdrHash		hashBuf;
+	HashSlot	slot;
+	int		slotNbr;
+	Object		slots;
 
 	if (entry)
 	{
@@ -302,125 +570,94 @@ int	sdr_hash_retrieve(Sdr sdrv, Object hash, char *key, Address *value,
 	CHKERR(hash);
 	CHKERR(key);
 	CHKERR(value);
-	keyLength = sdr_table_user_data(sdrv, hash);
-	kvpairLength = sizeof(Address) + keyLength;
-	sdr_table_dimensions(sdrv, hash, &rowSize, &rowCount);
-	rowNbr = computeRowNbr(rowCount, keyLength, key);
-	rowAddr = sdr_table_row(sdrv, hash, rowNbr);
-	sdr_read(sdrv, (char *) &listAddr, rowAddr, sizeof(Object));
-	for (elt = sdr_list_first(sdrv, listAddr); elt;
-			elt = sdr_list_next(sdrv, elt))
-	{
-		kvpairAddr = sdr_list_data(sdrv, elt);
-		sdr_read(sdrv, (char *) &kvpair, kvpairAddr, kvpairLength);
-		result = memcmp(kvpair.key, key, keyLength);
-		if (result < 0)
-		{
-			continue;
-		}
-
-		if (result > 0)
-		{
-			break;	/*	Not found.			*/
-		}
-
-		*value = kvpair.value;
-		if (entry)
-		{
-			*entry = elt;
-		}
+	sdrFetch(hashBuf, (Address) hash);
+	slots = locateEntry(sdrv, &hashBuf, key, &slotNbr, &slot);
+	if (slots == 0)
+	{
+		return 0;	/*	Unable to retrieve value.	*/
+	}
 
-		return 1;	/*	Got it.				*/
+	*value = slot.value;
+	if (entry)
+	{
+		*entry = slots + ((Address) slotNbr * hashBuf.slotLength);
 	}
 
-	return 0;		/*	Unable to retrieve value.	*/
+	return 1;		/*	Got it.				*/
 }
 
 int	sdr_hash_count(Sdr sdrv, Object hash)
 {
-	int	count = 0;
-	int	rowSize;
-	int	rowCount;
-	int	i;
-	Address	rowAddr;
-	Object	listAddr;
+	SdrHash	hashBuf;
 
 	CHKERR(sdrv);
 	CHKERR(hash);
-	sdr_table_dimensions(sdrv, hash, &rowSize, &rowCount);
-	for (i = 0; i < rowCount; i++)
+	sdrFetch(hashBuf, (Address) hash);
+	return hashBuf.count + hashBuf.oldCount;
+}
+
+static void	applyToSlots(Sdr sdrv, Object hash, SdrHash *hashBuf,
+			Object slots, int capacity,
+			sdr_hash_callback callback, void *args)
+{
+	char		window[PROBE_WINDOW * sizeof(HashSlot)];
+	int		i;
+	int		windowSlots;
+	int		j;
+	HashSlot	*slot;
+
+	for (i = 0; i < capacity; i += windowSlots)
 	{
-		rowAddr = sdr_table_row(sdrv, hash, i);
-		sdr_read(sdrv, (char *) &listAddr, rowAddr, sizeof(Object));
-		count += sdr_list_length(sdrv, listAddr);
-	}
+		windowSlots = capacity - i;
+		if (windowSlots > PROBE_WINDOW)
+		{
+			windowSlots = PROBE_WINDOW;
+		}
 
-	return count;
+		sdr_read(sdrv, window, slots + ((Address) i
+				* hashBuf->slotLength),
+				windowSlots * hashBuf->slotLength);
+		for (j = 0; j < windowSlots; j++)
+		{
+			slot = (HashSlot *) (window
+					+ (j * hashBuf->slotLength));
+			if (slot->state == SLOT_FULL)
+			{
+				callback(sdrv, hash, slot->key, slot->value,
+						args);
+			}
+		}
+	}
 }
 
 int	sdr_hash_foreach(Sdr sdrv, Object hash, sdr_hash_callback callback,
 		void *args)
 {
-	int		keyLength;
-	int		kvpairLength;
-	int		rowSize;
-	int		rowCount;
-	int		rowNbr;
-	Address		rowAddr;
-	Object		listAddr;
-	Object		elt;
-	Object		kvpairAddr;
-	KvPair		kvpair;
+	SdrHash	hashBuf;
 
 	CHKERR(sdrFetchSafe(sdrv));
 	CHKERR(hash);
 	CHKERR(callback);
 	//Passing NULL args is OK (passed through to callback)
-	keyLength = sdr_table_user_data(sdrv, hash);
-	kvpairLength = sizeof(Address) + keyLength;
-	sdr_table_dimensions(sdrv, hash, &rowSize, &rowCount);
-
-	/*	Iterate over each row/bucket, loading the sdrlist
-	 *	of members of each.					*/
-
-	for (rowNbr = 0; rowNbr < rowCount; rowNbr++)
+	sdrFetch(hashBuf, (Address) hash);
+	if (hashBuf.oldSlots)
 	{
-		rowAddr = sdr_table_row(sdrv, hash, rowNbr);
-		sdr_read(sdrv, (char *) &listAddr, rowAddr, sizeof(Object));
-
-		/*	Iterate over each member of this bucket.	*/
-
-		for (elt = sdr_list_first(sdrv, listAddr); elt;
-				elt = sdr_list_next(sdrv, elt))
-		{
-			kvpairAddr = sdr_list_data(sdrv, elt);
-			sdr_read(sdrv, (char *) &kvpair, kvpairAddr,
-					kvpairLength);
-
-			/*	Call the callback passed to us with
-			 *	the key, value pair.			*/
-
-			callback(sdrv, hash, kvpair.key, kvpair.value, args);
-		}
+		applyToSlots(sdrv, hash, &hashBuf, hashBuf.oldSlots,
+				hashBuf.oldCapacity, callback, args);
 	}
 
+	applyToSlots(sdrv, hash, &hashBuf, hashBuf.slots, hashBuf.capacity,
+			callback, args);
 	return 0;
 }
 
 int	Sdr_hash_revise(const char *file, int line, Sdr sdrv, Object hash,
 		char *key, Address value)
 {
-	int	keyLength;
-	int	kvpairLength;
-	int	rowSize;
-	int	rowCount;
-	int	rowNbr;
-	Address	rowAddr;
-	Object	listAddr;
-	Object	elt;
-	Object	kvpairAddr;
-	KvPair	kvpair;
-	int	result;
+	SdrHash		hashBuf;
+	HashSlot	slot;
+	int		slotNbr;
+	Object		slots;
 
 	if (!(sdr_in_xn(sdrv)))
 	{
@@ -435,51 +672,27 @@ int	Sdr_hash_revise(const char *file, int line, Sdr sdrv, Object hash,
 		return -1;
 	}
 
-	keyLength = sdr_table_user_data(sdrv, hash);
-	kvpairLength = sizeof(Address) + keyLength;
-	sdr_table_dimensions(sdrv, hash, &rowSize, &rowCount);
-	rowNbr = computeRowNbr(rowCount, keyLength, key);
-	rowAddr = sdr_table_row(sdrv, hash, rowNbr);
-	sdr_read(sdrv, (char *) &listAddr, rowAddr, sizeof(Object));
-	for (elt = sdr_list_first(sdrv, listAddr); elt;
-			elt = sdr_list_next(sdrv, elt))
+	sdrFetch(hashBuf, (Address) hash);
+	slots = locateEntry(sdrv, &hashBuf, key, &slotNbr, &slot);
+	if (slots == 0)
 	{
-		kvpairAddr = sdr_list_data(sdrv, elt);
-		sdr_read(sdrv, (char *) &kvpair, kvpairAddr, kvpairLength);
-		result = memcmp(kvpair.key, key, keyLength);
-		if (result < 0)
-		{
-			continue;
-		}
-
-		if (result > 0)
-		{
-			break;	/*	Not found.			*/
-		}
-
-		kvpair.value = value;
-		_sdrput(file, line, sdrv, kvpairAddr, (char *) &kvpair,
-				kvpairLength, SystemPut);
-		return 1;	/*	Succeeded.			*/
+		return 0;	/*	Unable to revise value.		*/
 	}
 
-	return 0;		/*	Unable to revise value.		*/
+	_sdrput(file, line, sdrv, slots + ((Address) slotNbr
+			* hashBuf.slotLength), (char *) &value,
+			sizeof(Address), SystemPut);
+	return 1;		/*	Succeeded.			*/
 }
 
 int	Sdr_hash_remove(const char *file, int line, Sdr sdrv, Object hash,
 		char *key, Address *value)
 {
-	int	keyLength;
-	int	kvpairLength;
-	int	rowSize;
-	int	rowCount;
-	int	rowNbr;
-	Address	rowAddr;
-	Object	listAddr;
-	Object	elt;
-	Object	kvpairAddr;
-	KvPair	kvpair;
-	int	result;
+	SdrHash		hashBuf;
+	HashSlot	slot;
+	int		slotNbr;
+	Object		slots;
+	int		result = 0;
 
 	if (!(sdr_in_xn(sdrv)))
 	{
@@ -494,53 +707,27 @@ int	Sdr_hash_remove(const char *file, int line, Sdr sdrv, Object hash,
 		return -1;
 	}
 
-	keyLength = sdr_table_user_data(sdrv, hash);
-	kvpairLength = sizeof(Address) + keyLength;
-	sdr_table_dimensions(sdrv, hash, &rowSize, &rowCount);
-	rowNbr = computeRowNbr(rowCount, keyLength, key);
-	rowAddr = sdr_table_row(sdrv, hash, rowNbr);
-	sdr_read(sdrv, (char *) &listAddr, rowAddr, sizeof(Object));
-	for (elt = sdr_list_first(sdrv, listAddr); elt;
-			elt = sdr_list_next(sdrv, elt))
+	sdrFetch(hashBuf, (Address) hash);
+	rehashSlots(file, line, sdrv, &hashBuf, SDR_HASH_REHASH_BATCH);
+	slots = locateEntry(sdrv, &hashBuf, key, &slotNbr, &slot);
+	if (slots)
 	{
-		kvpairAddr = sdr_list_data(sdrv, elt);
-		sdr_read(sdrv, (char *) &kvpair, kvpairAddr, kvpairLength);
-		result = memcmp(kvpair.key, key, keyLength);
-		if (result < 0)
-		{
-			continue;
-		}
-
-		if (result > 0)
-		{
-			break;	/*	Not found.			*/
-		}
-
 		if (value)
 		{
-			*value = kvpair.value;
+			*value = slot.value;
 		}
 
-		Sdr_free(file, line, sdrv, kvpairAddr);
-		Sdr_list_delete(file, line, sdrv, elt, NULL, NULL);
-		return 1;	/*	Succeeded.			*/
+		removeEntry(file, line, sdrv, &hashBuf, slots, slotNbr);
+		result = 1;
 	}
 
-	return 0;		/*	Unable to remove entry.		*/
-}
-
-static void	deleteHashEntry(Sdr sdrv, Object eltData, void *arg)
-{
-	sdr_free(sdrv, eltData);
+	sdrPut((Address) hash, hashBuf);
+	return result;
 }
 
 void	Sdr_hash_destroy(const char *file, int line, Sdr sdrv, Object hash)
 {
-	int	rowSize;
-	int	rowCount;
-	int	i;
-	Address	rowAddr;
-	Object	listAddr;
+	SdrHash	hashBuf;
 
 	if (!(sdr_in_xn(sdrv)))
 	{
@@ -555,14 +742,76 @@ void	Sdr_hash_destroy(const char *file, int line, Sdr sdrv, Object hash)
 		return;
 	}
 
-	sdr_table_dimensions(sdrv, hash, &rowSize, &rowCount);
-	for (i = 0; i < rowCount; i++)
+	sdrFetch(hashBuf, (Address) hash);
+	if (hashBuf.oldSlots)
 	{
-		rowAddr = sdr_table_row(sdrv, hash, i);
-		sdr_read(sdrv, (char *) &listAddr, rowAddr, sizeof(Object));
-		Sdr_list_destroy(file, line, sdrv, listAddr, deleteHashEntry,
-				NULL);
+		sdrFree(hashBuf.oldSlots);
 	}
 
-	Sdr_table_destroy(file, line, sdrv, hash);
+	sdrFree(hashBuf.slots);
+	sdrFree(hash);
+}
+
+void	sdr_hash_usage(Sdr sdrv, Object hash, SdrHashSummary *summary)
+{
+	SdrHash		hashBuf;
+	char		window[PROBE_WINDOW * sizeof(HashSlot)];
+	int		mask;
+	int		i;
+	int		windowSlots;
+	int		j;
+	HashSlot	*slot;
+	int		probeLength;
+	double		totalProbeLength = 0.0;
+
+	CHKVOID(sdrFetchSafe(sdrv));
+	CHKVOID(hash);
+	CHKVOID(summary);
+	memset((char *) summary, 0, sizeof(SdrHashSummary));
+	sdrFetch(hashBuf, (Address) hash);
+	summary->entries = hashBuf.count + hashBuf.oldCount;
+	summary->capacity = hashBuf.capacity;
+	summary->tombstones = hashBuf.tombstones;
+	summary->loadFactor = (100.0 * (hashBuf.count + hashBuf.tombstones))
+			/ hashBuf.capacity;
+	summary->rehashPending = hashBuf.oldCount;
+	summary->resizes = hashBuf.resizes;
+
+	/*	Probe length of an entry in the current array is the
+	 *	number of slots a successful search examines.		*/
+
+	mask = hashBuf.capacity - 1;
+	for (i = 0; i < hashBuf.capacity; i += windowSlots)
+	{
+		windowSlots = hashBuf.capacity - i;
+		if (windowSlots > PROBE_WINDOW)
+		{
+			windowSlots = PROBE_WINDOW;
+		}
+
+		sdr_read(sdrv, window, hashBuf.slots + ((Address) i
+				* hashBuf.slotLength),
+				windowSlots * hashBuf.slotLength);
+		for (j = 0; j < windowSlots; j++)
+		{
+			slot = (HashSlot *) (window + (j * hashBuf.slotLength));
+			if (slot->state != SLOT_FULL)
+			{
+				continue;
+			}
+
+			probeLength = (((i + j) - hashKey(slot->key,
+					hashBuf.keyLength)) & mask) + 1;
+			totalProbeLength += probeLength;
+			if (probeLength > summary->maxProbes)
+			{
+				summary->maxProbes = probeLength;
+			}
+		}
+	}
+
+	if (hashBuf.count > 0)
+	{
+		summary->meanProbes = totalProbeLength / hashBuf.count;
+	}
 }
@@ -24,12 +24,19 @@
 
 /*		Private definitions of SDR list structures.		*/
 
+/*	Note that the arena field enlarges the list header.  Any
+ *	change to the layout of these structures must be accompanied
+ *	by an increment of SDR_FORMAT_VERSION (sdrP.h), so that an
+ *	SDR created with the old layout is refused rather than
+ *	misread.							*/
+
 typedef struct
 {
 	Address		userData;
 	Object		first;	/*	first element in the list	*/
 	Object		last;	/*	last element in the list	*/
 	unsigned long   length;	/*	number of elements in the list	*/
+	Object		arena;	/*	source of elements, if any	*/
 } SdrList;
 
 typedef struct
@@ -48,6 +55,17 @@ static void	sdr_list__clear(SdrList *list)
 	list->first = 0;
 	list->last = 0;
 	list->length = 0;
+	list->arena = 0;
+}
+
+static Object	sdr_list__elt_alloc(Sdr sdrv, SdrList *list)
+{
+	if (list->arena)
+	{
+		return _sdrarenamalloc(sdrv, list->arena, sizeof(SdrListElt));
+	}
+
+	return _sdrzalloc(sdrv, sizeof(SdrListElt));
 }
 
 static void	sdr_list__elt_clear(SdrListElt *elt)
@@ -82,6 +100,38 @@ Object	Sdr_list_create(const char *file, int line, Sdr sdrv)
 	return list;
 }
 
+Object	Sdr_list_create_in_arena(const char *file, int line, Sdr sdrv,
+		Object arena)
+{
+	Object	list;
+	SdrList	listBuffer;
+
+	if (!(sdr_in_xn(sdrv)))
+	{
+		oK(_iEnd(file, line, _notInXnMsg()));
+		return 0;
+	}
+
+	joinTrace(sdrv, file, line);
+	if (arena == 0)
+	{
+		oK(_xniEnd(file, line, "arena", sdrv));
+		return 0;
+	}
+
+	list = _sdrarenamalloc(sdrv, arena, sizeof(SdrList));
+	if (list == 0)
+	{
+		oK(_iEnd(file, line, "list"));
+		return 0;
+	}
+
+	sdr_list__clear(&listBuffer);
+	listBuffer.arena = arena;
+	sdrPut((Address) list, listBuffer);
+	return list;
+}
+
 void	Sdr_list_destroy(const char *file, int line, Sdr sdrv, Object list,
 		SdrListDeleteFn deleteFn, void *arg)
 {
@@ -104,6 +154,24 @@ void	Sdr_list_destroy(const char *file, int line, Sdr sdrv, Object list,
 	}
 
 	sdrFetch(listBuffer, (Address) list);
+	if (listBuffer.arena)
+	{
+		/*	List and elements are released along with the
+		 *	arena; only the user's data need attention.	*/
+
+		if (deleteFn)
+		{
+			for (elt = listBuffer.first; elt != 0; elt = next)
+			{
+				sdrFetch(eltBuffer, (Address) elt);
+				next = eltBuffer.next;
+				deleteFn(sdrv, elt, arg);
+			}
+		}
+
+		return;
+	}
+
 	for (elt = listBuffer.first; elt != 0; elt = next)
 	{
 		sdrFetch(eltBuffer, (Address) elt);
@@ -187,7 +255,8 @@ Object	Sdr_list_insert_first(const char *file, int line, Sdr sdrv, Object list,
 	}
 
 	/* create new element */
-	elt = _sdrzalloc(sdrv, sizeof(SdrListElt));
+	sdrFetch(listBuffer, (Address) list);
+	elt = sdr_list__elt_alloc(sdrv, &listBuffer);
 	if (elt == 0)
 	{
 		oK(_iEnd(file, line, "elt"));
@@ -199,7 +268,6 @@ Object	Sdr_list_insert_first(const char *file, int line, Sdr sdrv, Object list,
 	eltBuffer.data = data;
 
 	/* insert new element at the beginning of the list */
-	sdrFetch(listBuffer, (Address) list);
 	eltBuffer.prev = 0;
 	eltBuffer.next = listBuffer.first;
 	sdrPut((Address) elt, eltBuffer);
@@ -241,7 +309,8 @@ Object	Sdr_list_insert_last(const char *file, int line, Sdr sdrv, Object list,
 	}
 
 	/* create new element */
-	elt = _sdrzalloc(sdrv, sizeof(SdrListElt));
+	sdrFetch(listBuffer, (Address) list);
+	elt = sdr_list__elt_alloc(sdrv, &listBuffer);
 	if (elt == 0)
 	{
 		oK(_iEnd(file, line, "elt"));
@@ -253,7 +322,6 @@ Object	Sdr_list_insert_last(const char *file, int line, Sdr sdrv, Object list,
 	eltBuffer.data = data;
 
 	/* insert new element at the end of the list */
-	sdrFetch(listBuffer, (Address) list);
 	eltBuffer.prev = listBuffer.last;
 	eltBuffer.next = 0;
 	sdrPut((Address) elt, eltBuffer);
@@ -304,7 +372,8 @@ Object	Sdr_list_insert_before(const char *file, int line, Sdr sdrv,
 	}
 
 	/* create new element */
-	elt = _sdrzalloc(sdrv, sizeof(SdrListElt));
+	sdrFetch(listBuffer, (Address) list);
+	elt = sdr_list__elt_alloc(sdrv, &listBuffer);
 	if (elt == 0)
 	{
 		oK(_iEnd(file, line, "elt"));
@@ -316,7 +385,6 @@ Object	Sdr_list_insert_before(const char *file, int line, Sdr sdrv,
 	eltBuffer.data = data;
 
 	/* insert new element before the specified element */
-	sdrFetch(listBuffer, (Address) list);
 	eltBuffer.prev = oldEltBuffer.prev;
 	eltBuffer.next = oldElt;
 	sdrPut((Address) elt, eltBuffer);
@@ -368,7 +436,8 @@ Object	Sdr_list_insert_after(const char *file, int line, Sdr sdrv,
 	}
 
 	/* create new element */
-	elt = _sdrzalloc(sdrv, sizeof(SdrListElt));
+	sdrFetch(listBuffer, (Address) list);
+	elt = sdr_list__elt_alloc(sdrv, &listBuffer);
 	if (elt == 0)
 	{
 		oK(_iEnd(file, line, "elt"));
@@ -380,7 +449,6 @@ Object	Sdr_list_insert_after(const char *file, int line, Sdr sdrv,
 	eltBuffer.data = data;
 
 	/* insert new element after the specified element */
-	sdrFetch(listBuffer, (Address) list);
 	eltBuffer.next = oldEltBuffer.next;
 	eltBuffer.prev = oldElt;
 	sdrPut((Address) elt, eltBuffer);
@@ -497,7 +565,15 @@ void	Sdr_list_delete(const char *file, int line, Sdr sdrv, Object elt,
 	/* just in case user accesses later... */
 	sdr_list__elt_clear(&eltBuffer);
 	sdrPut((Address) elt, eltBuffer);
-	sdrFree(elt);
+	if (listBuffer.arena)
+	{
+		_sdrarenafree(sdrv, listBuffer.arena, elt, sizeof(SdrListElt));
+	}
+	else
+	{
+		sdrFree(elt);
+	}
+
 	if (prev)
 	{
 		sdrFetch(eltBuffer, (Address) prev);
@@ -110,6 +110,8 @@ typedef union
 	BigOhd2		trailing;
 } Ohd;
 
+static long	slabObjectLength(Sdr sdrv, Address addr);
+
 /*		Space management utility functions.			*/
 
 static ObjectScale	scaleOf(Sdr sdrv, Address addr, Ohd *ohd)
@@ -218,9 +220,14 @@ void	sdr_stage(Sdr sdrv, char *into, Object from, long length)
 
 	if (scaleOf(sdrv, addr, &ohd) != LargeObject)
 	{
-		putErrmsg("Can't stage data, not a user object.", NULL);
-		crashXn(sdrv);
-		return;
+		ohd.leading.userDataSize = slabObjectLength(sdrv, addr);
+		if (ohd.leading.userDataSize == (u_long) -1)
+		{
+			putErrmsg("Can't stage data, not a user object.",
+					NULL);
+			crashXn(sdrv);
+			return;
+		}
 	}
 
 	for (elt = lyst_first(sdrv->knownObjects); elt; elt = lyst_next(elt))
@@ -948,6 +955,757 @@ void	Sdr_free(const char *file, int line, Sdr sdrv, Object object)
 	_sdrfree(sdrv, object, UserPut);
 }
 
+/*	*	*	Arena management functions	*	*	*/
+
+/*	An arena is a chain of large chunks from which small objects
+ *	are bump-allocated.  Objects allocated from an arena are never
+ *	returned to the SDR heap individually; instead the whole chain
+ *	of chunks is released at once when the arena is destroyed, at
+ *	a cost that is proportional to the number of chunks rather
+ *	than to the number of objects.
+ *
+ *	So that an arena serving a long-lived session doesn't grow
+ *	without bound as objects are repeatedly released and replaced,
+ *	a released object of up to SDR_ARENA_FREE_SIZES words is put
+ *	on the arena's free list for objects of its size (linked
+ *	through the object's first word) and is reused by the next
+ *	allocation of that size.  Space of larger released objects
+ *	is reclaimed only when the arena is destroyed.			*/
+
+#define	SDR_ARENA_FREE_SIZES	(8)
+
+typedef struct
+{
+	Object		lastChunk;	/*	Currently filling.	*/
+	unsigned long	chunkSize;	/*	Including chunk header.	*/
+	unsigned long	used;		/*	Within lastChunk.	*/
+	Object		firstFree[SDR_ARENA_FREE_SIZES];
+} SdrArena;
+
+typedef struct
+{
+	Object		prevChunk;
+	unsigned long	size;		/*	Including chunk header.	*/
+} SdrArenaChunk;
+
+Object	Sdr_arena_create(const char *file, int line, Sdr sdrv,
+		unsigned long chunkSize)
+{
+	Object		arena;
+	SdrArena	arenaBuffer;
+
+	if (!(sdr_in_xn(sdrv)))
+	{
+		oK(_iEnd(file, line, _notInXnMsg()));
+		return 0;
+	}
+
+	joinTrace(sdrv, file, line);
+	if (chunkSize < (sizeof(SdrArenaChunk) + WORD_SIZE)
+	|| chunkSize > LARGE_BLK_LIMIT)
+	{
+		oK(_xniEnd(file, line, _apiErrMsg(), sdrv));
+		return 0;
+	}
+
+	arena = _sdrzalloc(sdrv, sizeof(SdrArena));
+	if (arena == 0)
+	{
+		oK(_iEnd(file, line, "arena"));
+		return 0;
+	}
+
+	memset((char *) &arenaBuffer, 0, sizeof(SdrArena));
+	arenaBuffer.chunkSize = chunkSize;
+	sdrPut((Address) arena, arenaBuffer);
+	return arena;
+}
+
+Object	_sdrarenamalloc(Sdr sdrv, Object arena, unsigned long nbytes)
+{
+	SdrArena	arenaBuffer;
+	SdrArenaChunk	chunkBuffer;
+	SdrArenaChunk	lastChunkBuffer;
+	unsigned long	words;
+	Object		chunk;
+	Object		result;
+
+	CHKZERO(sdrv);
+	CHKZERO(arena);
+	XNCHKZERO(!(nbytes == 0 || nbytes > LARGE_BLK_LIMIT));
+
+	/*	Round nbytes up to an integral number of words, so
+	 *	that every object in the arena is word-aligned.		*/
+
+	nbytes += (WORD_SIZE - 1);
+	nbytes >>= SPACE_ORDER;
+	nbytes <<= SPACE_ORDER;
+	sdrFetch(arenaBuffer, (Address) arena);
+	words = nbytes >> SPACE_ORDER;
+	if (words <= SDR_ARENA_FREE_SIZES
+	&& (result = arenaBuffer.firstFree[words - 1]) != 0)
+	{
+		/*	Reuse a released object of the same size.	*/
+
+		sdrFetch(arenaBuffer.firstFree[words - 1], (Address) result);
+		sdrPatch((Address) arena, arenaBuffer);
+		return result;
+	}
+
+	if (arenaBuffer.lastChunk != 0
+	&& arenaBuffer.used + nbytes <= arenaBuffer.chunkSize)
+	{
+		/*	Current chunk has room: just bump.		*/
+
+		result = arenaBuffer.lastChunk + arenaBuffer.used;
+		arenaBuffer.used += nbytes;
+		sdrPatch((Address) arena, arenaBuffer);
+		return result;
+	}
+
+	if (sizeof(SdrArenaChunk) + nbytes > arenaBuffer.chunkSize)
+	{
+		/*	Object is too large for any chunk: give it a
+		 *	chunk of its own, linked in behind the current
+		 *	chunk so that the remaining space in the
+		 *	current chunk is not abandoned.			*/
+
+		chunkBuffer.size = sizeof(SdrArenaChunk) + nbytes;
+		chunk = _sdrmalloc(sdrv, chunkBuffer.size);
+		if (chunk == 0)
+		{
+			return 0;
+		}
+
+		if (arenaBuffer.lastChunk == 0)
+		{
+			chunkBuffer.prevChunk = 0;
+			arenaBuffer.lastChunk = chunk;
+			arenaBuffer.used = chunkBuffer.size;
+		}
+		else
+		{
+			sdrFetch(lastChunkBuffer,
+					(Address) arenaBuffer.lastChunk);
+			chunkBuffer.prevChunk = lastChunkBuffer.prevChunk;
+			lastChunkBuffer.prevChunk = chunk;
+			sdrPatch((Address) arenaBuffer.lastChunk,
+					lastChunkBuffer);
+		}
+
+		sdrPatch((Address) chunk, chunkBuffer);
+		sdrPatch((Address) arena, arenaBuffer);
+		return chunk + sizeof(SdrArenaChunk);
+	}
+
+	/*	Start a new chunk.					*/
+
+	chunkBuffer.size = arenaBuffer.chunkSize;
+	chunk = _sdrmalloc(sdrv, chunkBuffer.size);
+	if (chunk == 0)
+	{
+		return 0;
+	}
+
+	chunkBuffer.prevChunk = arenaBuffer.lastChunk;
+	sdrPatch((Address) chunk, chunkBuffer);
+	arenaBuffer.lastChunk = chunk;
+	arenaBuffer.used = sizeof(SdrArenaChunk) + nbytes;
+	sdrPatch((Address) arena, arenaBuffer);
+	return chunk + sizeof(SdrArenaChunk);
+}
+
+Object	Sdr_arena_malloc(const char *file, int line, Sdr sdrv, Object arena,
+		unsigned long nbytes)
+{
+	if (!(sdr_in_xn(sdrv)))
+	{
+		oK(_iEnd(file, line, _notInXnMsg()));
+		return 0;
+	}
+
+	joinTrace(sdrv, file, line);
+	if (arena == 0)
+	{
+		oK(_xniEnd(file, line, "arena", sdrv));
+		return 0;
+	}
+
+	return _sdrarenamalloc(sdrv, arena, nbytes);
+}
+
+void	_sdrarenafree(Sdr sdrv, Object arena, Object object,
+		unsigned long nbytes)
+{
+	SdrArena	arenaBuffer;
+	unsigned long	words;
+
+	CHKVOID(sdrv);
+	CHKVOID(arena);
+	CHKVOID(object);
+	words = (nbytes + (WORD_SIZE - 1)) >> SPACE_ORDER;
+	if (words == 0 || words > SDR_ARENA_FREE_SIZES)
+	{
+		return;		/*	Reclaimed with the arena.	*/
+	}
+
+	sdrFetch(arenaBuffer, (Address) arena);
+	sdrPatch((Address) object, arenaBuffer.firstFree[words - 1]);
+	arenaBuffer.firstFree[words - 1] = object;
+	sdrPatch((Address) arena, arenaBuffer);
+}
+
+void	Sdr_arena_free(const char *file, int line, Sdr sdrv, Object arena,
+		Object object, unsigned long nbytes)
+{
+	if (!(sdr_in_xn(sdrv)))
+	{
+		oK(_iEnd(file, line, _notInXnMsg()));
+		return;
+	}
+
+	joinTrace(sdrv, file, line);
+	if (arena == 0 || object == 0)
+	{
+		oK(_xniEnd(file, line, "arena object", sdrv));
+		return;
+	}
+
+	_sdrarenafree(sdrv, arena, object, nbytes);
+}
+
+void	Sdr_arena_destroy(const char *file, int line, Sdr sdrv, Object arena)
+{
+	SdrArena	arenaBuffer;
+	SdrArenaChunk	chunkBuffer;
+	Object		chunk;
+
+	if (!(sdr_in_xn(sdrv)))
+	{
+		oK(_iEnd(file, line, _notInXnMsg()));
+		return;
+	}
+
+	joinTrace(sdrv, file, line);
+	if (arena == 0)
+	{
+		oK(_xniEnd(file, line, "arena", sdrv));
+		return;
+	}
+
+	sdrFetch(arenaBuffer, (Address) arena);
+	for (chunk = arenaBuffer.lastChunk; chunk; chunk = chunkBuffer.prevChunk)
+	{
+		sdrFetch(chunkBuffer, (Address) chunk);
+		sdrFree(chunk);
+	}
+
+	sdrFree(arena);
+}
+
+/*	*	*	Slab management functions	*	*	*/
+
+/*	A slab is a large block divided into SLAB_CAPACITY slots of
+ *	equal size, each holding one object of the slab's type
+ *	preceded by the address of the slab itself.  The slots that
+ *	are in use are noted in a bitmap in the slab's header, so an
+ *	object is allocated or freed by rewriting a single word of
+ *	the bitmap; the rest of the slab is written only when the
+ *	slab is created.  Each slab cache chains all of its slabs,
+ *	and separately chains those that have at least one free
+ *	slot, so that both allocation and freeing take constant
+ *	time however many slabs there are.  A slab that becomes
+ *	empty is returned to the large pool unless it is the only
+ *	slab with a free slot.						*/
+
+#define	SLAB_CAPACITY		(64)
+#define	BITS_PER_MAP_WORD	(8 * sizeof(u_long))
+#define	SLAB_MAP_WORDS		(SLAB_CAPACITY / BITS_PER_MAP_WORD)
+#define	FULL_MAP_WORD		(~((u_long) 0))
+#define	SLOT_BIT(slot)		(((u_long) 1) << ((slot) % BITS_PER_MAP_WORD))
+
+typedef struct
+{
+	Object		nextCache;	/*	In registry.		*/
+	char		name[SDR_SLAB_NAME_LEN];
+	u_long		objectSize;	/*	Rounded up to words.	*/
+	u_long		slotSize;	/*	Object + slab address.	*/
+	Object		firstSlab;
+	Object		firstPartial;	/*	Has a free slot.	*/
+} SdrSlabCache;
+
+typedef struct
+{
+	Object		prevSlab;
+	Object		nextSlab;
+	Object		prevPartial;
+	Object		nextPartial;
+	Object		cache;
+	u_long		inUse[SLAB_MAP_WORDS];
+} SdrSlab;
+
+#define	SLAB_SIZE(slotSize)	(sizeof(SdrSlab) + (SLAB_CAPACITY * (slotSize)))
+#define	SLOT_OF(slab, i, slotSize)	((slab) + sizeof(SdrSlab) \
++ ((i) * (slotSize)))
+#define	FIELD_OF(obj, buf, X)	((obj) + (((char *) &((buf).X)) \
+- ((char *) &(buf))))
+
+Object	Sdr_slab_create(const char *file, int line, Sdr sdrv, char *name,
+		unsigned long objectSize)
+{
+	SdrMap		*map;
+	Object		cache;
+	SdrSlabCache	cacheBuf;
+	int		count = 0;
+
+	if (!(sdr_in_xn(sdrv)))
+	{
+		oK(_iEnd(file, line, _notInXnMsg()));
+		return 0;
+	}
+
+	joinTrace(sdrv, file, line);
+	if (name == NULL || objectSize == 0
+	|| SLAB_SIZE(objectSize + sizeof(Object)) > LARGE_BLK_LIMIT)
+	{
+		oK(_xniEnd(file, line, _apiErrMsg(), sdrv));
+		return 0;
+	}
+
+	map = _mapImage(sdrv);
+	for (cache = map->firstSlabCache; cache; cache = cacheBuf.nextCache)
+	{
+		sdrFetch(cacheBuf, (Address) cache);
+		count++;
+	}
+
+	if (count >= SDR_MAX_SLAB_TYPES)
+	{
+		putErrmsg("Too many slab types.", name);
+		crashXn(sdrv);
+		return 0;
+	}
+
+	cache = _sdrzalloc(sdrv, sizeof(SdrSlabCache));
+	if (cache == 0)
+	{
+		oK(_iEnd(file, line, "slab cache"));
+		return 0;
+	}
+
+	/*	Round object size up to an integral number of words,
+	 *	so that every object in the slab is word-aligned.	*/
+
+	objectSize += (WORD_SIZE - 1);
+	objectSize >>= SPACE_ORDER;
+	objectSize <<= SPACE_ORDER;
+	memset((char *) &cacheBuf, 0, sizeof(SdrSlabCache));
+	cacheBuf.nextCache = map->firstSlabCache;
+	istrcpy(cacheBuf.name, name, sizeof cacheBuf.name);
+	cacheBuf.objectSize = objectSize;
+	cacheBuf.slotSize = objectSize + sizeof(Object);
+	sdrPut((Address) cache, cacheBuf);
+	patchMap(firstSlabCache, cache);
+	return cache;
+}
+
+/*	Adds a slab to the head of the cache's chain of slabs that
+ *	have a free slot.						*/
+
+static void	linkPartial(Sdr sdrv, Object cache, SdrSlabCache *cacheBuf,
+			Object slab, SdrSlab *slabBuf)
+{
+	Object	none = 0;
+
+	slabBuf->prevPartial = 0;
+	slabBuf->nextPartial = cacheBuf->firstPartial;
+	sdrPatch(FIELD_OF(slab, *slabBuf, prevPartial), none);
+	sdrPatch(FIELD_OF(slab, *slabBuf, nextPartial), slabBuf->nextPartial);
+	if (slabBuf->nextPartial)
+	{
+		sdrPatch(FIELD_OF(slabBuf->nextPartial, *slabBuf, prevPartial),
+				slab);
+	}
+
+	cacheBuf->firstPartial = slab;
+	sdrPatch(FIELD_OF(cache, *cacheBuf, firstPartial), slab);
+}
+
+static void	unlinkPartial(Sdr sdrv, Object cache, SdrSlabCache *cacheBuf,
+			Object slab, SdrSlab *slabBuf)
+{
+	if (slabBuf->prevPartial)
+	{
+		sdrPatch(FIELD_OF(slabBuf->prevPartial, *slabBuf, nextPartial),
+				slabBuf->nextPartial);
+	}
+	else
+	{
+		cacheBuf->firstPartial = slabBuf->nextPartial;
+		sdrPatch(FIELD_OF(cache, *cacheBuf, firstPartial),
+				slabBuf->nextPartial);
+	}
+
+	if (slabBuf->nextPartial)
+	{
+		sdrPatch(FIELD_OF(slabBuf->nextPartial, *slabBuf, prevPartial),
+				slabBuf->prevPartial);
+	}
+}
+
+static Object	createSlab(Sdr sdrv, Object cache, SdrSlabCache *cacheBuf)
+{
+	long	size = SLAB_SIZE(cacheBuf->slotSize);
+	char	*buffer;
+	SdrSlab	*slabBuf;
+	Object	slab;
+	int	i;
+
+	buffer = MTAKE(size);
+	if (buffer == NULL)
+	{
+		putErrmsg(_noMemoryMsg(), NULL);
+		crashXn(sdrv);
+		return 0;
+	}
+
+	slab = _sdrmalloc(sdrv, size);
+	if (slab == 0)
+	{
+		MRELEASE(buffer);
+		return 0;
+	}
+
+	/*	Write the whole slab at once, so that creating it
+	 *	costs a single log entry.  The new slab is at the
+	 *	head of both of the cache's chains.			*/
+
+	memset(buffer, 0, size);
+	slabBuf = (SdrSlab *) buffer;
+	slabBuf->nextSlab = cacheBuf->firstSlab;
+	slabBuf->nextPartial = cacheBuf->firstPartial;
+	slabBuf->cache = cache;
+	for (i = 0; i < SLAB_CAPACITY; i++)
+	{
+		memcpy(buffer + SLOT_OF(0, i, cacheBuf->slotSize),
+				(char *) &slab, sizeof(Object));
+	}
+
+	_sdrput(__FILE__, __LINE__, sdrv, (Address) slab, buffer, size,
+			SystemPut);
+	if (slabBuf->nextSlab)
+	{
+		sdrPatch(FIELD_OF(slabBuf->nextSlab, *slabBuf, prevSlab),
+				slab);
+	}
+
+	if (slabBuf->nextPartial)
+	{
+		sdrPatch(FIELD_OF(slabBuf->nextPartial, *slabBuf, prevPartial),
+				slab);
+	}
+
+	MRELEASE(buffer);
+	cacheBuf->firstSlab = slab;
+	sdrPatch(FIELD_OF(cache, *cacheBuf, firstSlab), slab);
+	cacheBuf->firstPartial = slab;
+	sdrPatch(FIELD_OF(cache, *cacheBuf, firstPartial), slab);
+	return slab;
+}
+
+static int	claimSlot(Sdr sdrv, Object slab, SdrSlab *slabBuf)
+{
+	int	i;
+	int	bit;
+	u_long	word;
+
+	for (i = 0; i < SLAB_MAP_WORDS; i++)
+	{
+		word = slabBuf->inUse[i];
+		if (word == FULL_MAP_WORD)
+		{
+			continue;
+		}
+
+		for (bit = 0; word & SLOT_BIT(bit); bit++)
+		{
+			;
+		}
+
+		word |= SLOT_BIT(bit);
+		slabBuf->inUse[i] = word;
+		sdrPatch(FIELD_OF(slab, *slabBuf, inUse[i]), word);
+		return (i * BITS_PER_MAP_WORD) + bit;
+	}
+
+	return -1;			/*	Slab is full.		*/
+}
+
+static int	slabIsFull(SdrSlab *slabBuf)
+{
+	int	i;
+
+	for (i = 0; i < SLAB_MAP_WORDS; i++)
+	{
+		if (slabBuf->inUse[i] != FULL_MAP_WORD)
+		{
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+static int	slabIsEmpty(SdrSlab *slabBuf)
+{
+	int	i;
+
+	for (i = 0; i < SLAB_MAP_WORDS; i++)
+	{
+		if (slabBuf->inUse[i] != 0)
+		{
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+Object	Sdr_slab_malloc(const char *file, int line, Sdr sdrv, Object cache)
+{
+	SdrSlabCache	cacheBuf;
+	Object		slab;
+	SdrSlab		slabBuf;
+	int		slot;
+	Object		object;
+
+	if (!(sdr_in_xn(sdrv)))
+	{
+		oK(_iEnd(file, line, _notInXnMsg()));
+		return 0;
+	}
+
+	joinTrace(sdrv, file, line);
+	if (cache == 0)
+	{
+		oK(_xniEnd(file, line, "slab cache", sdrv));
+		return 0;
+	}
+
+	sdrFetch(cacheBuf, (Address) cache);
+	slab = cacheBuf.firstPartial;
+	if (slab == 0)		/*	All slabs are full.		*/
+	{
+		slab = createSlab(sdrv, cache, &cacheBuf);
+		if (slab == 0)
+		{
+			return 0;
+		}
+	}
+
+	sdrFetch(slabBuf, (Address) slab);
+	slot = claimSlot(sdrv, slab, &slabBuf);
+	if (slot < 0)
+	{
+		putErrmsg("Full slab in chain of partial slabs.", utoa(slab));
+		crashXn(sdrv);
+		return 0;
+	}
+
+	if (slabIsFull(&slabBuf))
+	{
+		unlinkPartial(sdrv, cache, &cacheBuf, slab, &slabBuf);
+	}
+
+	object = SLOT_OF(slab, slot, cacheBuf.slotSize) + sizeof(Object);
+	if (sdrv->sdr->configFlags & SDR_BOUNDED)
+	{
+		if (noteKnownObject(sdrv, object, object + cacheBuf.objectSize)
+				== NULL)
+		{
+			putErrmsg(_noMemoryMsg(), NULL);
+			crashXn(sdrv);
+			return 0;
+		}
+	}
+
+	return object;
+}
+
+/*	Returns the index of the object's slot in its slab, or -1 if
+ *	the object is not an allocated object in a slab of the
+ *	indicated cache (or, if cache is zero, of any cache).		*/
+
+static int	locateSlot(Sdr sdrv, Object cache, Address addr, Object *slab,
+			SdrSlab *slabBuf, SdrSlabCache *cacheBuf)
+{
+	SdrMap	*map = _mapImage(sdrv);
+	Address	slotAddr;
+	Address	offset;
+	Object	elt;
+	int	slot;
+
+	slotAddr = addr - sizeof(Object);
+	if (slotAddr < map->startOfLargePool || addr >= map->endOfLargePool)
+	{
+		return -1;
+	}
+
+	sdrFetch(*slab, slotAddr);
+	if (*slab < map->startOfLargePool || *slab >= slotAddr)
+	{
+		return -1;
+	}
+
+	sdrFetch(*slabBuf, (Address) *slab);
+	if (cache == 0)		/*	Must be a registered cache.	*/
+	{
+		for (elt = map->firstSlabCache; elt; elt = cacheBuf->nextCache)
+		{
+			if (elt == slabBuf->cache)
+			{
+				break;
+			}
+
+			sdrFetch(*cacheBuf, (Address) elt);
+		}
+
+		if (elt == 0)
+		{
+			return -1;
+		}
+
+		cache = elt;
+	}
+	else if (slabBuf->cache != cache)
+	{
+		return -1;
+	}
+
+	sdrFetch(*cacheBuf, (Address) cache);
+	offset = slotAddr - SLOT_OF(*slab, 0, 0);
+	if (offset % cacheBuf->slotSize != 0)
+	{
+		return -1;
+	}
+
+	slot = offset / cacheBuf->slotSize;
+	if (slot >= SLAB_CAPACITY
+	|| (slabBuf->inUse[slot / BITS_PER_MAP_WORD] & SLOT_BIT(slot)) == 0)
+	{
+		return -1;
+	}
+
+	return slot;
+}
+
+static long	slabObjectLength(Sdr sdrv, Address addr)
+{
+	Object		slab;
+	SdrSlab		slabBuf;
+	SdrSlabCache	cacheBuf;
+
+	if (locateSlot(sdrv, 0, addr, &slab, &slabBuf, &cacheBuf) < 0)
+	{
+		return -1;
+	}
+
+	return cacheBuf.objectSize;
+}
+
+static void	releaseSlab(Sdr sdrv, Object cache, SdrSlabCache *cacheBuf,
+			Object slab, SdrSlab *slabBuf)
+{
+	unlinkPartial(sdrv, cache, cacheBuf, slab, slabBuf);
+	if (slabBuf->prevSlab)
+	{
+		sdrPatch(FIELD_OF(slabBuf->prevSlab, *slabBuf, nextSlab),
+				slabBuf->nextSlab);
+	}
+	else
+	{
+		sdrPatch(FIELD_OF(cache, *cacheBuf, firstSlab),
+				slabBuf->nextSlab);
+	}
+
+	if (slabBuf->nextSlab)
+	{
+		sdrPatch(FIELD_OF(slabBuf->nextSlab, *slabBuf, prevSlab),
+				slabBuf->prevSlab);
+	}
+
+	sdrFree(slab);
+}
+
+void	Sdr_slab_free(const char *file, int line, Sdr sdrv, Object cache,
+		Object object)
+{
+	Object		slab;
+	SdrSlab		slabBuf;
+	SdrSlabCache	cacheBuf;
+	int		wasFull;
+	int		slot;
+	int		i;
+	LystElt		elt;
+	ObjectExtent	*extent;
+
+	if (!(sdr_in_xn(sdrv)))
+	{
+		oK(_iEnd(file, line, _notInXnMsg()));
+		return;
+	}
+
+	joinTrace(sdrv, file, line);
+	if (cache == 0)
+	{
+		oK(_xniEnd(file, line, "slab cache", sdrv));
+		return;
+	}
+
+	slot = locateSlot(sdrv, cache, (Address) object, &slab, &slabBuf,
+			&cacheBuf);
+	if (slot < 0)
+	{
+		putErrmsg("Can't free object, not in slab.", utoa(object));
+		crashXn(sdrv);
+		return;
+	}
+
+	wasFull = slabIsFull(&slabBuf);
+	i = slot / BITS_PER_MAP_WORD;
+	slabBuf.inUse[i] &= ~SLOT_BIT(slot);
+	sdrPatch(FIELD_OF(slab, slabBuf, inUse[i]), slabBuf.inUse[i]);
+	if (sdrv->sdr->configFlags & SDR_BOUNDED)
+	{
+		for (elt = lyst_first(sdrv->knownObjects); elt;
+				elt = lyst_next(elt))
+		{
+			extent = (ObjectExtent *) lyst_data(elt);
+			if (extent->from == (Address) object)
+			{
+				lyst_delete(elt);
+				break;
+			}
+		}
+	}
+
+	if (wasFull)		/*	Now has a free slot.		*/
+	{
+		linkPartial(sdrv, cache, &cacheBuf, slab, &slabBuf);
+		return;
+	}
+
+	/*	Keep an empty slab if no other slab has a free slot,
+	 *	so that alternating allocation and freeing don't keep
+	 *	creating and destroying slabs.				*/
+
+	if (slabIsEmpty(&slabBuf)
+	&& (slabBuf.prevPartial || slabBuf.nextPartial))
+	{
+		releaseSlab(sdrv, cache, &cacheBuf, slab, &slabBuf);
+	}
+}
+
 /*	*	Space management utility functions	*	*	*/
 
 int	sdrBoundaryViolated(Sdr sdrv, Address from, long length)
@@ -990,7 +1748,7 @@ long	sdr_object_length(Sdr sdrv, Object object)
 		return ohd.leading.userDataSize;
 
 	default:
-		return -1;
+		return slabObjectLength(sdrv, addr);
 	}
 }
 
@@ -1024,6 +1782,11 @@ void	sdr_usage(Sdr sdrv, SdrUsageSummary *usage)
 	Address		nextLarge;
 	u_long		freeTotal;
 	int		count;
+	Object		cache;
+	SdrSlabCache	cacheBuf;
+	Object		slab;
+	SdrSlab		slabBuf;
+	SdrSlabUsage	*slabUsage;
 
 	CHKVOID(sdrFetchSafe(sdrv));
 	CHKVOID(usage);
@@ -1074,7 +1837,39 @@ void	sdr_usage(Sdr sdrv, SdrUsageSummary *usage)
 	usage->largePoolAllocated = usage->largePoolSize - freeTotal;
 	usage->unusedSize = usage->dsSize - (sizeof(SdrMap) +
 			 usage->smallPoolSize + usage->largePoolSize);
-	return;
+
+	/*	Slabs occupy space in the large pool, so their space
+	 *	is counted above; here we report their occupancy.	*/
+
+	usage->slabTypeCount = 0;
+	for (cache = map->firstSlabCache; cache
+			&& usage->slabTypeCount < SDR_MAX_SLAB_TYPES;
+			cache = cacheBuf.nextCache)
+	{
+		sdrFetch(cacheBuf, (Address) cache);
+		slabUsage = usage->slabs + usage->slabTypeCount;
+		istrcpy(slabUsage->name, cacheBuf.name, sizeof slabUsage->name);
+		slabUsage->objectSize = cacheBuf.objectSize;
+		slabUsage->slabCount = 0;
+		slabUsage->objectsAllocated = 0;
+		for (slab = cacheBuf.firstSlab; slab; slab = slabBuf.nextSlab)
+		{
+			sdrFetch(slabBuf, (Address) slab);
+			slabUsage->slabCount++;
+			for (i = 0; i < SLAB_CAPACITY; i++)
+			{
+				if (slabBuf.inUse[i / BITS_PER_MAP_WORD]
+						& SLOT_BIT(i))
+				{
+					slabUsage->objectsAllocated++;
+				}
+			}
+		}
+
+		slabUsage->objectsFree = (slabUsage->slabCount * SLAB_CAPACITY)
+				- slabUsage->objectsAllocated;
+		usage->slabTypeCount++;
+	}
 }
 
 void	sdr_report(SdrUsageSummary *usage)
@@ -1136,6 +1931,23 @@ void	sdr_report(SdrUsageSummary *usage)
 	isprintf(buf, sizeof buf, "       total size: %10ld",
 		       	usage->largePoolSize);
         writeMemo(buf);
+	if (usage->slabTypeCount > 0)
+	{
+		istrcpy(buf, "slabs (within large pool):", sizeof buf);
+		writeMemo(buf);
+	}
+
+	for (i = 0; i < usage->slabTypeCount; i++)
+	{
+		isprintf(buf, sizeof buf, "    %-16s size %6ld slabs %6ld \
+used %8ld free %8ld", usage->slabs[i].name,
+				usage->slabs[i].objectSize,
+				usage->slabs[i].slabCount,
+				usage->slabs[i].objectsAllocated,
+				usage->slabs[i].objectsFree);
+		writeMemo(buf);
+	}
+
 	isprintf(buf, sizeof buf, "total sdr:         %10ld",
 		       	usage->dsSize);
         writeMemo(buf);
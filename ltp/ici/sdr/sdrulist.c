@@ -0,0 +1,519 @@
+/*
+ *	sdrulist.c:	simple data recorder unrolled list management
+ *			library.
+ *
+ *	An unrolled list is a doubly linked list of chunks, each of
+ *	which holds up to SDR_ULIST_CHUNK_ENTRIES data items in an
+ *	array.  The items in a chunk always occupy a contiguous run
+ *	of the array, from slot "head" through slot head + count - 1,
+ *	so that items may be pushed onto the back of the last chunk
+ *	and onto the front of the first chunk until the array is
+ *	exhausted at that end, whereupon a new chunk is added to the
+ *	list.  A chunk is freed as soon as its last item is popped.
+ */
+
+#include "sdrP.h"
+#include "sdrulist.h"
+
+/*	By default a chunk is exactly as large as the largest block
+ *	in the SDR's small pool, so that chunks are allocated by the
+ *	fast small-block allocator.					*/
+
+#ifndef SDR_ULIST_CHUNK_ENTRIES
+#define	SDR_ULIST_CHUNK_ENTRIES	((int) ((SMALL_SIZES * WORD_SIZE \
+- sizeof(SdrUlistChunk)) / sizeof(Address)))
+#endif
+
+typedef struct
+{
+	Object		first;	/*	first chunk in the list		*/
+	Object		last;	/*	last chunk in the list		*/
+	unsigned long	length;	/*	number of items in the list	*/
+} SdrUlist;
+
+typedef struct
+{
+	Object		prev;	/*	previous chunk in list		*/
+	Object		next;	/*	next chunk in list		*/
+	int		head;	/*	slot of first item in chunk	*/
+	int		count;	/*	number of items in chunk	*/
+
+	/*	Array of SDR_ULIST_CHUNK_ENTRIES items follows.		*/
+
+} SdrUlistChunk;
+
+#define	CHUNK_SIZE	(sizeof(SdrUlistChunk) \
++ (SDR_ULIST_CHUNK_ENTRIES * sizeof(Address)))
+#define	SLOT_ADDRESS(chunk, slot)	((chunk) + sizeof(SdrUlistChunk) \
++ ((slot) * sizeof(Address)))
+
+/*	*	*	Chunk management functions	*	*	*/
+
+static Object	allocChunk(Sdr sdrv)
+{
+	if (CHUNK_SIZE <= SMALL_SIZES * WORD_SIZE)
+	{
+		return _sdrzalloc(sdrv, CHUNK_SIZE);
+	}
+
+	return _sdrmalloc(sdrv, CHUNK_SIZE);
+}
+
+static Address	readSlot(Sdr sdrv, Object chunk, int slot)
+{
+	Address	data;
+
+	sdrFetch(data, SLOT_ADDRESS(chunk, slot));
+	return data;
+}
+
+/*	Adds a new chunk at the front or back of the list, holding the
+ *	single indicated data item at the far end of its array.		*/
+
+static int	addChunk(const char *file, int line, Sdr sdrv, Object list,
+			SdrUlist *listBuffer, Address data, int atFront)
+{
+	Object		chunk;
+	SdrUlistChunk	chunkBuffer;
+	Object		neighbor;
+	SdrUlistChunk	neighborBuffer;
+
+	chunk = allocChunk(sdrv);
+	if (chunk == 0)
+	{
+		oK(_iEnd(file, line, "chunk"));
+		return -1;
+	}
+
+	chunkBuffer.count = 1;
+	if (atFront)
+	{
+		chunkBuffer.head = SDR_ULIST_CHUNK_ENTRIES - 1;
+		chunkBuffer.prev = 0;
+		chunkBuffer.next = listBuffer->first;
+		neighbor = listBuffer->first;
+		listBuffer->first = chunk;
+		if (listBuffer->last == 0)
+		{
+			listBuffer->last = chunk;
+		}
+	}
+	else
+	{
+		chunkBuffer.head = 0;
+		chunkBuffer.prev = listBuffer->last;
+		chunkBuffer.next = 0;
+		neighbor = listBuffer->last;
+		listBuffer->last = chunk;
+		if (listBuffer->first == 0)
+		{
+			listBuffer->first = chunk;
+		}
+	}
+
+	sdrPut((Address) chunk, chunkBuffer);
+	sdrPut(SLOT_ADDRESS(chunk, chunkBuffer.head), data);
+	if (neighbor)
+	{
+		sdrFetch(neighborBuffer, (Address) neighbor);
+		if (atFront)
+		{
+			neighborBuffer.prev = chunk;
+		}
+		else
+		{
+			neighborBuffer.next = chunk;
+		}
+
+		sdrPut((Address) neighbor, neighborBuffer);
+	}
+
+	listBuffer->length += 1;
+	sdrPut((Address) list, *listBuffer);
+	return 0;
+}
+
+/*	Removes an emptied chunk from the front or back of the list.	*/
+
+static void	dropChunk(const char *file, int line, Sdr sdrv,
+			SdrUlist *listBuffer, SdrUlistChunk *chunkBuffer,
+			int atFront)
+{
+	Object		chunk;
+	Object		neighbor;
+	SdrUlistChunk	neighborBuffer;
+
+	if (atFront)
+	{
+		chunk = listBuffer->first;
+		neighbor = chunkBuffer->next;
+		listBuffer->first = neighbor;
+		if (neighbor == 0)
+		{
+			listBuffer->last = 0;
+		}
+	}
+	else
+	{
+		chunk = listBuffer->last;
+		neighbor = chunkBuffer->prev;
+		listBuffer->last = neighbor;
+		if (neighbor == 0)
+		{
+			listBuffer->first = 0;
+		}
+	}
+
+	if (neighbor)
+	{
+		sdrFetch(neighborBuffer, (Address) neighbor);
+		if (atFront)
+		{
+			neighborBuffer.prev = 0;
+		}
+		else
+		{
+			neighborBuffer.next = 0;
+		}
+
+		sdrPut((Address) neighbor, neighborBuffer);
+	}
+
+	sdrFree(chunk);
+}
+
+/*	*	*	Unrolled list functions	*	*	*/
+
+Object	Sdr_ulist_create(const char *file, int line, Sdr sdrv)
+{
+	Object		list;
+	SdrUlist	listBuffer;
+
+	if (!(sdr_in_xn(sdrv)))
+	{
+		oK(_iEnd(file, line, _notInXnMsg()));
+		return 0;
+	}
+
+	joinTrace(sdrv, file, line);
+	list = _sdrzalloc(sdrv, sizeof(SdrUlist));
+	if (list == 0)
+	{
+		oK(_iEnd(file, line, "list"));
+		return 0;
+	}
+
+	listBuffer.first = 0;
+	listBuffer.last = 0;
+	listBuffer.length = 0;
+	sdrPut((Address) list, listBuffer);
+	return list;
+}
+
+void	Sdr_ulist_destroy(const char *file, int line, Sdr sdrv, Object list,
+		SdrUlistDeleteFn deleteFn, void *arg)
+{
+	SdrUlist	listBuffer;
+	Object		chunk;
+	SdrUlistChunk	chunkBuffer;
+	int		i;
+
+	if (!(sdr_in_xn(sdrv)))
+	{
+		oK(_iEnd(file, line, _notInXnMsg()));
+		return;
+	}
+
+	joinTrace(sdrv, file, line);
+	if (list == 0)
+	{
+		oK(_xniEnd(file, line, "list", sdrv));
+		return;
+	}
+
+	sdrFetch(listBuffer, (Address) list);
+	for (chunk = listBuffer.first; chunk; chunk = chunkBuffer.next)
+	{
+		sdrFetch(chunkBuffer, (Address) chunk);
+		if (deleteFn)
+		{
+			for (i = 0; i < chunkBuffer.count; i++)
+			{
+				deleteFn(sdrv, readSlot(sdrv, chunk,
+						chunkBuffer.head + i), arg);
+			}
+		}
+
+		sdrFree(chunk);
+	}
+
+	/* just in case user mistakenly accesses later... */
+	listBuffer.first = 0;
+	listBuffer.last = 0;
+	listBuffer.length = 0;
+	sdrPut((Address) list, listBuffer);
+	sdrFree(list);
+}
+
+long	sdr_ulist_length(Sdr sdrv, Object list)
+{
+	SdrUlist	listBuffer;
+
+	CHKERR(list);
+	sdrFetch(listBuffer, (Address) list);
+	return listBuffer.length;
+}
+
+int	Sdr_ulist_push_first(const char *file, int line, Sdr sdrv, Object list,
+		Address data)
+{
+	SdrUlist	listBuffer;
+	SdrUlistChunk	chunkBuffer;
+
+	if (!(sdr_in_xn(sdrv)))
+	{
+		oK(_iEnd(file, line, _notInXnMsg()));
+		return -1;
+	}
+
+	joinTrace(sdrv, file, line);
+	if (list == 0 || data == 0)
+	{
+		oK(_xniEnd(file, line, "list and data", sdrv));
+		return -1;
+	}
+
+	sdrFetch(listBuffer, (Address) list);
+	if (listBuffer.first)
+	{
+		sdrFetch(chunkBuffer, (Address) listBuffer.first);
+		if (chunkBuffer.head > 0)
+		{
+			chunkBuffer.head -= 1;
+			chunkBuffer.count += 1;
+			sdrPut(SLOT_ADDRESS(listBuffer.first,
+					chunkBuffer.head), data);
+			sdrPut((Address) listBuffer.first, chunkBuffer);
+			listBuffer.length += 1;
+			sdrPut((Address) list, listBuffer);
+			return 0;
+		}
+	}
+
+	return addChunk(file, line, sdrv, list, &listBuffer, data, 1);
+}
+
+int	Sdr_ulist_push_last(const char *file, int line, Sdr sdrv, Object list,
+		Address data)
+{
+	SdrUlist	listBuffer;
+	SdrUlistChunk	chunkBuffer;
+	int		slot;
+
+	if (!(sdr_in_xn(sdrv)))
+	{
+		oK(_iEnd(file, line, _notInXnMsg()));
+		return -1;
+	}
+
+	joinTrace(sdrv, file, line);
+	if (list == 0 || data == 0)
+	{
+		oK(_xniEnd(file, line, "list and data", sdrv));
+		return -1;
+	}
+
+	sdrFetch(listBuffer, (Address) list);
+	if (listBuffer.last)
+	{
+		sdrFetch(chunkBuffer, (Address) listBuffer.last);
+		slot = chunkBuffer.head + chunkBuffer.count;
+		if (slot < SDR_ULIST_CHUNK_ENTRIES)
+		{
+			chunkBuffer.count += 1;
+			sdrPut(SLOT_ADDRESS(listBuffer.last, slot), data);
+			sdrPut((Address) listBuffer.last, chunkBuffer);
+			listBuffer.length += 1;
+			sdrPut((Address) list, listBuffer);
+			return 0;
+		}
+	}
+
+	return addChunk(file, line, sdrv, list, &listBuffer, data, 0);
+}
+
+Address	Sdr_ulist_pop_first(const char *file, int line, Sdr sdrv, Object list)
+{
+	SdrUlist	listBuffer;
+	SdrUlistChunk	chunkBuffer;
+	Address		data;
+
+	if (!(sdr_in_xn(sdrv)))
+	{
+		oK(_iEnd(file, line, _notInXnMsg()));
+		return 0;
+	}
+
+	joinTrace(sdrv, file, line);
+	if (list == 0)
+	{
+		oK(_xniEnd(file, line, "list", sdrv));
+		return 0;
+	}
+
+	sdrFetch(listBuffer, (Address) list);
+	if (listBuffer.first == 0)
+	{
+		return 0;
+	}
+
+	sdrFetch(chunkBuffer, (Address) listBuffer.first);
+	data = readSlot(sdrv, listBuffer.first, chunkBuffer.head);
+	if (chunkBuffer.count > 1)
+	{
+		chunkBuffer.head += 1;
+		chunkBuffer.count -= 1;
+		sdrPut((Address) listBuffer.first, chunkBuffer);
+	}
+	else
+	{
+		dropChunk(file, line, sdrv, &listBuffer, &chunkBuffer, 1);
+	}
+
+	listBuffer.length -= 1;
+	sdrPut((Address) list, listBuffer);
+	return data;
+}
+
+Address	Sdr_ulist_pop_last(const char *file, int line, Sdr sdrv, Object list)
+{
+	SdrUlist	listBuffer;
+	SdrUlistChunk	chunkBuffer;
+	Address		data;
+
+	if (!(sdr_in_xn(sdrv)))
+	{
+		oK(_iEnd(file, line, _notInXnMsg()));
+		return 0;
+	}
+
+	joinTrace(sdrv, file, line);
+	if (list == 0)
+	{
+		oK(_xniEnd(file, line, "list", sdrv));
+		return 0;
+	}
+
+	sdrFetch(listBuffer, (Address) list);
+	if (listBuffer.last == 0)
+	{
+		return 0;
+	}
+
+	sdrFetch(chunkBuffer, (Address) listBuffer.last);
+	data = readSlot(sdrv, listBuffer.last,
+			chunkBuffer.head + chunkBuffer.count - 1);
+	if (chunkBuffer.count > 1)
+	{
+		chunkBuffer.count -= 1;
+		sdrPut((Address) listBuffer.last, chunkBuffer);
+	}
+	else
+	{
+		dropChunk(file, line, sdrv, &listBuffer, &chunkBuffer, 0);
+	}
+
+	listBuffer.length -= 1;
+	sdrPut((Address) list, listBuffer);
+	return data;
+}
+
+Address	sdr_ulist_first(Sdr sdrv, Object list, SdrUlistCursor *cursor)
+{
+	SdrUlist	listBuffer;
+	SdrUlistChunk	chunkBuffer;
+
+	CHKZERO(sdrFetchSafe(sdrv));
+	CHKZERO(list);
+	sdrFetch(listBuffer, (Address) list);
+	if (listBuffer.first == 0)
+	{
+		return 0;
+	}
+
+	sdrFetch(chunkBuffer, (Address) listBuffer.first);
+	if (cursor)
+	{
+		cursor->chunk = listBuffer.first;
+		cursor->slot = chunkBuffer.head;
+	}
+
+	return readSlot(sdrv, listBuffer.first, chunkBuffer.head);
+}
+
+Address	sdr_ulist_last(Sdr sdrv, Object list, SdrUlistCursor *cursor)
+{
+	SdrUlist	listBuffer;
+	SdrUlistChunk	chunkBuffer;
+	int		slot;
+
+	CHKZERO(sdrFetchSafe(sdrv));
+	CHKZERO(list);
+	sdrFetch(listBuffer, (Address) list);
+	if (listBuffer.last == 0)
+	{
+		return 0;
+	}
+
+	sdrFetch(chunkBuffer, (Address) listBuffer.last);
+	slot = chunkBuffer.head + chunkBuffer.count - 1;
+	if (cursor)
+	{
+		cursor->chunk = listBuffer.last;
+		cursor->slot = slot;
+	}
+
+	return readSlot(sdrv, listBuffer.last, slot);
+}
+
+Address	Sdr_ulist_traverse(Sdr sdrv, SdrUlistCursor *cursor, int direction)
+{
+	SdrUlistChunk	chunkBuffer;
+
+	CHKZERO(sdrFetchSafe(sdrv));
+	CHKZERO(cursor);
+	CHKZERO(cursor->chunk);
+	sdrFetch(chunkBuffer, (Address) cursor->chunk);
+	if (direction)
+	{
+		cursor->slot += 1;
+		if (cursor->slot >= chunkBuffer.head + chunkBuffer.count)
+		{
+			cursor->chunk = chunkBuffer.next;
+			if (cursor->chunk == 0)
+			{
+				return 0;
+			}
+
+			sdrFetch(chunkBuffer, (Address) cursor->chunk);
+			cursor->slot = chunkBuffer.head;
+		}
+	}
+	else
+	{
+		cursor->slot -= 1;
+		if (cursor->slot < chunkBuffer.head)
+		{
+			cursor->chunk = chunkBuffer.prev;
+			if (cursor->chunk == 0)
+			{
+				return 0;
+			}
+
+			sdrFetch(chunkBuffer, (Address) cursor->chunk);
+			cursor->slot = chunkBuffer.head + chunkBuffer.count - 1;
+		}
+	}
+
+	return readSlot(sdrv, cursor->chunk, cursor->slot);
+}
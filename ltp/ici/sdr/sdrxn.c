@@ -26,6 +26,15 @@
 #define SDR_SEMKEY	(0xeee0)
 #endif
 
+/*	When the dataspace is both in memory and in a file, and the
+ *	SDR is reversible, reads are satisfied from memory and the
+ *	log records every extent written, so the writes to the file
+ *	can wait until the transaction ends.				*/
+
+#define	DS_FILE_DEFERRED	(SDR_IN_DRAM | SDR_IN_FILE | SDR_REVERSIBLE)
+#define	dsWritesDeferred(sdr)	(((sdr)->configFlags & DS_FILE_DEFERRED) \
+== DS_FILE_DEFERRED)
+
 static PsmPartition	_sdrwm(sm_WmParms *parms);
 
 #ifndef SDR_TRACE
@@ -184,6 +193,24 @@ static SdrControlHeader	*_sch(SdrControlHeader **schp)
 					sm_SemDelete(sdr->sdrSemaphore);
 					sdr->sdrSemaphore = SM_SEM_NONE;
 				}
+
+				if (sdr->readSemaphore != SM_SEM_NONE)
+				{
+					sm_SemDelete(sdr->readSemaphore);
+					sdr->readSemaphore = SM_SEM_NONE;
+				}
+
+				if (sdr->writeGate != SM_SEM_NONE)
+				{
+					sm_SemDelete(sdr->writeGate);
+					sdr->writeGate = SM_SEM_NONE;
+				}
+
+				if (sdr->syncSemaphore != SM_SEM_NONE)
+				{
+					sm_SemDelete(sdr->syncSemaphore);
+					sdr->syncSemaphore = SM_SEM_NONE;
+				}
 			}
 
 			sm_SemGive(lock);
@@ -381,19 +408,198 @@ SdrMap	*_mapImage(Sdr sdrv)
 		return (SdrMap *) (sdrv->dssm);
 	}
 
+	if (sdrv->dsmap)
+	{
+		return (SdrMap *) (sdrv->dsmap);
+	}
+
 	sdrFetch(map, 0);
 	return &map;
 }
 
+/*	*	Transaction profiling functions	*	*	*/
+
+/*	Profile data are kept in SDR working memory, so a profile
+ *	accumulates the transactions of all tasks that use the SDR.
+ *	Since the profile is only ever updated by the owner of the
+ *	SDR's transaction lock, it needs no lock of its own.		*/
+
+static int	profileBucket(unsigned long usec)
+{
+	int	msb = 2;
+	int	bucket;
+
+	if (usec < 4)
+	{
+		return usec;
+	}
+
+	while ((usec >> (msb + 1)) != 0)
+	{
+		msb++;
+	}
+
+	bucket = ((msb - 1) << 2) + ((usec >> (msb - 2)) & 3);
+	if (bucket >= SDR_PROFILE_BUCKETS)
+	{
+		bucket = SDR_PROFILE_BUCKETS - 1;
+	}
+
+	return bucket;
+}
+
+static unsigned long	bucketLimit(int bucket)
+{
+	int	msb;
+
+	if (bucket < 4)
+	{
+		return bucket;
+	}
+
+	msb = (bucket >> 2) + 1;
+	return ((unsigned long) (5 + (bucket & 3)) << (msb - 2)) - 1;
+}
+
+static unsigned long	elapsedUsec(struct timeval *from, struct timeval *to)
+{
+	long	usec;
+
+	usec = ((to->tv_sec - from->tv_sec) * 1000000)
+			+ (to->tv_usec - from->tv_usec);
+	return (usec < 0 ? 0 : usec);
+}
+
+static SdrProfileSite	*findProfileSite(SdrProfile *profile,
+				const char *file, int line)
+{
+	const char	*name;
+	const char	*cursor;
+	unsigned int	hash;
+	int		i;
+	SdrProfileSite	*site;
+
+	/*	Sites are keyed by file name without directory path,
+	 *	since the same source may be compiled from different
+	 *	directories.						*/
+
+	name = strrchr(file, ION_PATH_DELIMITER);
+	name = (name == NULL ? file : name + 1);
+	hash = line;
+	for (cursor = name; *cursor; cursor++)
+	{
+		hash = (hash * 31) + *cursor;
+	}
+
+	for (i = 0; i < SDR_PROFILE_SITES; i++)
+	{
+		site = profile->sites + ((hash + i) % SDR_PROFILE_SITES);
+		if (site->lineNbr == 0)		/*	Unused.		*/
+		{
+			site->lineNbr = line;
+			istrcpy(site->sourceFileName, name,
+					sizeof site->sourceFileName);
+			return site;
+		}
+
+		if (site->lineNbr == line && strncmp(site->sourceFileName,
+				name, SDR_PROFILE_NAME_LEN - 1) == 0)
+		{
+			return site;
+		}
+	}
+
+	return NULL;
+}
+
+static void	beginProfiledXn(SdrState *sdr, const char *file, int line,
+			struct timeval *waitStart)
+{
+	SdrProfile	*profile;
+	SdrProfileSite	*site;
+	unsigned long	wait;
+
+	if (sdr->profile == 0)		/*	Stopped meanwhile.	*/
+	{
+		return;
+	}
+
+	profile = (SdrProfile *) psp(_sdrwm(NULL), sdr->profile);
+	getCurrentTime(&sdr->xnStartTime);
+	site = findProfileSite(profile, file, line);
+	if (site == NULL)
+	{
+		profile->xnsUntracked++;
+		return;
+	}
+
+	wait = elapsedUsec(waitStart, &sdr->xnStartTime);
+	site->xnCount++;
+	site->totalWait += wait;
+	if (wait > site->maxWait)
+	{
+		site->maxWait = wait;
+	}
+
+	site->waits[profileBucket(wait)]++;
+	sdr->xnSite = site - profile->sites;
+	sdr->xnWrites = 0;
+	sdr->xnBytesLogged = 0;
+}
+
+static void	endProfiledXn(SdrState *sdr)
+{
+	SdrProfileSite	*site;
+	struct timeval	now;
+	unsigned long	hold;
+
+	if (sdr->xnSite < 0)
+	{
+		return;
+	}
+
+	if (sdr->profile)
+	{
+		site = ((SdrProfile *) psp(_sdrwm(NULL), sdr->profile))->sites
+				+ sdr->xnSite;
+		getCurrentTime(&now);
+		hold = elapsedUsec(&sdr->xnStartTime, &now);
+		site->totalHold += hold;
+		if (hold > site->maxHold)
+		{
+			site->maxHold = hold;
+		}
+
+		site->holds[profileBucket(hold)]++;
+		site->writeCount += sdr->xnWrites;
+		site->bytesLogged += sdr->xnBytesLogged;
+	}
+
+	sdr->xnSite = -1;
+}
+
 /*	*	Mutual exclusion functions	*	*	*	*/
 
 static int	lockSdr(SdrState *sdr)
 {
+	/*	A writer holds the write gate while it waits for the
+	 *	transaction semaphore, so that no new read-only
+	 *	transaction can begin in the meantime; otherwise a
+	 *	steady stream of overlapping readers could keep the
+	 *	writer waiting indefinitely.				*/
+
+	if (sdr->writeGate == SM_SEM_NONE || sm_SemTake(sdr->writeGate) < 0)
+	{
+		return -1;
+	}
+
 	if (sm_SemTake(sdr->sdrSemaphore) < 0)
 	{
+		sm_SemGive(sdr->writeGate);
 		return -1;
 	}
 
+	sm_SemGive(sdr->writeGate);
 	sdr->sdrOwnerThread = pthread_self();
 	sdr->sdrOwnerTask = sm_TaskIdSelf();
 	sdr->xnDepth = 1;
@@ -418,9 +624,27 @@ int	takeSdr(SdrState *sdr)
 	return lockSdr(sdr);
 }
 
-static void	unlockSdr(SdrState *sdr)
+static SdrUnlockFn	unlockFn = NULL;
+
+void	sdr_set_unlock_fn(SdrUnlockFn fn)
+{
+	unlockFn = fn;
+}
+
+static void	unlockSdr(SdrState *sdr, int canceled)
 {
+	endProfiledXn(sdr);
 	sdr->sdrOwnerTask = -1;
+
+	/*	The unlock function runs before the semaphore is
+	 *	given, so that it can publish volatile effects of the
+	 *	transaction before any other task can see the SDR.	*/
+
+	if (unlockFn)
+	{
+		unlockFn(canceled);
+	}
+
 	if (sdr->sdrSemaphore != -1)
 	{
 		sm_SemGive(sdr->sdrSemaphore);
@@ -436,7 +660,7 @@ void	releaseSdr(SdrState *sdr)
 		sdr->xnDepth--;
 		if (sdr->xnDepth == 0)
 		{
-			unlockSdr(sdr);
+			unlockSdr(sdr, 0);
 		}
 	}
 }
@@ -558,7 +782,137 @@ int	_xniEnd(const char *fileName, int lineNbr, const char *arg, Sdr sdrv)
 	the event that it is canceled: the log entries in the list
 	are processed in reverse order, with the original data of
 	each log entry being written back into the indicated start
-	address.							*/
+	address.
+
+	When the log is in a file, log entries are accumulated in a
+	buffer in SDR working memory and are written to the file only
+	when the buffer would overflow or when they must be in the
+	file: before any write to the dataspace file, so that no
+	change to the dataspace file can ever precede the log entry
+	that enables it to be reversed, and before the transaction
+	is reversed.  Because the buffer is in shared memory, entries
+	that a crashed program had not yet written are spilled to
+	the file when the SDR's profile is reloaded.			*/
+
+static int	syncFile(int fd)
+{
+#ifdef unix
+	return fsync(fd);
+#else
+	return 0;
+#endif
+}
+
+static int	writeLogFile(SdrState *sdr, int logfile, char *control,
+			long controlLength, char *data, long dataLength)
+{
+	char	*base[3];
+	long	len[3];
+	int	count = 0;
+	long	total = 0;
+	int	i;
+#ifdef unix
+	struct iovec	iov[3];
+#endif
+
+	/*	The buffered entries and the new entry, if any, are
+	 *	written in a single system call where possible.		*/
+
+	if (sdr->logBuffered > 0)
+	{
+		base[count] = (char *) psp(_sdrwm(NULL), sdr->logBuffer);
+		len[count++] = sdr->logBuffered;
+	}
+
+	if (controlLength > 0)
+	{
+		base[count] = control;
+		len[count++] = controlLength;
+	}
+
+	if (dataLength > 0)
+	{
+		base[count] = data;
+		len[count++] = dataLength;
+	}
+
+	for (i = 0; i < count; i++)
+	{
+		total += len[i];
+	}
+
+	if (total == 0)
+	{
+		return 0;
+	}
+
+#ifdef unix
+	for (i = 0; i < count; i++)
+	{
+		iov[i].iov_base = base[i];
+		iov[i].iov_len = len[i];
+	}
+
+	if (writev(logfile, iov, count) != total)
+	{
+		putSysErrmsg("Can't write to log file", itoa(total));
+		return -1;
+	}
+#else
+	for (i = 0; i < count; i++)
+	{
+		if (write(logfile, base[i], len[i]) != len[i])
+		{
+			putSysErrmsg("Can't write to log file", itoa(len[i]));
+			return -1;
+		}
+	}
+#endif
+	sdr->logFlushed += total;
+	sdr->logBuffered = 0;
+	if (sdr->configFlags & SDR_FULL_SYNC)
+	{
+		if (syncFile(logfile) < 0)
+		{
+			putSysErrmsg("Can't sync log file", NULL);
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+static int	flushLog(Sdr sdrv)
+{
+	if (sdrv->sdr->logBuffered == 0)
+	{
+		return 0;
+	}
+
+	return writeLogFile(sdrv->sdr, sdrv->logfile, NULL, 0, NULL, 0);
+}
+
+static void	spillLogBuffer(SdrState *sdr)
+{
+	char	logfilename[PATHLENMAX + 1 + 32 + 1 + 6 + 1];
+	int	logfile;
+
+	isprintf(logfilename, sizeof logfilename, "%s%c%s.sdrlog",
+			sdr->pathName, ION_PATH_DELIMITER, sdr->name);
+	logfile = open(logfilename, O_RDWR | O_CREAT | O_APPEND, 0777);
+	if (logfile == -1)
+	{
+		putSysErrmsg("Can't open log file", logfilename);
+		return;
+	}
+
+	if (writeLogFile(sdr, logfile, NULL, 0, NULL, 0) < 0)
+	{
+		putErrmsg("Can't spill buffered log entries.", NULL);
+	}
+
+	close(logfile);
+}
 
 static int	readFromLog(int logfile, char *logsm, unsigned long offset,
 			char *into, size_t length, SdrState *sdr)
@@ -685,123 +1039,368 @@ static int	reverseTransaction(SdrState *sdr, int logfile, char *logsm,
 	return 0;
 }
 
-static void	clearTransaction(Sdr sdrv)
+static int	writeDsFile(Sdr sdrv, Address from, long length)
 {
-	char	logfilename[PATHLENMAX + 1 + 32 + 1 + 6 + 1];
-
-	if (sdrv->logfile != -1)
-	{
-		close(sdrv->logfile);
-		sdrv->logfile = -1;
-	}
-
-	if (sdrv->sdr->configFlags & SDR_REVERSIBLE)
-	{
-		if (sdrv->sdr->logSize == 0)	/*	Log is in file.	*/
-		{
-			isprintf(logfilename, sizeof logfilename,
-					"%s%c%s.sdrlog", sdrv->sdr->pathName,
-					ION_PATH_DELIMITER, sdrv->sdr->name);
-			sdrv->logfile = open(logfilename,
-					O_RDWR | O_CREAT | O_TRUNC, 0777);
-			if (sdrv->logfile == -1)
-			{
-				putSysErrmsg("Can't open log file",
-						logfilename);
-			}
-		}
-	}
-
-	if (sdrv->knownObjects)
+	if (lseek(sdrv->dsfile, from, SEEK_SET) < 0
+	|| write(sdrv->dsfile, sdrv->dssm + from, length) < length)
 	{
-		lyst_clear(sdrv->knownObjects);
+		putSysErrmsg("Can't write to dataspace", itoa(length));
+		return -1;
 	}
 
-	sdrv->sdr->logLength = 0;
-	sm_list_clear(_sdrwm(NULL), sdrv->sdr->logEntries, NULL, NULL);
+	return 0;
 }
 
-static void	handleUnrecoverableError(Sdr sdrv)
-{
-	putErrmsg("Unrecoverable SDR error.", NULL);
-#ifdef IN_FLIGHT
-	sdr_abort(sdrv);
-#endif
-	sm_Abort();
-}
+/*	Concurrent read transactions in one process share the file
+ *	descriptor, so reads from the file must not depend on its
+ *	offset.								*/
 
-static void	terminateXn(Sdr sdrv)
+static int	readDsFile(Sdr sdrv, char *into, Address from, long length)
 {
-	SdrState	*sdr = sdrv->sdr;
-
-	if (sdr->xnCanceled == 0)
+#ifdef unix
+	if (pread(sdrv->dsfile, into, length, from) < length)
 	{
-		clearTransaction(sdrv);
-		unlockSdr(sdr);
-		return;
+		return -1;
 	}
-
-	/*	Transaction was canceled.  If cancellation has already
-	 *	triggered restart, nothing more to do; just get out.	*/
-
-	if (!(sdr_in_xn(sdrv)))
+#else
+	if (lseek(sdrv->dsfile, from, SEEK_SET) < 0
+	|| read(sdrv->dsfile, into, length) < length)
 	{
-		return;
+		return -1;
 	}
+#endif
+	return 0;
+}
 
-	/*	Initiate cancellation procedure.			*/
+static int	syncDataspace(Sdr sdrv, Address start, Address end)
+{
+#ifdef SDR_MMAP
+	long	pageSize;
 
-	sdr->xnCanceled = 0;
-	if (!(sdr->configFlags & SDR_REVERSIBLE))
+	if (sdrv->dsmap)
 	{
-		/*	Can't back out; if data modified, bail.	*/
+		if (end <= start)
+		{
+			return 0;	/*	Nothing written.	*/
+		}
 
-		if (sdrv->modified)
+		pageSize = sysconf(_SC_PAGESIZE);
+		start -= (start % pageSize);
+		if (msync(sdrv->dsmap + start, end - start, MS_SYNC) < 0)
 		{
-			handleUnrecoverableError(sdrv);
+			putSysErrmsg("Can't sync dataspace map", NULL);
+			return -1;
 		}
 
-		clearTransaction(sdrv);
-		unlockSdr(sdr);
-		return;
+		return 0;
 	}
-
-	/*	Transaction must be reversed as necessary.		*/
-
-	if (reverseTransaction(sdr, sdrv->logfile, sdrv->logsm, sdrv->dsfile,
-			sdrv->dssm) < 0)
+#endif
+	if (syncFile(sdrv->dsfile) < 0)
 	{
-		handleUnrecoverableError(sdrv);
-
-		/*	In case not aborted....				*/
-
-		clearTransaction(sdrv);
-		unlockSdr(sdr);
-		return;
+		putSysErrmsg("Can't sync dataspace file", NULL);
+		return -1;
 	}
 
-	/*	Reversal succeeded, so try to reboot volatiles.		*/
+	return 0;
+}
 
-	if (sdr->restartCmd[0] == '\0')
-	{
-		/*	No restart utility, so can't do any more.	*/
+static int	commitXn(Sdr sdrv)
+{
+	SdrState	*sdr = sdrv->sdr;
+	PsmPartition	sdrwm = _sdrwm(NULL);
+	char		*logBuffer = NULL;
+	int		bufferStart;
+	PsmAddress	elt;
+	unsigned long	logEntryOffset;
+	unsigned long	logEntryControl[2];	/*	Offset, length.	*/
+	Address		start = 0;
+	Address		end = 0;
 
-		clearTransaction(sdrv);
-		unlockSdr(sdr);
-		return;
+	if (!sdrv->modified || !(sdr->configFlags & SDR_IN_FILE))
+	{
+		return 0;
 	}
 
-	/*	Restart utility provided.				*/
-
-	sdr->halted = 1;	/*	Enable restart to ionAttach.	*/
-	if (pseudoshell(sdr->restartCmd) < 0)
+	if (dsWritesDeferred(sdr))
+	{
+		/*	Write the log first, then the extents it
+		 *	records, coalescing overlapping and adjacent
+		 *	extents.  Entries that were still buffered
+		 *	are read back from the buffer, not the file.	*/
+
+		bufferStart = sdr->logFlushed;
+		if (sdr->logSize == 0)
+		{
+			logBuffer = (char *) psp(sdrwm, sdr->logBuffer);
+			if (flushLog(sdrv) < 0)
+			{
+				return -1;
+			}
+		}
+
+		for (elt = sm_list_first(sdrwm, sdr->logEntries); elt;
+				elt = sm_list_next(sdrwm, elt))
+		{
+			logEntryOffset = (unsigned long) sm_list_data(sdrwm,
+					elt);
+			if (logBuffer && logEntryOffset >= bufferStart)
+			{
+				memcpy((char *) logEntryControl, logBuffer
+						+ (logEntryOffset - bufferStart),
+						sizeof logEntryControl);
+			}
+			else if (readFromLog(sdrv->logfile, sdrv->logsm,
+					logEntryOffset, (char *) logEntryControl,
+					sizeof logEntryControl, sdr) < 0)
+			{
+				putErrmsg("Can't locate log entry.", NULL);
+				return -1;
+			}
+
+			if (end > start && logEntryControl[0] <= end
+			&& logEntryControl[0] + logEntryControl[1] >= start)
+			{
+				if (logEntryControl[0] < start)
+				{
+					start = logEntryControl[0];
+				}
+
+				if (logEntryControl[0] + logEntryControl[1]
+						> end)
+				{
+					end = logEntryControl[0]
+						+ logEntryControl[1];
+				}
+
+				continue;
+			}
+
+			if (end > start && writeDsFile(sdrv, start,
+					end - start) < 0)
+			{
+				return -1;
+			}
+
+			start = logEntryControl[0];
+			end = start + logEntryControl[1];
+		}
+
+		if (end > start && writeDsFile(sdrv, start, end - start) < 0)
+		{
+			return -1;
+		}
+	}
+
+	if (sdr->configFlags & SDR_FULL_SYNC)
+	{
+		if (syncDataspace(sdrv, sdrv->dirtyStart, sdrv->dirtyEnd) < 0)
+		{
+			return -1;
+		}
+	}
+
+	sdr->xnsCommitted++;
+	if ((sdr->configFlags & (SDR_GROUP_SYNC | SDR_FULL_SYNC))
+			== SDR_GROUP_SYNC)
+	{
+		sdrv->xnToSync = sdr->xnsCommitted;
+	}
+
+	return 0;
+}
+
+static int	syncCommits(Sdr sdrv)
+{
+	SdrState	*sdr = sdrv->sdr;
+	unsigned long	xnNbr = sdrv->xnToSync;
+	unsigned long	target;
+
+	/*	Group commit: the SDR has already been released, so
+	 *	other transactions may commit while the dataspace file
+	 *	is being synced; a single sync then makes all of them
+	 *	durable at once.					*/
+
+	sdrv->xnToSync = 0;
+	if (sm_SemTake(sdr->syncSemaphore) < 0)
+	{
+		putErrmsg("Can't take SDR sync semaphore.", NULL);
+		return -1;
+	}
+
+	if ((long) (xnNbr - sdr->xnsSynced) > 0)
+	{
+		/*	No sync since this transaction committed.	*/
+
+		target = sdr->xnsCommitted;
+		if (syncDataspace(sdrv, 0, sdr->dsSize) < 0)
+		{
+			sm_SemGive(sdr->syncSemaphore);
+			return -1;
+		}
+
+		sdr->xnsSynced = target;
+	}
+
+	sm_SemGive(sdr->syncSemaphore);
+	return 0;
+}
+
+static void	clearTransaction(Sdr sdrv)
+{
+	SdrState	*sdr = sdrv->sdr;
+	char		logfilename[PATHLENMAX + 1 + 32 + 1 + 6 + 1];
+
+	/*	The log file need not be truncated if nothing was
+	 *	ever written to it.					*/
+
+	if (sdrv->logfile == -1 || sdr->logFlushed > 0)
+	{
+		if (sdrv->logfile != -1)
+		{
+			close(sdrv->logfile);
+			sdrv->logfile = -1;
+		}
+
+		if (sdr->configFlags & SDR_REVERSIBLE
+		&& sdr->logSize == 0)		/*	Log is in file.	*/
+		{
+			isprintf(logfilename, sizeof logfilename,
+					"%s%c%s.sdrlog", sdr->pathName,
+					ION_PATH_DELIMITER, sdr->name);
+			sdrv->logfile = open(logfilename,
+					O_RDWR | O_CREAT | O_TRUNC, 0777);
+			if (sdrv->logfile == -1)
+			{
+				putSysErrmsg("Can't open log file",
+						logfilename);
+			}
+		}
+	}
+
+	if (sdrv->knownObjects)
+	{
+		lyst_clear(sdrv->knownObjects);
+	}
+
+	if (sdr->lastDirtyLine >= 0)
+	{
+		memset((char *) psp(_sdrwm(NULL), sdr->dirtyLines)
+				+ (sdr->firstDirtyLine >> 3), 0,
+				(sdr->lastDirtyLine >> 3)
+				- (sdr->firstDirtyLine >> 3) + 1);
+		sdr->lastDirtyLine = -1;
+	}
+
+	sdr->logLength = 0;
+	sdr->logBuffered = 0;
+	sdr->logFlushed = 0;
+	sdrv->dirtyStart = 0;
+	sdrv->dirtyEnd = 0;
+	sm_list_clear(_sdrwm(NULL), sdr->logEntries, NULL, NULL);
+}
+
+static void	handleUnrecoverableError(Sdr sdrv)
+{
+	putErrmsg("Unrecoverable SDR error.", NULL);
+#ifdef IN_FLIGHT
+	sdr_abort(sdrv);
+#endif
+	sm_Abort();
+}
+
+static int	terminateXn(Sdr sdrv)
+{
+	SdrState	*sdr = sdrv->sdr;
+	int		dsfile = sdrv->dsfile;
+	char		*dssm = sdrv->dssm;
+
+	if (sdr->xnCanceled == 0)
+	{
+		if (commitXn(sdrv) == 0)
+		{
+			clearTransaction(sdrv);
+			unlockSdr(sdr, 0);
+			return 0;
+		}
+
+		/*	The dataspace file may now be inconsistent,
+		 *	so the transaction must be reversed.		*/
+
+		putErrmsg("Can't commit transaction; reversing it.", NULL);
+		sdr->xnCanceled = 1;
+		sdrv->xnToSync = 0;
+	}
+
+	/*	Transaction was canceled.  If cancellation has already
+	 *	triggered restart, nothing more to do; just get out.	*/
+
+	if (!(sdr_in_xn(sdrv)))
+	{
+		return -1;
+	}
+
+	/*	Initiate cancellation procedure.			*/
+
+	sdr->xnCanceled = 0;
+	if (!(sdr->configFlags & SDR_REVERSIBLE))
+	{
+		/*	Can't back out; if data modified, bail.	*/
+
+		if (sdrv->modified)
+		{
+			handleUnrecoverableError(sdrv);
+		}
+
+		clearTransaction(sdrv);
+		unlockSdr(sdr, 1);
+		return -1;
+	}
+
+	/*	Transaction must be reversed as necessary.  A mapped
+	 *	dataspace file is reversed in the same way as a
+	 *	dataspace in memory.					*/
+
+	if (sdrv->dsmap)
+	{
+		dsfile = -1;
+		dssm = sdrv->dsmap;
+	}
+
+	if (flushLog(sdrv) < 0
+	|| reverseTransaction(sdr, sdrv->logfile, sdrv->logsm, dsfile, dssm)
+			< 0)
+	{
+		handleUnrecoverableError(sdrv);
+
+		/*	In case not aborted....				*/
+
+		clearTransaction(sdrv);
+		unlockSdr(sdr, 1);
+		return -1;
+	}
+
+	/*	Reversal succeeded, so try to reboot volatiles.		*/
+
+	if (sdr->restartCmd[0] == '\0')
+	{
+		/*	No restart utility, so can't do any more.	*/
+
+		clearTransaction(sdrv);
+		unlockSdr(sdr, 1);
+		return -1;
+	}
+
+	/*	Restart utility provided.				*/
+
+	sdr->halted = 1;	/*	Enable restart to ionAttach.	*/
+	if (pseudoshell(sdr->restartCmd) < 0)
 	{
 		writeMemoNote("[!] Can't execute restart command",
 				sdr->restartCmd);
 		sdr->halted = 0;
 		clearTransaction(sdrv);
-		unlockSdr(sdr);
-		return;
+		unlockSdr(sdr, 1);
+		return -1;
 	}
 
 	/*	Restart utility is running; give it time to hijack the
@@ -811,11 +1410,17 @@ static void	terminateXn(Sdr sdrv)
 
 	/*	Transaction still exists, but restart utility is now
 	 *	its owner.  From the perspective of the current task,
-	 *	the transaction is finished; nothing more to do.  The
+	 *	the transaction is finished and canceled; nothing more
+	 *	to do except to say so to the unlock function.  The
 	 *	restart utility will clear the hijacked transaction.	*/
 
+	if (unlockFn)
+	{
+		unlockFn(1);
+	}
+
 	sdr->halted = 0;
-	return;
+	return -1;
 }
 
 void	crashXn(Sdr sdrv)
@@ -946,6 +1551,7 @@ static void	initSdrMap(SdrMap *map, SdrState *sdr)
 {
 	map->catalogue = 0;
 	map->status = INITIALIZED;
+	map->formatVersion = SDR_FORMAT_VERSION;
 	map->dsSize = sdr->dsSize;
 	map->heapSize = sdr->heapSize;
 	map->startOfSmallPool = sizeof(SdrMap);
@@ -955,6 +1561,43 @@ static void	initSdrMap(SdrMap *map, SdrState *sdr)
 	map->startOfLargePool = map->endOfLargePool;
 	memset(map->firstLargeFree, 0, sizeof map->firstLargeFree);
 	map->unassignedSpace = map->startOfLargePool - map->endOfSmallPool;
+	map->firstSlabCache = 0;
+}
+
+static int	checkSdrFormat(SdrMap *map, char *name)
+{
+	if (map->status == INITIALIZED
+	&& map->formatVersion == SDR_FORMAT_VERSION)
+	{
+		return 0;
+	}
+
+	putErrmsg("SDR dataspace format doesn't match this software; \
+SDR must be re-initialized.", name);
+	return -1;
+}
+
+static int	checkDsFileFormat(char *name, char *pathName)
+{
+	char	dsfilename[PATHLENMAX + 1 + 32 + 1 + 3 + 1];
+	int	dsfile;
+	SdrMap	map;
+
+	isprintf(dsfilename, sizeof dsfilename, "%s%c%s.sdr", pathName,
+			ION_PATH_DELIMITER, name);
+	dsfile = open(dsfilename, O_RDONLY, 0);
+	if (dsfile == -1)
+	{
+		return 0;		/*	Not yet created.	*/
+	}
+
+	if (read(dsfile, (char *) &map, sizeof map) < sizeof map)
+	{
+		memset((char *) &map, 0, sizeof map);
+	}
+
+	close(dsfile);
+	return checkSdrFormat(&map, name);
 }
 
 static int	createDsFile(SdrState *sdr, char *dsfilename)
@@ -1063,6 +1706,21 @@ static void	destroySdr(SdrState *sdr)
 		sm_SemDelete(sdr->sdrSemaphore);
 	}
 
+	if (sdr->readSemaphore != SM_SEM_NONE)
+	{
+		sm_SemDelete(sdr->readSemaphore);
+	}
+
+	if (sdr->writeGate != SM_SEM_NONE)
+	{
+		sm_SemDelete(sdr->writeGate);
+	}
+
+	if (sdr->syncSemaphore != SM_SEM_NONE)
+	{
+		sm_SemDelete(sdr->syncSemaphore);
+	}
+
 	/*	Destroy file copy of dataspace if any.			*/
 
 	if (sdr->configFlags & SDR_IN_FILE)
@@ -1111,13 +1769,28 @@ static void	destroySdr(SdrState *sdr)
 		}
 	}
 
-	/*	Destroy list of log entries if any.			*/
+	/*	Destroy list of log entries and log buffer if any.	*/
 
 	if (sdr->logEntries)
 	{
 		oK(sm_list_destroy(sdrwm, sdr->logEntries, NULL, NULL));
 	}
 
+	if (sdr->logBuffer)
+	{
+		psm_free(sdrwm, sdr->logBuffer);
+	}
+
+	if (sdr->dirtyLines)
+	{
+		psm_free(sdrwm, sdr->dirtyLines);
+	}
+
+	if (sdr->profile)
+	{
+		psm_free(sdrwm, sdr->profile);
+	}
+
 	/*	Unload profile and destroy it.				*/
 
 	if (sdr->sdrsElt)
@@ -1209,7 +1882,16 @@ SDR heap data, the heap MUST be resident in memory.", itoa(configFlags));
 		}
 	}
 
-	/*	This is an SDR profile that's not currently loaded.	*/
+	/*	This is an SDR profile that's not currently loaded.
+	 *	A dataspace file left by software that used another
+	 *	format must be refused before anything is done to it.	*/
+
+	if (configFlags & SDR_IN_FILE
+	&& checkDsFileFormat(name, pathName) < 0)
+	{
+		sm_SemGive(lock);
+		return -1;
+	}
 
 	newSdrAddress = psm_zalloc(sdrwm, sizeof(SdrState));
 	if (newSdrAddress == 0)
@@ -1240,6 +1922,9 @@ SDR heap data, the heap MUST be resident in memory.", itoa(configFlags));
 	}
 
 	sdr->logKey = logKey;
+	sdr->syncSemaphore = SM_SEM_NONE;
+	sdr->readSemaphore = SM_SEM_NONE;
+	sdr->writeGate = SM_SEM_NONE;
 	sdr->sdrSemaphore = sm_SemCreate(SM_NO_KEY, SM_SEM_FIFO);
 	if (sdr->sdrSemaphore == SM_SEM_NONE)
 	{
@@ -1248,7 +1933,24 @@ SDR heap data, the heap MUST be resident in memory.", itoa(configFlags));
 		return -1;
 	}
 
+	sdr->readSemaphore = sm_SemCreate(SM_NO_KEY, SM_SEM_FIFO);
+	if (sdr->readSemaphore == SM_SEM_NONE)
+	{
+		putErrmsg("Can't create read semaphore for SDR.", NULL);
+		destroySdr(sdr);		/*	Releases lock.	*/
+		return -1;
+	}
+
+	sdr->writeGate = sm_SemCreate(SM_NO_KEY, SM_SEM_FIFO);
+	if (sdr->writeGate == SM_SEM_NONE)
+	{
+		putErrmsg("Can't create write gate for SDR.", NULL);
+		destroySdr(sdr);		/*	Releases lock.	*/
+		return -1;
+	}
+
 	sdr->sdrOwnerTask = -1;
+	sdr->xnSite = -1;
 	sdr->logEntries = sm_list_create(sdrwm);
 	if (sdr->logEntries == 0)
 	{
@@ -1280,26 +1982,65 @@ in file and transaction reversibility", sdr->pathName);
 		istrcpy(sdr->restartCmd, restartCmd, limit);
 	}
 
-	/*	Add SDR to linked list of defined SDRs.			*/
-
-	sdr->sdrsElt = sm_list_insert_last(sdrwm, sch->sdrs, newSdrAddress);
-	if (sdr->sdrsElt == 0)
+	if (sdr->configFlags & SDR_REVERSIBLE && logSize == 0)
 	{
-		putErrmsg("Can't insert SDR state into list of SDRs.", NULL);
-		destroySdr(sdr);		/*	Releases lock.	*/
-		return -1;
+		sdr->logBuffer = psm_malloc(sdrwm, SDR_LOG_BUFFER_SIZE);
+		if (sdr->logBuffer == 0)
+		{
+			putErrmsg("Can't allocate log buffer for SDR.", NULL);
+			destroySdr(sdr);	/*	Releases lock.	*/
+			return -1;
+		}
 	}
 
-	/*	If SDR exists, back out any current transaction.  If
-	 *	not, create the SDR and initialize it.			*/
-
-	if (sdr->configFlags & SDR_REVERSIBLE)
+	sdr->lastDirtyLine = -1;
+	if (sdr->configFlags & SDR_REVERSIBLE
+	&& sdr->configFlags & SDR_LINE_UNDO)
 	{
-		if (logSize > 0)	/*	Log in memory only.	*/
+		limit = ((sdr->dsSize / SDR_UNDO_LINE_SIZE) >> 3) + 1;
+		sdr->dirtyLines = psm_malloc(sdrwm, limit);
+		if (sdr->dirtyLines == 0)
 		{
-			logsm = NULL;
-			if (sm_ShmAttach(sdr->logKey, sdr->logSize, &logsm,
-					&logsmId) < 0)
+			putErrmsg("Can't allocate undo line map for SDR.",
+					NULL);
+			destroySdr(sdr);	/*	Releases lock.	*/
+			return -1;
+		}
+
+		memset((char *) psp(sdrwm, sdr->dirtyLines), 0, limit);
+	}
+
+	if (sdr->configFlags & SDR_GROUP_SYNC)
+	{
+		sdr->syncSemaphore = sm_SemCreate(SM_NO_KEY, SM_SEM_FIFO);
+		if (sdr->syncSemaphore == SM_SEM_NONE)
+		{
+			putErrmsg("Can't create sync semaphore for SDR.", NULL);
+			destroySdr(sdr);	/*	Releases lock.	*/
+			return -1;
+		}
+	}
+
+	/*	Add SDR to linked list of defined SDRs.			*/
+
+	sdr->sdrsElt = sm_list_insert_last(sdrwm, sch->sdrs, newSdrAddress);
+	if (sdr->sdrsElt == 0)
+	{
+		putErrmsg("Can't insert SDR state into list of SDRs.", NULL);
+		destroySdr(sdr);		/*	Releases lock.	*/
+		return -1;
+	}
+
+	/*	If SDR exists, back out any current transaction.  If
+	 *	not, create the SDR and initialize it.			*/
+
+	if (sdr->configFlags & SDR_REVERSIBLE)
+	{
+		if (logSize > 0)	/*	Log in memory only.	*/
+		{
+			logsm = NULL;
+			if (sm_ShmAttach(sdr->logKey, sdr->logSize, &logsm,
+					&logsmId) < 0)
 			{
 				putErrmsg("Can't attach to log memory.", NULL);
 				destroySdr(sdr);/*	Releases lock.	*/
@@ -1331,6 +2072,8 @@ in file and transaction reversibility", sdr->pathName);
 				destroySdr(sdr);/*	Releases lock.	*/
 				return -1;
 			}
+
+			sdr->logFlushed = sdr->logLength;
 		}
 	}
 
@@ -1409,6 +2152,20 @@ in file and transaction reversibility", sdr->pathName);
 				return -1;
 			}
 
+			/*	A dataspace that persists in memory
+			 *	from software that used another format
+			 *	is unusable, so it is discarded.	*/
+
+			if (checkSdrFormat((SdrMap *) dssm, name) < 0)
+			{
+				sm_ShmDetach(dssm);
+				if (dsfile != -1) close(dsfile);
+				if (logfile != -1) close(logfile);
+				if (logsm) sm_ShmDetach(logsm);
+				destroySdr(sdr);/*	Releases lock.	*/
+				return -1;
+			}
+
 			break;
 
 		default:	/*	Newly allocated partition.	*/
@@ -1501,7 +2258,45 @@ int	sdr_reload_profile(char *name, int configFlags, long heapWords,
 		 *	force reversal of any incomplete transaction
 		 *	that is currently in progress.			*/
 
+		if (sdr->logBuffered > 0)
+		{
+			/*	Entries buffered by a crashed program
+			 *	are needed for the reversal.		*/
+
+			spillLogBuffer(sdr);
+		}
+
 		sm_SemDelete(sdr->sdrSemaphore);
+		if (sdr->readSemaphore != SM_SEM_NONE)
+		{
+			sm_SemDelete(sdr->readSemaphore);
+		}
+
+		if (sdr->writeGate != SM_SEM_NONE)
+		{
+			sm_SemDelete(sdr->writeGate);
+		}
+
+		if (sdr->syncSemaphore != SM_SEM_NONE)
+		{
+			sm_SemDelete(sdr->syncSemaphore);
+		}
+
+		if (sdr->logBuffer)
+		{
+			psm_free(sdrwm, sdr->logBuffer);
+		}
+
+		if (sdr->dirtyLines)
+		{
+			psm_free(sdrwm, sdr->dirtyLines);
+		}
+
+		if (sdr->profile)
+		{
+			psm_free(sdrwm, sdr->profile);
+		}
+
 		psm_free(sdrwm, sdrAddress);
 		oK(sm_list_delete(sdrwm, elt, NULL, NULL));
 	}
@@ -1570,6 +2365,14 @@ Sdr	Sdr_start_using(char *name)
 	sdrv = (SdrView *) psp(sdrwm, sdrViewAddress);
 	memset((char *) sdrv, 0, sizeof(SdrView));
 	sdrv->sdr = sdr;
+	if (pthread_key_create(&(sdrv->readDepthKey), NULL))
+	{
+		sm_SemGive(lock);
+		putSysErrmsg("Can't create read depth key for SDR", name);
+		psm_free(sdrwm, sdrViewAddress);
+		return NULL;
+	}
+
 	if (sdr->configFlags & SDR_IN_FILE)
 	{
 		isprintf(dsfilename, sizeof dsfilename, "%s%c%s.sdr",
@@ -1581,6 +2384,22 @@ Sdr	Sdr_start_using(char *name)
 			putSysErrmsg("Can't open dataspace file", dsfilename);
 			return NULL;
 		}
+#ifdef SDR_MMAP
+		if (!(sdr->configFlags & SDR_IN_DRAM))
+		{
+			sdrv->dsmap = (char *) mmap(NULL, sdr->dsSize,
+					PROT_READ | PROT_WRITE, MAP_SHARED,
+					sdrv->dsfile, 0);
+			if (sdrv->dsmap == (char *) MAP_FAILED)
+			{
+				/*	Fall back to lseek and read/write.*/
+
+				writeMemoNote("[?] Can't map dataspace file",
+						dsfilename);
+				sdrv->dsmap = NULL;
+			}
+		}
+#endif
 	}
 	else
 	{
@@ -1685,6 +2504,12 @@ void	sdr_stop_using(Sdr sdrv)
 
 	/*	Terminate all local SDR state and destroy the Sdr.	*/
 
+#ifdef SDR_MMAP
+	if (sdrv->dsmap)
+	{
+		oK(munmap(sdrv->dsmap, sdrv->sdr->dsSize));
+	}
+#endif
 	if (sdrv->dsfile != -1)
 	{
 		close(sdrv->dsfile);
@@ -1710,6 +2535,8 @@ void	sdr_stop_using(Sdr sdrv)
 		lyst_destroy(sdrv->knownObjects);
 	}
 
+	oK(pthread_key_delete(sdrv->readDepthKey));
+
 	/*	Erase content of SdrView, in case space is re-used
 	 *	for another SdrView; then delete it.			*/
 
@@ -1764,14 +2591,46 @@ void	sdr_destroy(Sdr sdrv)
 
 /*	*	Low-level transaction functions		*	*	*/
 
-int	sdr_begin_xn(Sdr sdrv)
+int	Sdr_begin_xn(const char *file, int line, Sdr sdrv)
 {
+	int		profiling;
+	struct timeval	waitStart;
+
 	CHKZERO(sdrv);
+	CHKZERO(sdrv->sdr);
+
+	/*	A transaction can't be begun within the thread's own
+	 *	read transaction: it would wait forever for the
+	 *	transaction semaphore that its own read transaction
+	 *	holds, all the while holding the write gate against
+	 *	every other reader.					*/
+
+	if (sdr_in_read(sdrv))
+	{
+		_putErrmsg(file, line, "Can't begin transaction within \
+read transaction.", NULL);
+		return 0;
+	}
+
+	/*	Only the outermost transaction is profiled; nested
+	 *	transactions are attributed to it.			*/
+
+	profiling = (sdrv->sdr->profile != 0 && !sdr_in_xn(sdrv));
+	if (profiling)
+	{
+		getCurrentTime(&waitStart);
+	}
+
 	if (takeSdr(sdrv->sdr) < 0)
 	{
 		return 0;	/*	Failed to begin transaction.	*/
 	}
 
+	if (profiling)
+	{
+		beginProfiledXn(sdrv->sdr, file, line, &waitStart);
+	}
+
 	sdrv->modified = 0;
 	return 1;		/*	Began transaction.		*/
 }
@@ -1792,7 +2651,8 @@ int	sdr_heap_is_halted(Sdr sdrv)
 
 int	sdrFetchSafe(Sdr sdrv)
 {
-	return (sdr_in_xn(sdrv) || sdr_heap_is_halted(sdrv));
+	return (sdr_in_xn(sdrv) || sdr_in_read(sdrv)
+			|| sdr_heap_is_halted(sdrv));
 }
 
 void	sdr_exit_xn(Sdr sdrv)
@@ -1818,7 +2678,7 @@ void	sdr_exit_xn(Sdr sdrv)
 			}
 
 			clearTransaction(sdrv);
-			unlockSdr(sdr);
+			unlockSdr(sdr, 0);
 		}
 	}
 }
@@ -1851,7 +2711,15 @@ int	sdr_end_xn(Sdr sdrv)
 		sdr->xnDepth--;
 		if (sdr->xnDepth == 0)
 		{
-			terminateXn(sdrv);
+			if (terminateXn(sdrv) < 0)
+			{
+				return -1;	/*	Reversed.	*/
+			}
+
+			if (sdrv->xnToSync)
+			{
+				return syncCommits(sdrv);
+			}
 		}
 
 		return 0;
@@ -1860,6 +2728,131 @@ int	sdr_end_xn(Sdr sdrv)
 	return -1;
 }
 
+/*	Read transactions share the SDR's transaction semaphore as
+ *	a readers-writer lock: the first of any number of concurrent
+ *	readers takes the semaphore on behalf of all of them, and the
+ *	last to finish gives it back.  The reader count is guarded by
+ *	the read semaphore, which a writer never takes.  A writer
+ *	does hold the write gate while it waits for the transaction
+ *	semaphore, and a reader must pass through the write gate
+ *	before joining the readers, so once a writer is waiting no
+ *	new read transaction begins until that writer is done.
+ *
+ *	Each thread's depth of nested read transactions is thread-
+ *	specific data of the SdrView, so a nested read transaction
+ *	neither passes through the write gate (where it could wait
+ *	forever on a writer that is waiting for it) nor counts as a
+ *	second reader, and one thread's read transaction does not
+ *	make sdr_in_read true for any other thread of the process.
+ *	A read transaction begun within the thread's own write
+ *	transaction simply nests in that transaction.			*/
+
+static int	readDepth(Sdr sdrv)
+{
+	return (int) ((long) pthread_getspecific(sdrv->readDepthKey));
+}
+
+static void	setReadDepth(Sdr sdrv, int depth)
+{
+	oK(pthread_setspecific(sdrv->readDepthKey, (void *) ((long) depth)));
+}
+
+int	sdr_begin_read(Sdr sdrv)
+{
+	SdrState	*sdr;
+	int		depth;
+
+	CHKZERO(sdrv);
+	sdr = sdrv->sdr;
+	CHKZERO(sdr);
+	if (sdr_in_xn(sdrv))
+	{
+		sdr->xnDepth++;
+		return 1;		/*	Nested in own xn.	*/
+	}
+
+	depth = readDepth(sdrv);
+	if (depth > 0)
+	{
+		setReadDepth(sdrv, depth + 1);
+		return 1;		/*	Nested in own read.	*/
+	}
+
+	if (sdr->writeGate == SM_SEM_NONE
+	|| sm_SemTake(sdr->writeGate) < 0)
+	{
+		return 0;	/*	Failed to begin transaction.	*/
+	}
+
+	sm_SemGive(sdr->writeGate);
+	if (sdr->readSemaphore == SM_SEM_NONE
+	|| sm_SemTake(sdr->readSemaphore) < 0)
+	{
+		return 0;	/*	Failed to begin transaction.	*/
+	}
+
+	if (sdr->readers == 0)
+	{
+		if (sdr->sdrSemaphore == SM_SEM_NONE
+		|| sm_SemEnded(sdr->sdrSemaphore)
+		|| sm_SemTake(sdr->sdrSemaphore) < 0)
+		{
+			sm_SemGive(sdr->readSemaphore);
+			return 0;	/*	Can't be taken.		*/
+		}
+	}
+
+	sdr->readers++;
+	sm_SemGive(sdr->readSemaphore);
+	setReadDepth(sdrv, 1);
+	return 1;		/*	Began transaction.		*/
+}
+
+int	sdr_in_read(Sdr sdrv)
+{
+	CHKZERO(sdrv);
+	return (readDepth(sdrv) > 0);
+}
+
+void	sdr_end_read(Sdr sdrv)
+{
+	SdrState	*sdr;
+	int		depth;
+
+	CHKVOID(sdrv);
+	sdr = sdrv->sdr;
+	CHKVOID(sdr);
+	if (sdr_in_xn(sdrv))
+	{
+		sdr_exit_xn(sdrv);
+		return;
+	}
+
+	depth = readDepth(sdrv);
+	CHKVOID(depth > 0);
+	setReadDepth(sdrv, depth - 1);
+	if (depth > 1)
+	{
+		return;			/*	Still in outer read.	*/
+	}
+
+	if (sm_SemTake(sdr->readSemaphore) < 0)
+	{
+		return;
+	}
+
+	if (sdr->readers > 0)		/*	Else ejected.		*/
+	{
+		sdr->readers--;
+		if (sdr->readers == 0 && sdr->sdrSemaphore != SM_SEM_NONE)
+		{
+			sm_SemGive(sdr->sdrSemaphore);
+		}
+	}
+
+	sm_SemGive(sdr->readSemaphore);
+}
+
 void	sdr_eject_xn(Sdr sdrv)
 {
 	SdrState	*sdr;
@@ -1871,12 +2864,211 @@ void	sdr_eject_xn(Sdr sdrv)
 
 	CHKVOID(sdrv);
 	sdr = sdrv->sdr;
-	if (sdr != NULL)
+	if (sdr == NULL)
+	{
+		return;
+	}
+
+	/*	If the transaction semaphore is held by read
+	 *	transactions, one of whose owners has crashed, the
+	 *	semaphore is released on behalf of all of them: the
+	 *	reader count is cleared (so that the read transactions
+	 *	of any surviving readers end without effect) and the
+	 *	read semaphore is forcibly released in case the
+	 *	crashed reader held it.					*/
+
+	if (sdr->readers > 0)
+	{
+		oK(sm_SemUnwedge(sdr->readSemaphore, 3));
+		if (sm_SemTake(sdr->readSemaphore) < 0)
+		{
+			putErrmsg("Can't eject read transactions.", NULL);
+			return;
+		}
+
+		sdr->readers = 0;
+		if (sdr->sdrSemaphore != SM_SEM_NONE)
+		{
+			sm_SemGive(sdr->sdrSemaphore);
+		}
+
+		sm_SemGive(sdr->readSemaphore);
+	}
+	else
 	{
 		sdr->xnCanceled = 1;
 		sdr->xnDepth = 0;
 		terminateXn(sdrv);
 	}
+
+	/*	A writer that crashed while waiting for the transaction
+	 *	semaphore would have left the write gate closed.	*/
+
+	oK(sm_SemUnwedge(sdr->writeGate, 3));
+}
+
+/*	*	Transaction profile management functions	*	*/
+
+int	sdr_start_profile(Sdr sdrv)
+{
+	PsmPartition	sdrwm = _sdrwm(NULL);
+	SdrState	*sdr;
+
+	CHKERR(sdrv);
+	sdr = sdrv->sdr;
+	CHKERR(takeSdr(sdr) == 0);
+	if (sdr->profile == 0)	/*	Profiling not yet enabled.	*/
+	{
+		sdr->profile = psm_malloc(sdrwm, sizeof(SdrProfile));
+		if (sdr->profile == 0)
+		{
+			releaseSdr(sdr);
+			putErrmsg("Can't allocate SDR transaction profile.",
+					utoa(sizeof(SdrProfile)));
+			return -1;
+		}
+
+		memset((char *) psp(sdrwm, sdr->profile), 0,
+				sizeof(SdrProfile));
+	}
+
+	releaseSdr(sdr);
+	return 0;
+}
+
+static unsigned long	histogramPercentile(unsigned int *histogram,
+				int percent, unsigned long max)
+{
+	unsigned long	total = 0;
+	unsigned long	threshold;
+	unsigned long	count = 0;
+	int		i;
+
+	for (i = 0; i < SDR_PROFILE_BUCKETS; i++)
+	{
+		total += histogram[i];
+	}
+
+	threshold = ((total * percent) + 99) / 100;
+	for (i = 0; i < SDR_PROFILE_BUCKETS; i++)
+	{
+		count += histogram[i];
+		if (count >= threshold && count > 0)
+		{
+			break;
+		}
+	}
+
+	if (i == SDR_PROFILE_BUCKETS || bucketLimit(i) > max)
+	{
+		return max;
+	}
+
+	return bucketLimit(i);
+}
+
+int	sdr_get_profile(Sdr sdrv, SdrXnProfile *sites, int maxSites)
+{
+	SdrState	*sdr;
+	SdrProfile	*profile;
+	char		reported[SDR_PROFILE_SITES];
+	SdrProfileSite	*site;
+	SdrProfileSite	*worst;
+	SdrXnProfile	*result;
+	int		count;
+	int		i;
+
+	CHKERR(sdrv);
+	CHKERR(sites);
+	sdr = sdrv->sdr;
+	CHKERR(takeSdr(sdr) == 0);
+	if (sdr->profile == 0)	/*	Profiling not enabled.		*/
+	{
+		releaseSdr(sdr);
+		return -1;
+	}
+
+	profile = (SdrProfile *) psp(_sdrwm(NULL), sdr->profile);
+	memset(reported, 0, sizeof reported);
+	for (count = 0, result = sites; count < maxSites; count++, result++)
+	{
+		worst = NULL;
+		for (i = 0, site = profile->sites; i < SDR_PROFILE_SITES;
+				i++, site++)
+		{
+			if (site->lineNbr == 0 || reported[i])
+			{
+				continue;
+			}
+
+			if (worst == NULL || site->totalHold > worst->totalHold)
+			{
+				worst = site;
+			}
+		}
+
+		if (worst == NULL)	/*	All sites reported.	*/
+		{
+			break;
+		}
+
+		reported[worst - profile->sites] = 1;
+		memcpy(result->sourceFileName, worst->sourceFileName,
+				SDR_PROFILE_NAME_LEN);
+		result->lineNbr = worst->lineNbr;
+		result->xnCount = worst->xnCount;
+		result->writeCount = worst->writeCount;
+		result->bytesLogged = worst->bytesLogged;
+		result->totalWait = worst->totalWait;
+		result->totalHold = worst->totalHold;
+		result->medianWait = histogramPercentile(worst->waits, 50,
+				worst->maxWait);
+		result->p99Wait = histogramPercentile(worst->waits, 99,
+				worst->maxWait);
+		result->maxWait = worst->maxWait;
+		result->medianHold = histogramPercentile(worst->holds, 50,
+				worst->maxHold);
+		result->p99Hold = histogramPercentile(worst->holds, 99,
+				worst->maxHold);
+		result->maxHold = worst->maxHold;
+	}
+
+	releaseSdr(sdr);
+	return count;
+}
+
+void	sdr_clear_profile(Sdr sdrv)
+{
+	SdrState	*sdr;
+
+	CHKVOID(sdrv);
+	sdr = sdrv->sdr;
+	CHKVOID(takeSdr(sdr) == 0);
+	if (sdr->profile)
+	{
+		memset((char *) psp(_sdrwm(NULL), sdr->profile), 0,
+				sizeof(SdrProfile));
+	}
+
+	sdr->xnSite = -1;	/*	Caller's own xn, if any.	*/
+	releaseSdr(sdr);
+}
+
+void	sdr_stop_profile(Sdr sdrv)
+{
+	SdrState	*sdr;
+
+	CHKVOID(sdrv);
+	sdr = sdrv->sdr;
+	CHKVOID(takeSdr(sdr) == 0);
+	if (sdr->profile)
+	{
+		psm_free(_sdrwm(NULL), sdr->profile);
+		sdr->profile = 0;
+	}
+
+	sdr->xnSite = -1;	/*	Caller's own xn, if any.	*/
+	releaseSdr(sdr);
 }
 
 void	*sdr_pointer(Sdr sdrv, Address address)
@@ -1906,34 +3098,209 @@ Address	sdr_address(Sdr sdrv, void *pointer)
 
 /*	*	Low-level I/O functions		*	*	*	*/
 
-static int	writeToLog(const char *file, int line, Sdr sdrv, char *from,
-			long length)
+static int	writeLogEntry(const char *file, int line, Sdr sdrv,
+			unsigned long *control, char *data, long length)
 {
 	SdrState	*sdr = sdrv->sdr;
+	long		controlLength = 2 * sizeof(unsigned long);
+	long		entryLength = controlLength + length;
+	char		*buffer;
 
 	if (sdr->logSize == 0)		/*	Log is in file.		*/
 	{
-		if (write(sdrv->logfile, from, length) != length)
+		if (sdr->logBuffered + entryLength > SDR_LOG_BUFFER_SIZE)
 		{
-			_putSysErrmsg(file, line, "Can't write log entry",
-					itoa(length));
-			return -1;
+			/*	Write buffer and entry together.	*/
+
+			if (writeLogFile(sdr, sdrv->logfile, (char *) control,
+					controlLength, data, length) < 0)
+			{
+				return -1;
+			}
+		}
+		else
+		{
+			buffer = (char *) psp(_sdrwm(NULL), sdr->logBuffer)
+					+ sdr->logBuffered;
+			memcpy(buffer, (char *) control, controlLength);
+			memcpy(buffer + controlLength, data, length);
+			sdr->logBuffered += entryLength;
 		}
 	}
 	else				/*	Log is in memory.	*/
 	{
-		if (sdr->logLength + length > sdr->logSize)
+		if (sdr->logLength + entryLength > sdr->logSize)
 		{
 			_putErrmsg(file, line, "Log max size exceeded.",
 					itoa(length));
 			return -1;
 		}
 
-		memcpy(sdrv->logsm + sdr->logLength, (char *) from, length);
+		memcpy(sdrv->logsm + sdr->logLength, (char *) control,
+				controlLength);
+		memcpy(sdrv->logsm + sdr->logLength + controlLength, data,
+				length);
+	}
+
+	sdr->logLength += entryLength;
+	sdr->xnBytesLogged += entryLength;
+	return entryLength;
+}
+
+static int	logExtent(const char *file, int line, Sdr sdrv, Address into,
+			long length)
+{
+	SdrState	*sdr = sdrv->sdr;
+	unsigned long	logEntryControl[2];
+	char		*buffer;
+	long		logOffset;
+	int		result;
+
+	logOffset = sdr->logLength;	/*	Before writing.		*/
+	logEntryControl[0] = into;
+	logEntryControl[1] = length;
+	if (sdr->configFlags & SDR_IN_DRAM)
+	{
+		result = writeLogEntry(file, line, sdrv, logEntryControl,
+				sdrv->dssm + into, length);
+	}
+	else if (sdrv->dsmap)
+	{
+		result = writeLogEntry(file, line, sdrv, logEntryControl,
+				sdrv->dsmap + into, length);
+	}
+	else	/*	Dataspace is only in file.			*/
+	{
+		buffer = MTAKE(length);
+		if (buffer == NULL)
+		{
+			_putErrmsg(file, line, "Not enough memory for log \
+entry.", itoa(length));
+			return -1;
+		}
+
+		if (lseek(sdrv->dsfile, into, SEEK_SET) < 0
+		|| read(sdrv->dsfile, buffer, length) < length)
+		{
+			MRELEASE(buffer);
+			_putSysErrmsg(file, line, "Can't read old data",
+					itoa(length));
+			return -1;
+		}
+
+		result = writeLogEntry(file, line, sdrv, logEntryControl,
+				buffer, length);
+		MRELEASE(buffer);
+	}
+
+	if (result < 0)
+	{
+		_putErrmsg(file, line, "Can't write log entry", itoa(length));
+		return -1;
+	}
+
+	/*	Store location of newly written log entry.		*/
+
+	if (sm_list_insert_last(_sdrwm(NULL), sdr->logEntries,
+			(PsmAddress) logOffset) == 0)
+	{
+		_putErrmsg(file, line, "Can't note transaction log entry.",
+				NULL);
+		return -1;
+	}
+
+	return 0;
+}
+
+static int	logLines(const char *file, int line, Sdr sdrv, Address from,
+			Address to)
+{
+	SdrState	*sdr = sdrv->sdr;
+	unsigned char	*dirtyLines;
+	long		lineNbr;
+	long		lastLine;
+	Address		lineStart;
+	long		lineLength;
+
+	/*	Each undo line is logged in full, once, the first
+	 *	time any of its bytes is written in the transaction.
+	 *	Later writes to the same line need no logging.		*/
+
+	dirtyLines = (unsigned char *) psp(_sdrwm(NULL), sdr->dirtyLines);
+	lastLine = (to - 1) / SDR_UNDO_LINE_SIZE;
+	for (lineNbr = from / SDR_UNDO_LINE_SIZE; lineNbr <= lastLine;
+			lineNbr++)
+	{
+		if (dirtyLines[lineNbr >> 3] & (1 << (lineNbr & 7)))
+		{
+			continue;	/*	Already logged.		*/
+		}
+
+		lineStart = lineNbr * SDR_UNDO_LINE_SIZE;
+		lineLength = SDR_UNDO_LINE_SIZE;
+		if (lineStart + lineLength > sdr->dsSize)
+		{
+			lineLength = sdr->dsSize - lineStart;
+		}
+
+		if (logExtent(file, line, sdrv, lineStart, lineLength) < 0)
+		{
+			return -1;
+		}
+
+		dirtyLines[lineNbr >> 3] |= (1 << (lineNbr & 7));
+		if (sdr->lastDirtyLine < 0)
+		{
+			sdr->firstDirtyLine = lineNbr;
+			sdr->lastDirtyLine = lineNbr;
+		}
+		else if (lineNbr < sdr->firstDirtyLine)
+		{
+			sdr->firstDirtyLine = lineNbr;
+		}
+		else if (lineNbr > sdr->lastDirtyLine)
+		{
+			sdr->lastDirtyLine = lineNbr;
+		}
 	}
 
-	sdr->logLength += length;
-	return length;
+	return 0;
+}
+
+static int	linesLogged(Sdr sdrv, Address from, Address to)
+{
+	SdrState	*sdr = sdrv->sdr;
+	unsigned char	*dirtyLines;
+	long		lineNbr;
+	long		lastLine;
+
+	if (!(sdr->configFlags & SDR_LINE_UNDO) || sdr->lastDirtyLine < 0)
+	{
+		return 0;
+	}
+
+	dirtyLines = (unsigned char *) psp(_sdrwm(NULL), sdr->dirtyLines);
+	lastLine = (to - 1) / SDR_UNDO_LINE_SIZE;
+	if (lastLine > sdr->lastDirtyLine)
+	{
+		lastLine = sdr->lastDirtyLine;
+	}
+
+	lineNbr = from / SDR_UNDO_LINE_SIZE;
+	if (lineNbr < sdr->firstDirtyLine)
+	{
+		lineNbr = sdr->firstDirtyLine;
+	}
+
+	for (; lineNbr <= lastLine; lineNbr++)
+	{
+		if (dirtyLines[lineNbr >> 3] & (1 << (lineNbr & 7)))
+		{
+			return 1;
+		}
+	}
+
+	return 0;
 }
 
 void	_sdrput(const char *file, int line, Sdr sdrv, Address into, char *from,
@@ -1941,9 +3308,7 @@ void	_sdrput(const char *file, int line, Sdr sdrv, Address into, char *from,
 {
 	SdrState	*sdr;
 	Address		to;
-	unsigned long	logEntryControl[2];
-	char		*buffer;
-	long		logOffset;
+	int		result;
 
 	if (length == 0)
 	{
@@ -1963,7 +3328,7 @@ void	_sdrput(const char *file, int line, Sdr sdrv, Address into, char *from,
 		return;
 	}
 
-	if (sdr->configFlags & SDR_BOUNDED && src == UserPut)
+	if (sdr->configFlags & SDR_BOUNDED && src != SystemPut)
 	{
 		if (sdrBoundaryViolated(sdrv, into, length))
 		{
@@ -1973,79 +3338,63 @@ void	_sdrput(const char *file, int line, Sdr sdrv, Address into, char *from,
 		}
 	}
 
-	if (sdr->configFlags & SDR_REVERSIBLE)
+	sdr->xnWrites++;
+
+	/*	Scratch writes are never logged: the overwritten
+	 *	bytes are not restored if the transaction is reversed
+	 *	(unless they share an undo line with logged bytes).	*/
+
+	if (sdr->configFlags & SDR_REVERSIBLE && src != ScratchPut)
 	{
-		logOffset = sdr->logLength;	/*	Before writing.	*/
-		logEntryControl[0] = into;
-		logEntryControl[1] = length;
-		if (writeToLog(file, line, sdrv, (char *) logEntryControl,
-				sizeof logEntryControl) < 0)
+		if (sdr->configFlags & SDR_LINE_UNDO)
+		{
+			result = logLines(file, line, sdrv, into, to);
+		}
+		else
+		{
+			result = logExtent(file, line, sdrv, into, length);
+		}
+
+		if (result < 0)
 		{
-			_putSysErrmsg(file, line, "Can't write logEntryControl",
-					NULL);
 			crashXn(sdrv);
 			return;
 		}
+	}
 
-		if (sdr->configFlags & SDR_IN_DRAM)
+	/*	Unless deferred to the end of the transaction, the
+	 *	write to the dataspace file must follow the writing
+	 *	of all log entries to the log file.  A scratch write
+	 *	need wait for the log only if it lands in an undo
+	 *	line that has been logged, since only then will the
+	 *	bytes it overwrites be restored on reversal.		*/
+
+	if (sdr->configFlags & SDR_IN_FILE
+	&& (src == ScratchPut || !dsWritesDeferred(sdr)))
+	{
+		if (sdr->logBuffered > 0
+		&& (src != ScratchPut || linesLogged(sdrv, into, to))
+		&& flushLog(sdrv) < 0)
 		{
-			if (writeToLog(file, line, sdrv, sdrv->dssm + into,
-					length) < 0)
-			{
-				_putSysErrmsg(file, line, "Can't write log \
-entry", itoa(length));
-				crashXn(sdrv);
-				return;
-			}
+			_putErrmsg(file, line, "Can't flush log", NULL);
+			crashXn(sdrv);
+			return;
 		}
-		else	/*	Dataspace is only in file.		*/
-		{
-			buffer = MTAKE(length);
-			if (buffer == NULL)
-			{
-				_putErrmsg(file, line, "Not enough memory for \
-log entry.", itoa(length));
-				crashXn(sdrv);
-				return;
-			}
 
-			if (lseek(sdrv->dsfile, into, SEEK_SET) < 0
-			|| read(sdrv->dsfile, buffer, length) < length)
+		if (sdrv->dsmap)
+		{
+			memcpy(sdrv->dsmap + into, from, length);
+			if (sdrv->dirtyEnd == 0 || into < sdrv->dirtyStart)
 			{
-				MRELEASE(buffer);
-				_putSysErrmsg(file, line, "Can't read old data",
-						itoa(length));
-				crashXn(sdrv);
-				return;
+				sdrv->dirtyStart = into;
 			}
 
-			if (writeToLog(file, line, sdrv, buffer, length) < 0)
+			if (to > sdrv->dirtyEnd)
 			{
-				MRELEASE(buffer);
-				_putSysErrmsg(file, line, "Can't write log \
-entry", itoa(length));
-				crashXn(sdrv);
-				return;
+				sdrv->dirtyEnd = to;
 			}
-
-			MRELEASE(buffer);
-		}
-
-		/*	Store location of newly written log entry.	*/
-
-		if (sm_list_insert_last(_sdrwm(NULL), sdr->logEntries,
-				(PsmAddress) logOffset) == 0)
-		{
-			_putErrmsg(file, line, "Can't note transaction log \
-entry.", NULL);
-			crashXn(sdrv);
-			return;
 		}
-	}
-
-	if (sdr->configFlags & SDR_IN_FILE)
-	{
-		if (lseek(sdrv->dsfile, into, SEEK_SET) < 0
+		else if (lseek(sdrv->dsfile, into, SEEK_SET) < 0
 		|| write(sdrv->dsfile, from, length) < length)
 		{
 			_putSysErrmsg(file, line, "Can't write to dataspace",
@@ -2076,6 +3425,19 @@ void	Sdr_write(const char *file, int line, Sdr sdrv, Address into,
 	_sdrput(file, line, sdrv, into, from, length, UserPut);
 }
 
+void	Sdr_write_scratch(const char *file, int line, Sdr sdrv, Address into,
+		char *from, long length)
+{
+	if (!(sdr_in_xn(sdrv)))
+	{
+		oK(_iEnd(file, line, _notInXnMsg()));
+		return;
+	}
+
+	joinTrace(sdrv, file, line);
+	_sdrput(file, line, sdrv, into, from, length, ScratchPut);
+}
+
 void	sdr_read(Sdr sdrv, char *into, Address from, long length)
 {
 	SdrState	*sdr;
@@ -2105,12 +3467,15 @@ void	sdr_read(Sdr sdrv, char *into, Address from, long length)
 	{
 		memcpy(into, sdrv->dssm + from, length);
 	}
+	else if (sdrv->dsmap)
+	{
+		memcpy(into, sdrv->dsmap + from, length);
+	}
 	else
 	{
 		if (sdr->configFlags & SDR_IN_FILE)
 		{
-			if (lseek(sdrv->dsfile, from, SEEK_SET) < 0
-			|| read(sdrv->dsfile, into, length) < length)
+			if (readDsFile(sdrv, into, from, length) < 0)
 			{
 				putSysErrmsg("Dataspace read failed",
 						itoa(length));
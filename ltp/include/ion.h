@@ -388,6 +388,7 @@ extern int		_extractSmallSdnv(unsigned int *into,
 					int lineNbr);
 
 extern int		ionLocked();
+extern int		ionReadLocked();
 
 extern void		ionNoteMainThread(char *procName);
 extern void		ionPauseMainThread(int seconds);
@@ -34,14 +34,28 @@ extern int	ltp_engine_is_started();
 		/*	Returns 1 if the local LTP engine has been
 		 *	started and not yet stopped, 0 otherwise.	*/
 
+extern int	ltp_span_shard(uvast destinationEngineId);
+		/*	If the local node's spans are served by several
+		 *	LTP engine instances ("shards", see the "m
+		 *	shard" command in ltprc(5)), returns the number
+		 *	of the shard that serves the span to the
+		 *	indicated engine; otherwise returns 0.  The
+		 *	functions of this API operate only on the spans
+		 *	and clients of the shard to which the calling
+		 *	process is attached, so an application must
+		 *	attach to the shard that serves its span.
+		 *	Returns -1 on any error.			*/
+
 /*	*	*	LTP data transmission	*	*	*	*/
 
-#define	LTP_ALL_RED	((unsigned int) -1)
+#define	LTP_ALL_RED	((uvast) -1)
+
+#define	LTP_NONBLOCK	(1)
 
 extern int	ltp_send(uvast destinationEngineId,
 			unsigned int clientId,
 			Object clientServiceData,
-			unsigned int redLength,
+			uvast redLength,
 			LtpSessionId *sessionId);
 		/*	clientServiceData must be a "zero-copy object"
 	 	 *	reference as returned by ionCreateZco().  Note
@@ -52,6 +66,57 @@ extern int	ltp_send(uvast destinationEngineId,
 		 *	data unit is to be sent reliably, redLength
 		 *	may be simply LTP_ALL_RED.	 		*/
 
+extern int	ltp_send_many(uvast destinationEngineId,
+			unsigned int clientId,
+			Object *clientServiceData,
+			uvast *redLengths,
+			int sduCount,
+			LtpSessionId *sessionIds,
+			int flags);
+		/*	Sends sduCount client service data units, each
+		 *	as if by ltp_send, but appends to each block as
+		 *	many of the SDUs as the block can hold in a
+		 *	single transaction.  SDUs that don't fit into
+		 *	the block currently being aggregated are sent
+		 *	in subsequent blocks.  The session ID of the
+		 *	block carrying clientServiceData[i] is placed
+		 *	in sessionIds[i].  Returns the number of SDUs
+		 *	sent, which is less than sduCount only if the
+		 *	span was stopped, or -1 on any error.
+		 *
+		 *	If flags includes LTP_NONBLOCK, ltp_send_many
+		 *	never waits for a block to be opened: it
+		 *	returns as soon as an SDU can't be appended to
+		 *	the current block.  A return value between 1
+		 *	and sduCount - 1 means that the remaining SDUs
+		 *	were not sent, for either reason; calling
+		 *	ltp_send_many again for the remaining SDUs
+		 *	tells which.  A return value of 0 means that
+		 *	the span was stopped, and the application
+		 *	should give up.  A return value of -2, with
+		 *	errno set to EWOULDBLOCK, means that no SDU
+		 *	could be sent without blocking; the application
+		 *	can poll the span's readiness file descriptor
+		 *	(see ltp_span_fd) before trying again.		*/
+
+extern int	ltp_span_fd(uvast destinationEngineId);
+		/*	Returns a file descriptor that becomes readable
+		 *	whenever it may again be possible to append
+		 *	SDUs to the block being aggregated for the span
+		 *	to the indicated engine, e.g., because an export
+		 *	session has closed and freed capacity in the
+		 *	span's flow control window.  The descriptor may
+		 *	be monitored by poll, select, or epoll; when it
+		 *	is readable, call ltp_drain_fd before retrying
+		 *	ltp_send_many.  Returns -1 on any error.	*/
+
+extern void	ltp_close_span_fd(uvast destinationEngineId, int fd);
+
+extern void	ltp_drain_fd(int fd);
+		/*	Discards all pending readiness indications
+		 *	from a file descriptor returned by an LTP
+		 *	readiness function.				*/
+
 /*	*	*	LTP data reception	*	*	*	*/
 
 typedef enum
@@ -66,6 +131,17 @@ typedef enum
 	LtpImportSessionCanceled
 } LtpNoticeType;
 
+typedef struct
+{
+	LtpSessionId	sessionId;
+	uvast		dataOffset;
+	uvast		dataLength;
+	LtpNoticeType	type;
+	unsigned char	reasonCode;
+	unsigned char	endOfBlock;	/*	Boolean.		*/
+	Object		data;		/*	To be serialized.	*/
+} LtpNotice;
+
 extern int	ltp_open(unsigned int clientId);
 
 extern int	ltp_get_notice(unsigned int clientId,
@@ -73,8 +149,8 @@ extern int	ltp_get_notice(unsigned int clientId,
 			LtpSessionId *sessionId,
 			unsigned char *reasonCode,
 			unsigned char *endOfBlock,
-			unsigned int *dataOffset,
-			unsigned int *dataLength,
+			uvast *dataOffset,
+			uvast *dataLength,
 			Object *data);
 		/*	The value returned in *data is always a zero-
 		 *	copy object; use the zco_* functions defined
@@ -100,6 +176,8 @@ extern int	ltp_get_notice(unsigned int clientId,
 		 *	ltp_send, so that the receiving application
 		 *	can alternate extraction of object lengths and
 		 *	objects from the delivered block's red part.
+		 *	To parse a large red part without copying it,
+		 *	use zco_map_source to view it in place.
 		 *
 		 *	The cancellation of an export session may result
 		 *	in delivery of multiple LtpExportSessionCanceled
@@ -109,6 +187,35 @@ extern int	ltp_get_notice(unsigned int clientId,
 		 *	is a service data unit ZCO that had previously
 		 *	been passed to the ltp_send function.		*/
 
+extern int	ltp_get_notices(unsigned int clientId,
+			LtpNotice *notices,
+			int maxNotices,
+			int flags);
+		/*	Retrieves as many as maxNotices pending notices
+		 *	in a single call, blocking only while no notice
+		 *	at all is pending.  The fields of each notice
+		 *	have the same meanings as the like-named
+		 *	arguments of ltp_get_notice.  Returns the number
+		 *	of notices placed in the notices array, which
+		 *	is zero if the call was interrupted, or -1 on
+		 *	any error.
+		 *
+		 *	If flags includes LTP_NONBLOCK, ltp_get_notices
+		 *	never blocks: it returns zero immediately if no
+		 *	notice is pending.				*/
+
+extern int	ltp_notice_fd(unsigned int clientId);
+		/*	Returns a file descriptor that becomes readable
+		 *	whenever a notice is posted for the client
+		 *	service that the calling task has opened.  The
+		 *	descriptor may be monitored by poll, select, or
+		 *	epoll; when it is readable, call ltp_drain_fd
+		 *	and then call ltp_get_notices with LTP_NONBLOCK
+		 *	until it returns zero.  Returns -1 on any
+		 *	error.						*/
+
+extern void	ltp_close_notice_fd(unsigned int clientId, int fd);
+
 extern void	ltp_interrupt(unsigned int clientId);
 
 extern void	ltp_release_data(Object data);
@@ -420,6 +420,8 @@ typedef void	(*FUNCPTR)(int, int, int, int, int, int, int, int, int, int);
 #include <netdb.h>
 #include <sys/resource.h>
 #include <sys/time.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
 /*
 ** End of *NIX Headers
 */
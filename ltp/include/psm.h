@@ -36,12 +36,23 @@ typedef struct
 	unsigned long	unusedSize;
 } PsmUsageSummary;
 
+typedef struct
+{
+	unsigned long	cacheHits;	/*	Allocations from cache.	*/
+	unsigned long	cacheFrees;	/*	Frees into cache.	*/
+	unsigned long	refills;	/*	Batches from partition.	*/
+	unsigned long	flushes;	/*	Batches to partition.	*/
+	unsigned long	bypasses;	/*	Uncached small allocs.	*/
+	unsigned long	cachedBlockCount[SMALL_SIZES];
+	unsigned long	cachedBytes;
+} PsmCacheSummary;
+
 typedef struct psm_str		/*	Local view of managed memory.	*/
 {
 	char		*space;		/*	Local pointer.		*/
 	long		freeNeeded;	/*	Free PsmView?  Boolean.	*/
 	struct psm_str	*trace;		/*	For sptrace.		*/
-	long		traceArea[3];	/*	psm_str for sptrace.	*/
+	struct psm_cache_str	*cache;	/*	Per-process blocks.	*/
 } PsmView, *PsmPartition;
 
 typedef enum { Okay, Redundant, Refused } PsmMgtOutcome;
@@ -238,6 +249,45 @@ extern void		psm_stop_trace(PsmPartition);
 				the shared memory allocated to the
 				trace operations.			*/
 
+extern int		psm_start_cache(PsmPartition);
+			/*	Begins caching small blocks (those
+				allocated by psm_zalloc from the small
+				pool) in private memory for use by the
+				calling process only, so that most
+				psm_zalloc and psm_free calls for small
+				blocks need not lock the partition.
+				Blocks are moved between the cache and
+				the partition in batches, under a
+				single lock of the partition.  Blocks
+				in the cache count as allocated in
+				psm_usage.  Redundant calls are
+				harmless.  Returns 0 on success, -1 on
+				any error.				*/
+
+extern void		psm_cache_usage(PsmPartition, PsmCacheSummary *);
+			/*	Loads PsmCacheSummary structure with
+				snapshot of the calling process's
+				small block cache statistics; all
+				zero if there is no cache.		*/
+
+extern void		psm_cache_report(PsmCacheSummary *);
+			/*	Sends to stdout a snapshot of the
+				small block cache statistics.		*/
+
+extern void		psm_stop_cache(PsmPartition);
+			/*	Returns all cached blocks to the
+				partition and ends caching.  Must not
+				be called while any other thread of
+				the process may be allocating from
+				or freeing to the partition.  Blocks
+				cached by a process that terminates
+				without calling psm_stop_cache (or
+				psm_unmanage), e.g., because it
+				crashed, are lost to the partition
+				until the partition is re-initialized;
+				the loss is bounded by the capacity
+				of one process's cache.			*/
+
 extern void		psm_unmanage(PsmPartition);
 			/*	Terminates psm management of the
 				space in the partition and destroys
@@ -23,6 +23,15 @@
 			declared length will have unpredictable
 			results.
 
+			Key/value pairs are stored inline in an array
+			of slots that is searched by linear probing.
+			The array is replaced by a larger one as the
+			table fills, and entries are moved into the new
+			array incrementally by subsequent insertions and
+			removals.  So an "entry" -- the location of a
+			key/value pair -- remains valid only until the
+			next insertion into or removal from the table.
+
 	Author: Scott Burleigh, JPL
 	
 	Copyright (c) 2008 California Institute of Technology.
@@ -37,6 +46,18 @@
 extern "C" {
 #endif
 
+typedef struct
+{
+	int	entries;	/*	Total key/value pairs.		*/
+	int	capacity;	/*	Slots in the current array.	*/
+	int	tombstones;	/*	Slots of deleted entries.	*/
+	double	loadFactor;	/*	% of current array occupied.	*/
+	int	rehashPending;	/*	Entries still in prior array.	*/
+	int	resizes;	/*	Arrays replaced since creation.	*/
+	double	meanProbes;	/*	Slots per successful search.	*/
+	int	maxProbes;
+} SdrHashSummary;
+
 /*	Functions for operating on hash tables in SDR.			*/
 
 #define sdr_hash_create(sdr, keyLength, estNbrOfEntries, meanSearchLength) \
@@ -52,10 +73,10 @@ extern int		Sdr_hash_insert(const char *file, int line, Sdr sdr,
 				Object hash, char *key, Address value,
 				Object *entry);
 
-#define sdr_hash_delete_entry(sdr, entry) \
-Sdr_hash_delete_entry(__FILE__, __LINE__, sdr, entry)
+#define sdr_hash_delete_entry(sdr, hash, entry) \
+Sdr_hash_delete_entry(__FILE__, __LINE__, sdr, hash, entry)
 extern int		Sdr_hash_delete_entry(const char *file, int line,
-				Sdr sdr, Object entry);
+				Sdr sdr, Object hash, Object entry);
 
 extern Address		sdr_hash_entry_value(Sdr sdr,
 				Object hash, Object entry);
@@ -73,6 +94,12 @@ extern int 		sdr_hash_foreach(Sdr sdrv, Object hash,
 extern int		sdr_hash_count(Sdr sdr,
 				Object hash);
 
+extern void		sdr_hash_usage(Sdr sdr, Object hash,
+				SdrHashSummary *summary);
+			/*	Load factor and probe lengths are
+			 *	those of the current array.  Reads
+			 *	every slot of the array.		*/
+
 #define sdr_hash_revise(sdr, hash, key, value) \
 Sdr_hash_revise(__FILE__, __LINE__, sdr, hash, key, value)
 extern int		Sdr_hash_revise(const char *file, int line, Sdr sdr,
@@ -40,6 +40,18 @@ Sdr_list_create(__FILE__, __LINE__, sdr)
 extern Object		Sdr_list_create(const char *file, int line,
 				Sdr sdr);
 
+#define sdr_list_create_in_arena(sdr, arena) \
+Sdr_list_create_in_arena(__FILE__, __LINE__, sdr, arena)
+extern Object		Sdr_list_create_in_arena(const char *file, int line,
+				Sdr sdr, Object arena);
+			/*	Creates a list whose header and
+				elements are all allocated from the
+				indicated arena (see sdrmgt.h), so
+				that deleting elements never frees
+				them and destroying the list is cheap.
+				The list must not be used after the
+				arena is destroyed.			*/
+
 #define sdr_list_destroy(sdr, list, deleteFn, argument) \
 Sdr_list_destroy(__FILE__, __LINE__, sdr, list, deleteFn, argument)
 extern void		Sdr_list_destroy(const char *file, int line,
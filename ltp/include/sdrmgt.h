@@ -23,6 +23,18 @@
 extern "C" {
 #endif
 
+#define	SDR_SLAB_NAME_LEN	(16)
+#define	SDR_MAX_SLAB_TYPES	(16)
+
+typedef struct
+{
+	char		name[SDR_SLAB_NAME_LEN];
+	long		objectSize;
+	long		slabCount;
+	long		objectsAllocated;
+	long		objectsFree;
+} SdrSlabUsage;
+
 typedef struct
 {
 	char		sdrName[MAX_SDR_NAME + 1];
@@ -36,6 +48,8 @@ typedef struct
 	long		largePoolFree;
 	long		largePoolAllocated;
 	long		unusedSize;
+	int		slabTypeCount;
+	SdrSlabUsage	slabs[SDR_MAX_SLAB_TYPES];
 } SdrUsageSummary;
 
 /*		Low-level SDR space management functions.		*/
@@ -60,6 +74,89 @@ Sdr_free(__FILE__, __LINE__, sdr, object)
 extern void		Sdr_free(const char *file, int line,
 				Sdr sdr, Object object);
 
+
+/*	Session-lifetime object arenas.					*/
+
+#define sdr_arena_create(sdr, chunkSize) \
+Sdr_arena_create(__FILE__, __LINE__, sdr, chunkSize)
+extern Object		Sdr_arena_create(const char *file, int line,
+				Sdr sdr, unsigned long chunkSize);
+			/*	Creates an arena from which objects
+				can be allocated in chunks of the
+				indicated size.  Returns the arena
+				object on success, zero on any error.	*/
+
+#define sdr_arena_malloc(sdr, arena, size) \
+Sdr_arena_malloc(__FILE__, __LINE__, sdr, arena, size)
+extern Object		Sdr_arena_malloc(const char *file, int line,
+				Sdr sdr, Object arena,
+				unsigned long size);
+			/*	Allocates an object from the arena.
+				Such objects must never be passed to
+				sdr_free; they are all released when
+				the arena is destroyed.			*/
+
+#define sdr_arena_free(sdr, arena, object, size) \
+Sdr_arena_free(__FILE__, __LINE__, sdr, arena, object, size)
+extern void		Sdr_arena_free(const char *file, int line,
+				Sdr sdr, Object arena, Object object,
+				unsigned long size);
+			/*	Releases an object, allocated from
+				the arena with the indicated size,
+				for reuse by later allocations of the
+				same size from the same arena.  Space
+				of objects larger than a few words is
+				reused only after the arena has been
+				destroyed.				*/
+
+#define sdr_arena_destroy(sdr, arena) \
+Sdr_arena_destroy(__FILE__, __LINE__, sdr, arena)
+extern void		Sdr_arena_destroy(const char *file, int line,
+				Sdr sdr, Object arena);
+			/*	Frees all chunks of the arena, and
+				thereby every object that was ever
+				allocated from it, in one pass.		*/
+
+/*	Slabs of fixed-size objects.					*/
+
+#define sdr_slab_create(sdr, name, objectSize) \
+Sdr_slab_create(__FILE__, __LINE__, sdr, name, objectSize)
+extern Object		Sdr_slab_create(const char *file, int line,
+				Sdr sdr, char *name,
+				unsigned long objectSize);
+			/*	Registers a type of object of the
+				indicated size, to be allocated from
+				slabs: large blocks that are each
+				divided into a fixed number of slots,
+				with a bitmap noting which slots are
+				in use.  Allocating or freeing such an
+				object normally updates just one word
+				of the bitmap.  Returns the slab cache
+				object, which the caller must retain
+				(typically in its own database) for
+				use in allocating and freeing objects
+				of this type; returns zero on any
+				error, including registration of more
+				than SDR_MAX_SLAB_TYPES types.		*/
+
+#define sdr_slab_malloc(sdr, slabCache) \
+Sdr_slab_malloc(__FILE__, __LINE__, sdr, slabCache)
+extern Object		Sdr_slab_malloc(const char *file, int line,
+				Sdr sdr, Object slabCache);
+			/*	Allocates an object of the slab
+				cache's type.  Returns zero on any
+				error.					*/
+
+#define sdr_slab_free(sdr, slabCache, object) \
+Sdr_slab_free(__FILE__, __LINE__, sdr, slabCache, object)
+extern void		Sdr_slab_free(const char *file, int line,
+				Sdr sdr, Object slabCache,
+				Object object);
+			/*	Frees an object that was allocated
+				from this slab cache.  Objects
+				allocated from slabs must never be
+				passed to sdr_free.			*/
+
 extern void		sdr_stage(Sdr sdr, char *into, Object from, long size);
 
 extern long		sdr_unused(Sdr sdr);
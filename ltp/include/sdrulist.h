@@ -0,0 +1,105 @@
+/*
+
+	sdrulist.h:	definitions supporting use of SDR-based
+			unrolled lists.
+
+			An unrolled list is a sequence of data items
+			(SDR Addresses) that are stored many to a
+			chunk, rather than one to a list element as
+			in an SDR linked list.  Items may be added and
+			removed only at the ends of the list, so an
+			unrolled list suits queues that grow long:
+			only one chunk is allocated (and only one is
+			freed) for every several dozen items pushed
+			and popped, and each push or pop updates only
+			the affected item, chunk header, and list
+			header.
+
+			A data item may not be zero, so that zero can
+			signify the end of the list.
+
+			An unrolled list may be traversed by means of
+			a cursor, which notes the position of one data
+			item in the list.  A cursor remains valid only
+			until the next push onto or pop from the list.
+
+									*/
+#ifndef _SDRULIST_H_
+#define _SDRULIST_H_
+
+#include "sdrmgt.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*	Functions for operating on unrolled lists in SDR.		*/
+
+typedef void		(*SdrUlistDeleteFn)(Sdr sdr, Address data, void *arg);
+
+typedef struct
+{
+	Object		chunk;
+	int		slot;
+} SdrUlistCursor;
+
+#define sdr_ulist_create(sdr) \
+Sdr_ulist_create(__FILE__, __LINE__, sdr)
+extern Object		Sdr_ulist_create(const char *file, int line,
+				Sdr sdr);
+
+#define sdr_ulist_destroy(sdr, list, deleteFn, argument) \
+Sdr_ulist_destroy(__FILE__, __LINE__, sdr, list, deleteFn, argument)
+extern void		Sdr_ulist_destroy(const char *file, int line,
+				Sdr sdr, Object list, SdrUlistDeleteFn deleteFn,
+				void *argument);
+
+extern long		sdr_ulist_length(Sdr sdr, Object list);
+
+#define sdr_ulist_push_first(sdr, list, data) \
+Sdr_ulist_push_first(__FILE__, __LINE__, sdr, list, data)
+extern int		Sdr_ulist_push_first(const char *file, int line,
+				Sdr sdr, Object list, Address data);
+
+#define sdr_ulist_push_last(sdr, list, data) \
+Sdr_ulist_push_last(__FILE__, __LINE__, sdr, list, data)
+extern int		Sdr_ulist_push_last(const char *file, int line,
+				Sdr sdr, Object list, Address data);
+			/*	Return 0 on success, -1 on any error.	*/
+
+#define sdr_ulist_pop_first(sdr, list) \
+Sdr_ulist_pop_first(__FILE__, __LINE__, sdr, list)
+extern Address		Sdr_ulist_pop_first(const char *file, int line,
+				Sdr sdr, Object list);
+
+#define sdr_ulist_pop_last(sdr, list) \
+Sdr_ulist_pop_last(__FILE__, __LINE__, sdr, list)
+extern Address		Sdr_ulist_pop_last(const char *file, int line,
+				Sdr sdr, Object list);
+			/*	Remove the first (or last) data item
+				from the list and return it.  Return
+				zero if the list is empty or on any
+				error.					*/
+
+extern Address		sdr_ulist_first(Sdr sdr, Object list,
+				SdrUlistCursor *cursor);
+extern Address		sdr_ulist_last(Sdr sdr, Object list,
+				SdrUlistCursor *cursor);
+			/*	Return the first (or last) data item
+				in the list, or zero if the list is
+				empty.  If cursor is non-NULL, it is
+				set to the position of that item.	*/
+
+#define sdr_ulist_prev(sdr, cursor) Sdr_ulist_traverse(sdr, cursor, 0)
+#define sdr_ulist_next(sdr, cursor) Sdr_ulist_traverse(sdr, cursor, 1)
+extern Address		Sdr_ulist_traverse(Sdr sdr, SdrUlistCursor *cursor,
+				int direction);
+			/*	Advance the cursor to the preceding
+				(or following) data item and return
+				that item.  Return zero at the start
+				(or end) of the list.			*/
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* _SDRULIST_H_ */
@@ -36,6 +36,15 @@ typedef struct sdrv_str	*Sdr;	/*	Local view of an SDR.		*/
 #define	SDR_IN_FILE	2	/*	Write file; read file if nec.	*/
 #define	SDR_REVERSIBLE	4	/*	Transactions may be reversed.	*/
 #define	SDR_BOUNDED	8	/*	Object boundaries defended.	*/
+#define	SDR_GROUP_SYNC	16	/*	Commits synced in batches.	*/
+#define	SDR_FULL_SYNC	32	/*	Log & heap synced per xn.	*/
+#define	SDR_LINE_UNDO	64	/*	Undo logged per line.		*/
+
+/*	Granularity of undo logging when SDR_LINE_UNDO is selected.	*/
+
+#ifndef SDR_UNDO_LINE_SIZE
+#define	SDR_UNDO_LINE_SIZE	(256)
+#endif
 
 /*		SDR system administration functions.			*/
 
@@ -93,7 +102,12 @@ extern int		sdr_load_profile(char *name, int configFlags,
 				reversibility and the transaction
 				log contains any log entries).  If
 				it does not, then we create and
-				initialize the SDR.
+				initialize the SDR.  An existing SDR
+				whose dataspace was created with a
+				different format version of the SDR
+				library is not loaded; the function
+				fails, leaving the SDR untouched, and
+				the SDR must be re-initialized.
 
 			 	"name" is the name of the SDR.
 				The "configFlags" value must be some
@@ -127,6 +141,19 @@ extern int		sdr_load_profile(char *name, int configFlags,
 				is zero then the transaction
 				reversibility log will be written
 				to a file rather than to memory.
+				Entries destined for a log file are
+				accumulated in a buffer in SDR working
+				memory and are written to the file,
+				as few system calls as possible, only
+				when they must be: before any write
+				to the dataspace file, when the buffer
+				fills, and before any transaction
+				reversal.  Where the dataspace is
+				selected for both SDR_IN_DRAM and
+				SDR_IN_FILE, writes to the dataspace
+				file are deferred to the end of the
+				transaction, so each transaction
+				writes its log entries at once.
 
 				On creation of the SDR, where the
 				SDR_REVERSIBLE option is selected
@@ -142,6 +169,44 @@ extern int		sdr_load_profile(char *name, int configFlags,
 				the log size, shared using the
 				indicated key.
 
+				Where SDR_REVERSIBLE is selected, by
+				default every write is logged with
+				the original data it overwrites.  If
+				SDR_LINE_UNDO is also selected, the
+				dataspace is instead divided into
+				lines of SDR_UNDO_LINE_SIZE bytes,
+				and the original content of each line
+				is logged once, on the first write to
+				that line in the transaction; later
+				writes to the same line are not
+				logged.  Scratch writes to a line
+				that has been logged are reversed
+				along with the rest of the line.
+
+				Where SDR_IN_FILE is selected, the
+				durability of transactions is set by
+				two further flags.  If neither is set,
+				ION never forces data to disk and a
+				committed transaction may be lost in
+				a power failure (but not in a crash
+				of the program).  If SDR_GROUP_SYNC is
+				set, sdr_end_xn() does not return
+				until the dataspace file has been
+				synced to disk, but the sync is done
+				after the transaction has released
+				the SDR, so a single sync covers every
+				transaction that committed while the
+				previous sync was in progress.  If
+				SDR_FULL_SYNC is set, the log file (if
+				any) is synced before the dataspace
+				file is written and the dataspace file
+				is synced before the log is discarded,
+				so that in a reversible SDR with its
+				log in a file even a power failure can
+				neither lose a committed transaction
+				nor leave one partially applied; this
+				costs two syncs per transaction.
+
 				If SDR_IN_FILE is selected, or if
 				SDR_REVERSIBLE is selected and
 				"logSize" is zero, then the path
@@ -157,7 +222,14 @@ extern int		sdr_load_profile(char *name, int configFlags,
 				option is selected, a file of the
 				indicated name and of the size given
 				by total data space size will be
-				created and filled with zeros.
+				created and filled with zeros.  Where
+				SDR_IN_FILE is selected but SDR_IN_DRAM
+				is not, each Sdr handle maps the db
+				file into memory (unless ION is built
+				with SDR_NO_MMAP) and reads and writes
+				it as memory; the dirty extent of each
+				transaction is what SDR_FULL_SYNC
+				syncs at commit.
 
 				If a cleanup task must be run whenever
 				a transaction is reversed, the command
@@ -211,13 +283,113 @@ extern void		sdr_destroy(Sdr sdr);
 
 /*		Basic, low-level SDR transaction functions.		*/
 
-extern int		sdr_begin_xn(Sdr sdr);
+#define sdr_begin_xn(sdr) \
+Sdr_begin_xn(__FILE__, __LINE__, sdr)
+extern int		Sdr_begin_xn(const char *file, int line, Sdr sdr);
 extern int		sdr_in_xn(Sdr sdr);		/*	Boolean	*/
 extern int		sdr_heap_is_halted(Sdr sdr);	/*	Boolean	*/
 extern void		sdr_exit_xn(Sdr sdr);
 extern void		sdr_cancel_xn(Sdr sdr);
 extern int		sdr_end_xn(Sdr sdr);
 
+typedef void		(*SdrUnlockFn)(int canceled);
+extern void		sdr_set_unlock_fn(SdrUnlockFn fn);
+			/*	Registers a function that is invoked
+				each time any thread of the calling
+				process releases the transaction lock
+				of any SDR, i.e., after its outermost
+				transaction has ended.  The function
+				is invoked just before the lock is
+				given up, so no other task can begin
+				a transaction until it returns; it
+				must therefore be brief.  "canceled" is
+				1 if the transaction was canceled (or
+				could not be committed and was
+				reversed), 0 if it was committed or
+				merely exited.  The function must not
+				begin a transaction.  There is at most
+				one such function per process; NULL
+				unregisters it.				*/
+
+extern int		sdr_begin_read(Sdr sdr);
+			/*	Begins a read-only transaction, which
+				excludes write transactions but may
+				run concurrently with any number of
+				other read-only transactions.  Data
+				must not be written, nor a write
+				transaction begun, until the read-only
+				transaction is ended; sdr_begin_xn
+				fails if invoked while the calling
+				thread is in a read-only transaction.
+				A thread may nest read-only
+				transactions.  While a
+				write transaction is waiting to begin,
+				no new (non-nested) read-only
+				transaction begins.  Returns 1 on
+				success, 0 on failure, like
+				sdr_begin_xn.				*/
+extern int		sdr_in_read(Sdr sdr);		/*	Boolean	*/
+extern void		sdr_end_read(Sdr sdr);
+
+extern void		sdr_eject_xn(Sdr sdr);
+			/*	Emergency recovery only: ends the
+				transaction (or the read-only
+				transactions) holding the SDR's lock,
+				when the owner is known to have
+				crashed.				*/
+
+/*		SDR transaction profiling functions.			*/
+
+#define	SDR_PROFILE_NAME_LEN	(24)
+
+typedef struct
+{
+	char		sourceFileName[SDR_PROFILE_NAME_LEN];
+	int		lineNbr;
+	unsigned long	xnCount;
+	unsigned long	writeCount;
+	unsigned long	bytesLogged;
+	uvast		totalWait;	/*	All times in microseconds.	*/
+	uvast		totalHold;
+	unsigned long	medianWait;
+	unsigned long	p99Wait;
+	unsigned long	maxWait;
+	unsigned long	medianHold;
+	unsigned long	p99Hold;
+	unsigned long	maxHold;
+} SdrXnProfile;
+
+extern int		sdr_start_profile(Sdr sdr);
+			/*	Begins recording, for each source
+				line at which sdr_begin_xn is called,
+				the time spent waiting for the SDR's
+				transaction lock and then holding it,
+				the number of writes, and the number
+				of bytes written to the transaction
+				log.  Profiling is SDR-wide: it
+				covers transactions begun by all
+				tasks.  Returns 0 on success, -1 if
+				working memory for the profile can't
+				be allocated.				*/
+
+extern int		sdr_get_profile(Sdr sdr, SdrXnProfile *sites,
+				int maxSites);
+			/*	Fills "sites" with the profiles of up
+				to maxSites call sites, in descending
+				order of total lock hold time.
+				Percentile times are approximate, to
+				within 25%.  Returns the number of
+				sites reported, or -1 if profiling
+				is not enabled.				*/
+
+extern void		sdr_clear_profile(Sdr sdr);
+			/*	Discards all profile data recorded
+				so far.					*/
+
+extern void		sdr_stop_profile(Sdr sdr);
+			/*	Ends profiling and releases the
+				profile's working memory.		*/
+
 /*		Low-level SDR I/O functions.				*/
 
 typedef saddr		SdrAddress;
@@ -261,6 +433,22 @@ Sdr_write(__FILE__, __LINE__, sdr, into, from, size)
 extern void		Sdr_write(const char *file, int line,
 				Sdr sdr, Address into, char *from, long size);
 
+#define sdr_write_scratch(sdr, into, from, size) \
+Sdr_write_scratch(__FILE__, __LINE__, sdr, into, from, size)
+extern void		Sdr_write_scratch(const char *file, int line,
+				Sdr sdr, Address into, char *from, long size);
+			/*	Same as sdr_write, except that the
+				prior content of the written bytes
+				is not recorded in the transaction
+				log, so it is NOT restored if the
+				transaction is reversed.  Intended
+				only for bulk payload written into
+				space whose meaning is governed by
+				other, transactionally written,
+				metadata: if the transaction is
+				reversed, that metadata once again
+				marks the scratch bytes as unused.	*/
+
 #define sdr_poke(sdr, address, variable) \
 Sdr_write(__FILE__, __LINE__, sdr, address, \
 (char *) &variable, sizeof variable)
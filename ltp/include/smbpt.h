@@ -0,0 +1,108 @@
+/*
+
+	smbpt.h:	definitions supporting use of B+trees in
+			shared memory.
+
+	A B+tree keeps many data items in each node, so a search
+	visits a few wide nodes rather than one narrow node per
+	comparison, and an in-order traversal walks a chain of
+	leaves.  The API mirrors that of smrbt, and the compare and
+	delete callbacks have the same signatures, so an index may
+	be switched between the two.  The differences are:
+
+	-	A B+tree does not admit two data items that compare
+		equal; an insertion that would duplicate a key fails.
+
+	-	A B+tree "node", as returned by sm_bpt_insert,
+		sm_bpt_search, sm_bpt_first, sm_bpt_last, and the
+		traversal functions, is the position of a data item
+		within the tree.  It is valid only until the next
+		insertion into or deletion from the tree.
+
+									*/
+#ifndef _SMBPT_H_
+#define _SMBPT_H_
+
+#include "psm.h"
+
+/*	Size of each node of a B+tree, in bytes.			*/
+
+#ifndef SM_BPT_NODE_SIZE
+#define	SM_BPT_NODE_SIZE	(256)
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*	Functions for operating on B+trees in shared memory.		*/
+
+typedef int		(*SmBptCompareFn)(PsmPartition partition,
+				PsmAddress nodeData, void *dataBuffer);
+/*	Note: an SmBptCompareFn operates by comparing some value(s)
+	derived from its first argument (which will always be the
+	sm_bpt_data of some data item in the tree) to some value(s)
+	derived from its second argument (which is typically a pointer
+	to an object residing in memory).				*/
+
+typedef void		(*SmBptDeleteFn)(PsmPartition partition,
+				PsmAddress nodeData, void *arg);
+
+#define sm_bpt_create(partition) \
+Sm_bpt_create(__FILE__, __LINE__, partition)
+extern PsmAddress	Sm_bpt_create(const char *file, int line,
+				PsmPartition partition);
+extern void		sm_bpt_unwedge(PsmPartition partition, PsmAddress bpt,
+				int interval);
+
+#define sm_bpt_clear(partition, bpt, deleteFn, argument) \
+Sm_bpt_clear(__FILE__, __LINE__, partition, bpt, deleteFn, argument)
+extern void		Sm_bpt_clear(const char *file, int line,
+				PsmPartition partition, PsmAddress bpt,
+				SmBptDeleteFn deleteFn, void *argument);
+
+#define sm_bpt_destroy(partition, bpt, deleteFn, argument) \
+Sm_bpt_destroy(__FILE__, __LINE__, partition, bpt, deleteFn, argument)
+extern void		Sm_bpt_destroy(const char *file, int line,
+				PsmPartition partition, PsmAddress bpt,
+				SmBptDeleteFn deleteFn, void *argument);
+
+extern PsmAddress	sm_bpt_user_data(PsmPartition partition,
+				PsmAddress bpt);
+extern void		sm_bpt_user_data_set(PsmPartition partition,
+				PsmAddress bpt, PsmAddress userData);
+extern long		sm_bpt_length(PsmPartition partition, PsmAddress bpt);
+
+#define sm_bpt_insert(partition, bpt, data, compare, dataBuffer) \
+Sm_bpt_insert(__FILE__, __LINE__, partition, bpt, data, compare, dataBuffer)
+extern PsmAddress	Sm_bpt_insert(const char *file, int line,
+				PsmPartition partition, PsmAddress bpt,
+				PsmAddress data, SmBptCompareFn compare,
+				void *dataBuffer);
+
+#define sm_bpt_delete(partition, bpt, compare, dataBuffer, deleteFn, \
+argument) Sm_bpt_delete(__FILE__, __LINE__, partition, bpt, compare, \
+dataBuffer, deleteFn, argument)
+extern void		Sm_bpt_delete(const char *file, int line,
+				PsmPartition partition, PsmAddress bpt,
+				SmBptCompareFn compare, void *dataBuffer,
+				SmBptDeleteFn deleteFn, void *argument);
+
+extern PsmAddress	sm_bpt_search(PsmPartition partition, PsmAddress bpt,
+				SmBptCompareFn compare, void *dataBuffer,
+				PsmAddress *successor);
+
+extern PsmAddress	sm_bpt_first(PsmPartition partition, PsmAddress bpt);
+extern PsmAddress	sm_bpt_last(PsmPartition partition, PsmAddress bpt);
+#define sm_bpt_prev(partition, node) Sm_bpt_traverse(partition, node, 0)
+#define sm_bpt_next(partition, node) Sm_bpt_traverse(partition, node, 1)
+extern PsmAddress	Sm_bpt_traverse(PsmPartition partition,
+				PsmAddress node, int direction);
+
+extern PsmAddress	sm_bpt_bpt(PsmPartition partition, PsmAddress node);
+extern PsmAddress	sm_bpt_data(PsmPartition partition, PsmAddress node);
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* _SMBPT_H_ */
@@ -93,6 +93,14 @@ typedef struct
 	vast	lengthCopied;			/*	incl. capsules	*/
 } ZcoReader;
 
+typedef struct
+{
+	char	*text;				/*	read-only	*/
+	vast	length;
+	char	*mapBase;			/*	if mmapped	*/
+	size_t	mapLength;			/*	if mmapped	*/
+} ZcoView;
+
 /*	Commonly used functions for building, accessing, managing,
  	and destroying a ZCO.						*/
 
@@ -528,6 +536,40 @@ extern vast	zco_receive_trailers(Sdr sdr,
 			 *	"buffer".  Returns number of bytes
 			 *	copied, or -1 on any error.		*/
 
+/*	*	Functions for viewing ZCO source data in place.	*	*/
+
+extern int	zco_map_source(	Sdr sdr,
+				Object zco,
+				ZcoView *views,
+				int maxViews);
+			/*	Obtains read-only views of the source
+			 *	data of this ZCO without copying them:
+			 *	for each source data extent, views[i]
+			 *	is populated with a pointer into the
+			 *	SDR heap (if the extent's text is a
+			 *	heap object and the heap is in DRAM) or
+			 *	into a read-only mapping of the file
+			 *	that contains the extent's text.  Must
+			 *	be called within a transaction, but
+			 *	the views remain valid after the
+			 *	transaction ends, until they are
+			 *	released by zco_unmap_views; the ZCO
+			 *	must not be destroyed before then.
+			 *
+			 *	Returns the number of views populated.
+			 *	Returns 0 if the source data can't be
+			 *	viewed in place (e.g., some extent's
+			 *	text is in bulk storage, or the ZCO has
+			 *	more than maxViews extents), in which
+			 *	case the source data must be copied by
+			 *	zco_receive_source as usual.  Returns
+			 *	-1 on any error.			*/
+
+extern void	zco_unmap_views(ZcoView *views,
+				int viewCount);
+			/*	Releases views obtained from
+			 *	zco_map_source.				*/
+
 #ifdef __cplusplus
 }
 #endif
@@ -11,6 +11,48 @@
 
 #include "ltpP.h"
 
+/*	Opens or closes a client service at every other shard, whose
+ *	relay then forwards the client's notices to this shard.	*/
+
+static int	relayClient(int type, unsigned int clientSvcId)
+{
+	LtpDB		*db = getLtpConstants();
+	LtpRelayMsg	msg;
+	LtpRelayReply	reply;
+	unsigned int	i;
+	int		result = 0;
+
+	CHKERR(db);
+	memset((char *) &msg, 0, sizeof msg);
+	msg.type = type;
+	msg.shardNbr = db->shardNbr;
+	msg.clientSvcId = clientSvcId;
+	for (i = 0; i < db->shardCount; i++)
+	{
+		if (i == db->shardNbr)
+		{
+			continue;
+		}
+
+		reply.result = 0;
+		if (ltpRelayRequest(i, &msg, 0,
+				type == LTP_RELAY_OPEN ? &reply : NULL) < 0
+		|| reply.result < 0)
+		{
+			result = -1;
+		}
+
+		if (result < 0 && type == LTP_RELAY_OPEN)
+		{
+			putErrmsg("Can't open client service at shard.",
+					utoa(i));
+			break;
+		}
+	}
+
+	return result;
+}
+
 int	ltp_attach()
 {
 	return ltpAttach();
@@ -18,6 +60,7 @@ int	ltp_attach()
 
 void	ltp_detach()
 {
+	ltpRelayDisconnect();
 #if (!(defined (ION_LWT)))
 	ltpDetach();
 #endif
@@ -26,14 +69,30 @@ void	ltp_detach()
 
 int	ltp_engine_is_started()
 {
+	Sdr	sdr = getIonsdr();
 	LtpVdb	*vdb = getLtpVdb();
+	int	started;
+
+	/*	ltpStart and ltpStop change clockPid only while they
+	 *	hold the ION lock, so a read-only transaction suffices.	*/
+
+	CHKZERO(sdr_begin_read(sdr));
+	started = (vdb && vdb->clockPid != ERROR);
+	sdr_end_read(sdr);
+	return started;
+}
 
-	return (vdb && vdb->clockPid != ERROR);
+int	ltp_span_shard(uvast destinationEngineId)
+{
+	LtpDB	*db = getLtpConstants();
+
+	CHKERR(db);
+	return ltpShardOf(destinationEngineId, db->shardCount);
 }
 
-static int	sduCanBeAppendedToBlock(LtpSpan *span,
+static int	sduCanBeAppendedToBlock(LtpSpan *span, LtpVspan *vspan,
 			unsigned int clientSvcId,
-			unsigned int redPartLength)
+			uvast redPartLength)
 {
 	Sdr	sdr = getIonsdr();
 
@@ -74,7 +133,7 @@ static int	sduCanBeAppendedToBlock(LtpSpan *span,
 		 *	of red data.					*/
 
 		if (sdr_list_length(sdr, span->exportSessions)
-				> span->maxExportSessions)
+				> vspan->maxExportSessions)
 		{
 			if (redPartLength == 0)	/*	All-green SDU.	*/
 			{
@@ -105,7 +164,7 @@ static int	sduCanBeAppendedToBlock(LtpSpan *span,
 		return 0;
 	}
 
-	if (span->lengthOfBufferedBlock >= span->aggrSizeLimit)
+	if (span->lengthOfBufferedBlock >= vspan->aggrSizeLimit)
 	{
 		/*	Block has reached its aggregation limit, so
 		 *	it's already released for transmission and
@@ -137,21 +196,126 @@ static int	sduCanBeAppendedToBlock(LtpSpan *span,
 	return 1;
 }
 
-int	ltp_send(uvast destinationEngineId, unsigned int clientSvcId,
-		Object clientServiceData, unsigned int redPartLength,
-		LtpSessionId *sessionId)
+/*	Sends SDUs over a span that is served by another shard, by
+ *	passing a copy of each SDU to the relay of that shard.  The
+ *	relay sends the copy just as ltp_send_many would, so the local
+ *	SDU is then destroyed as if it had been transmitted.		*/
+
+static int	relaySdus(unsigned int shardNbr, uvast destinationEngineId,
+			unsigned int clientSvcId, Object *clientServiceData,
+			uvast *redPartLengths, int sduCount,
+			LtpSessionId *sessionIds, int flags)
+{
+	Sdr		sdr = getIonsdr();
+	LtpRelayMsg	msg;
+	LtpRelayReply	reply;
+	int		sent = 0;
+	int		i;
+
+	memset((char *) &msg, 0, sizeof msg);
+	msg.type = LTP_RELAY_SEND;
+	msg.flags = flags;
+	msg.shardNbr = (getLtpConstants())->shardNbr;
+	msg.clientSvcId = clientSvcId;
+	msg.engineId = destinationEngineId;
+	reply.result = 0;
+	while (sent < sduCount)
+	{
+		if (sdr_begin_read(sdr) == 0)
+		{
+			reply.result = -1;
+			break;
+		}
+
+		msg.dataLength = zco_length(sdr, clientServiceData[sent]);
+		sdr_end_read(sdr);
+		msg.redPartLength = redPartLengths[sent];
+		if (ltpRelayRequest(shardNbr, &msg, clientServiceData[sent],
+				&reply) < 0)
+		{
+			reply.result = -1;
+			break;
+		}
+
+		if (reply.result != 1)
+		{
+			break;
+		}
+
+		sessionIds[sent] = reply.sessionId;
+		sent++;
+	}
+
+	if (sent > 0)
+	{
+		CHKERR(sdr_begin_xn(sdr));
+		for (i = 0; i < sent; i++)
+		{
+			zco_destroy(sdr, clientServiceData[i]);
+		}
+
+		if (sdr_end_xn(sdr) < 0)
+		{
+			putErrmsg("Can't destroy relayed SDUs.", NULL);
+			return -1;
+		}
+
+		return sent;
+	}
+
+	switch (reply.result)
+	{
+	case -2:
+		errno = EWOULDBLOCK;
+		return -2;	/*	Would block.		*/
+
+	case -1:
+		putErrmsg("Can't send data.", NULL);
+		return -1;
+
+	default:
+		return 0;	/*	Transmission stopped.	*/
+	}
+}
+
+int	ltp_send_many(uvast destinationEngineId, unsigned int clientSvcId,
+		Object *clientServiceData, uvast *redPartLengths,
+		int sduCount, LtpSessionId *sessionIds, int flags)
 {
 	LtpVdb		*vdb = getLtpVdb();
+	LtpDB		*db = getLtpConstants();
 	Sdr		sdr = getIonsdr();
+	unsigned int	shardNbr;
 	LtpVspan	*vspan;
 	PsmAddress	vspanElt;
-	unsigned int	dataLength;
+	uvast		dataLength;
+	uvast		redPartLength;
 	Object		spanObj;
 	LtpSpan		span;
+	int		i;
+	int		appended = 0;	/*	In current transaction.	*/
+	int		sent = 0;
 			OBJ_POINTER(ExportSession, session);
 
 	CHKERR(clientSvcId <= MAX_LTP_CLIENT_NBR);
 	CHKERR(clientServiceData);
+	CHKERR(redPartLengths);
+	CHKERR(sessionIds);
+	CHKERR(sduCount > 0);
+	for (i = 0; i < sduCount; i++)
+	{
+		CHKERR(clientServiceData[i]);
+	}
+
+	CHKERR(db);
+	shardNbr = ltpShardOf(destinationEngineId, db->shardCount);
+	if (shardNbr != db->shardNbr)
+	{
+		return relaySdus(shardNbr, destinationEngineId, clientSvcId,
+				clientServiceData, redPartLengths, sduCount,
+				sessionIds, flags);
+	}
+
 	CHKERR(sdr_begin_xn(sdr));
 	findSpan(destinationEngineId, &vspan, &vspanElt);
 	if (vspanElt == 0)
@@ -162,198 +326,469 @@ int	ltp_send(uvast destinationEngineId, unsigned int clientSvcId,
 		return -1;
 	}
 
-	dataLength = zco_length(sdr, clientServiceData);
-
-	/*	We spare the client service from needing to know the
-	 *	exact length of the ZCO before calling ltp_send():
-	 *	if the client service data is all red, the red length
-	 *	LTP_ALL_RED can be specified and we simply reduce it
-	 *	to the actual ZCO length here.				*/
-
-	if (redPartLength > dataLength)
-	{
-		redPartLength = dataLength;
-	}
-
 	spanObj = sdr_list_data(sdr, vspan->spanElt);
 	sdr_stage(sdr, (char *) &span, spanObj, sizeof(LtpSpan));
+	while (sent < sduCount)
+	{
+		dataLength = zco_length(sdr, clientServiceData[sent]);
 
-	/*	All service data units aggregated into any single
-	 *	block must have the same client service ID, and
-	 *	no service data unit can be added to a block that
-	 *	has any green data (only all-red service data units
-	 *	can be aggregated in a single block).			*/
+		/*	We spare the client service from needing to
+		 *	know the exact length of the ZCO before calling
+		 *	ltp_send(): if the client service data is all
+		 *	red, the red length LTP_ALL_RED can be specified
+		 *	and we simply reduce it to the actual ZCO length
+		 *	here.						*/
 
-	while (1)
-	{
-		if (span.currentExportSessionObj)
+		redPartLength = redPartLengths[sent];
+		if (redPartLength > dataLength)
 		{
-			/*	Span has been initialized with a
-			 *	session buffer (block) into which
-			 *	service data can be inserted.		*/
-
-			if (sduCanBeAppendedToBlock(&span, clientSvcId,
-					redPartLength))
-			{
-				break;		/*	Out of loop.	*/
-			}
+			redPartLength = dataLength;
 		}
 
-		/*	Can't append service data unit to block.  Wait
-		 *	until block is open for insertion of SDUs of
-		 *	the same color as the SDU we're trying to send,
-		 *	based on redPartLength.				*/
+		/*	All service data units aggregated into any
+		 *	single block must have the same client service
+		 *	ID, and no service data unit can be added to a
+		 *	block that has any green data (only all-red
+		 *	service data units can be aggregated in a
+		 *	single block).					*/
 
-		sdr_exit_xn(sdr);
-		if (redPartLength > 0)
+		if (span.currentExportSessionObj == 0
+		|| !sduCanBeAppendedToBlock(&span, vspan, clientSvcId,
+				redPartLength))
 		{
-			if (sm_SemTake(vspan->bufOpenRedSemaphore) < 0)
+			/*	Can't append service data unit to
+			 *	block.  Commit all SDUs appended so
+			 *	far, then wait until block is open for
+			 *	insertion of SDUs of the same color as
+			 *	the SDU we're trying to send, based on
+			 *	redPartLength.				*/
+
+			if (appended == 0)
 			{
-				putErrmsg("Can't take buffer open semaphore.",
-						itoa(vspan->engineId));
-				return -1;
+				sdr_exit_xn(sdr);
 			}
-
-			if (sm_SemEnded(vspan->bufOpenRedSemaphore))
+			else
 			{
-				putErrmsg("Span has been stopped.",
-						itoa(vspan->engineId));
-				return 0;
+				sdr_write(sdr, spanObj, (char *) &span,
+						sizeof(LtpSpan));
+				if (sdr_end_xn(sdr))
+				{
+					putErrmsg("Can't send data.", NULL);
+					return -1;
+				}
+
+				appended = 0;
 			}
-		}
-		else
-		{
-			if (sm_SemTake(vspan->bufOpenGreenSemaphore) < 0)
+
+			if (flags & LTP_NONBLOCK)
 			{
-				putErrmsg("Can't take buffer open semaphore.",
-						itoa(vspan->engineId));
-				return -1;
+				if (sent > 0 || sm_SemEnded(redPartLength > 0 ?
+						vspan->bufOpenRedSemaphore :
+						vspan->bufOpenGreenSemaphore))
+				{
+					return sent;
+				}
+
+				errno = EWOULDBLOCK;
+				return -2;	/*	Would block.	*/
 			}
 
-			if (sm_SemEnded(vspan->bufOpenGreenSemaphore))
+			if (redPartLength > 0)
+			{
+				if (sm_SemTake(vspan->bufOpenRedSemaphore) < 0)
+				{
+					putErrmsg("Can't take buffer open \
+semaphore.", itoa(vspan->engineId));
+					return -1;
+				}
+
+				if (sm_SemEnded(vspan->bufOpenRedSemaphore))
+				{
+					putErrmsg("Span has been stopped.",
+							itoa(vspan->engineId));
+					return sent;
+				}
+			}
+			else
 			{
-				putErrmsg("Span has been stopped.",
-						itoa(vspan->engineId));
-				return 0;
+				if (sm_SemTake(vspan->bufOpenGreenSemaphore)
+						< 0)
+				{
+					putErrmsg("Can't take buffer open \
+semaphore.", itoa(vspan->engineId));
+					return -1;
+				}
+
+				if (sm_SemEnded(vspan->bufOpenGreenSemaphore))
+				{
+					putErrmsg("Span has been stopped.",
+							itoa(vspan->engineId));
+					return sent;
+				}
 			}
+
+			CHKERR(sdr_begin_xn(sdr));
+			sdr_stage(sdr, (char *) &span, spanObj,
+					sizeof(LtpSpan));
+			continue;
 		}
 
-		CHKERR(sdr_begin_xn(sdr));
-		sdr_stage(sdr, (char *) &span, spanObj, sizeof(LtpSpan));
-	}
+		/*	Now append the outbound SDU to the block that
+		 *	is currently being aggregated for this span
+		 *	and, if the block buffer is now full or the
+		 *	block buffer contains any green data, notify
+		 *	ltpmeter that block segmentation can begin.	*/
+
+		GET_OBJ_POINTER(sdr, ExportSession, session,
+				span.currentExportSessionObj);
+		sdr_list_insert_last(sdr, session->svcDataObjects,
+				clientServiceData[sent]);
+		span.clientSvcIdOfBufferedBlock = clientSvcId;
+		span.lengthOfBufferedBlock += dataLength;
+		span.redLengthOfBufferedBlock += redPartLength;
+		if (span.lengthOfBufferedBlock >= vspan->aggrSizeLimit
+		|| span.redLengthOfBufferedBlock < span.lengthOfBufferedBlock)
+		{
+			sm_SemGive(vspan->bufClosedSemaphore);
+		}
 
-	/*	Now append the outbound SDU to the block that is
-	 *	currently being aggregated for this span and, if the
-	 *	block buffer is now full or the block buffer contains
-	 *	any green data, notify ltpmeter that block segmentation
-	 *	can begin.						*/
+		if (vdb->watching & WATCH_d)
+		{
+			iwatch('d');
+		}
+
+		sessionIds[sent].sourceEngineId = vdb->ownEngineId;
+		sessionIds[sent].sessionNbr = session->sessionNbr;
+		appended++;
+		sent++;
+	}
 
-	GET_OBJ_POINTER(sdr, ExportSession, session,
-			span.currentExportSessionObj);
-	sdr_list_insert_last(sdr, session->svcDataObjects, clientServiceData);
-	span.clientSvcIdOfBufferedBlock = clientSvcId;
-	span.lengthOfBufferedBlock += dataLength;
-	span.redLengthOfBufferedBlock += redPartLength;
 	sdr_write(sdr, spanObj, (char *) &span, sizeof(LtpSpan));
-	if (span.lengthOfBufferedBlock >= span.aggrSizeLimit
-	|| span.redLengthOfBufferedBlock < span.lengthOfBufferedBlock)
+	if (sdr_end_xn(sdr))
 	{
-		sm_SemGive(vspan->bufClosedSemaphore);
+		putErrmsg("Can't send data.", NULL);
+		return -1;
 	}
 
-	if (vdb->watching & WATCH_d)
+	return sent;
+}
+
+int	ltp_send(uvast destinationEngineId, unsigned int clientSvcId,
+		Object clientServiceData, uvast redPartLength,
+		LtpSessionId *sessionId)
+{
+	return ltp_send_many(destinationEngineId, clientSvcId,
+			&clientServiceData, &redPartLength, 1, sessionId, 0);
+}
+
+/*	The readiness FIFO of a span that is served by another shard
+ *	is signaled by the local relay whenever the relay of that
+ *	shard reports that the span's own FIFO has been signaled.	*/
+
+static int	relaySpanFd(unsigned int shardNbr, uvast destinationEngineId)
+{
+	LtpRelayMsg	msg;
+	LtpRelayReply	reply;
+	int		fd;
+
+	fd = ltpOpenReadinessFifo(LTP_SPAN_FIFO, destinationEngineId);
+	if (fd < 0)
 	{
-		iwatch('d');
+		return -1;
 	}
 
-	if (sdr_end_xn(sdr))
+	memset((char *) &msg, 0, sizeof msg);
+	msg.type = LTP_RELAY_WATCH;
+	msg.shardNbr = (getLtpConstants())->shardNbr;
+	msg.engineId = destinationEngineId;
+	if (ltpRelayRequest(shardNbr, &msg, 0, &reply) < 0
+	|| reply.result < 0)
 	{
-		putErrmsg("Can't send data.", NULL);
+		close(fd);
+		putErrmsg("Can't watch span at shard.", utoa(shardNbr));
 		return -1;
 	}
 
-	sessionId->sourceEngineId = vdb->ownEngineId;
-	sessionId->sessionNbr = session->sessionNbr;
-	return 1;
+	return fd;
+}
+
+int	ltp_span_fd(uvast destinationEngineId)
+{
+	Sdr		sdr = getIonsdr();
+	LtpDB		*db = getLtpConstants();
+	unsigned int	shardNbr;
+	LtpVspan	*vspan;
+	PsmAddress	vspanElt;
+	int		fd;
+
+	CHKERR(db);
+	shardNbr = ltpShardOf(destinationEngineId, db->shardCount);
+	if (shardNbr != db->shardNbr)
+	{
+		return relaySpanFd(shardNbr, destinationEngineId);
+	}
+
+	CHKERR(sdr_begin_xn(sdr));	/*	Just to lock memory.	*/
+	findSpan(destinationEngineId, &vspan, &vspanElt);
+	if (vspanElt == 0)
+	{
+		sdr_exit_xn(sdr);
+		putErrmsg("Destination engine unknown.",
+				utoa(destinationEngineId));
+		return -1;
+	}
+
+	fd = ltpOpenReadinessFifo(LTP_SPAN_FIFO, destinationEngineId);
+	if (fd >= 0)
+	{
+		vspan->readinessFdCount++;
+	}
+
+	sdr_exit_xn(sdr);
+	return fd;
+}
+
+void	ltp_close_span_fd(uvast destinationEngineId, int fd)
+{
+	Sdr		sdr = getIonsdr();
+	LtpVspan	*vspan;
+	PsmAddress	vspanElt;
+
+	CHKVOID(fd >= 0);
+	close(fd);
+	CHKVOID(sdr_begin_xn(sdr));	/*	Just to lock memory.	*/
+	findSpan(destinationEngineId, &vspan, &vspanElt);
+	if (vspanElt && vspan->readinessFdCount > 0)
+	{
+		vspan->readinessFdCount--;
+	}
+
+	sdr_exit_xn(sdr);
+}
+
+void	ltp_drain_fd(int fd)
+{
+	CHKVOID(fd >= 0);
+	ltpDrainReadinessFifo(fd);
 }
 
 int	ltp_open(unsigned int clientSvcId)
 {
-	return ltpAttachClient(clientSvcId);
+	if (ltpAttachClient(clientSvcId) < 0)
+	{
+		return -1;
+	}
+
+	if (relayClient(LTP_RELAY_OPEN, clientSvcId) < 0)
+	{
+		oK(relayClient(LTP_RELAY_CLOSE, clientSvcId));
+		ltpDetachClient(clientSvcId);
+		return -1;
+	}
+
+	return 0;
 }
 
-int	ltp_get_notice(unsigned int clientSvcId, LtpNoticeType *type,
-		LtpSessionId *sessionId, unsigned char *reasonCode,
-		unsigned char *endOfBlock, unsigned int *dataOffset,
-		unsigned int *dataLength, Object *data)
+static int	takeListedNotice(Sdr sdr, LtpVclient *client, LtpNotice *notice)
+{
+	Object	noticeAddr;
+
+	noticeAddr = sdr_ulist_pop_first(sdr, client->notices);
+	if (noticeAddr == 0)
+	{
+		return 0;
+	}
+
+	sdr_read(sdr, (char *) notice, noticeAddr, sizeof(LtpNotice));
+	sdr_slab_free(sdr, (getLtpConstants())->noticeSlab, noticeAddr);
+	return 1;
+}
+
+static int	drainNotices(LtpVclient *client, LtpNotice *notices,
+			int maxNotices)
 {
 	Sdr		sdr = getIonsdr();
+	LtpNoticeSlot	*ring;
+	LtpNoticeSlot	*slot;
+	unsigned int	tail;
+	int		locked = 0;
+	int		count = 0;
+
+	ring = (LtpNoticeSlot *) psp(getIonwm(), client->ring);
+	while (count < maxNotices)
+	{
+		tail = client->ringTail;
+		__sync_synchronize();
+		if (client->ringHead == tail)
+		{
+			/*	Ring is empty.  Any remaining notices
+			 *	were spilled to the SDR list, which
+			 *	can only be drained while the ION lock
+			 *	keeps the engine from posting notices.	*/
+
+			if (client->spilled == 0)
+			{
+				break;
+			}
+
+			if (!locked)
+			{
+				CHKERR(sdr_begin_xn(sdr));
+				locked = 1;
+				continue;	/*	Check again.	*/
+			}
+
+			if (takeListedNotice(sdr, client, notices + count))
+			{
+				count++;
+				client->spilled--;
+			}
+			else
+			{
+				client->spilled = 0;
+			}
+
+			continue;
+		}
+
+		slot = ring + (client->ringHead % LTP_NOTICE_RING_SIZE);
+		if (slot->inSdr)
+		{
+			if (!locked)
+			{
+				CHKERR(sdr_begin_xn(sdr));
+				locked = 1;
+			}
+
+			/*	The slot was published only when the
+			 *	transaction that listed the notice was
+			 *	committed, so the notice is at the head
+			 *	of the list unless the list was lost.	*/
+
+			if (takeListedNotice(sdr, client, notices + count))
+			{
+				count++;
+			}
+		}
+		else
+		{
+			memcpy((char *) (notices + count),
+					(char *) &(slot->notice),
+					sizeof(LtpNotice));
+			count++;
+		}
+
+		/*	Slot must be fully consumed before the engine
+		 *	can see that it is free to be overwritten.	*/
+
+		__sync_synchronize();
+		client->ringHead++;
+	}
+
+	if (locked)
+	{
+		if (sdr_end_xn(sdr) < 0)
+		{
+			putErrmsg("Can't get inbound notices.", NULL);
+			return -1;
+		}
+	}
+
+	return count;
+}
+
+/*	The ring has a single consumer, so threads of the client's
+ *	process that retrieve notices concurrently are serialized.	*/
+
+static int	takeNotices(LtpVclient *client, LtpNotice *notices,
+			int maxNotices)
+{
+	static ResourceLock	noticesLock;
+	int			count;
+
+	if (initResourceLock(&noticesLock) < 0)
+	{
+		putErrmsg("Can't initialize notices lock.", NULL);
+		return -1;
+	}
+
+	lockResource(&noticesLock);
+	count = drainNotices(client, notices, maxNotices);
+	unlockResource(&noticesLock);
+	return count;
+}
+
+int	ltp_get_notices(unsigned int clientSvcId, LtpNotice *notices,
+		int maxNotices, int flags)
+{
 	LtpVdb		*vdb = getLtpVdb();
 	LtpVclient	*client;
-	Object		elt;
-	Object		noticeAddr;
-	LtpNotice	notice;
+	int		count;
 
 	CHKERR(clientSvcId <= MAX_LTP_CLIENT_NBR);
-	CHKERR(type);
-	CHKERR(sessionId);
-	CHKERR(reasonCode);
-	CHKERR(endOfBlock);
-	CHKERR(dataOffset);
-	CHKERR(dataLength);
-	CHKERR(data);
-	*type = LtpNoNotice;	/*	Default.			*/
-	*data = 0;		/*	Default.			*/
-	CHKERR(sdr_begin_xn(sdr));
+	CHKERR(notices);
+	CHKERR(maxNotices > 0);
 	client = vdb->clients + clientSvcId;
 	if (client->pid != sm_TaskIdSelf())
 	{
-		sdr_exit_xn(sdr);
 		putErrmsg("Can't get notice: not owner of client service.",
 				itoa(client->pid));
 		return -1;
 	}
 
-	elt = sdr_list_first(sdr, client->notices);
-	if (elt == 0)
+	count = takeNotices(client, notices, maxNotices);
+	if (count != 0 || (flags & LTP_NONBLOCK))
 	{
-		sdr_exit_xn(sdr);
-
-		/*	Wait until LTP engine announces an event
-		 *	by giving the client's semaphore.		*/
+		return count;
+	}
 
-		if (sm_SemTake(client->semaphore) < 0)
-		{
-			putErrmsg("LTP client can't take semaphore.", NULL);
-			return -1;
-		}
+	/*	Wait until LTP engine announces an event by giving
+	 *	the client's semaphore.					*/
 
-		if (sm_SemEnded(client->semaphore))
-		{
-			writeMemo("[?] Client access terminated.");
+	if (sm_SemTake(client->semaphore) < 0)
+	{
+		putErrmsg("LTP client can't take semaphore.", NULL);
+		return -1;
+	}
 
-			/*	End task, but without error.		*/
+	if (sm_SemEnded(client->semaphore))
+	{
+		writeMemo("[?] Client access terminated.");
 
-			return -1;
-		}
+		/*	End task, but without error.			*/
 
-		CHKERR(sdr_begin_xn(sdr));
-		elt = sdr_list_first(sdr, client->notices);
-		if (elt == 0)	/*	Function was interrupted.	*/
-		{
-			sdr_exit_xn(sdr);
-			return 0;
-		}
+		return -1;
 	}
 
-	/*	Got next inbound notice.  Remove it from the queue
-	 *	for this client.					*/
+	/*	Zero notices taken means the function was interrupted.	*/
 
-	noticeAddr = sdr_list_data(sdr, elt);
-	sdr_list_delete(sdr, elt, (SdrListDeleteFn) NULL, NULL);
-	sdr_read(sdr, (char *) &notice, noticeAddr, sizeof(LtpNotice));
-	sdr_free(sdr, noticeAddr);
-	*data = notice.data;
+	return takeNotices(client, notices, maxNotices);
+}
+
+int	ltp_get_notice(unsigned int clientSvcId, LtpNoticeType *type,
+		LtpSessionId *sessionId, unsigned char *reasonCode,
+		unsigned char *endOfBlock, uvast *dataOffset,
+		uvast *dataLength, Object *data)
+{
+	LtpNotice	notice;
+
+	CHKERR(type);
+	CHKERR(sessionId);
+	CHKERR(reasonCode);
+	CHKERR(endOfBlock);
+	CHKERR(dataOffset);
+	CHKERR(dataLength);
+	CHKERR(data);
+	*type = LtpNoNotice;	/*	Default.			*/
+	*data = 0;		/*	Default.			*/
+	switch (ltp_get_notices(clientSvcId, &notice, 1, 0))
+	{
+	case -1:
+		return -1;
+
+	case 0:			/*	Function was interrupted.	*/
+		return 0;
+	}
 
 	/*	Note that an ExportSessionCanceled notice may have
 	 *	associated data of zero, in the event that local
@@ -365,12 +800,6 @@ int	ltp_get_notice(unsigned int clientSvcId, LtpNoticeType *type,
 	 *	destroyed, but both cancellations cause notices
 	 *	to be sent to the user.					*/
 
-	if (sdr_end_xn(sdr))
-	{
-		putErrmsg("Can't get inbound notice.", NULL);
-		return -1;
-	}
-
 	*type = notice.type;
 	sessionId->sourceEngineId = notice.sessionId.sourceEngineId;
 	sessionId->sessionNbr = notice.sessionId.sessionNbr;
@@ -378,9 +807,56 @@ int	ltp_get_notice(unsigned int clientSvcId, LtpNoticeType *type,
 	*endOfBlock = notice.endOfBlock;
 	*dataOffset = notice.dataOffset;
 	*dataLength = notice.dataLength;
+	*data = notice.data;
 	return 0;
 }
 
+int	ltp_notice_fd(unsigned int clientSvcId)
+{
+	Sdr		sdr = getIonsdr();
+	LtpVdb		*vdb = getLtpVdb();
+	LtpVclient	*client;
+	int		fd;
+
+	CHKERR(clientSvcId <= MAX_LTP_CLIENT_NBR);
+	CHKERR(sdr_begin_xn(sdr));	/*	Just to lock memory.	*/
+	client = vdb->clients + clientSvcId;
+	if (client->pid != sm_TaskIdSelf())
+	{
+		sdr_exit_xn(sdr);
+		putErrmsg("Can't get notice fd: not owner of client service.",
+				itoa(client->pid));
+		return -1;
+	}
+
+	fd = ltpOpenReadinessFifo(LTP_CLIENT_FIFO, clientSvcId);
+	if (fd >= 0)
+	{
+		client->readinessFdCount++;
+	}
+
+	sdr_exit_xn(sdr);
+	return fd;
+}
+
+void	ltp_close_notice_fd(unsigned int clientSvcId, int fd)
+{
+	Sdr		sdr = getIonsdr();
+	LtpVclient	*client;
+
+	CHKVOID(clientSvcId <= MAX_LTP_CLIENT_NBR);
+	CHKVOID(fd >= 0);
+	close(fd);
+	CHKVOID(sdr_begin_xn(sdr));	/*	Just to lock memory.	*/
+	client = (getLtpVdb())->clients + clientSvcId;
+	if (client->pid == sm_TaskIdSelf() && client->readinessFdCount > 0)
+	{
+		client->readinessFdCount--;
+	}
+
+	sdr_exit_xn(sdr);
+}
+
 void	ltp_interrupt(unsigned int clientSvcId)
 {
 	LtpVdb		*vdb;
@@ -414,5 +890,6 @@ void	ltp_release_data(Object data)
 
 void	ltp_close(unsigned int clientSvcId)
 {
+	oK(relayClient(LTP_RELAY_CLOSE, clientSvcId));
 	ltpDetachClient(clientSvcId);
 }
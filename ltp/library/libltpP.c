@@ -25,11 +25,40 @@
  *			 from generalized extensions.
  */
 
+#ifndef LTP_BLOCK_DIRECT_IO
+#define	LTP_BLOCK_DIRECT_IO	0	/*	O_DIRECT block files.	*/
+#endif
+
+#if LTP_BLOCK_DIRECT_IO && defined(linux) && !defined(_GNU_SOURCE)
+#define	_GNU_SOURCE			/*	For O_DIRECT.		*/
+#endif
+
 #include "ltpP.h"
 #include "ltpei.h"
+#include <netinet/tcp.h>
 
 #define	EST_LINK_OHD		16
 
+#ifndef LTP_BLOCK_FILES_OPEN
+#define	LTP_BLOCK_FILES_OPEN	8
+#endif
+
+#ifndef LTP_READINESS_WRITERS
+#define	LTP_READINESS_WRITERS	16
+#endif
+
+#ifndef LTP_NOTICE_STAGE_SIZE
+#define	LTP_NOTICE_STAGE_SIZE	(LTP_NOTICE_RING_SIZE)
+#endif
+
+#ifndef LTP_RELAY_CHUNK_SIZE
+#define	LTP_RELAY_CHUNK_SIZE	(65536)
+#endif
+
+#ifndef LTP_BLOCK_IO_ALIGN
+#define	LTP_BLOCK_IO_ALIGN	4096	/*	Must be a power of 2.	*/
+#endif
+
 #ifndef LTPDEBUG
 #define	LTPDEBUG		0
 #endif
@@ -73,6 +102,7 @@ static int	setTimer(LtpTimer *timer, Address timerAddr, time_t currentSec,
 static int	constructReportAckSegment(LtpSpan *span, Object spanObj,
 			unsigned int sessionNbr, unsigned int reportSerialNbr);
 static Object	enqueueAckSegment(Object spanObj, Object segmentObj);
+static void	endLtpTransaction(int canceled);
 
 /*	*	*	Helpful utility functions	*	*	*/
 
@@ -114,10 +144,10 @@ static LtpDB	*_ltpConstants()
 			}
 			else
 			{
-				CHKNULL(sdr_begin_xn(sdr));
+				CHKNULL(sdr_begin_read(sdr));
 				sdr_read(sdr, (char *) &buf, dbObject,
 						sizeof(LtpDB));
-				sdr_exit_xn(sdr);
+				sdr_end_read(sdr);
 			}
 
 			db = &buf;
@@ -135,12 +165,9 @@ static LtpDB	*_ltpConstants()
  *	at that time; specifically, it establishes the size of the
  *	exportSessions hash table.					*/
 
-void	ltpSpanTally(LtpVspan *vspan, unsigned int idx, unsigned int size)
+void	ltpSpanTally(LtpVspan *vspan, unsigned int idx, uvast size)
 {
-	Sdr		sdr = getIonsdr();
-	LtpSpanStats	stats;
-	Tally		*tally;
-	int		offset;
+	Tally	*tally;
 
 	CHKVOID(vspan && vspan->stats);
 	if (!(vspan->updateStats))
@@ -148,16 +175,465 @@ void	ltpSpanTally(LtpVspan *vspan, unsigned int idx, unsigned int size)
 		return;
 	}
 
-	CHKVOID(ionLocked());
 	CHKVOID(idx < LTP_SPAN_STATS);
-	sdr_stage(sdr, (char *) &stats, vspan->stats, sizeof(LtpSpanStats));
-	tally = stats.tallies + idx;
+	CHKVOID(ionLocked());
+	tally = vspan->pendingTallies + idx;
 	tally->totalCount += 1;
 	tally->totalBytes += size;
 	tally->currentCount += 1;
 	tally->currentBytes += size;
-	offset = (char *) tally - ((char *) &stats);
-	sdr_write(sdr, vspan->stats + offset, (char *) tally, sizeof(Tally));
+}
+
+/*	Tallies folded into a span's stats are retained in its
+ *	flushedTallies until the transaction that folded them in
+ *	ends.  If that transaction is canceled, the folded stats are
+ *	rolled back, so the retained tallies are restored to pending.	*/
+
+static int	spanTalliesFlushed = 0;
+
+static void	settleSpanTallies(int canceled)
+{
+	PsmPartition	ionwm = getIonwm();
+	PsmAddress	elt;
+	LtpVspan	*vspan;
+	Tally		*flushed;
+	Tally		*pending;
+	int		i;
+
+	if (!spanTalliesFlushed)
+	{
+		return;
+	}
+
+	spanTalliesFlushed = 0;
+	for (elt = sm_list_first(ionwm, (getLtpVdb())->spans); elt;
+			elt = sm_list_next(ionwm, elt))
+	{
+		vspan = (LtpVspan *) psp(ionwm, sm_list_data(ionwm, elt));
+		if (!(vspan->talliesFlushed))
+		{
+			continue;
+		}
+
+		if (canceled)
+		{
+			for (i = 0, flushed = vspan->flushedTallies,
+					pending = vspan->pendingTallies;
+					i < LTP_SPAN_STATS;
+					i++, flushed++, pending++)
+			{
+				pending->totalCount += flushed->totalCount;
+				pending->totalBytes += flushed->totalBytes;
+				pending->currentCount += flushed->currentCount;
+				pending->currentBytes += flushed->currentBytes;
+			}
+		}
+
+		memset((char *) vspan->flushedTallies, 0,
+				sizeof vspan->flushedTallies);
+		vspan->talliesFlushed = 0;
+	}
+}
+
+void	ltpFlushSpanStats(LtpVspan *vspan)
+{
+	Sdr		sdr = getIonsdr();
+	LtpSpanStats	stats;
+	Tally		*pending;
+	Tally		*flushed;
+	Tally		*tally;
+	int		i;
+
+	CHKVOID(vspan && vspan->stats);
+	CHKVOID(ionLocked());
+	for (i = 0, pending = vspan->pendingTallies; i < LTP_SPAN_STATS;
+			i++, pending++)
+	{
+		if (pending->totalCount > 0)
+		{
+			break;
+		}
+	}
+
+	if (i == LTP_SPAN_STATS)	/*	Nothing tallied.	*/
+	{
+		return;
+	}
+
+	sdr_stage(sdr, (char *) &stats, vspan->stats, sizeof(LtpSpanStats));
+	for (i = 0, pending = vspan->pendingTallies, tally = stats.tallies,
+			flushed = vspan->flushedTallies; i < LTP_SPAN_STATS;
+			i++, pending++, tally++, flushed++)
+	{
+		tally->totalCount += pending->totalCount;
+		tally->totalBytes += pending->totalBytes;
+		tally->currentCount += pending->currentCount;
+		tally->currentBytes += pending->currentBytes;
+		flushed->totalCount += pending->totalCount;
+		flushed->totalBytes += pending->totalBytes;
+		flushed->currentCount += pending->currentCount;
+		flushed->currentBytes += pending->currentBytes;
+	}
+
+	memset((char *) vspan->pendingTallies, 0,
+			sizeof vspan->pendingTallies);
+	sdr_write(sdr, vspan->stats, (char *) &stats, sizeof(LtpSpanStats));
+	vspan->talliesFlushed = 1;
+	spanTalliesFlushed = 1;
+	sdr_set_unlock_fn(endLtpTransaction);
+}
+
+void	ltpReadSpanStats(LtpVspan *vspan, LtpSpanStats *stats)
+{
+	Sdr	sdr = getIonsdr();
+	Tally	*pending;
+	Tally	*tally;
+	int	i;
+
+	/*	Adds pending tallies to a copy of the span's stats
+	 *	rather than folding them in, so that the stats can
+	 *	be read within a read-only transaction.  Tallies are
+	 *	changed only under the ION lock, which no task holds
+	 *	while the read lock is held.				*/
+
+	CHKVOID(vspan && vspan->stats);
+	CHKVOID(stats);
+	CHKVOID(ionReadLocked());
+	sdr_read(sdr, (char *) stats, vspan->stats, sizeof(LtpSpanStats));
+	for (i = 0, pending = vspan->pendingTallies, tally = stats->tallies;
+			i < LTP_SPAN_STATS; i++, pending++, tally++)
+	{
+		tally->totalCount += pending->totalCount;
+		tally->totalBytes += pending->totalBytes;
+		tally->currentCount += pending->currentCount;
+		tally->currentBytes += pending->currentBytes;
+	}
+}
+
+/*	Readiness FIFOs enable applications to wait for LTP events
+ *	by polling file descriptors (e.g., in an epoll loop) rather
+ *	than by blocking on semaphores.  A FIFO is a named pipe in
+ *	the ION working directory, so the engine task that detects
+ *	an event needn't be in the same process as the application
+ *	that is waiting for it.  The application opens the FIFO for
+ *	both reading and writing, so that it never sees end-of-file;
+ *	the engine writes one byte to the FIFO per event, discarding
+ *	the byte if the FIFO is full (it's already readable) or if
+ *	no application currently has the FIFO open.
+ *
+ *	Each process that posts events keeps its FIFOs open for
+ *	writing in a small private table.  An event is only noted
+ *	in the table while the ION lock is held; the byte is written
+ *	as the process releases the lock, i.e., once the transaction
+ *	that posted the event has ended.  If the FIFO's
+ *	reader has disappeared (e.g., the application crashed
+ *	without closing its descriptor), the count of readiness
+ *	descriptors is reset at the next event so that the engine
+ *	stops signaling.						*/
+
+typedef struct
+{
+	char		kind[8];	/*	Empty if entry unused.	*/
+	uvast		id;
+	int		fd;
+	int		pending;	/*	Boolean.		*/
+	int		readerGone;	/*	Boolean.		*/
+	unsigned int	lastUse;
+} LtpReadinessWriter;
+
+static LtpReadinessWriter	readinessWriters[LTP_READINESS_WRITERS];
+static unsigned int		readinessWriterUses = 0;
+static ResourceLock		readinessWritersLock;
+static int			readinessPending = 0;
+
+static void	getReadinessFifoName(char *kind, uvast id, char *buffer,
+			int bufLen)
+{
+	isprintf(buffer, bufLen, "%.200s%cltp.%s." UVAST_FIELDSPEC ".fifo",
+			getIonWorkingDirectory(), ION_PATH_DELIMITER, kind,
+			id);
+}
+
+int	ltpOpenReadinessFifo(char *kind, uvast id)
+{
+	char	name[256];
+	int	fd;
+
+	CHKERR(kind);
+	getReadinessFifoName(kind, id, name, sizeof name);
+	if (mkfifo(name, 0666) < 0 && errno != EEXIST)
+	{
+		putSysErrmsg("Can't create readiness FIFO", name);
+		return -1;
+	}
+
+	fd = open(name, O_RDWR | O_NONBLOCK);
+	if (fd < 0)
+	{
+		putSysErrmsg("Can't open readiness FIFO", name);
+		return -1;
+	}
+
+	return fd;
+}
+
+static void	closeReadinessWriter(LtpReadinessWriter *writer)
+{
+	close(writer->fd);
+	writer->kind[0] = '\0';
+	writer->pending = 0;
+	writer->readerGone = 0;
+}
+
+/*	Writes one byte to each FIFO at which an event has been noted.
+ *	Invoked whenever this process releases the ION lock.  If the
+ *	transaction in which the events were noted was canceled, the
+ *	events never happened: they are discarded unsignaled.		*/
+
+static void	flushReadinessWriters(int canceled)
+{
+	LtpReadinessWriter	*writer;
+	int			i;
+	char			event = 1;
+	sigset_t		pipeSignal;
+	sigset_t		oldMask;
+	struct timespec		noWait = { 0, 0 };
+
+	if (!readinessPending)
+	{
+		return;
+	}
+
+	lockResource(&readinessWritersLock);
+	readinessPending = 0;
+	for (i = 0, writer = readinessWriters; i < LTP_READINESS_WRITERS;
+			i++, writer++)
+	{
+		if (!writer->pending)
+		{
+			continue;
+		}
+
+		/*	A write to a FIFO that no longer has a reader
+		 *	raises SIGPIPE, which must not kill the engine.	*/
+
+		writer->pending = 0;
+		if (canceled)
+		{
+			continue;
+		}
+
+		sigemptyset(&pipeSignal);
+		sigaddset(&pipeSignal, SIGPIPE);
+		pthread_sigmask(SIG_BLOCK, &pipeSignal, &oldMask);
+		if (write(writer->fd, &event, 1) < 0 && errno == EPIPE)
+		{
+			writer->readerGone = 1;
+			oK(sigtimedwait(&pipeSignal, NULL, &noWait));
+		}
+
+		pthread_sigmask(SIG_SETMASK, &oldMask, NULL);
+	}
+
+	unlockResource(&readinessWritersLock);
+}
+
+/*	Notices posted to clients' rings are staged in a private table
+ *	until the transaction that posted them ends.  Only when that
+ *	transaction is committed are the staged notices copied into
+ *	the rings, the counts of spilled notices raised, and the
+ *	clients' semaphores given; if it is canceled, the staged
+ *	notices are discarded along with the rolled-back SDR list
+ *	entries of any spilled notices or notices that carry data.
+ *	Notices are staged only by the thread that holds the ION lock,
+ *	which publishes them before giving up the lock, so each ring
+ *	still has a single producer.					*/
+
+typedef struct
+{
+	LtpVclient	*client;
+	LtpNoticeSlot	slot;
+} LtpStagedNotice;
+
+typedef struct
+{
+	unsigned int	ringEntries;	/*	In stagedNotices.	*/
+	unsigned int	spills;		/*	In SDR list only.	*/
+} LtpStagedClient;
+
+static LtpStagedNotice	stagedNotices[LTP_NOTICE_STAGE_SIZE];
+static int		stagedNoticeCount = 0;
+static LtpStagedClient	stagedClients[LTP_MAX_NBR_OF_CLIENTS];
+static int		noticesStaged = 0;
+static pthread_t	stagingThread;
+
+static void	publishNotices(int canceled)
+{
+	LtpStagedNotice	*staged;
+	LtpStagedClient	*staging;
+	LtpVclient	*client;
+	LtpNoticeSlot	*slot;
+	unsigned int	wakeups;
+	int		i;
+
+	if (!noticesStaged || !pthread_equal(stagingThread, pthread_self()))
+	{
+		return;
+	}
+
+	if (!canceled)
+	{
+		for (i = 0, staged = stagedNotices; i < stagedNoticeCount;
+				i++, staged++)
+		{
+			client = staged->client;
+			slot = ((LtpNoticeSlot *) psp(getIonwm(), client->ring))
+				+ (client->ringTail % LTP_NOTICE_RING_SIZE);
+			memcpy((char *) slot, (char *) &(staged->slot),
+					sizeof(LtpNoticeSlot));
+
+			/*	Slot must be populated before the
+			 *	client can see that the ring's tail
+			 *	has advanced.				*/
+
+			__sync_synchronize();
+			client->ringTail++;
+		}
+
+		for (i = 0, staging = stagedClients,
+				client = (getLtpVdb())->clients;
+				i < LTP_MAX_NBR_OF_CLIENTS;
+				i++, staging++, client++)
+		{
+			client->spilled += staging->spills;
+			wakeups = staging->ringEntries + staging->spills;
+			while (wakeups > 0)
+			{
+				sm_SemGive(client->semaphore);
+				wakeups--;
+			}
+		}
+	}
+
+	memset((char *) stagedClients, 0, sizeof stagedClients);
+	stagedNoticeCount = 0;
+	noticesStaged = 0;
+}
+
+/*	Invoked as this process releases the lock on any transaction.	*/
+
+static void	endLtpTransaction(int canceled)
+{
+	publishNotices(canceled);
+	settleSpanTallies(canceled);
+	flushReadinessWriters(canceled);
+}
+
+/*	Notes an event at a readiness FIFO.  Must be called with the
+ *	ION lock held; fdCount is the count of readiness descriptors
+ *	that applications have open for this FIFO.			*/
+
+void	ltpSignalReadinessFifo(char *kind, uvast id, int *fdCount)
+{
+	LtpReadinessWriter	*victim = readinessWriters;
+	LtpReadinessWriter	*writer;
+	char			name[256];
+	int			fd;
+	int			i;
+
+	CHKVOID(ionLocked());
+	if (*fdCount <= 0)
+	{
+		return;
+	}
+
+	if (initResourceLock(&readinessWritersLock) < 0)
+	{
+		return;
+	}
+
+	lockResource(&readinessWritersLock);
+	for (i = 0, writer = readinessWriters; i < LTP_READINESS_WRITERS;
+			i++, writer++)
+	{
+		if (writer->kind[0] != '\0' && writer->id == id
+		&& strcmp(writer->kind, kind) == 0)
+		{
+			if (!writer->readerGone)
+			{
+				writer->pending = 1;
+				writer->lastUse = ++readinessWriterUses;
+				readinessPending = 1;
+				unlockResource(&readinessWritersLock);
+				return;
+			}
+
+			/*	Reader has disappeared; check whether
+			 *	another has since opened the FIFO.	*/
+
+			closeReadinessWriter(writer);
+		}
+
+		if (victim->kind[0] == '\0')
+		{
+			continue;	/*	Already have a free entry.	*/
+		}
+
+		if (writer->kind[0] == '\0'
+		|| writer->lastUse < victim->lastUse)
+		{
+			victim = writer;
+		}
+	}
+
+	getReadinessFifoName(kind, id, name, sizeof name);
+	fd = open(name, O_WRONLY | O_NONBLOCK);
+	if (fd < 0)
+	{
+		/*	No application has the FIFO open, so any
+		 *	descriptors counted were never closed.		*/
+
+		*fdCount = 0;
+		unlockResource(&readinessWritersLock);
+		return;
+	}
+
+	if (victim->kind[0] != '\0')
+	{
+		closeReadinessWriter(victim);
+	}
+
+	istrcpy(victim->kind, kind, sizeof victim->kind);
+	victim->id = id;
+	victim->fd = fd;
+	victim->pending = 1;
+	victim->readerGone = 0;
+	victim->lastUse = ++readinessWriterUses;
+	readinessPending = 1;
+	unlockResource(&readinessWritersLock);
+	sdr_set_unlock_fn(endLtpTransaction);
+}
+
+void	ltpDrainReadinessFifo(int fd)
+{
+	char	buffer[64];
+
+	while (read(fd, buffer, sizeof buffer) > 0)
+	{
+		continue;
+	}
+}
+
+static void	openExportBuffer(LtpVspan *vspan)
+{
+	/*	Tell any blocked ltp_send function, and any
+	 *	application polling the span's readiness FIFO, that
+	 *	it may now be possible to append an SDU to the block.	*/
+
+	sm_SemGive(vspan->bufOpenRedSemaphore);
+	sm_SemGive(vspan->bufOpenGreenSemaphore);
+	ltpSignalReadinessFifo(LTP_SPAN_FIFO, vspan->engineId,
+			&(vspan->readinessFdCount));
 }
 
 /*	*	*	Functions for LTP enhancements	*	*	*/
@@ -300,7 +776,8 @@ int	enqueueBurst(LtpXmitSeg *segment, LtpSpan *span, Object where,
 
 	for (i = 1; i < burstType; i++)
 	{
-		segmentObj = sdr_malloc(sdr, sizeof(LtpXmitSeg));
+		segmentObj = sdr_slab_malloc(sdr,
+				(_ltpConstants())->xmitSegSlab);
 		segment->pdu.timer.expirationCount = -1;
 
 	/*	Note: expirationCount -1 indicates that the segment
@@ -339,7 +816,8 @@ int	enqueueAckBurst(LtpXmitSeg *segment, Object spanObj, int burstType)
 
 	for (i = 1; i < burstType; i++)
 	{
-		segmentObj = sdr_malloc(sdr, sizeof(LtpXmitSeg));
+		segmentObj = sdr_slab_malloc(sdr,
+				(_ltpConstants())->xmitSegSlab);
 		segment->pdu.timer.expirationCount = -1;
 
 	/*	Note: expirationCount -1 indicates that the segment
@@ -375,10 +853,32 @@ static void	resetClient(LtpVclient *client)
 	client->pid = ERROR;				/*	None.	*/
 }
 
-static void	raiseClient(LtpVclient *client)
+static int	raiseClient(LtpVclient *client)
 {
+	Sdr		sdr = getIonsdr();
+	PsmPartition	ltpwm = getIonwm();
+
+	client->ring = psm_zalloc(ltpwm,
+			LTP_NOTICE_RING_SIZE * sizeof(LtpNoticeSlot));
+	if (client->ring == 0)
+	{
+		putErrmsg("No space for notice ring.", NULL);
+		return -1;
+	}
+
+	memset(psp(ltpwm, client->ring), 0,
+			LTP_NOTICE_RING_SIZE * sizeof(LtpNoticeSlot));
+	client->ringHead = 0;
+	client->ringTail = 0;
+
+	/*	Any notices left over in the SDR list must be
+	 *	delivered before any newly posted notices.		*/
+
+	client->spilled = sdr_ulist_length(sdr, client->notices);
+	client->spilling = (client->spilled > 0);
 	client->semaphore = SM_SEM_NONE;
 	resetClient(client);
+	return 0;
 }
 
 static void	resetSpan(LtpVspan *vspan)
@@ -491,12 +991,23 @@ loss rate %f, recv segment loss rate %f, max timeouts %d.", vspan->engineId,
 	writeMemo(buf);
 }
 
+static void	mirrorSpanConfig(LtpVspan *vspan, LtpSpanConfig *config)
+{
+	vspan->remoteQtime = config->remoteQtime;
+	vspan->purge = config->purge;
+	vspan->maxExportSessions = config->maxExportSessions;
+	vspan->maxImportSessions = config->maxImportSessions;
+	vspan->aggrSizeLimit = config->aggrSizeLimit;
+	vspan->aggrTimeLimit = config->aggrTimeLimit;
+}
+
 static int	raiseSpan(Object spanElt, LtpVdb *ltpvdb)
 {
 	Sdr		sdr = getIonsdr();
 	PsmPartition	ltpwm = getIonwm();
 	Object		spanObj;
 	LtpSpan		span;
+	LtpSpanConfig	config;
 	LtpVspan	*vspan;
 	PsmAddress	vspanElt;
 	PsmAddress	addr;
@@ -528,10 +1039,13 @@ static int	raiseSpan(Object spanElt, LtpVdb *ltpvdb)
 	vspan->stats = span.stats;
 	vspan->updateStats = span.updateStats;
 	vspan->engineId = span.engineId;
-	vspan->maxXmitSegSize = span.maxSegmentSize;
+	vspan->segments = span.segments;
+	sdr_read(sdr, (char *) &config, span.config, sizeof(LtpSpanConfig));
+	mirrorSpanConfig(vspan, &config);
+	vspan->maxXmitSegSize = config.maxSegmentSize;
 	vspan->maxRecvSegSize = 1;
 	computeRetransmissionLimits(vspan);
-	vspan->segmentBuffer = psm_malloc(ltpwm, span.maxSegmentSize);
+	vspan->segmentBuffer = psm_malloc(ltpwm, config.maxSegmentSize);
 	if (vspan->segmentBuffer == 0)
 	{
 		oK(sm_list_delete(ltpwm, vspanElt, NULL, NULL));
@@ -539,7 +1053,7 @@ static int	raiseSpan(Object spanElt, LtpVdb *ltpvdb)
 		return -1;
 	}
 
-	vspan->importSessions = sm_rbt_create(ltpwm);
+	vspan->importSessions = ltp_idx_create(ltpwm);
 	if (vspan->importSessions == 0)
 	{
 		psm_free(ltpwm, vspan->segmentBuffer);
@@ -551,7 +1065,7 @@ static int	raiseSpan(Object spanElt, LtpVdb *ltpvdb)
 	vspan->avblIdxRbts = sm_list_create(ltpwm);
 	if (vspan->avblIdxRbts == 0)
 	{
-		sm_rbt_destroy(ltpwm, vspan->importSessions, NULL, NULL);
+		ltp_idx_destroy(ltpwm, vspan->importSessions, NULL, NULL);
 		psm_free(ltpwm, vspan->segmentBuffer);
 		oK(sm_list_delete(ltpwm, vspanElt, NULL, NULL));
 		psm_free(ltpwm, addr);
@@ -563,19 +1077,20 @@ static int	raiseSpan(Object spanElt, LtpVdb *ltpvdb)
 	vspan->bufClosedSemaphore = SM_SEM_NONE;
 	vspan->segSemaphore = SM_SEM_NONE;
 	resetSpan(vspan);
+	ltpIndexSpan(vspanElt);
 	return 0;
 }
 
-static void	deleteSegmentRef(PsmPartition ltpwm, PsmAddress nodeData,
+static void	deleteExtentRef(PsmPartition ltpwm, PsmAddress nodeData,
 			void *arg)
 {
-	psm_free(ltpwm, nodeData);	/*	Delete LtpSegmentRef.	*/
+	psm_free(ltpwm, nodeData);	/*	Delete LtpExtentRef.	*/
 }
 
 static PsmAddress	releaseIdxRbt(PsmPartition ltpwm, LtpVspan *vspan,
 				PsmAddress rbt)
 {
-	sm_rbt_clear(ltpwm, rbt, deleteSegmentRef, NULL);
+	ltp_idx_clear(ltpwm, rbt, deleteExtentRef, NULL);
 	return sm_list_insert_first(ltpwm, vspan->avblIdxRbts, rbt);
 }
 
@@ -585,9 +1100,9 @@ static void	deleteVImportSession(PsmPartition ltpwm, PsmAddress nodeData,
 	VImportSession	*vsession = (VImportSession *) psp(ltpwm, nodeData);
 	LtpVspan	*vspan = (LtpVspan *) arg;
 
-	if (vsession->redSegmentsIdx)
+	if (vsession->redExtentsIdx)
 	{
-		oK(releaseIdxRbt(ltpwm, vspan, vsession->redSegmentsIdx));
+		oK(releaseIdxRbt(ltpwm, vspan, vsession->redExtentsIdx));
 	}
 
 	psm_free(ltpwm, nodeData);	/*	Delete VImportSession.	*/
@@ -595,7 +1110,7 @@ static void	deleteVImportSession(PsmPartition ltpwm, PsmAddress nodeData,
 
 static void	deleteIdxRbt(PsmPartition ltpwm, PsmAddress nodeData, void *arg)
 {
-	oK(sm_rbt_destroy(ltpwm, nodeData, NULL, NULL));
+	oK(ltp_idx_destroy(ltpwm, nodeData, NULL, NULL));
 }
 
 static void	dropSpan(LtpVspan *vspan, PsmAddress vspanElt)
@@ -604,6 +1119,7 @@ static void	dropSpan(LtpVspan *vspan, PsmAddress vspanElt)
 	PsmAddress	vspanAddr;
 
 	vspanAddr = sm_list_data(ltpwm, vspanElt);
+	ltpUnindexSpan(vspanElt);
 	if (vspan->bufOpenRedSemaphore != SM_SEM_NONE)
 	{
 		sm_SemDelete(vspan->bufOpenRedSemaphore);
@@ -624,7 +1140,7 @@ static void	dropSpan(LtpVspan *vspan, PsmAddress vspanElt)
 		sm_SemDelete(vspan->segSemaphore);
 	}
 
-	oK(sm_rbt_destroy(ltpwm, vspan->importSessions,
+	oK(ltp_idx_destroy(ltpwm, vspan->importSessions,
 			deleteVImportSession, vspan));
 	oK(sm_list_destroy(ltpwm, vspan->avblIdxRbts,
 			deleteIdxRbt, NULL));
@@ -635,19 +1151,21 @@ static void	dropSpan(LtpVspan *vspan, PsmAddress vspanElt)
 
 static void	startSpan(LtpVspan *vspan)
 {
-	Sdr	sdr = getIonsdr();
-	LtpSpan	span;
-	char	ltpmeterCmdString[64];
-	char	cmd[SDRSTRING_BUFSZ];
-	char	engineIdString[11];
-	char	lsoCmdString[SDRSTRING_BUFSZ + 64];
+	Sdr		sdr = getIonsdr();
+	LtpSpan		span;
+	LtpSpanConfig	config;
+	char		ltpmeterCmdString[64];
+	char		cmd[SDRSTRING_BUFSZ];
+	char		engineIdString[11];
+	char		lsoCmdString[SDRSTRING_BUFSZ + 64];
 
 	sdr_read(sdr, (char *) &span, sdr_list_data(sdr, vspan->spanElt),
 			sizeof(LtpSpan));
+	sdr_read(sdr, (char *) &config, span.config, sizeof(LtpSpanConfig));
 	isprintf(ltpmeterCmdString, sizeof ltpmeterCmdString,
 			"ltpmeter " UVAST_FIELDSPEC, span.engineId);
 	vspan->meterPid = pseudoshell(ltpmeterCmdString);
-	sdr_string_read(sdr, cmd, span.lsoCmd);
+	sdr_string_read(sdr, cmd, config.lsoCmd);
 	isprintf(engineIdString, sizeof engineIdString, UVAST_FIELDSPEC,
 			span.engineId);
 	isprintf(lsoCmdString, sizeof lsoCmdString, "%s %s", cmd,
@@ -760,7 +1278,10 @@ static LtpVdb		*_ltpvdb(char **name)
 		vdb->ownEngineId = db->ownEngineId;
 		vdb->lsiPid = ERROR;		/*	None yet.	*/
 		vdb->clockPid = ERROR;		/*	None yet.	*/
+		vdb->relayPid = ERROR;		/*	None yet.	*/
 		if ((vdb->spans = sm_list_create(wm)) == 0
+		|| (vdb->spanHash = psm_malloc(wm, LTP_SPAN_HASH_BUCKETS
+				* sizeof(PsmAddress))) == 0
 		|| psm_catlg(wm, *name, vdbAddress) < 0)
 		{
 			sdr_exit_xn(sdr);
@@ -768,13 +1289,21 @@ static LtpVdb		*_ltpvdb(char **name)
 			return NULL;
 		}
 
+		memset((char *) psp(wm, vdb->spanHash), 0,
+				LTP_SPAN_HASH_BUCKETS * sizeof(PsmAddress));
+
 		/*	Raise all clients.				*/
 
 		for (i = 0, client = vdb->clients; i < LTP_MAX_NBR_OF_CLIENTS;
 				i++, client++)
 		{
 			client->notices = db->clients[i].notices;
-			raiseClient(client);
+			if (raiseClient(client) < 0)
+			{
+				sdr_exit_xn(sdr);
+				putErrmsg("Can't raise all clients.", NULL);
+				return NULL;
+			}
 		}
 
 		/*	Raise all spans.				*/
@@ -801,6 +1330,33 @@ static char	*_ltpdbName()
 	return "ltpdb";
 }
 
+static void	createSlabCaches(Sdr sdr, LtpDB *db)
+{
+	if (db->xmitSegSlab == 0)
+	{
+		db->xmitSegSlab = sdr_slab_create(sdr, "ltp xmit seg",
+				sizeof(LtpXmitSeg));
+	}
+
+	if (db->eventSlab == 0)
+	{
+		db->eventSlab = sdr_slab_create(sdr, "ltp event",
+				sizeof(LtpEvent));
+	}
+
+	if (db->noticeSlab == 0)
+	{
+		db->noticeSlab = sdr_slab_create(sdr, "ltp notice",
+				sizeof(LtpNotice));
+	}
+
+	if (db->claimSlab == 0)
+	{
+		db->claimSlab = sdr_slab_create(sdr, "ltp claim",
+				sizeof(LtpReceptionClaim));
+	}
+}
+
 int	ltpInit(int estMaxExportSessions)
 {
 	Sdr	sdr;
@@ -859,7 +1415,7 @@ int	ltpInit(int estMaxExportSessions)
 		ltpdbBuf.maxBER = DEFAULT_MAX_BER;
 		for (i = 0; i < LTP_MAX_NBR_OF_CLIENTS; i++)
 		{
-			ltpdbBuf.clients[i].notices = sdr_list_create(sdr);
+			ltpdbBuf.clients[i].notices = sdr_ulist_create(sdr);
 		}
 
 		ltpdbBuf.exportSessionsHash = sdr_hash_create(sdr,
@@ -871,6 +1427,7 @@ int	ltpInit(int estMaxExportSessions)
 		ltpdbBuf.deadExports = sdr_list_create(sdr);
 		ltpdbBuf.spans = sdr_list_create(sdr);
 		ltpdbBuf.timeline = sdr_list_create(sdr);
+		createSlabCaches(sdr, &ltpdbBuf);
 		ltpdbBuf.maxAcqInHeap = 560;
 		sdr_write(sdr, ltpdbObject, (char *) &ltpdbBuf,
 				sizeof(LtpDB));
@@ -884,11 +1441,29 @@ int	ltpInit(int estMaxExportSessions)
 		break;
 
 	default:		/*	Found DB in the SDR.		*/
-		sdr_exit_xn(sdr);
-	}
+		sdr_read(sdr, (char *) &ltpdbBuf, ltpdbObject, sizeof(LtpDB));
+		if (ltpdbBuf.xmitSegSlab && ltpdbBuf.eventSlab
+		&& ltpdbBuf.noticeSlab && ltpdbBuf.claimSlab)
+		{
+			sdr_exit_xn(sdr);
+			break;
+		}
 
-	oK(_ltpdbObject(&ltpdbObject));	/*	Save database location.	*/
-	oK(_ltpConstants());
+		/*	Database predates slab allocation.		*/
+
+		createSlabCaches(sdr, &ltpdbBuf);
+		sdr_write(sdr, ltpdbObject, (char *) &ltpdbBuf,
+				sizeof(LtpDB));
+		if (sdr_end_xn(sdr))
+		{
+			putErrmsg("Can't add slab caches to LTP database.",
+					NULL);
+			return -1;
+		}
+	}
+
+	oK(_ltpdbObject(&ltpdbObject));	/*	Save database location.	*/
+	oK(_ltpConstants());
 
 	/*	Load volatile database, initializing as necessary.	*/
 
@@ -945,6 +1520,14 @@ int	ltpStart(char *lsiCmd)
 		ltpvdb->lsiPid = pseudoshell(lsiCmd);
 	}
 
+	/*	Start the shard relay if necessary.			*/
+
+	if ((_ltpConstants())->shardCount > 1
+	&& (ltpvdb->relayPid == ERROR || sm_TaskExists(ltpvdb->relayPid) == 0))
+	{
+		ltpvdb->relayPid = pseudoshell("ltprelay");
+	}
+
 	/*	Start output link services for remote spans.		*/
 
 	for (elt = sm_list_first(ltpwm, ltpvdb->spans); elt;
@@ -996,6 +1579,11 @@ void	ltpStop()		/*	Reverses ltpStart.		*/
 		sm_TaskKill(ltpvdb->clockPid, SIGTERM);
 	}
 
+	if (ltpvdb->relayPid != ERROR)
+	{
+		sm_TaskKill(ltpvdb->relayPid, SIGTERM);
+	}
+
 	sdr_exit_xn(sdr);	/*	Unlock memory.			*/
 
 	/*	Wait until all LTP processes have stopped.		*/
@@ -1023,10 +1611,19 @@ void	ltpStop()		/*	Reverses ltpStart.		*/
 		}
 	}
 
+	if (ltpvdb->relayPid != ERROR)
+	{
+		while (sm_TaskExists(ltpvdb->relayPid))
+		{
+			microsnooze(100000);
+		}
+	}
+
 	/*	Now erase all the tasks and reset the semaphores.	*/
 
-	CHKVOID(sdr_begin_xn(sdr));	/*	Just to lock memory.	*/
+	CHKVOID(sdr_begin_xn(sdr));
 	ltpvdb->clockPid = ERROR;
+	ltpvdb->relayPid = ERROR;
 	for (i = 0, client = ltpvdb->clients; i < LTP_MAX_NBR_OF_CLIENTS;
 			i++, client++)
 	{
@@ -1038,10 +1635,14 @@ void	ltpStop()		/*	Reverses ltpStart.		*/
 			elt = sm_list_next(ltpwm, elt))
 	{
 		vspan = (LtpVspan *) psp(ltpwm, sm_list_data(ltpwm, elt));
+		ltpFlushSpanStats(vspan);
 		resetSpan(vspan);
 	}
 
-	sdr_exit_xn(sdr);		/*	Unlock memory.		*/
+	if (sdr_end_xn(sdr) < 0)
+	{
+		putErrmsg("Can't flush LTP span statistics.", NULL);
+	}
 }
 
 int	ltpAttach()
@@ -1107,16 +1708,71 @@ void	ltpDetach()
 
 /*	*	*	LTP span mgt and access functions	*	*/
 
+/*	Every raised span is in the volatile database's list of
+ *	spans and also in a hash index, an array of buckets each of
+ *	which is the first of a chain of list elements for spans
+ *	whose engine IDs hash to that bucket.  The chains are linked
+ *	through the spans' hashNext fields.				*/
+
+static PsmAddress	*spanHashBucket(uvast engineId)
+{
+	PsmPartition	ltpwm = getIonwm();
+	PsmAddress	*buckets;
+
+	buckets = (PsmAddress *) psp(ltpwm, (_ltpvdb(NULL))->spanHash);
+	return buckets + (engineId % LTP_SPAN_HASH_BUCKETS);
+}
+
+void	ltpIndexSpan(PsmAddress vspanElt)
+{
+	PsmPartition	ltpwm = getIonwm();
+	LtpVspan	*vspan;
+	PsmAddress	*bucket;
+
+	CHKVOID(ionLocked());
+	CHKVOID(vspanElt);
+	vspan = (LtpVspan *) psp(ltpwm, sm_list_data(ltpwm, vspanElt));
+	bucket = spanHashBucket(vspan->engineId);
+	vspan->hashNext = *bucket;
+	*bucket = vspanElt;
+}
+
+void	ltpUnindexSpan(PsmAddress vspanElt)
+{
+	PsmPartition	ltpwm = getIonwm();
+	LtpVspan	*vspan;
+	PsmAddress	*bucket;
+	LtpVspan	*predecessor;
+
+	CHKVOID(ionLocked());
+	CHKVOID(vspanElt);
+	vspan = (LtpVspan *) psp(ltpwm, sm_list_data(ltpwm, vspanElt));
+	bucket = spanHashBucket(vspan->engineId);
+	while (*bucket != vspanElt)
+	{
+		if (*bucket == 0)
+		{
+			return;		/*	Span wasn't indexed.	*/
+		}
+
+		predecessor = (LtpVspan *) psp(ltpwm, sm_list_data(ltpwm,
+				*bucket));
+		bucket = &(predecessor->hashNext);
+	}
+
+	*bucket = vspan->hashNext;
+	vspan->hashNext = 0;
+}
+
 void	findSpan(uvast engineId, LtpVspan **vspan, PsmAddress *vspanElt)
 {
 	PsmPartition	ltpwm = getIonwm();
 	PsmAddress	elt;
 
-	CHKVOID(ionLocked());
+	CHKVOID(ionReadLocked());
 	CHKVOID(vspan);
 	CHKVOID(vspanElt);
-	for (elt = sm_list_first(ltpwm, (_ltpvdb(NULL))->spans); elt;
-			elt = sm_list_next(ltpwm, elt))
+	for (elt = *(spanHashBucket(engineId)); elt; elt = (*vspan)->hashNext)
 	{
 		*vspan = (LtpVspan *) psp(ltpwm, sm_list_data(ltpwm, elt));
 		if ((*vspan)->engineId == engineId)
@@ -1130,12 +1786,15 @@ void	findSpan(uvast engineId, LtpVspan **vspan, PsmAddress *vspanElt)
 
 void	checkReservationLimit()
 {
-	Sdr	sdr = getIonsdr();
-	Object	dbobj = getLtpDbObject();
-	LtpDB	db;
-	int	totalSessionsAvbl;
-	Object	elt;
+	Sdr		sdr = getIonsdr();
+	Object		dbobj = getLtpDbObject();
+	LtpDB		db;
+	int		totalSessionsAvbl;
+	Object		elt;
+	SdrHashSummary	hashUsage;
+	char		buf[128];
 		OBJ_POINTER(LtpSpan, span);
+		OBJ_POINTER(LtpSpanConfig, config);
 
 	CHKVOID(sdr_begin_xn(sdr));
 	sdr_read(sdr, (char *) &db, dbobj, sizeof(LtpDB));
@@ -1145,13 +1804,15 @@ void	checkReservationLimit()
 	{
 		GET_OBJ_POINTER(sdr, LtpSpan, span, sdr_list_data(sdr,
 				elt));
-		totalSessionsAvbl -= span->maxExportSessions;
+		GET_OBJ_POINTER(sdr, LtpSpanConfig, config, span->config);
+		totalSessionsAvbl -= config->maxExportSessions;
 	}
 
 	if (totalSessionsAvbl < 0)
 	{
-		writeMemoNote("[?] Total max export sessions exceeds \
-estimate.  Session lookup speed may be degraded", itoa(totalSessionsAvbl));
+		writeMemoNote("[i] Total max export sessions exceeds \
+estimate.  Export session hash table will grow as needed",
+				itoa(totalSessionsAvbl));
 	}
 	else
 	{
@@ -1159,6 +1820,11 @@ estimate.  Session lookup speed may be degraded", itoa(totalSessionsAvbl));
 estimate.");
 	}
 
+	sdr_hash_usage(sdr, db.exportSessionsHash, &hashUsage);
+	isprintf(buf, sizeof buf, "entries %d, slots %d, load %.1f%%, mean \
+probes %.2f", hashUsage.entries, hashUsage.capacity, hashUsage.loadFactor,
+			hashUsage.meanProbes);
+	writeMemoNote("[i] Export session hash table", buf);
 	sdr_exit_xn(sdr);
 }
 
@@ -1171,7 +1837,9 @@ int	addSpan(uvast engineId, unsigned int maxExportSessions,
 	LtpVspan	*vspan;
 	PsmAddress	vspanElt;
 	LtpSpan		spanBuf;
+	LtpSpanConfig	configBuf;
 	LtpSpanStats	statsInit;
+			OBJ_POINTER(LtpDB, ltpdb);
 	Object		addr;
 	Object		spanElt = 0;
 
@@ -1219,19 +1887,31 @@ int	addSpan(uvast engineId, unsigned int maxExportSessions,
 		return 0;
 	}
 
+	GET_OBJ_POINTER(sdr, LtpDB, ltpdb, _ltpdbObject(NULL));
+	if (ltpShardOf(engineId, ltpdb->shardCount) != ltpdb->shardNbr)
+	{
+		sdr_exit_xn(sdr);
+		writeMemoNote("[?] Span is served by another shard",
+				utoa(engineId));
+		return 0;
+	}
+
 	/*	All parameters validated, okay to add the span.		*/
 
+	memset((char *) &configBuf, 0, sizeof(LtpSpanConfig));
+	configBuf.remoteQtime = qTime;
+	configBuf.purge = purge ? 1 : 0;
+	configBuf.lsoCmd = sdr_string_create(sdr, lsoCmd);
+	configBuf.maxExportSessions = maxExportSessions;
+	configBuf.maxImportSessions = maxImportSessions;
+	configBuf.aggrSizeLimit = aggrSizeLimit;
+	configBuf.aggrTimeLimit = aggrTimeLimit;
+	configBuf.maxSegmentSize = maxSegmentSize;
 	memset((char *) &spanBuf, 0, sizeof(LtpSpan));
 	spanBuf.engineId = engineId;
 	encodeSdnv(&(spanBuf.engineIdSdnv), spanBuf.engineId);
-	spanBuf.remoteQtime = qTime;
-	spanBuf.purge = purge ? 1 : 0;
-	spanBuf.lsoCmd = sdr_string_create(sdr, lsoCmd);
-	spanBuf.maxExportSessions = maxExportSessions;
-	spanBuf.maxImportSessions = maxImportSessions;
-	spanBuf.aggrSizeLimit = aggrSizeLimit;
-	spanBuf.aggrTimeLimit = aggrTimeLimit;
-	spanBuf.maxSegmentSize = maxSegmentSize;
+	spanBuf.config = sdr_insert(sdr, (char *) &configBuf,
+			sizeof(LtpSpanConfig));
 	spanBuf.exportSessions = sdr_list_create(sdr);
 	spanBuf.segments = sdr_list_create(sdr);
 	spanBuf.importSessions = sdr_list_create(sdr);
@@ -1285,6 +1965,7 @@ int	updateSpan(uvast engineId, unsigned int maxExportSessions,
 	PsmAddress	vspanElt;
 	Object		addr;
 	LtpSpan		spanBuf;
+	LtpSpanConfig	configBuf;
 
 	if (lsoCmd)
 	{
@@ -1324,57 +2005,61 @@ string too long.", lsoCmd);
 	}
 
 	addr = (Object) sdr_list_data(sdr, vspan->spanElt);
-	sdr_stage(sdr, (char *) &spanBuf, addr, sizeof(LtpSpan));
+	sdr_read(sdr, (char *) &spanBuf, addr, sizeof(LtpSpan));
+	sdr_stage(sdr, (char *) &configBuf, spanBuf.config,
+			sizeof(LtpSpanConfig));
 	if (maxExportSessions == 0)
 	{
-		maxExportSessions = spanBuf.maxExportSessions;
+		maxExportSessions = configBuf.maxExportSessions;
 	}
 
 	if (maxImportSessions == 0)
 	{
-		maxImportSessions = spanBuf.maxImportSessions;
+		maxImportSessions = configBuf.maxImportSessions;
 	}
 
 	if (aggrSizeLimit == 0)
 	{
-		aggrSizeLimit = spanBuf.aggrSizeLimit;
+		aggrSizeLimit = configBuf.aggrSizeLimit;
 	}
 
 	if (aggrTimeLimit == 0)
 	{
-		aggrTimeLimit = spanBuf.aggrTimeLimit;
+		aggrTimeLimit = configBuf.aggrTimeLimit;
 	}
 
 	/*	All parameters validated, okay to update the span.	*/
 
-	spanBuf.maxExportSessions = maxExportSessions;
-	spanBuf.maxImportSessions = maxImportSessions;
+	configBuf.maxExportSessions = maxExportSessions;
+	configBuf.maxImportSessions = maxImportSessions;
 	if (lsoCmd)
 	{
-		if (spanBuf.lsoCmd)
+		if (configBuf.lsoCmd)
 		{
-			sdr_free(sdr, spanBuf.lsoCmd);
+			sdr_free(sdr, configBuf.lsoCmd);
 		}
 
-		spanBuf.lsoCmd = sdr_string_create(sdr, lsoCmd);
+		configBuf.lsoCmd = sdr_string_create(sdr, lsoCmd);
 	}
 
-	spanBuf.remoteQtime = qTime;
-	spanBuf.purge = purge ? 1 : 0;
-	if (maxSegmentSize > 0 && maxSegmentSize != spanBuf.maxSegmentSize)
+	configBuf.remoteQtime = qTime;
+	configBuf.purge = purge ? 1 : 0;
+	if (maxSegmentSize > 0 && maxSegmentSize != configBuf.maxSegmentSize)
 	{
-		spanBuf.maxSegmentSize = maxSegmentSize;
+		configBuf.maxSegmentSize = maxSegmentSize;
 		vspan->maxXmitSegSize = maxSegmentSize;
 		computeRetransmissionLimits(vspan);
 	}
 
-	spanBuf.aggrSizeLimit = aggrSizeLimit;
+	configBuf.aggrSizeLimit = aggrSizeLimit;
 	if (aggrTimeLimit)
 	{
-		spanBuf.aggrTimeLimit = aggrTimeLimit;
+		configBuf.aggrTimeLimit = aggrTimeLimit;
 	}
 
-	sdr_write(sdr, addr, (char *) &spanBuf, sizeof(LtpSpan));
+	sdr_write(sdr, spanBuf.config, (char *) &configBuf,
+			sizeof(LtpSpanConfig));
+	mirrorSpanConfig(vspan, &configBuf);
 	if (sdr_end_xn(sdr) < 0)
 	{
 		putErrmsg("Can't update span.", itoa(engineId));
@@ -1392,6 +2077,7 @@ int	removeSpan(uvast engineId)
 	Object		spanElt;
 	Object		spanObj;
 			OBJ_POINTER(LtpSpan, span);
+			OBJ_POINTER(LtpSpanConfig, config);
 
 	/*	Must stop the span before trying to remove it.		*/
 
@@ -1442,11 +2128,14 @@ removed yet.", itoa(engineId));
 	/*	Okay to remove this span from the database.		*/
 
 	dropSpan(vspan, vspanElt);
-	if (span->lsoCmd)
+	GET_OBJ_POINTER(sdr, LtpSpanConfig, config, span->config);
+	if (config->lsoCmd)
 	{
-		sdr_free(sdr, span->lsoCmd);
+		sdr_free(sdr, config->lsoCmd);
 	}
 
+	sdr_free(sdr, span->config);
+
 	sdr_list_destroy(sdr, span->exportSessions, NULL, NULL);
 	sdr_list_destroy(sdr, span->segments, NULL, NULL);
 	sdr_list_destroy(sdr, span->importSessions, NULL, NULL);
@@ -1528,7 +2217,8 @@ int	startExportSession(Sdr sdr, Object spanObj, LtpVspan *vspan)
 	sdr_stage(sdr, (char *) &ltpdb, dbobj, sizeof(LtpDB));
 	ltpdb.sessionCount++;
 	sdr_write(sdr, dbobj, (char *) &ltpdb, sizeof(LtpDB));
-	sessionNbr = ltpdb.sessionCount;
+	sessionNbr = ltpShardSessionNbr(ltpdb.sessionCount, ltpdb.shardNbr,
+			ltpdb.shardCount);
 
 	/*	Record the session object in the database. The
 	 *	exportSessions list element points to the session
@@ -1553,12 +2243,27 @@ int	startExportSession(Sdr sdr, Object spanObj, LtpVspan *vspan)
 	session.span = spanObj;
 	session.sessionNbr = sessionNbr;
 	encodeSdnv(&(session.sessionNbrSdnv), session.sessionNbr);
-	session.svcDataObjects = sdr_list_create(sdr);
-	session.redSegments = sdr_list_create(sdr);
-	session.greenSegments = sdr_list_create(sdr);
-	session.claims = sdr_list_create(sdr);
-	session.checkpoints = sdr_list_create(sdr);
-	session.rsSerialNbrs = sdr_list_create(sdr);
+	session.arena = sdr_arena_create(sdr, LTP_SESSION_ARENA_CHUNK);
+	if (session.arena == 0)
+	{
+		putErrmsg("Can't create export session arena.", NULL);
+		sdr_cancel_xn(sdr);
+		return -1;
+	}
+
+	/*	All of the session's lists, and the claims and
+	 *	checkpoints referenced by them, are allocated from
+	 *	the session's arena.  List elements and claims that
+	 *	are discarded while the session is active are reused
+	 *	within the arena; everything else is released all at
+	 *	once when the session is cleared.			*/
+
+	session.svcDataObjects = sdr_list_create_in_arena(sdr, session.arena);
+	session.redSegments = sdr_list_create_in_arena(sdr, session.arena);
+	session.greenSegments = sdr_list_create_in_arena(sdr, session.arena);
+	session.claims = sdr_list_create_in_arena(sdr, session.arena);
+	session.checkpoints = sdr_list_create_in_arena(sdr, session.arena);
+	session.rsSerialNbrs = sdr_list_create_in_arena(sdr, session.arena);
 	sdr_write(sdr, sessionObj, (char *) &session, sizeof(ExportSession));
 
 	/*	Note session address in span, then finish: unless span
@@ -1571,8 +2276,7 @@ int	startExportSession(Sdr sdr, Object spanObj, LtpVspan *vspan)
 	sdr_write(sdr, spanObj, (char *) &span, sizeof(LtpSpan));
 	if (vspan->localXmitRate > 0)
 	{
-		sm_SemGive(vspan->bufOpenRedSemaphore);
-		sm_SemGive(vspan->bufOpenGreenSemaphore);
+		openExportBuffer(vspan);
 	}
 
 	if (sdr_end_xn(sdr))
@@ -1595,7 +2299,7 @@ static Object	insertLtpTimelineEvent(LtpEvent *newEvent)
 		OBJ_POINTER(LtpEvent, event);
 
 	CHKZERO(ionLocked());
-	eventObj = sdr_malloc(sdr, sizeof(LtpEvent));
+	eventObj = sdr_slab_malloc(sdr, (_ltpConstants())->eventSlab);
 	if (eventObj == 0)
 	{
 		putErrmsg("No space for timeline event.", NULL);
@@ -1637,7 +2341,8 @@ static void	cancelEvent(LtpEventType type, uvast refNbr1,
 		if (event->type == type && event->refNbr1 == refNbr1
 		&& event->refNbr2 == refNbr2 && event->refNbr3 == refNbr3)
 		{
-			sdr_free(sdr, eventObj);
+			sdr_slab_free(sdr, (_ltpConstants())->eventSlab,
+					eventObj);
 			sdr_list_delete(sdr, elt, NULL, NULL);
 			return;
 		}
@@ -1678,6 +2383,7 @@ int	ltpAttachClient(unsigned int clientSvcId)
 		 *	endpoint, so simply close it now.		*/
 
 		client->pid = ERROR;
+		client->readinessFdCount = 0;
 	}
 
 	client->pid = sm_TaskIdSelf();
@@ -1705,20 +2411,23 @@ void	ltpDetachClient(unsigned int clientSvcId)
 	}
 
 	client->pid = -1;
+	client->readinessFdCount = 0;
 	sdr_exit_xn(sdr);	/*	Unlock memory.			*/
 }
 
 /*	*	*	Service interface functions	*	*	*/
 
 int	enqueueNotice(LtpVclient *client, uvast sourceEngineId,
-		unsigned int sessionNbr, unsigned int dataOffset,
-		unsigned int dataLength, LtpNoticeType type,
+		unsigned int sessionNbr, uvast dataOffset,
+		uvast dataLength, LtpNoticeType type,
 		unsigned char reasonCode, unsigned char endOfBlock,
 		Object data)
 {
 	Sdr		sdr = getIonsdr();
 	Object		noticeObj;
 	LtpNotice	notice;
+	LtpStagedClient	*staging;
+	LtpStagedNotice	*staged;
 
 	CHKERR(client);
 	if (client->pid == ERROR)
@@ -1727,17 +2436,6 @@ int	enqueueNotice(LtpVclient *client, uvast sourceEngineId,
 	}
 
 	CHKERR(ionLocked());
-	noticeObj = sdr_malloc(sdr, sizeof(LtpNotice));
-	if (noticeObj == 0)
-	{
-		return -1;
-	}
-
-	if (sdr_list_insert_last(sdr, client->notices, noticeObj) == 0)
-	{
-		return -1;
-	}
-
 	notice.sessionId.sourceEngineId = sourceEngineId;
 	notice.sessionId.sessionNbr = sessionNbr;
 	notice.dataOffset = dataOffset;
@@ -1746,26 +2444,138 @@ int	enqueueNotice(LtpVclient *client, uvast sourceEngineId,
 	notice.reasonCode = reasonCode;
 	notice.endOfBlock = endOfBlock;
 	notice.data = data;
-	sdr_write(sdr, noticeObj, (char *) &notice, sizeof(LtpNotice));
 
-	/*	Tell client that a notice is waiting.			*/
+	/*	Once the ring has overflowed, all notices are spilled
+	 *	to the SDR list until the client has caught up, so
+	 *	that notices are never delivered out of order.  Ring
+	 *	entries and spills staged in the current transaction
+	 *	count as already posted.  (If a transaction that set
+	 *	spilling is canceled, spilling merely continues until
+	 *	the client next catches up.)				*/
+
+	staging = stagedClients + (client - (getLtpVdb())->clients);
+	if (client->spilling)
+	{
+		if (client->ringHead == client->ringTail
+		&& client->spilled == 0 && staging->spills == 0)
+		{
+			client->spilling = 0;
+		}
+	}
+	else
+	{
+		if (client->ringTail + staging->ringEntries - client->ringHead
+				>= LTP_NOTICE_RING_SIZE
+		|| stagedNoticeCount == LTP_NOTICE_STAGE_SIZE)
+		{
+			client->spilling = 1;
+		}
+	}
+
+	if (client->spilling || data != 0)
+	{
+		/*	Notice must be retained in the SDR.		*/
+
+		noticeObj = sdr_slab_malloc(sdr,
+				(_ltpConstants())->noticeSlab);
+		if (noticeObj == 0)
+		{
+			return -1;
+		}
+
+		if (sdr_ulist_push_last(sdr, client->notices, noticeObj) < 0)
+		{
+			return -1;
+		}
+
+		sdr_write(sdr, noticeObj, (char *) &notice, sizeof(LtpNotice));
+	}
+
+	/*	The notice is published to the client, and the client
+	 *	told that a notice is waiting, only when the current
+	 *	transaction is committed.				*/
+
+	if (client->spilling)
+	{
+		staging->spills++;
+	}
+	else
+	{
+		staged = stagedNotices + stagedNoticeCount;
+		stagedNoticeCount++;
+		staged->client = client;
+		if (data != 0)
+		{
+			staged->slot.inSdr = 1;
+		}
+		else
+		{
+			staged->slot.inSdr = 0;
+			memcpy((char *) &(staged->slot.notice),
+					(char *) &notice, sizeof(LtpNotice));
+		}
+
+		staging->ringEntries++;
+	}
+
+	if (!noticesStaged)
+	{
+		noticesStaged = 1;
+		stagingThread = pthread_self();
+		sdr_set_unlock_fn(endLtpTransaction);
+	}
+
+	ltpSignalReadinessFifo(LTP_CLIENT_FIFO,
+			client - (_ltpvdb(NULL))->clients,
+			&(client->readinessFdCount));
 
-	sm_SemGive(client->semaphore);
 	return 0;
 }
 
 /*	*	*	Session management functions	*	*	*/
 
+static LtpSessionCacheEntry	*cacheEntry(LtpSessionCache *cache,
+					unsigned int sessionNbr)
+{
+	return cache->entries + (sessionNbr & (LTP_SESSION_CACHE_SIZE - 1));
+}
+
+static void	forgetCachedSession(LtpSessionCache *cache,
+			unsigned int sessionNbr)
+{
+	LtpSessionCacheEntry	*entry = cacheEntry(cache, sessionNbr);
+
+	if (entry->sessionNbr == sessionNbr)
+	{
+		entry->sessionNbr = 0;
+	}
+}
+
 static void	getExportSession(unsigned int sessionNbr, Object *sessionObj)
 {
-	Sdr	sdr = getIonsdr();
-	Object	elt;
+	Sdr			sdr = getIonsdr();
+	LtpSessionCache		*cache = &((_ltpvdb(NULL))->exportCache);
+	LtpSessionCacheEntry	*entry;
+	Object			elt;
 
 	CHKVOID(ionLocked());
+	entry = cacheEntry(cache, sessionNbr);
+	if (entry->sessionNbr == sessionNbr && sessionNbr != 0)
+	{
+		cache->hits++;
+		*sessionObj = entry->sessionObj;
+		return;
+	}
+
+	cache->misses++;
 	if (sdr_hash_retrieve(sdr, (_ltpConstants())->exportSessionsHash,
 			(char *) &sessionNbr, (Address *) &elt, NULL) == 1)
 	{
 		*sessionObj = sdr_list_data(sdr, elt);
+		entry->sessionNbr = sessionNbr;
+		entry->sessionObj = *sessionObj;
+		entry->sessionElt = elt;
+		entry->vsession = 0;
 		return; 
 	}
 
@@ -1817,9 +2627,9 @@ static void	destroyDataXmitSeg(Object dsElt, Object dsObj, LtpXmitSeg *ds)
 	{
 		if (ds->ckptListElt)	/*	A checkpoint segment.	*/
 		{
-			/*	Destroy LtpCkpt object and its ListElt.	*/
+			/*	Forget the LtpCkpt; the object itself
+			 *	is in the session's arena.		*/
 
-			sdr_free(sdr, sdr_list_data(sdr, ds->ckptListElt));
 			sdr_list_delete(sdr, ds->ckptListElt, NULL, NULL);
 		}
 	}
@@ -1841,7 +2651,7 @@ static void	destroyDataXmitSeg(Object dsElt, Object dsObj, LtpXmitSeg *ds)
 				ltpei_destroy_extension, NULL);
 	}
 
-	sdr_free(sdr, dsObj);
+	sdr_slab_free(sdr, (_ltpConstants())->xmitSegSlab, dsObj);
 	sdr_list_delete(sdr, dsElt, NULL, NULL);
 }
 
@@ -1868,17 +2678,17 @@ static void	stopExportSession(ExportSession *session)
 	}
 }
 
-static void	destroySdrListData(Sdr sdr, Object elt, void *arg)
-{
-	sdr_free(sdr, sdr_list_data(sdr, elt));
-}
-
 static void	clearExportSession(ExportSession *session)
 {
 	Sdr	sdr = getIonsdr();
 	int	claimCount;
 
-	sdr_list_destroy(sdr, session->checkpoints, destroySdrListData, NULL);
+	/*	The session's lists are all in the session's arena,
+	 *	as are the checkpoints and claims they reference,
+	 *	so destroying the lists costs nothing and all of
+	 *	their space is released when the arena is destroyed.	*/
+
+	sdr_list_destroy(sdr, session->checkpoints, NULL, NULL);
 	session->checkpoints = 0;
 	sdr_list_destroy(sdr, session->rsSerialNbrs, NULL, NULL);
 	session->rsSerialNbrs = 0;
@@ -1893,8 +2703,10 @@ static void	clearExportSession(ExportSession *session)
 reception claims", itoa(claimCount));
 	}
 
-	sdr_list_destroy(sdr, session->claims, destroySdrListData, NULL);
+	sdr_list_destroy(sdr, session->claims, NULL, NULL);
 	session->claims = 0;
+	sdr_arena_destroy(sdr, session->arena);
+	session->arena = 0;
 }
 
 static void	closeExportSession(Object sessionObj)
@@ -1960,6 +2772,8 @@ notice.", NULL);
 	 *	list length and thereby possibly enabling a blocked
 	 *	client to append an SDU to the current block.		*/
 
+	forgetCachedSession(&((_ltpvdb(NULL))->exportCache),
+			session->sessionNbr);
 	sdr_hash_remove(sdr, db.exportSessionsHash,
 			(char *) &(session->sessionNbr), (Address *) &elt);
 	sdr_list_delete(sdr, elt, NULL, NULL);
@@ -1973,8 +2787,7 @@ putErrmsg("Closed export session.", itoa(session->sessionNbr));
 	}
 	else
 	{
-		sm_SemGive(vspan->bufOpenRedSemaphore);
-		sm_SemGive(vspan->bufOpenGreenSemaphore);
+		openExportBuffer(vspan);
 	}
 }
 
@@ -2012,7 +2825,7 @@ static PsmAddress	getIdxRbt(PsmPartition ltpwm, LtpVspan *vspan)
 		return rbt;
 	}
 
-	return sm_rbt_create(ltpwm);
+	return ltp_idx_create(ltpwm);
 }
 
 static void	addVImportSession(LtpVspan *vspan, unsigned int sessionNbr,
@@ -2032,17 +2845,17 @@ static void	addVImportSession(LtpVspan *vspan, unsigned int sessionNbr,
 	vsession = (VImportSession *) psp(ltpwm, addr);
 	vsession->sessionNbr = sessionNbr;
 	vsession->sessionElt = sessionElt;
-	vsession->redSegmentsIdx = getIdxRbt(ltpwm, vspan);
-	if (vsession->redSegmentsIdx == 0)
+	vsession->redExtentsIdx = getIdxRbt(ltpwm, vspan);
+	if (vsession->redExtentsIdx == 0)
 	{
 		psm_free(ltpwm, addr);
 		return;
 	}
 
-	if (sm_rbt_insert(ltpwm, vspan->importSessions, addr,
+	if (ltp_idx_insert(ltpwm, vspan->importSessions, addr,
 			orderImportSessions, vsession) == 0)
 	{
-		sm_rbt_destroy(ltpwm, vsession->redSegmentsIdx, NULL, NULL);
+		ltp_idx_destroy(ltpwm, vsession->redExtentsIdx, NULL, NULL);
 		psm_free(ltpwm, addr);
 		return;
 	}
@@ -2050,14 +2863,14 @@ static void	addVImportSession(LtpVspan *vspan, unsigned int sessionNbr,
 	*vsessionPtr = vsession;
 }
 
-static int	orderRedSegments(PsmPartition wm, PsmAddress nodeData,
+static int	orderRedExtents(PsmPartition wm, PsmAddress nodeData,
 			void *dataBuffer)
 {
-	LtpSegmentRef	*argRef;
-	LtpSegmentRef	*nodeRef;
+	LtpExtentRef	*argRef;
+	LtpExtentRef	*nodeRef;
 
-	argRef = (LtpSegmentRef *) dataBuffer;
-	nodeRef = (LtpSegmentRef *) psp(wm, nodeData);
+	argRef = (LtpExtentRef *) dataBuffer;
+	nodeRef = (LtpExtentRef *) psp(wm, nodeData);
 	if (nodeRef->offset < argRef->offset)
 	{
 		return -1;
@@ -2084,10 +2897,11 @@ static void	getImportSession(LtpVspan *vspan, unsigned int sessionNbr,
 	Object		elt;
 	ImportSession	session;
 	Object		elt2;
-	Object		segObj;
-			OBJ_POINTER(LtpRecvSeg, segment);
-	LtpSegmentRef	refbuf;
+			OBJ_POINTER(LtpRecvExtent, extent);
+	LtpExtentRef	refbuf;
 	Object		addr;
+	LtpSessionCache	*cache = &(vspan->importCache);
+	LtpSessionCacheEntry	*entry;
 
 	*sessionObj = 0;		/*	Default.		*/
 	if (vsessionPtr)
@@ -2096,13 +2910,28 @@ static void	getImportSession(LtpVspan *vspan, unsigned int sessionNbr,
 	}
 
 	CHKVOID(ionLocked());
+	entry = cacheEntry(cache, sessionNbr);
+	if (entry->sessionNbr == sessionNbr && sessionNbr != 0)
+	{
+		cache->hits++;
+		*sessionObj = entry->sessionObj;
+		if (vsessionPtr)
+		{
+			*vsessionPtr = (VImportSession *) psp(ltpwm,
+					entry->vsession);
+		}
+
+		return;
+	}
+
+	cache->misses++;
 	arg.sessionNbr = sessionNbr;
-	rbtNode = sm_rbt_search(ltpwm, vspan->importSessions,
+	rbtNode = ltp_idx_search(ltpwm, vspan->importSessions,
 			orderImportSessions, &arg, &nextRbtNode);
 	if (rbtNode)
 	{
 		vsession = (VImportSession *) psp(ltpwm,
-				sm_rbt_data(ltpwm, rbtNode));
+				ltp_idx_data(ltpwm, rbtNode));
 		*sessionObj = sdr_list_data(sdr, vsession->sessionElt);
 	}
 	else	/*	Must resurrect VImportSession.			*/
@@ -2118,7 +2947,7 @@ static void	getImportSession(LtpVspan *vspan, unsigned int sessionNbr,
 		*sessionObj = sdr_list_data(sdr, elt);
 
 		/*	Need to add this VImportSession and load it
-		 *	with all previously acquired red segments.	*/
+		 *	with all previously acquired red extents.	*/
 
 		addVImportSession(vspan, sessionNbr, elt, &vsession);
 		if (vsession == NULL)
@@ -2128,15 +2957,15 @@ static void	getImportSession(LtpVspan *vspan, unsigned int sessionNbr,
 
 		sdr_read(sdr, (char *) &session, *sessionObj,
 				sizeof(ImportSession));
-		for (elt2 = sdr_list_first(sdr, session.redSegments); elt2;
+		for (elt2 = sdr_list_first(sdr, session.redExtents); elt2;
 				elt2 = sdr_list_next(sdr, elt2))
 		{
-			segObj = sdr_list_data(sdr, elt2);
-			GET_OBJ_POINTER(sdr, LtpRecvSeg, segment, segObj);
-			refbuf.offset = segment->pdu.offset;
-			refbuf.length = segment->pdu.length;
-			refbuf.sessionListElt = segment->sessionListElt;
-			addr = psm_zalloc(ltpwm, sizeof(LtpSegmentRef));
+			GET_OBJ_POINTER(sdr, LtpRecvExtent, extent,
+					sdr_list_data(sdr, elt2));
+			refbuf.offset = extent->offset;
+			refbuf.length = extent->length;
+			refbuf.sessionListElt = elt2;
+			addr = psm_zalloc(ltpwm, sizeof(LtpExtentRef));
 			if (addr == 0)
 			{
 				putErrmsg("Failed resurrecting VImportSession.",
@@ -2146,9 +2975,9 @@ static void	getImportSession(LtpVspan *vspan, unsigned int sessionNbr,
 			}
 
 			memcpy((char *) psp(ltpwm, addr), (char *) &refbuf,
-					sizeof(LtpSegmentRef));
-			if (sm_rbt_insert(ltpwm, vsession->redSegmentsIdx,
-					addr, orderRedSegments, &refbuf) == 0)
+					sizeof(LtpExtentRef));
+			if (ltp_idx_insert(ltpwm, vsession->redExtentsIdx,
+					addr, orderRedExtents, &refbuf) == 0)
 			{
 				putErrmsg("Failed resurrecting VImportSession.",
 						NULL);
@@ -2158,6 +2987,10 @@ static void	getImportSession(LtpVspan *vspan, unsigned int sessionNbr,
 		}
 	}
 
+	entry->sessionNbr = sessionNbr;
+	entry->sessionObj = *sessionObj;
+	entry->sessionElt = vsession->sessionElt;
+	entry->vsession = psa(ltpwm, vsession);
 	if (vsessionPtr)
 	{
 		*vsessionPtr = vsession;
@@ -2246,7 +3079,8 @@ static void	destroyRsXmitSeg(Object rsElt, Object rsObj, LtpXmitSeg *rs)
 
 	while ((elt = sdr_list_first(sdr, rs->pdu.receptionClaims)))
 	{
-		sdr_free(sdr, sdr_list_data(sdr, elt));
+		sdr_slab_free(sdr, (_ltpConstants())->claimSlab,
+				sdr_list_data(sdr, elt));
 		sdr_list_delete(sdr, elt, NULL, NULL);
 	}
 
@@ -2272,7 +3106,7 @@ static void	destroyRsXmitSeg(Object rsElt, Object rsObj, LtpXmitSeg *rs)
 				ltpei_destroy_extension, NULL);
 	}
 
-	sdr_free(sdr, rsObj);
+	sdr_slab_free(sdr, (_ltpConstants())->xmitSegSlab, rsObj);
 	sdr_list_delete(sdr, rsElt, NULL, NULL);
 }
 
@@ -2292,119 +3126,405 @@ static void	stopVImportSession(ImportSession *session)
 		return;		/*	No such span.			*/
 	}
 
+	forgetCachedSession(&(vspan->importCache), session->sessionNbr);
 	arg.sessionNbr = session->sessionNbr;
-	oK(sm_rbt_delete(ltpwm, vspan->importSessions, orderImportSessions,
+	oK(ltp_idx_delete(ltpwm, vspan->importSessions, orderImportSessions,
 			&arg, deleteVImportSession, vspan));
 }
 
-static void	stopImportSession(ImportSession *session)
-{
-	Sdr	sdr = getIonsdr();
-	Object	elt;
-	Object	segObj;
-		OBJ_POINTER(LtpXmitSeg, rs);
-		OBJ_POINTER(LtpRecvSeg, ds);
+/*	When a red part overflows the heap reception buffer, the
+ *	remainder is written to a block file.  File descriptors are
+ *	private to the process, so the block files this process is
+ *	currently writing are tracked in a small private table (all
+ *	access to which is serialized by the ION lock) rather than
+ *	in the LTP volatile database.  A block file stays open from
+ *	one segment to the next until its red part is delivered,
+ *	its session is stopped, or its table entry is reused for
+ *	a more recently written block file.
+ *
+ *	A session may be stopped by some other process, which then
+ *	deletes the block file; a later session with the same
+ *	number would then reuse the path.  So a cached descriptor is
+ *	used only if it still refers to the file that is currently
+ *	at the block file's path.					*/
 
-	CHKVOID(ionLocked());
-	while ((elt = sdr_list_first(sdr, session->rsSegments)) != 0)
-	{
-		segObj = sdr_list_data(sdr, elt);
-		GET_OBJ_POINTER(sdr, LtpXmitSeg, rs, segObj);
-		destroyRsXmitSeg(elt, segObj, rs);
-	}
+typedef struct
+{
+	char		path[256];	/*	Empty if entry unused.	*/
+	int		fd;
+	dev_t		dev;		/*	Of the open file.	*/
+	ino_t		ino;		/*	Of the open file.	*/
+	int		preallocated;	/*	Boolean.		*/
+	unsigned int	lastUse;
+} LtpBlockFile;
 
-	sdr_list_destroy(sdr, session->rsSegments, NULL, NULL);
-	session->rsSegments = 0;
+static LtpBlockFile	blockFiles[LTP_BLOCK_FILES_OPEN];
+static unsigned int	blockFileUses = 0;
 
-	/*	Terminate reception of red-part data, release space,
-	 *	and reduce heap reservation occupancy.			*/
+static LtpBlockFile	*openBlockFile(char *path, int create)
+{
+	LtpBlockFile	*victim = blockFiles;
+	LtpBlockFile	*bf;
+	struct stat	st;
+	int		flags;
+	int		fd;
+	int		i;
 
-	if (session->redSegments)
+	for (i = 0, bf = blockFiles; i < LTP_BLOCK_FILES_OPEN; i++, bf++)
 	{
-		while ((elt = sdr_list_first(sdr, session->redSegments)))
+		if (bf->path[0] != '\0' && strcmp(bf->path, path) == 0)
 		{
-			segObj = sdr_list_data(sdr, elt);
-			GET_OBJ_POINTER(sdr, LtpRecvSeg, ds, segObj);
-			if (ds->pdu.headerExtensions)
+			if (stat(path, &st) == 0 && st.st_dev == bf->dev
+			&& st.st_ino == bf->ino)
 			{
-				sdr_list_destroy(sdr,
-						ds->pdu.headerExtensions,
-						ltpei_destroy_extension, NULL);
+				bf->lastUse = ++blockFileUses;
+				return bf;
 			}
 
-			if (ds->pdu.trailerExtensions)
-			{
-				sdr_list_destroy(sdr,
-						ds->pdu.trailerExtensions,
-						ltpei_destroy_extension, NULL);
-			}
+			/*	File was deleted (and maybe re-created)
+			 *	by another process; descriptor is stale.	*/
 
-			sdr_free(sdr, segObj);
-			sdr_list_delete(sdr, elt, NULL, NULL);
+			close(bf->fd);
+			bf->path[0] = '\0';
+		}
+
+		if (victim->path[0] == '\0')
+		{
+			continue;	/*	Already have a free entry.	*/
+		}
+
+		if (bf->path[0] == '\0' || bf->lastUse < victim->lastUse)
+		{
+			victim = bf;
 		}
+	}
 
-		sdr_list_destroy(sdr, session->redSegments, NULL, NULL);
-		session->redSegments = 0;
+	if (victim->path[0] != '\0')
+	{
+		close(victim->fd);
+		victim->path[0] = '\0';
 	}
 
-	stopVImportSession(session);
-	if (session->blockObjRef)
+	flags = O_WRONLY;
+	if (create)
 	{
-		zco_destroy_obj_ref(sdr, session->blockObjRef);
-		session->blockObjRef = 0;
+		flags |= O_CREAT;
 	}
 
-	/*	If service data not delivered, then destroying the
-	 *	object ref immediately causes the referenced heap
-	 *	object to be freed.  Otherwise, the service data
-	 *	object passed to the client is a ZCO, one of whose
-	 *	extents references this object reference; the object
-	 *	ref is retained until the last reference to that ZCO
-	 *	is destroyed, at which time the object ref is
-	 *	destroyed and the referenced heap object is freed.	*/
+#if LTP_BLOCK_DIRECT_IO && defined(O_DIRECT)
+	/*	Aligned staging must read back the partial blocks at
+	 *	the edges of each segment, so the file is opened for
+	 *	reading as well.  If the file system doesn't support
+	 *	direct I/O, the staged writes simply go through the
+	 *	page cache.						*/
 
-	if (session->blockFileRef)
+	flags = (flags & ~O_WRONLY) | O_RDWR;
+	fd = open(path, flags | O_DIRECT, 0666);
+	if (fd < 0 && errno == EINVAL)
 	{
-		zco_destroy_file_ref(sdr, session->blockFileRef);
-		session->blockFileRef = 0;
+		fd = open(path, flags, 0666);
 	}
-
-	/*	If service data not delivered, then destroying the
-	 *	file ref immediately causes its cleanup script to
-	 *	be executed, unlinking the file.  Otherwise, the
-	 *	service data object passed to the client is a ZCO,
-	 *	one of whose extents references this file ref; the
-	 *	file ref is retained until the last reference to that
-	 *	ZCO is destroyed, at which time the file ref is
-	 *	destroyed and the file is consequently unlinked.	*/
-#if LTPDEBUG
-putErrmsg("Stopped import session.", itoa(session->sessionNbr));
+#else
+	fd = open(path, flags, 0666);
 #endif
+	if (fd < 0)
+	{
+		putSysErrmsg("Can't open block file", path);
+		return NULL;
+	}
+
+	if (fstat(fd, &st) < 0)
+	{
+		putSysErrmsg("Can't stat block file", path);
+		close(fd);
+		return NULL;
+	}
+
+	istrcpy(victim->path, path, sizeof victim->path);
+	victim->fd = fd;
+	victim->dev = st.st_dev;
+	victim->ino = st.st_ino;
+	victim->preallocated = 0;
+	victim->lastUse = ++blockFileUses;
+	return victim;
 }
 
-static void	noteClosedImport(Sdr sdr, LtpSpan *span, ImportSession *session)
+static void	closeBlockFile(char *path, uvast fileSize)
 {
-	Object		elt;
-	unsigned int	closedSessionNbr;
-	Object		elt2;
-	LtpEvent	event;
-	time_t		currentTime;
-	LtpVspan	*vspan;
-	PsmAddress	vspanElt;
+	LtpBlockFile	*bf;
+	int		i;
 
-	/*	The closed-sessions list is in ascending session
-	 *	number order, so we insert at the end of the list.	*/
+	if (path[0] == '\0')
+	{
+		return;
+	}
 
-	for (elt = sdr_list_last(sdr, span->closedImports); elt;
-			elt = sdr_list_prev(sdr, elt))
+	for (i = 0, bf = blockFiles; i < LTP_BLOCK_FILES_OPEN; i++, bf++)
 	{
-		closedSessionNbr = (unsigned int) sdr_list_data(sdr, elt);
-		if (closedSessionNbr > session->sessionNbr)
+		if (bf->path[0] != '\0' && strcmp(bf->path, path) == 0)
 		{
-			continue;
-		}
+#if LTP_BLOCK_DIRECT_IO
+			/*	Aligned writes may have lengthened the
+			 *	file past the end of the red part.	*/
 
-		break;
+			if (ftruncate(bf->fd, fileSize) < 0)
+			{
+				putSysErrmsg("Can't truncate block file",
+						path);
+			}
+#endif
+			close(bf->fd);
+			bf->path[0] = '\0';
+			return;
+		}
+	}
+}
+
+static char	*getBlockFilePath(ImportSession *session, char *path)
+{
+	Sdr			sdr = getIonsdr();
+	ImportSessionCold	cold;
+
+	/*	The path lives in the session's cold record, which
+	 *	exists only once red data has overflowed to a file.	*/
+
+	if (session->cold == 0)
+	{
+		path[0] = '\0';
+	}
+	else
+	{
+		sdr_read(sdr, (char *) &cold, session->cold,
+				sizeof(ImportSessionCold));
+		istrcpy(path, cold.fileBufferPath, sizeof cold.fileBufferPath);
+	}
+
+	return path;
+}
+
+static void	preallocateBlockFile(LtpBlockFile *bf, uvast fileSize)
+{
+#if defined(linux)
+	int	result;
+
+	/*	Reserving all of the file's space at once keeps the
+	 *	file contiguous on disk and spares the file system
+	 *	an extension of the file on every segment written.	*/
+
+	result = posix_fallocate(bf->fd, 0, fileSize);
+	if (result != 0)
+	{
+		writeMemoNote("[?] Can't preallocate block file", bf->path);
+	}
+#endif
+	bf->preallocated = 1;
+}
+
+#if LTP_BLOCK_DIRECT_IO
+static int	readBlockFileBlock(LtpBlockFile *bf, char *into, uvast offset)
+{
+	ssize_t	length;
+
+	length = pread(bf->fd, into, LTP_BLOCK_IO_ALIGN, offset);
+	if (length < 0)
+	{
+		putSysErrmsg("Can't read from block file", bf->path);
+		return -1;
+	}
+
+	if (length < LTP_BLOCK_IO_ALIGN)	/*	Past EOF.	*/
+	{
+		memset(into + length, 0, LTP_BLOCK_IO_ALIGN - length);
+	}
+
+	return 0;
+}
+#endif
+
+static int	writeBlockFile(LtpBlockFile *bf, char *from, uvast offset,
+			uvast length)
+{
+	ssize_t		written;
+#if LTP_BLOCK_DIRECT_IO
+	static char	*stage = NULL;
+	static size_t	stageSize = 0;
+	uvast		start;
+	uvast		end;
+	size_t		stageLength;
+
+	/*	Direct I/O requires that buffer address, file offset,
+	 *	and transfer length all be aligned, so the segment's
+	 *	content is staged into the aligned blocks that it
+	 *	spans, after reading back any partial blocks at the
+	 *	edges of the segment.					*/
+
+	start = offset & ~((uvast) LTP_BLOCK_IO_ALIGN - 1);
+	end = (offset + length + LTP_BLOCK_IO_ALIGN - 1)
+			& ~((uvast) LTP_BLOCK_IO_ALIGN - 1);
+	stageLength = end - start;
+	if (stageLength > stageSize)
+	{
+		if (stage)
+		{
+			free(stage);
+			stage = NULL;
+			stageSize = 0;
+		}
+
+		if (posix_memalign((void **) &stage, LTP_BLOCK_IO_ALIGN,
+				stageLength) != 0)
+		{
+			stage = NULL;
+			putErrmsg("Can't allocate block file staging buffer.",
+					utoa(stageLength));
+			return -1;
+		}
+
+		stageSize = stageLength;
+	}
+
+	if (offset > start)
+	{
+		if (readBlockFileBlock(bf, stage, start) < 0)
+		{
+			return -1;
+		}
+	}
+
+	if (offset + length < end
+	&& !(offset > start && end - start == LTP_BLOCK_IO_ALIGN))
+	{
+		if (readBlockFileBlock(bf, stage + stageLength
+				- LTP_BLOCK_IO_ALIGN, end - LTP_BLOCK_IO_ALIGN)
+				< 0)
+		{
+			return -1;
+		}
+	}
+
+	memcpy(stage + (offset - start), from, length);
+	from = stage;
+	offset = start;
+	length = stageLength;
+#endif
+	while (length > 0)
+	{
+		written = pwrite(bf->fd, from, length, offset);
+		if (written < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+
+			putSysErrmsg("Can't write to block file", bf->path);
+			return -1;
+		}
+
+		from += written;
+		offset += written;
+		length -= written;
+	}
+
+	return 0;
+}
+
+static void	stopImportSession(ImportSession *session)
+{
+	Sdr	sdr = getIonsdr();
+	Object	elt;
+	Object	segObj;
+		OBJ_POINTER(LtpXmitSeg, rs);
+	char	path[256];
+
+	CHKVOID(ionLocked());
+	while ((elt = sdr_list_first(sdr, session->rsSegments)) != 0)
+	{
+		segObj = sdr_list_data(sdr, elt);
+		GET_OBJ_POINTER(sdr, LtpXmitSeg, rs, segObj);
+		destroyRsXmitSeg(elt, segObj, rs);
+	}
+
+	sdr_list_destroy(sdr, session->rsSegments, NULL, NULL);
+	session->rsSegments = 0;
+
+	/*	Terminate reception of red-part data, release space,
+	 *	and reduce heap reservation occupancy.  The extents
+	 *	list and its extents are in the session's arena.	*/
+
+	if (session->redExtents)
+	{
+		sdr_list_destroy(sdr, session->redExtents, NULL, NULL);
+		session->redExtents = 0;
+		session->redSegmentsCount = 0;
+	}
+
+	stopVImportSession(session);
+	if (session->blockObjRef)
+	{
+		zco_destroy_obj_ref(sdr, session->blockObjRef);
+		session->blockObjRef = 0;
+	}
+
+	/*	If service data not delivered, then destroying the
+	 *	object ref immediately causes the referenced heap
+	 *	object to be freed.  Otherwise, the service data
+	 *	object passed to the client is a ZCO, one of whose
+	 *	extents references this object reference; the object
+	 *	ref is retained until the last reference to that ZCO
+	 *	is destroyed, at which time the object ref is
+	 *	destroyed and the referenced heap object is freed.	*/
+
+	closeBlockFile(getBlockFilePath(session, path), session->blockFileSize);
+	if (session->blockFileRef)
+	{
+		zco_destroy_file_ref(sdr, session->blockFileRef);
+		session->blockFileRef = 0;
+	}
+
+	/*	The arena holds the session's lists, claims, extents,
+	 *	and cold record, so it goes last.			*/
+
+	sdr_arena_destroy(sdr, session->arena);
+	session->arena = 0;
+	session->cold = 0;
+
+	/*	If service data not delivered, then destroying the
+	 *	file ref immediately causes its cleanup script to
+	 *	be executed, unlinking the file.  Otherwise, the
+	 *	service data object passed to the client is a ZCO,
+	 *	one of whose extents references this file ref; the
+	 *	file ref is retained until the last reference to that
+	 *	ZCO is destroyed, at which time the file ref is
+	 *	destroyed and the file is consequently unlinked.	*/
+#if LTPDEBUG
+putErrmsg("Stopped import session.", itoa(session->sessionNbr));
+#endif
+}
+
+static void	noteClosedImport(Sdr sdr, LtpSpan *span, ImportSession *session)
+{
+	Object		elt;
+	unsigned int	closedSessionNbr;
+	Object		elt2;
+	LtpEvent	event;
+	time_t		currentTime;
+	LtpVspan	*vspan;
+	PsmAddress	vspanElt;
+
+	/*	The closed-sessions list is in ascending session
+	 *	number order, so we insert at the end of the list.	*/
+
+	for (elt = sdr_list_last(sdr, span->closedImports); elt;
+			elt = sdr_list_prev(sdr, elt))
+	{
+		closedSessionNbr = (unsigned int) sdr_list_data(sdr, elt);
+		if (closedSessionNbr > session->sessionNbr)
+		{
+			continue;
+		}
+
+		break;
 	}
 
 	if (elt)
@@ -2449,15 +3569,24 @@ static void	noteClosedImport(Sdr sdr, LtpSpan *span, ImportSession *session)
 
 static void	closeImportSession(Object sessionObj)
 {
-	Sdr	sdr = getIonsdr();
-		OBJ_POINTER(ImportSession, session);
-		OBJ_POINTER(LtpSpan, span);
-	Object	elt;
+	Sdr		sdr = getIonsdr();
+			OBJ_POINTER(ImportSession, session);
+			OBJ_POINTER(LtpSpan, span);
+	LtpVspan	*vspan;
+	PsmAddress	vspanElt;
+	Object		elt;
 
 	CHKVOID(ionLocked());
 	GET_OBJ_POINTER(sdr, ImportSession, session, sessionObj);
 	GET_OBJ_POINTER(sdr, LtpSpan, span, session->span);
 	noteClosedImport(sdr, span, session);
+	findSpan(span->engineId, &vspan, &vspanElt);
+	if (vspanElt)
+	{
+		forgetCachedSession(&(vspan->importCache),
+				session->sessionNbr);
+	}
+
 	sdr_hash_remove(sdr, span->importSessionsHash,
 			(char *) &(session->sessionNbr), (Address *) &elt);
 	sdr_list_delete(sdr, elt, NULL, NULL);
@@ -2670,7 +3799,7 @@ static void	serializeReportSegment(LtpXmitSeg *segment, char *buf)
 	int		count;
 	Object		elt;
 			OBJ_POINTER(LtpReceptionClaim, claim);
-	unsigned int	offset;
+	uvast		offset;
 
 	/*	Report is from local engine, so origin is the remote
 	 *	engine.							*/
@@ -2807,7 +3936,6 @@ static int	setTimer(LtpTimer *timer, Address timerAddr, time_t currentSec,
 	time_t	segArrivalTimeOffset = 0;
 	time_t	ackDeadlineOffset = 0;
 	int	radTime;
-		OBJ_POINTER(LtpSpan, span);
 
 	if (timer->expirationCount == -1)	/*	(burst)		*/
 	{
@@ -2835,7 +3963,6 @@ static int	setTimer(LtpTimer *timer, Address timerAddr, time_t currentSec,
 
 	segArrivalTimeOffset = radTime + vspan->owltOutbound
 			+ ((ltpdb.ownQtime >> 1) & 0x7fffffff);
-	GET_OBJ_POINTER(sdr, LtpSpan, span, sdr_list_data(sdr, vspan->spanElt));
 
 	/*	Following arrival of the segment, the response from
 	 *	the remote node should arrive here following the
@@ -2855,7 +3982,7 @@ static int	setTimer(LtpTimer *timer, Address timerAddr, time_t currentSec,
 	 *	the remote fire rate might change, etc.).		*/
 
 	ackDeadlineOffset = segArrivalTimeOffset
-			+ span->remoteQtime + vspan->owltInbound
+			+ vspan->remoteQtime + vspan->owltInbound
 			+ ((ltpdb.ownQtime >> 1) & 0x7fffffff);
 	timer->segArrivalTime = currentSec
 			+ CEIL(segArrivalTimeOffset / SIGNAL_REDUNDANCY);
@@ -2889,12 +4016,12 @@ static int	setTimer(LtpTimer *timer, Address timerAddr, time_t currentSec,
 }
 
 static int	readFromExportBlock(char *buffer, Object svcDataObjects,
-			unsigned int offset, unsigned int length)
+			uvast offset, unsigned int length)
 {
 	Sdr		sdr = getIonsdr();
 	Object		elt;
 	Object		sdu;	/*	Each member of list is a ZCO.	*/
-	unsigned int	sduLength;
+	uvast		sduLength;
 	int		totalBytesRead = 0;
 	ZcoReader	reader;
 	unsigned int	bytesToRead;
@@ -2928,7 +4055,7 @@ static int	readFromExportBlock(char *buffer, Object svcDataObjects,
 		bytesToRead = length;
 		if (bytesToRead > sduLength)
 		{
-			bytesToRead = sduLength;
+			bytesToRead = (unsigned int) sduLength;
 		}
 
 		bytesRead = zco_transmit(sdr, &reader, bytesToRead,
@@ -2997,8 +4124,6 @@ int	ltpDequeueOutboundSegment(LtpVspan *vspan, char **buf)
 	Sdr		sdr = getIonsdr();
 	LtpVdb		*ltpvdb = _ltpvdb(NULL);
 	LtpDB		*ltpConstants = _ltpConstants();
-	Object		spanObj;
-	LtpSpan		spanBuf;
 	Object		elt;
 	char		memo[64];
 	Object		segAddr;
@@ -3017,9 +4142,7 @@ int	ltpDequeueOutboundSegment(LtpVspan *vspan, char **buf)
 	CHKERR(buf);
 	*buf = (char *) psp(getIonwm(), vspan->segmentBuffer);
 	CHKERR(sdr_begin_xn(sdr));
-	spanObj = sdr_list_data(sdr, vspan->spanElt);
-	sdr_stage(sdr, (char *) &spanBuf, spanObj, sizeof(LtpSpan));
-	elt = sdr_list_first(sdr, spanBuf.segments);
+	elt = sdr_list_first(sdr, vspan->segments);
 	while (elt == 0 || vspan->localXmitRate == 0)
 	{
 		sdr_exit_xn(sdr);
@@ -3044,8 +4167,7 @@ int	ltpDequeueOutboundSegment(LtpVspan *vspan, char **buf)
 		}
 
 		CHKERR(sdr_begin_xn(sdr));
-		sdr_stage(sdr, (char *) &spanBuf, spanObj, sizeof(LtpSpan));
-		elt = sdr_list_first(sdr, spanBuf.segments);
+		elt = sdr_list_first(sdr, vspan->segments);
 	}
 
 	/*	Got next outbound segment.  Remove it from the queue
@@ -3081,7 +4203,8 @@ int	ltpDequeueOutboundSegment(LtpVspan *vspan, char **buf)
 
 		if (readFromExportBlock((*buf) + segment.pdu.headerLength
 				+ segment.pdu.ohdLength, segment.pdu.block,
-				segment.pdu.offset, segment.pdu.length) < 0)
+				segment.pdu.offset,
+				(unsigned int) segment.pdu.length) < 0)
 		{
 			putErrmsg("Can't read data from export block.", NULL);
 			sdr_cancel_xn(sdr);
@@ -3116,7 +4239,7 @@ int	ltpDequeueOutboundSegment(LtpVspan *vspan, char **buf)
 					ltpei_destroy_extension, NULL);
 		}
 
-		sdr_free(sdr, segAddr);
+		sdr_slab_free(sdr, (_ltpConstants())->xmitSegSlab, segAddr);
 	}
 
 	/*	Post timeout event as necessary.			*/
@@ -3278,9 +4401,6 @@ int	ltpDequeueOutboundSegment(LtpVspan *vspan, char **buf)
 				sdr_cancel_xn(sdr);
 				return -1;
 			}
-
-			sdr_write(sdr, spanObj, (char *) &spanBuf,
-					sizeof(LtpSpan));
 		}
 
 		/*	If entire block is green or all red-part data
@@ -3413,7 +4533,7 @@ static Object	enqueueCancelReqSegment(LtpXmitSeg *segment,
 	segment->sessionListElt = 0;
 	segment->segmentClass = LtpMgtSeg;
 	segment->pdu.reasonCode = reasonCode;
-	segmentObj = sdr_malloc(sdr, sizeof(LtpXmitSeg));
+	segmentObj = sdr_slab_malloc(sdr, (_ltpConstants())->xmitSegSlab);
 	if (segmentObj == 0)
 	{
 		return 0;
@@ -3529,6 +4649,8 @@ static int	cancelSessionBySender(ExportSession *session,
 	/*	Remove session from active sessions pool, so that the
 	 *	cancellation won't affect flow control.			*/
 
+	forgetCachedSession(&((_ltpvdb(NULL))->exportCache),
+			session->sessionNbr);
 	sdr_hash_remove(sdr, db.exportSessionsHash,
 			(char *) &(session->sessionNbr), (Address *) &elt);
 	sdr_list_delete(sdr, elt, NULL, NULL);
@@ -3567,8 +4689,7 @@ static int	cancelSessionBySender(ExportSession *session,
 		 *	enabling a blocked client to append an SDU
 		 *	to the current block.				*/
 
-		sm_SemGive(vspan->bufOpenRedSemaphore);
-		sm_SemGive(vspan->bufOpenGreenSemaphore);
+		openExportBuffer(vspan);
 	}
 
 	/*	Finally, inform receiver of cancellation.		*/
@@ -3704,7 +4825,7 @@ static int	constructCancelAckSegment(LtpXmitSeg *segment, Object spanObj,
 	segment->pdu.trailerLength = 0;
 	segment->sessionListElt = 0;
 	segment->segmentClass = LtpMgtSeg;
-	segmentObj = sdr_malloc(sdr, sizeof(LtpXmitSeg));
+	segmentObj = sdr_slab_malloc(sdr, (_ltpConstants())->xmitSegSlab);
 	if (segmentObj == 0)
 	{
 		return -1;
@@ -3761,7 +4882,7 @@ static int	constructDestCancelAckSegment(Object spanObj,
 
 static int	initializeRs(LtpXmitSeg *rs, unsigned int rptSerialNbr,
 			int checkpointSerialNbrSdnvLength,
-			unsigned int rsLowerBound)
+			uvast rsLowerBound)
 {
 	Sdnv	sdnv;
 
@@ -3783,8 +4904,8 @@ static int	initializeRs(LtpXmitSeg *rs, unsigned int rptSerialNbr,
 	return 0;
 }
 
-static int	constructReceptionClaim(LtpXmitSeg *rs, int lowerBound,
-			int upperBound)
+static int	constructReceptionClaim(LtpXmitSeg *rs, uvast lowerBound,
+			uvast upperBound)
 {
 	Sdr			sdr = getIonsdr();
 	Object			claimObj;
@@ -3793,7 +4914,7 @@ static int	constructReceptionClaim(LtpXmitSeg *rs, int lowerBound,
 
 	CHKERR(ionLocked());
 	CHKERR(upperBound > lowerBound);
-	claimObj = sdr_malloc(sdr, sizeof(LtpReceptionClaim));
+	claimObj = sdr_slab_malloc(sdr, (_ltpConstants())->claimSlab);
 	if (claimObj == 0)
 	{
 		return -1;
@@ -3829,7 +4950,7 @@ static int	constructRs(LtpXmitSeg *rs, int claimCount,
 	encodeSdnv(&sdnv, claimCount);
 	rs->pdu.contentLength += sdnv.length;
 	GET_OBJ_POINTER(sdr, LtpSpan, span, session->span);
-	rsObj = sdr_malloc(sdr, sizeof(LtpXmitSeg));
+	rsObj = sdr_slab_malloc(sdr, (_ltpConstants())->xmitSegSlab);
 	if (rsObj == 0)
 	{
 		return -1;
@@ -3860,7 +4981,8 @@ static int	constructRs(LtpXmitSeg *rs, int claimCount,
 	signalLso(span->engineId);
 #if LTPDEBUG
 char	buf[256];
-sprintf(buf, "Sending RS: %u to %u, ckpt %u, rpt %u.", rs->pdu.lowerBound,
+sprintf(buf, "Sending RS: " UVAST_FIELDSPEC " to " UVAST_FIELDSPEC ", \
+ckpt %u, rpt %u.", rs->pdu.lowerBound,
 rs->pdu.upperBound, rs->pdu.ckptSerialNbr, rs->pdu.rptSerialNbr);
 putErrmsg(buf, itoa(session->sessionNbr));
 #endif
@@ -3871,8 +4993,8 @@ static int	sendLastReport(ImportSession *session, Object sessionObj,
 			unsigned int checkpointSerialNbr)
 {
 	Sdr		sdr = getIonsdr();
-	unsigned int	reportLowerBound = 0;
-	unsigned int	reportUpperBound = session->redPartLength;
+	uvast		reportLowerBound = 0;
+	uvast		reportUpperBound = session->redPartLength;
 			OBJ_POINTER(LtpSpan, span);
 	LtpXmitSeg	rsBuf;
 	Sdnv		checkpointSerialNbrSdnv;
@@ -3920,21 +5042,21 @@ putErrmsg("Reporting all data received.", itoa(session->sessionNbr));
 static int	sendReport(ImportSession *session, Object sessionObj,
 			unsigned int checkpointSerialNbr,
 			unsigned int reportSerialNbr,
-			unsigned int reportUpperBound)
+			uvast reportUpperBound)
 {
 	Sdr		sdr = getIonsdr();
-	unsigned int	reportLowerBound = 0;
+	uvast		reportLowerBound = 0;
 	Object		elt;
 	Object		obj;
 			OBJ_POINTER(LtpXmitSeg, oldRpt);
 			OBJ_POINTER(LtpSpan, span);
 	LtpXmitSeg	rsBuf;
 	Sdnv		checkpointSerialNbrSdnv;
-	unsigned int	lowerBound;
-	unsigned int	upperBound;
+	uvast		lowerBound;
+	uvast		upperBound;
 	int		claimCount;
-			OBJ_POINTER(LtpRecvSeg, ds);
-	unsigned int	segmentEnd;
+			OBJ_POINTER(LtpRecvExtent, extent);
+	uvast		extentEnd;
 
 	CHKERR(ionLocked());
 	if (session->lastRptSerialNbr != 0)
@@ -4023,7 +5145,9 @@ putErrmsg("Too many reports, canceling session.", itoa(session->sessionNbr));
 	encodeSdnv(&checkpointSerialNbrSdnv, checkpointSerialNbr);
 
 	/*	Initialize the first report segment and start adding
-	 *	reception claims.					*/
+	 *	reception claims.  Received extents are already
+	 *	coalesced, so each extent within the scope of the
+	 *	report is a single reception claim.			*/
 
 	if (initializeRs(&rsBuf, session->nextRptSerialNbr,
 			checkpointSerialNbrSdnv.length, lowerBound) < 0)
@@ -4032,23 +5156,24 @@ putErrmsg("Too many reports, canceling session.", itoa(session->sessionNbr));
 	}
 
 	claimCount = 0;
-	for (elt = sdr_list_first(sdr, session->redSegments); elt;
+	for (elt = sdr_list_first(sdr, session->redExtents); elt;
 			elt = sdr_list_next(sdr, elt))
 	{
-		GET_OBJ_POINTER(sdr, LtpRecvSeg, ds, sdr_list_data(sdr, elt));
-		segmentEnd = ds->pdu.offset + ds->pdu.length;
-		if (segmentEnd <= lowerBound)
+		GET_OBJ_POINTER(sdr, LtpRecvExtent, extent,
+				sdr_list_data(sdr, elt));
+		extentEnd = extent->offset + extent->length;
+		if (extentEnd <= lowerBound)
 		{
 			continue;	/*	Not in bounds.		*/
 		}
 
-		if (ds->pdu.offset <= upperBound)
+		if (extent->offset <= upperBound)
 		{
-			upperBound = MIN(segmentEnd, reportUpperBound);
+			upperBound = MIN(extentEnd, reportUpperBound);
 			continue;	/*	Contiguous.		*/
 		}
 
-		if (ds->pdu.offset >= reportUpperBound)
+		if (extent->offset >= reportUpperBound)
 		{
 			break;		/*	No more to include.	*/
 		}
@@ -4068,8 +5193,8 @@ putErrmsg("Too many reports, canceling session.", itoa(session->sessionNbr));
 			claimCount++;
 		}
 
-		lowerBound = ds->pdu.offset;
-		upperBound = MIN(segmentEnd, reportUpperBound);
+		lowerBound = extent->offset;
+		upperBound = MIN(extentEnd, reportUpperBound);
 		if (claimCount < MAX_CLAIMS_PER_RS)
 		{
 			continue;
@@ -4128,10 +5253,10 @@ putErrmsg("No report, upper bound == lower bound.", itoa(upperBound));
 	}
 
 #if LTPDEBUG
-int	shortfall;
+uvast	shortfall;
 char	buf[256];
 shortfall = session->redPartLength - session->redPartReceived;
-sprintf(buf, "Total of %d bytes missing.", shortfall);
+sprintf(buf, "Total of " UVAST_FIELDSPEC " bytes missing.", shortfall);
 putErrmsg(buf, itoa(session->sessionNbr));
 #endif
 	sdr_write(sdr, sessionObj, (char *) session, sizeof(ImportSession));
@@ -4166,7 +5291,7 @@ static int	constructReportAckSegment(LtpSpan *span, Object spanObj,
 	segment.segmentClass = LtpMgtSeg;
 	segment.pdu.segTypeCode = LtpRAS;
 	segment.pdu.rptSerialNbr = reportSerialNbr;
-	segmentObj = sdr_malloc(sdr, sizeof(LtpXmitSeg));
+	segmentObj = sdr_slab_malloc(sdr, (_ltpConstants())->xmitSegSlab);
 	if (segmentObj == 0)
 	{
 		return -1;
@@ -4236,7 +5361,7 @@ static int	startImportSession(Object spanObj, unsigned int sessionNbr,
 	CHKERR(ionLocked());
 	GET_OBJ_POINTER(sdr, LtpSpan, span, spanObj);
 	if (!(sdr_list_length(sdr, span->importSessions)
-			< span->maxImportSessions))
+			< vspan->maxImportSessions))
 	{
 		/*	Limit reached.  Can't start any more sessions.	*/
 #if LTPDEBUG
@@ -4266,8 +5391,17 @@ putErrmsg("Opened import session.", utoa(sessionNbr));
 	sessionBuf->sessionNbr = sessionNbr;
 	encodeSdnv(&(sessionBuf->sessionNbrSdnv), sessionNbr);
 	sessionBuf->clientSvcId = clientSvcId;
-	sessionBuf->redSegments = sdr_list_create(sdr);
-	sessionBuf->rsSegments = sdr_list_create(sdr);
+	sessionBuf->arena = sdr_arena_create(sdr, LTP_SESSION_ARENA_CHUNK);
+	if (sessionBuf->arena == 0)
+	{
+		putErrmsg("Can't create import session arena.", NULL);
+		return -1;
+	}
+
+	sessionBuf->redExtents = sdr_list_create_in_arena(sdr,
+			sessionBuf->arena);
+	sessionBuf->rsSegments = sdr_list_create_in_arena(sdr,
+			sessionBuf->arena);
 	sessionBuf->span = spanObj;
 	if (db->maxAcqInHeap == 0)
 	{
@@ -4305,7 +5439,7 @@ putErrmsg("Opened import session.", utoa(sessionNbr));
 				sessionBuf->heapBufferSize, ZcoInbound);
 	}
 
-	if (sessionBuf->redSegments == 0
+	if (sessionBuf->redExtents == 0
 	|| sessionBuf->rsSegments == 0
 	|| (sessionBuf->heapBufferSize > 0 &&
 		(sessionBuf->heapBufferObj == 0
@@ -4337,9 +5471,9 @@ static int	createBlockFile(LtpSpan *span, Object sessionObj,
 			ImportSession *session)
 {
 	Sdr	sdr = getIonsdr();
-	char	cwd[200];
-	char	name[256];
-	int	fd;
+	char			cwd[200];
+	char			name[256];
+	ImportSessionCold	cold;
 
 	if (igetcwd(cwd, sizeof cwd) == NULL)
 	{
@@ -4350,14 +5484,12 @@ static int	createBlockFile(LtpSpan *span, Object sessionObj,
 	isprintf(name, sizeof name, "%s%cltpblock." UVAST_FIELDSPEC ".%u",
 			cwd, ION_PATH_DELIMITER, span->engineId,
 			session->sessionNbr);
-	fd = open(name, O_WRONLY | O_CREAT, 0666);
-	if (fd < 0)
+	if (openBlockFile(name, 1) == NULL)
 	{
-		putSysErrmsg("Can't create block file", name);
+		putErrmsg("Can't create block file.", name);
 		return -1;
 	}
 
-	close(fd);
 	session->blockFileRef = zco_create_file_ref(sdr, name, "",
 			ZcoInbound);
 	if (session->blockFileRef == 0)
@@ -4366,69 +5498,103 @@ static int	createBlockFile(LtpSpan *span, Object sessionObj,
 		return -1;
 	}
 
-	istrcpy(session->fileBufferPath, name, sizeof session->fileBufferPath);
+	session->cold = sdr_arena_malloc(sdr, session->arena,
+			sizeof(ImportSessionCold));
+	if (session->cold == 0)
+	{
+		putErrmsg("Can't create import session cold record.", NULL);
+		return -1;
+	}
+
+	memset((char *) &cold, 0, sizeof(ImportSessionCold));
+	istrcpy(cold.fileBufferPath, name, sizeof cold.fileBufferPath);
+	sdr_write(sdr, session->cold, (char *) &cold,
+			sizeof(ImportSessionCold));
 	sdr_write(sdr, sessionObj, (char *) session, sizeof(ImportSession));
 	return 0;
 }
 
+static void	writeExtent(LtpExtentRef *ref)
+{
+	Sdr		sdr = getIonsdr();
+	LtpRecvExtent	extent;
+
+	extent.offset = ref->offset;
+	extent.length = ref->length;
+	sdr_write(sdr, sdr_list_data(sdr, ref->sessionListElt),
+			(char *) &extent, sizeof(LtpRecvExtent));
+}
+
 static int	insertDataSegment(ImportSession *session,
 			VImportSession *vsession, LtpRecvSeg *segment,
-			LtpPdu *pdu, Object *segmentObj)
+			LtpPdu *pdu, uvast *segUpperBound)
 {
 	Sdr		sdr = getIonsdr();
 	PsmPartition	wm = getIonwm();
-	int		segUpperBound;
-	LtpSegmentRef	arg;
+	LtpExtentRef	arg;
 	PsmAddress	rbtNode;
 	PsmAddress	nextRbtNode;
-	LtpSegmentRef	*nextRef = NULL;
+	LtpExtentRef	*nextRef = NULL;
 	PsmAddress	prevRbtNode;
-	LtpSegmentRef	*prevRef = NULL;
-	LtpSegmentRef	refbuf;
+	LtpExtentRef	*prevRef = NULL;
+	int		adjoinsPrev;
+	int		adjoinsNext;
+	Object		nextElt;
+	LtpRecvExtent	extent;
+	Object		extentObj;
+	LtpExtentRef	refbuf;
 	PsmAddress	addr;
 
 	CHKERR(ionLocked());
-	segUpperBound = segment->pdu.offset + segment->pdu.length;
+	*segUpperBound = segment->pdu.offset + segment->pdu.length;
+	if (*segUpperBound < segment->pdu.offset)
+	{
+#if LTPDEBUG
+putErrmsg("discarded segment", utoa(segment->pdu.offset));
+#endif
+		return 0;	/*	Length wraps around.	*/
+	}
+
 	if (session->redPartLength > 0)	/*	EORP received.		*/
 	{
-		if (segUpperBound > session->redPartLength)
+		if (*segUpperBound > session->redPartLength)
 		{
 #if LTPDEBUG
-putErrmsg("discarded segment", itoa(segment->pdu.offset));
+putErrmsg("discarded segment", utoa(segment->pdu.offset));
 #endif
 			return 0;	/*	Beyond end of red part.	*/
 		}
 	}
 
 	arg.offset = segment->pdu.offset;
-	rbtNode = sm_rbt_search(wm, vsession->redSegmentsIdx,
-			orderRedSegments, &arg, &nextRbtNode);
-	if (rbtNode)	/*	Segment has already been received.	*/
+	rbtNode = ltp_idx_search(wm, vsession->redExtentsIdx,
+			orderRedExtents, &arg, &nextRbtNode);
+	if (rbtNode)	/*	Data at this offset already received.	*/
 	{
 #if LTPDEBUG
-putErrmsg("discarded segment", itoa(segment->pdu.offset));
+putErrmsg("discarded segment", utoa(segment->pdu.offset));
 #endif
 		return 0;			/*	Overlap.	*/
 	}
 
 	if (nextRbtNode)
 	{
-		nextRef = (LtpSegmentRef *)
-				psp(wm, sm_rbt_data(wm, nextRbtNode));
-		prevRbtNode = sm_rbt_prev(wm, nextRbtNode);
+		nextRef = (LtpExtentRef *)
+				psp(wm, ltp_idx_data(wm, nextRbtNode));
+		prevRbtNode = ltp_idx_prev(wm, nextRbtNode);
 		if (prevRbtNode)
 		{
-			prevRef = (LtpSegmentRef *)
-					psp(wm, sm_rbt_data(wm, prevRbtNode));
+			prevRef = (LtpExtentRef *)
+					psp(wm, ltp_idx_data(wm, prevRbtNode));
 		}
 	}
-	else	/*	No segment with greater offset received so far.	*/
+	else	/*	No extent with greater offset received so far.	*/
 	{
-		prevRbtNode = sm_rbt_last(wm, vsession->redSegmentsIdx);
+		prevRbtNode = ltp_idx_last(wm, vsession->redExtentsIdx);
 		if (prevRbtNode)
 		{
-			prevRef = (LtpSegmentRef *)
-					psp(wm, sm_rbt_data(wm, prevRbtNode));
+			prevRef = (LtpExtentRef *)
+					psp(wm, ltp_idx_data(wm, prevRbtNode));
 		}
 	}
 
@@ -4436,74 +5602,129 @@ putErrmsg("discarded segment", itoa(segment->pdu.offset));
 	&& (prevRef->offset + prevRef->length) > segment->pdu.offset)
 	{
 #if LTPDEBUG
-putErrmsg("discarded segment", itoa(segment->pdu.offset));
+putErrmsg("discarded segment", utoa(segment->pdu.offset));
 #endif
 		return 0;			/*	Overlap.	*/
 	}
 
-	if (nextRbtNode && nextRef->offset < segUpperBound)
+	if (nextRbtNode && nextRef->offset < *segUpperBound)
 	{
 #if LTPDEBUG
-putErrmsg("discarded segment", itoa(segment->pdu.offset));
+putErrmsg("discarded segment", utoa(segment->pdu.offset));
 #endif
 		return 0;			/*	Overlap.	*/
 	}
 
-	/*	If we're low on heap space we can't accept the segment,
-	 *	because we don't have enough space for the necessary
-	 *	accounting objects.					*/
+	adjoinsPrev = (prevRbtNode
+		&& (prevRef->offset + prevRef->length) == segment->pdu.offset);
+	adjoinsNext = (nextRbtNode && nextRef->offset == *segUpperBound);
+
+	/*	If we're low on heap space we can't accept a segment
+	 *	that opens a new extent, because we don't have enough
+	 *	space for the necessary accounting objects.		*/
 
-	if (sdr_heap_depleted(sdr))
+	if (!adjoinsPrev && !adjoinsNext && sdr_heap_depleted(sdr))
 	{
 		return 0;
 	}
 
-	/*	Okay to insert this segment into the list.		*/
+	/*	Okay to add this segment's data to the session.		*/
 
 	session->redPartReceived += segment->pdu.length;
-	*segmentObj = sdr_malloc(sdr, sizeof(LtpRecvSeg));
-	if (*segmentObj == 0)
+	session->redSegmentsCount++;
+	if (segment->pdu.length > session->maxRedSegLength)
+	{
+		session->maxRedSegLength = segment->pdu.length;
+	}
+
+	if (adjoinsPrev)
+	{
+		prevRef->length += segment->pdu.length;
+		if (adjoinsNext)
+		{
+			/*	Segment fills the gap between two
+			 *	extents, so the following extent is
+			 *	absorbed into the preceding one and
+			 *	its space in the session arena is
+			 *	released for reuse.			*/
+
+			prevRef->length += nextRef->length;
+			nextElt = nextRef->sessionListElt;
+			sdr_arena_free(sdr, session->arena,
+					sdr_list_data(sdr, nextElt),
+					sizeof(LtpRecvExtent));
+			sdr_list_delete(sdr, nextElt, NULL, NULL);
+			arg.offset = nextRef->offset;
+			ltp_idx_delete(wm, vsession->redExtentsIdx,
+					orderRedExtents, &arg, deleteExtentRef,
+					NULL);
+		}
+
+		writeExtent(prevRef);
+		return 1;
+	}
+
+	if (adjoinsNext)
+	{
+		/*	Extending the following extent downward
+		 *	leaves its position in the index unchanged,
+		 *	as the segment doesn't overlap any extent
+		 *	that precedes it.				*/
+
+		nextRef->offset = segment->pdu.offset;
+		nextRef->length += segment->pdu.length;
+		writeExtent(nextRef);
+		return 1;
+	}
+
+	/*	Segment is isolated, so it starts a new extent.		*/
+
+	extent.offset = segment->pdu.offset;
+	extent.length = segment->pdu.length;
+	extentObj = sdr_arena_malloc(sdr, session->arena,
+			sizeof(LtpRecvExtent));
+	if (extentObj == 0)
 	{
 		return -1;
 	}
 
+	sdr_write(sdr, extentObj, (char *) &extent, sizeof(LtpRecvExtent));
 	if (nextRef)
 	{
-		segment->sessionListElt = sdr_list_insert_before(sdr,
-				nextRef->sessionListElt, *segmentObj);
+		refbuf.sessionListElt = sdr_list_insert_before(sdr,
+				nextRef->sessionListElt, extentObj);
 	}
 	else
 	{
-		segment->sessionListElt = sdr_list_insert_last(sdr,
-				session->redSegments, *segmentObj);
+		refbuf.sessionListElt = sdr_list_insert_last(sdr,
+				session->redExtents, extentObj);
 	}
 
-	if (segment->sessionListElt == 0)
+	if (refbuf.sessionListElt == 0)
 	{
 		return -1;
 	}
 
-	refbuf.offset = segment->pdu.offset;
-	refbuf.length = segment->pdu.length;
-	refbuf.sessionListElt = segment->sessionListElt;
-	addr = psm_zalloc(wm, sizeof(LtpSegmentRef));
+	refbuf.offset = extent.offset;
+	refbuf.length = extent.length;
+	addr = psm_zalloc(wm, sizeof(LtpExtentRef));
 	if (addr == 0)
 	{
 		return -1;
 	}
 
-	memcpy((char *) psp(wm, addr), (char *) &refbuf, sizeof(LtpSegmentRef));
-	rbtNode = sm_rbt_insert(wm, vsession->redSegmentsIdx, addr,
-			orderRedSegments, &refbuf);
+	memcpy((char *) psp(wm, addr), (char *) &refbuf, sizeof(LtpExtentRef));
+	rbtNode = ltp_idx_insert(wm, vsession->redExtentsIdx, addr,
+			orderRedExtents, &refbuf);
 	if (rbtNode == 0)
 	{
 		return -1;
 	}
 
-	return segUpperBound;
+	return 1;
 }
 
-int	getMaxReports(int redPartLength, LtpVspan *vspan, int asReceiver)
+int	getMaxReports(uvast redPartLength, LtpVspan *vspan, int asReceiver)
 {
 	/*	The limit on reports is never less than 2: at least
 	 *	one negative report, plus the final positive report.
@@ -4515,8 +5736,8 @@ int	getMaxReports(int redPartLength, LtpVspan *vspan, int asReceiver)
 	float		segmentLossRate;
 	unsigned int	maxSegmentSize;
 	int		maxReportSegments;
-	int		xmitBytes;
-	int		xmitSegments;
+	uvast		xmitBytes;
+	uvast		xmitSegments;
 	float		lostSegments;
 	int		dataGaps;
 	int		reportsIssued;
@@ -4561,13 +5782,13 @@ int	getMaxReports(int redPartLength, LtpVspan *vspan, int asReceiver)
 
 		/*	Compute next xmit: retransmission data volume.	*/
 
-		xmitBytes = (int) (lostSegments * maxSegmentSize);
+		xmitBytes = (uvast) (lostSegments * maxSegmentSize);
 	}
 
 #if LTPDEBUG
 char	buf[256];
-sprintf(buf, "[i] Max report segments = %d for red part length %d, max segment \
-size %d, segment loss rate %f.", maxReportSegments, redPartLength,
+sprintf(buf, "[i] Max report segments = %d for red part length " UVAST_FIELDSPEC
+", max segment size %d, segment loss rate %f.", maxReportSegments, redPartLength,
 maxSegmentSize, segmentLossRate);
 writeMemo(buf);
 #endif
@@ -4581,9 +5802,7 @@ static int	deliverSvcData(LtpVclient *client, uvast sourceEngineId,
 	Sdr	sdr = getIonsdr();
 	LtpVdb	*ltpvdb = _ltpvdb(NULL);
 	Object	svcDataObject;
-	Object	elt;
-	Object	segObj;
-		OBJ_POINTER(LtpRecvSeg, segment);
+	char	path[256];
 
 	/*	Construct a ZCO with up to two extents, one for
 	 *	each of the session's two possible data reception
@@ -4638,6 +5857,8 @@ putErrmsg("Canceled session: insufficient ZCO space.", NULL);
 
 	if (session->blockFileRef)
 	{
+		closeBlockFile(getBlockFilePath(session, path),
+				session->blockFileSize);
 		switch (zco_append_extent(sdr, svcDataObject, ZcoFileSource,
 			session->blockFileRef, 0, session->blockFileSize))
 		{
@@ -4658,30 +5879,11 @@ putErrmsg("Canceled session: insufficient ZCO space.", NULL);
 		session->blockFileRef = 0;
 	}
 
-	/*	Can now discard all red segments.			*/
-
-	while ((elt = sdr_list_first(sdr, session->redSegments)))
-	{
-		segObj = sdr_list_data(sdr, elt);
-		GET_OBJ_POINTER(sdr, LtpRecvSeg, segment, segObj);
-		sdr_list_delete(sdr, elt, NULL, NULL);
-		if (segment->pdu.headerExtensions)
-		{
-			sdr_list_destroy(sdr, segment->pdu.headerExtensions,
-					ltpei_destroy_extension, NULL);
-		}
-
-		if (segment->pdu.trailerExtensions)
-		{
-			sdr_list_destroy(sdr, segment->pdu.trailerExtensions,
-					ltpei_destroy_extension, NULL);
-		}
-
-		sdr_free(sdr, segObj);
-	}
+	/*	Can now discard all red extents.			*/
 
-	sdr_list_destroy(sdr, session->redSegments, NULL, NULL);
-	session->redSegments = 0;
+	sdr_list_destroy(sdr, session->redExtents, NULL, NULL);
+	session->redExtents = 0;
+	session->redSegmentsCount = 0;
 
 	/*	Pass the new service data ZCO to the client service.	*/
 
@@ -4821,17 +6023,18 @@ static int	acceptRedContent(LtpDB *ltpdb, Object *sessionObj,
 			ImportSession *sessionBuf, unsigned int sessionNbr,
 			VImportSession *vsession, Object spanObj, LtpSpan *span,
 			LtpVspan *vspan, LtpRecvSeg *segment,
-			unsigned int *segUpperBound, LtpPdu *pdu, char **cursor)
+			uvast *segUpperBound, LtpPdu *pdu, char **cursor)
 {
 	Sdr		sdr = getIonsdr();
 	uvast		endOfSegment;
 	uvast		bytesForHeap;
 	uvast		bytesForFile;
 	Object		sessionElt;
-	Object		segmentObj = 0;
 	uvast		offsetInFile;
 	uvast		endOfIncrement;
-	int		fd;
+	uvast		endOfRedPart;
+	LtpBlockFile	*blockFile;
+	char		path[256];
 
 	*segUpperBound = 0;	/*	Default: discard segment.	*/
 	bytesForHeap = pdu->offset < ltpdb->maxAcqInHeap ?
@@ -4856,7 +6059,7 @@ static int	acceptRedContent(LtpDB *ltpdb, Object *sessionObj,
 	{
 		sdr_stage(sdr, (char *) sessionBuf, *sessionObj,
 				sizeof(ImportSession));
-		if (sessionBuf->redSegments == 0)
+		if (sessionBuf->redExtents == 0)
 		{
 			/*	Reception already completed, just
 			 *	waiting for report acknowledgment.
@@ -4904,13 +6107,13 @@ putErrmsg("Discarded data segment: can't start new session.", itoa(sessionNbr));
 	}
 
 	segment->sessionObj = *sessionObj;
-	*segUpperBound = insertDataSegment(sessionBuf, vsession, segment, pdu,
-			&segmentObj);
-	switch (*segUpperBound)
+	switch (insertDataSegment(sessionBuf, vsession, segment, pdu,
+			segUpperBound))
 	{
 	case 0:
 		/*	Segment was found to be useless.  Discard it.	*/
 
+		*segUpperBound = 0;
 		ltpSpanTally(vspan, IN_SEG_REDUNDANT, pdu->length);
 		return 0;
 
@@ -4925,7 +6128,13 @@ putErrmsg("Discarded data segment: can't start new session.", itoa(sessionNbr));
 	ltpSpanTally(vspan, IN_SEG_RECV_RED, pdu->length);
 	if (bytesForHeap > 0)
 	{
-		sdr_write(sdr, sessionBuf->heapBufferObj + pdu->offset,
+		/*	The heap buffer content need not be logged for
+		 *	reversal: if this transaction is canceled, the
+		 *	session's red extents no longer cover these
+		 *	bytes, so they are simply rewritten whenever
+		 *	the segment is retransmitted.			*/
+
+		sdr_write_scratch(sdr, sessionBuf->heapBufferObj + pdu->offset,
 				*cursor, bytesForHeap);
 		*cursor += bytesForHeap;
 		endOfIncrement = pdu->offset + bytesForHeap;
@@ -4949,7 +6158,7 @@ putErrmsg("Discarded data segment: can't start new session.", itoa(sessionNbr));
 		/*	Create overflow reception buffer file if
 		 *	necessary.					*/
 
-		if (sessionBuf->fileBufferPath[0] == '\0')
+		if (sessionBuf->cold == 0)
 		{
 			if (createBlockFile(span, *sessionObj, sessionBuf) < 0)
 			{
@@ -4958,39 +6167,42 @@ putErrmsg("Discarded data segment: can't start new session.", itoa(sessionNbr));
 			}
 		}
 
-		/*	Now write to the reception buffer file.		*/
+		/*	Now write to the reception buffer file.  Once
+		 *	the end of the red part is known, the file's
+		 *	full length is preallocated.			*/
 
-		fd = open(sessionBuf->fileBufferPath, O_WRONLY, 0666);
-		if (fd < 0)
+		getBlockFilePath(sessionBuf, path);
+		blockFile = openBlockFile(path, 0);
+		if (blockFile == NULL)
 		{
-			putSysErrmsg("Can't open block file",
-					sessionBuf->fileBufferPath);
+			putErrmsg("Can't open block file.", path);
 			return -1;
 		}
 
-		/*	(If offsetInFile is after end of file, lseek()
-		 *	will succeed and write() will cause the file
-		 *	to be lengthened as necessary, with zeroes
-		 *	written between the old EOF and the offset
-		 *	at which we are writing.)			*/
+		if (pdu->segTypeCode == LtpDsRedEORP
+		|| pdu->segTypeCode == LtpDsRedEOB)
+		{
+			endOfRedPart = endOfSegment;
+		}
+		else
+		{
+			endOfRedPart = sessionBuf->redPartLength;
+		}
 
-		if (lseek(fd, offsetInFile, SEEK_SET) < 0)
+		if (!blockFile->preallocated
+		&& endOfRedPart > sessionBuf->heapBufferSize)
 		{
-			putSysErrmsg("Can't seek to offset within block file",
-					sessionBuf->fileBufferPath);
-			close(fd);
-			return -1;
+			preallocateBlockFile(blockFile,
+				endOfRedPart - sessionBuf->heapBufferSize);
 		}
 
-		if (write(fd, *cursor, bytesForFile) < bytesForFile)
+		if (writeBlockFile(blockFile, *cursor, offsetInFile,
+				bytesForFile) < 0)
 		{
-			putSysErrmsg("Can't write to block file",
-					sessionBuf->fileBufferPath);
-			close(fd);
+			putErrmsg("Can't write to block file.", path);
 			return -1;
 		}
 
-		close(fd);
 		endOfIncrement = offsetInFile + bytesForFile;
 		if (endOfIncrement > sessionBuf->blockFileSize)
 		{
@@ -4998,7 +6210,6 @@ putErrmsg("Discarded data segment: can't start new session.", itoa(sessionNbr));
 		}
 	}
 
-	sdr_write(sdr, segmentObj, (char *) segment, sizeof(LtpRecvSeg));
 	return 0;
 }
 
@@ -5022,17 +6233,16 @@ static int	handleDataSegment(uvast sourceEngineId, LtpDB *ltpdb,
 			OBJ_POINTER(LtpSpan, span);
 	LtpVclient	*client;
 	int		result;
-	unsigned int	endOfRed;
+	uvast		endOfRed;
 	Object		clientSvcData = 0;
-	unsigned int	segUpperBound;
-			OBJ_POINTER(LtpRecvSeg, firstSegment);
+	uvast		segUpperBound;
 
 	/*	First finish parsing the segment.			*/
 
 	endOfHeader = *cursor;
 	extractSmallSdnv(&(pdu->clientSvcId), cursor, bytesRemaining);
-	extractSmallSdnv(&(pdu->offset), cursor, bytesRemaining);
-	extractSmallSdnv(&(pdu->length), cursor, bytesRemaining);
+	extractSdnv(&(pdu->offset), cursor, bytesRemaining);
+	extractSdnv(&(pdu->length), cursor, bytesRemaining);
 	if (pdu->segTypeCode > 0 && !(pdu->segTypeCode & LTP_EXC_FLAG))
 	{
 		/*	This segment is an LTP checkpoint.		*/
@@ -5086,8 +6296,9 @@ putErrmsg("Discarded malformed data segment.", itoa(sessionNbr));
 	 *	client service data and trailer extensions.  So
 	 *	next we parse the trailer extensions.			*/
 
-	pdu->contentLength = (*cursor - endOfHeader) + pdu->length;
-	pdu->trailerLength = *bytesRemaining - pdu->length;
+	pdu->contentLength = (*cursor - endOfHeader)
+			+ (unsigned int) pdu->length;
+	pdu->trailerLength = *bytesRemaining - (unsigned int) pdu->length;
 	switch (parseTrailerExtensions(endOfHeader, pdu, trailerExtensions))
 	{
 	case -1:	/*	No available memory.			*/
@@ -5294,12 +6505,23 @@ putErrmsg("Discarded data segment.", itoa(sessionNbr));
 		 *	of the red part.				*/
 
 		sessionBuf.redPartLength = segUpperBound;
-		GET_OBJ_POINTER(sdr, LtpRecvSeg, firstSegment,
-				sdr_list_data(sdr, sdr_list_first(sdr,
-				sessionBuf.redSegments)));
-		if (firstSegment->pdu.length > vspan->maxRecvSegSize)
+		if (sessionBuf.maxRedSegLength > vspan->maxRecvSegSize)
 		{
-			vspan->maxRecvSegSize = firstSegment->pdu.length;
+			/*	Segment size is a property of the link
+			 *	service, not of the block, so the span's
+			 *	maximum stays 32 bits wide; clamp it.	*/
+
+			if (sessionBuf.maxRedSegLength
+					> (uvast) ((unsigned int) -1))
+			{
+				vspan->maxRecvSegSize = ((unsigned int) -1);
+			}
+			else
+			{
+				vspan->maxRecvSegSize = (unsigned int)
+						sessionBuf.maxRedSegLength;
+			}
+
 			computeRetransmissionLimits(vspan);
 		}
 
@@ -5334,7 +6556,7 @@ putErrmsg("Discarded data segment.", itoa(sessionNbr));
 		}
 
 		if (sessionBuf.redPartReceived == sessionBuf.redPartLength
-		&& sessionBuf.redSegments != 0)
+		&& sessionBuf.redExtents != 0)
 		{
 			/*	The entire red part of the block has
 			 *	been received, and has not yet been
@@ -5378,12 +6600,12 @@ putErrmsg("Discarded data segment.", itoa(sessionNbr));
 
 static int	loadClaimsArray(char **cursor, int *bytesRemaining,
 			unsigned int claimCount, LtpReceptionClaim *claims,
-			unsigned int lowerBound, unsigned int upperBound)
+			uvast lowerBound, uvast upperBound)
 {
 	int			i;
 	LtpReceptionClaim	*claim;
-	unsigned int		offset;
-	unsigned int		dataEnd;
+	uvast			offset;
+	uvast			dataEnd;
 
 	for (i = 0, claim = claims; i < claimCount; i++, claim++)
 	{
@@ -5392,16 +6614,16 @@ static int	loadClaimsArray(char **cursor, int *bytesRemaining,
 		 *	compressed to offset from report segment's
 		 *	lower bound rather than from start of block.	*/
 
-		extractSmallSdnv(&offset, cursor, bytesRemaining);
+		extractSdnv(&offset, cursor, bytesRemaining);
 		claim->offset = offset + lowerBound;
-		extractSmallSdnv(&(claim->length), cursor, bytesRemaining);
-		if (claim->length == 0)
+		extractSdnv(&(claim->length), cursor, bytesRemaining);
+		if (claim->length == 0 || claim->offset < lowerBound)
 		{
 			return 0;
 		}
 
 		dataEnd = claim->offset + claim->length;
-		if (dataEnd > upperBound)
+		if (dataEnd > upperBound || dataEnd < claim->offset)
 		{
 			return 0;
 		}
@@ -5416,7 +6638,8 @@ static int	insertClaim(ExportSession *session, LtpReceptionClaim *claim)
 	Object	claimObj;
 
 	CHKERR(ionLocked());
-	claimObj = sdr_malloc(sdr, sizeof(LtpReceptionClaim));
+	claimObj = sdr_arena_malloc(sdr, session->arena,
+			sizeof(LtpReceptionClaim));
 	if (claimObj == 0)
 	{
 		return -1;
@@ -5440,7 +6663,7 @@ static Object	insertCheckpoint(ExportSession *session, LtpXmitSeg *segment)
 
 	checkpoint.serialNbr = segment->pdu.ckptSerialNbr;
 	checkpoint.sessionListElt = segment->sessionListElt;
-	obj = sdr_malloc(sdr, sizeof(LtpCkpt));
+	obj = sdr_arena_malloc(sdr, session->arena, sizeof(LtpCkpt));
 	if (obj == 0)
 	{
 		putErrmsg("Can't create checkpoint reference.", NULL);
@@ -5461,12 +6684,12 @@ static int	constructDataSegment(Sdr sdr, ExportSession *session,
 	Object		segmentObj;
 	LtpXmitSeg	segment;
 	Sdnv		offsetSdnv;
-	int		remainingRedBytes;
-	int		redBytesToSegment;
-	int		length;
+	vast		remainingRedBytes;
+	vast		redBytesToSegment;
+	vast		length;
 	int		dataSegmentOverhead;
 	int		checkpointOverhead;
-	int		worstCaseSegmentSize;
+	vast		worstCaseSegmentSize;
 	Sdnv		rsnSdnv;
 	Sdnv		cpsnSdnv;
 	int		isCheckpoint = 0;
@@ -5475,7 +6698,7 @@ static int	constructDataSegment(Sdr sdr, ExportSession *session,
 	Sdnv		lengthSdnv;
 
 	extent = (ExportExtent *) lyst_data(extentElt);
-	segmentObj = sdr_malloc(sdr, sizeof(LtpXmitSeg));
+	segmentObj = sdr_slab_malloc(sdr, (_ltpConstants())->xmitSegSlab);
 	if (segmentObj == 0)
 	{
 		return -1;
@@ -5502,7 +6725,7 @@ static int	constructDataSegment(Sdr sdr, ExportSession *session,
 	 *	green data only, or some red data followed by some
 	 *	green data.						*/
 
-	remainingRedBytes = session->redPartLength - extent->offset;
+	remainingRedBytes = (vast) session->redPartLength - (vast) extent->offset;
 	if (remainingRedBytes > 0)	/*	This is a red segment.	*/
 	{
 		/*	Segment must be all one color, so the maximum
@@ -5551,7 +6774,7 @@ static int	constructDataSegment(Sdr sdr, ExportSession *session,
 
 		worstCaseSegmentSize = length
 				+ dataSegmentOverhead + checkpointOverhead;
-		if (worstCaseSegmentSize > span->maxSegmentSize)
+		if (worstCaseSegmentSize > vspan->maxXmitSegSize)
 		{
 			/*	Must reduce length.  So this segment's
 			 *	last data byte can't be the last data
@@ -5569,7 +6792,7 @@ static int	constructDataSegment(Sdr sdr, ExportSession *session,
 			 *	data), whichever is less.		*/
 
 			checkpointOverhead = 0;
-			length = span->maxSegmentSize - dataSegmentOverhead;
+			length = vspan->maxXmitSegSize - dataSegmentOverhead;
 			if (lastExtent)
 			{
 				if (length >= redBytesToSegment)
@@ -5620,12 +6843,12 @@ static int	constructDataSegment(Sdr sdr, ExportSession *session,
 		dataSegmentOverhead = segment.pdu.headerLength +
 				segment.pdu.ohdLength + lengthSdnv.length;
 		worstCaseSegmentSize = length + dataSegmentOverhead;
-		if (worstCaseSegmentSize > span->maxSegmentSize)
+		if (worstCaseSegmentSize > vspan->maxXmitSegSize)
 		{
 			/*	Must reduce length, so cannot be end
 			 *	of green part (which is end of block).	*/
 
-			length = span->maxSegmentSize - dataSegmentOverhead;
+			length = vspan->maxXmitSegSize - dataSegmentOverhead;
 			encodeSdnv(&lengthSdnv, length);
 		}
 		else	/*	Remainder of extent fits in one segment.*/
@@ -5714,7 +6937,8 @@ static int	constructDataSegment(Sdr sdr, ExportSession *session,
 	segment.pdu.length = length;
 	encodeSdnv(&lengthSdnv, segment.pdu.length);
 	segment.pdu.ohdLength += lengthSdnv.length;
-	segment.pdu.contentLength = segment.pdu.ohdLength + segment.pdu.length;
+	segment.pdu.contentLength = segment.pdu.ohdLength
+			+ (unsigned int) segment.pdu.length;
 	segment.pdu.trailerLength = 0;
 	segment.pdu.block = session->svcDataObjects;
 	if (invokeOutboundOnHeaderExtensionGenerationCallbacks(&segment) < 0)
@@ -5841,8 +7065,8 @@ putErrmsg("Discarding stray segment.", itoa(sessionNbr));
 	}
 }
 
-static int	addTransmissionExtent(Lyst extents, unsigned int startOfGap,
-			unsigned int endOfGap)
+static int	addTransmissionExtent(Lyst extents, uvast startOfGap,
+			uvast endOfGap)
 {
 	ExportExtent	*extent;
 
@@ -5856,8 +7080,8 @@ static int	addTransmissionExtent(Lyst extents, unsigned int startOfGap,
 	extent->length = endOfGap - startOfGap;
 #if LTPDEBUG
 char	xmitbuf[256];
-sprintf(xmitbuf, "      retransmitting from %d to %d.", extent->offset,
-extent->offset + extent->length);
+sprintf(xmitbuf, "      retransmitting from " UVAST_FIELDSPEC " to "
+UVAST_FIELDSPEC ".", extent->offset, extent->offset + extent->length);
 putErrmsg(xmitbuf, NULL);
 #endif
 	if (lyst_insert_last(extents, extent) == NULL)
@@ -5879,8 +7103,8 @@ static int	handleRS(LtpDB *ltpdb, unsigned int sessionNbr,
 	char			*endOfHeader;
 	unsigned int		rptSerialNbr;
 	unsigned int		ckptSerialNbr;
-	unsigned int		rptUpperBound;
-	unsigned int		rptLowerBound;
+	uvast			rptUpperBound;
+	uvast			rptLowerBound;
 	unsigned int		claimCount;
 	LtpReceptionClaim	*newClaims;
 	Object			sessionObj;
@@ -5897,15 +7121,15 @@ static int	handleRS(LtpDB *ltpdb, unsigned int sessionNbr,
 	Object			claimObj;
 	Object			nextElt;
 	LtpReceptionClaim	*claim;
-	unsigned int		claimEnd;
+	uvast			claimEnd;
 	LtpReceptionClaim	*newClaim;
-	unsigned int		newClaimEnd;
+	uvast			newClaimEnd;
 	LystElt			elt2;
 	LystElt			nextElt2;
 	int			i;
 	Lyst			extents;
-	unsigned int		startOfGap;
-	unsigned int		endOfGap;
+	uvast			startOfGap;
+	uvast			endOfGap;
 #if LTPDEBUG
 putErrmsg("Handling report.", utoa(sessionNbr));
 #endif
@@ -5917,13 +7141,14 @@ putErrmsg("Handling report.", utoa(sessionNbr));
 	endOfHeader = *cursor;
 	extractSmallSdnv(&rptSerialNbr, cursor, bytesRemaining);
 	extractSmallSdnv(&ckptSerialNbr, cursor, bytesRemaining);
-	extractSmallSdnv(&rptUpperBound, cursor, bytesRemaining);
-	extractSmallSdnv(&rptLowerBound, cursor, bytesRemaining);
+	extractSdnv(&rptUpperBound, cursor, bytesRemaining);
+	extractSdnv(&rptLowerBound, cursor, bytesRemaining);
 	extractSmallSdnv(&claimCount, cursor, bytesRemaining);
 #if LTPDEBUG
 char	rsbuf[256];
-sprintf(rsbuf, "[i] Got RS %u for checkpoint %u; %u claims from %u to %u.",
-rptSerialNbr, ckptSerialNbr, claimCount, rptLowerBound, rptUpperBound);
+sprintf(rsbuf, "[i] Got RS %u for checkpoint %u; %u claims from "
+UVAST_FIELDSPEC " to " UVAST_FIELDSPEC ".", rptSerialNbr, ckptSerialNbr,
+claimCount, rptLowerBound, rptUpperBound);
 putErrmsg(rsbuf, utoa(sessionNbr));
 #endif
 	newClaims = (LtpReceptionClaim *)
@@ -6159,7 +7384,8 @@ putErrmsg("Discarding report.", NULL);
 
 		sdr_read(sdr, (char *) claim, claimObj,
 				sizeof(LtpReceptionClaim));
-		sdr_free(sdr, claimObj);
+		sdr_arena_free(sdr, sessionBuf.arena, claimObj,
+				sizeof(LtpReceptionClaim));
 		sdr_list_delete(sdr, elt, NULL, NULL);
 	}
 
@@ -6385,7 +7611,8 @@ putErrmsg("Incomplete reception.  Claims:", utoa(claimCount));
 	{
 #if LTPDEBUG
 char	claimbuf[256];
-sprintf(claimbuf, "-   offset %u length %u (%u-%u)", claim->offset,
+sprintf(claimbuf, "-   offset " UVAST_FIELDSPEC " length " UVAST_FIELDSPEC \
+" (" UVAST_FIELDSPEC "-" UVAST_FIELDSPEC ")", claim->offset,
 claim->length, claim->offset, claim->offset + claim->length);
 putErrmsg(claimbuf, itoa(sessionBuf.sessionNbr));
 #endif
@@ -6572,8 +7799,8 @@ putErrmsg("Discarding stray segment.", itoa(sessionNbr));
 		sdr_stage(sdr, (char *) &rsBuf, rsObj, sizeof(LtpXmitSeg));
 #if LTPDEBUG
 char	buf[256];
-sprintf(buf, "Acknowledged report is %u, lowerBound %d, upperBound %d, \
-last report serial number %u.", rsBuf.pdu.rptSerialNbr, rsBuf.pdu.lowerBound,
+sprintf(buf, "Acknowledged report is %u, lowerBound " UVAST_FIELDSPEC ", \
+upperBound " UVAST_FIELDSPEC ", last report serial number %u.", rsBuf.pdu.rptSerialNbr, rsBuf.pdu.lowerBound,
 rsBuf.pdu.upperBound, session.lastRptSerialNbr);
 putErrmsg(buf, itoa(sessionNbr));
 #endif
@@ -7076,6 +8303,486 @@ putErrmsg("Discarding stray segment.", itoa(sessionNbr));
 	return 1;
 }
 
+/*	Link service input tasks of a sharded node use these two
+ *	functions to route each inbound segment to the shard that
+ *	serves the span to the segment's source engine.		*/
+
+unsigned int	ltpShardOf(uvast engineId, unsigned int shardCount)
+{
+	if (shardCount < 2)
+	{
+		return 0;
+	}
+
+	return engineId % shardCount;
+}
+
+/*	Each shard of a sharded node numbers its export sessions
+ *	within its own range of session numbers, so that the IDs of
+ *	sessions on the spans of different shards never collide.
+ *	Session numbers within a range still vary in their low-order
+ *	bits, which index the session caches.				*/
+
+unsigned int	ltpShardSessionNbr(unsigned int sessionCount,
+			unsigned int shardNbr, unsigned int shardCount)
+{
+	unsigned int	range;
+
+	if (shardCount < 2)
+	{
+		return sessionCount;
+	}
+
+	range = ((unsigned int) -1) / shardCount;
+	return (shardNbr * range) + 1 + (sessionCount % (range - 1));
+}
+
+/*	*	*	Shard relay functions	*	*	*	*/
+
+/*	A task of one shard of a sharded node uses the other shards'
+ *	spans and client services by way of their relays, over one
+ *	connection per shard that is shared by all of its threads.	*/
+
+static ResourceLock	relayLocks[LTP_MAX_SHARDS];
+static int		relayFds[LTP_MAX_SHARDS];
+static int		relayConnected[LTP_MAX_SHARDS];
+
+static int	relayConnect(unsigned int shardNbr)
+{
+	LtpDB			*db = _ltpConstants();
+	unsigned short		portBase;
+	int			fd;
+	int			noDelay = 1;
+	struct sockaddr_in	relayName;
+
+	CHKERR(db);
+	CHKERR(shardNbr < db->shardCount);
+	portBase = db->relayPortBase;
+	if (portBase == 0)
+	{
+		portBase = LTP_RELAY_PORT_BASE;
+	}
+
+	fd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	if (fd < 0)
+	{
+		putSysErrmsg("Can't open LTP relay socket", NULL);
+		return -1;
+	}
+
+	memset((char *) &relayName, 0, sizeof relayName);
+	relayName.sin_family = AF_INET;
+	relayName.sin_port = htons(portBase + shardNbr);
+	relayName.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	if (connect(fd, (struct sockaddr *) &relayName, sizeof relayName) < 0)
+	{
+		putSysErrmsg("Can't connect to LTP relay of shard",
+				utoa(shardNbr));
+		close(fd);
+		return -1;
+	}
+
+	/*	Requests are small and each awaits its answer.		*/
+
+	oK(setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, (char *) &noDelay,
+			sizeof noDelay));
+	return fd;
+}
+
+int	ltpRelayWrite(int fd, char *buffer, int length)
+{
+	int	bytesWritten;
+
+	while (length > 0)
+	{
+		/*	A relay that has gone away must not raise
+		 *	SIGPIPE in the application.			*/
+
+		bytesWritten = send(fd, buffer, length, MSG_NOSIGNAL);
+		if (bytesWritten < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+
+			putSysErrmsg("Can't write to LTP relay connection",
+					NULL);
+			return -1;
+		}
+
+		buffer += bytesWritten;
+		length -= bytesWritten;
+	}
+
+	return 0;
+}
+
+/*	Returns 1 on success, 0 if the connection was closed before
+ *	any byte was read, -1 on any other failure.			*/
+
+int	ltpRelayRead(int fd, char *buffer, int length)
+{
+	int	bytesRead;
+	int	total = 0;
+
+	while (total < length)
+	{
+		bytesRead = recv(fd, buffer + total, length - total, 0);
+		switch (bytesRead)
+		{
+		case -1:
+			if (errno == EINTR)
+			{
+				continue;
+			}
+
+			putSysErrmsg("Can't read from LTP relay connection",
+					NULL);
+			return -1;
+
+		case 0:
+			if (total == 0)
+			{
+				return 0;
+			}
+
+			putErrmsg("LTP relay connection closed mid-message.",
+					NULL);
+			return -1;
+		}
+
+		total += bytesRead;
+	}
+
+	return 1;
+}
+
+/*	Writes the first length bytes of a ZCO's content, including
+ *	any headers and trailers, to a relay connection.  On failure
+ *	the connection is no longer usable and must be closed.	*/
+
+int	ltpRelaySendZco(int fd, Object zco, uvast length)
+{
+	Sdr		sdr = getIonsdr();
+	ZcoReader	reader;
+	char		*buffer;
+	vast		chunk;
+
+	CHKERR(zco);
+	buffer = MTAKE(LTP_RELAY_CHUNK_SIZE);
+	if (buffer == NULL)
+	{
+		putErrmsg("No space for relay buffer.", NULL);
+		return -1;
+	}
+
+	zco_start_transmitting(zco, &reader);
+	while (length > 0)
+	{
+		chunk = LTP_RELAY_CHUNK_SIZE;
+		if (length < (uvast) chunk)
+		{
+			chunk = length;
+		}
+
+		if (sdr_begin_xn(sdr) == 0)
+		{
+			MRELEASE(buffer);
+			return -1;
+		}
+
+		chunk = zco_transmit(sdr, &reader, chunk, buffer);
+		sdr_exit_xn(sdr);
+		if (chunk <= 0)
+		{
+			MRELEASE(buffer);
+			putErrmsg("Can't read ZCO for relay.", NULL);
+			return -1;
+		}
+
+		if (ltpRelayWrite(fd, buffer, chunk) < 0)
+		{
+			MRELEASE(buffer);
+			return -1;
+		}
+
+		length -= chunk;
+	}
+
+	MRELEASE(buffer);
+	return 0;
+}
+
+/*	Sends one request, followed by the content of zco if zco is
+ *	non-zero, to the relay of the indicated shard and waits for
+ *	the relay's answer if reply is non-NULL.  A connection that
+ *	fails is closed, and the next request opens a new one.	*/
+
+int	ltpRelayRequest(unsigned int shardNbr, LtpRelayMsg *msg, Object zco,
+		LtpRelayReply *reply)
+{
+	int	fd;
+	int	result = 0;
+
+	CHKERR(shardNbr < LTP_MAX_SHARDS);
+	CHKERR(msg);
+	if (initResourceLock(relayLocks + shardNbr) < 0)
+	{
+		putErrmsg("Can't initialize LTP relay lock.", NULL);
+		return -1;
+	}
+
+	lockResource(relayLocks + shardNbr);
+	if (!relayConnected[shardNbr])
+	{
+		relayFds[shardNbr] = relayConnect(shardNbr);
+		if (relayFds[shardNbr] < 0)
+		{
+			unlockResource(relayLocks + shardNbr);
+			return -1;
+		}
+
+		relayConnected[shardNbr] = 1;
+	}
+
+	fd = relayFds[shardNbr];
+	if (ltpRelayWrite(fd, (char *) msg, sizeof(LtpRelayMsg)) < 0
+	|| (zco && ltpRelaySendZco(fd, zco, msg->dataLength) < 0)
+	|| (reply && ltpRelayRead(fd, (char *) reply,
+			sizeof(LtpRelayReply)) < 1))
+	{
+		close(fd);
+		relayConnected[shardNbr] = 0;
+		putErrmsg("LTP shard relay request failed.", utoa(shardNbr));
+		result = -1;
+	}
+
+	unlockResource(relayLocks + shardNbr);
+	return result;
+}
+
+void	ltpRelayDisconnect()
+{
+	int	i;
+
+	for (i = 0; i < LTP_MAX_SHARDS; i++)
+	{
+		if (relayConnected[i])
+		{
+			close(relayFds[i]);
+			relayConnected[i] = 0;
+		}
+	}
+}
+
+/*	Reads length bytes of source data from a relay connection into
+ *	a new ZCO in the local SDR heap.  If attendant is NULL and ZCO
+ *	space can't be awarded immediately, or if waiting for space is
+ *	interrupted, the data are discarded and 0 is returned.  On any
+ *	failure returns ERROR, and the connection must be closed.	*/
+
+Object	ltpRelayReceiveZco(int fd, uvast length, ZcoAcct acct,
+		ReqAttendant *attendant)
+{
+	Sdr		sdr = getIonsdr();
+	ReqTicket	ticket;
+	int		admitted = 1;
+	int		failed = 0;
+	char		*buffer;
+	int		chunk;
+	Object		extent;
+	Object		zco = 0;
+
+	CHKERR(length > 0);
+	buffer = MTAKE(LTP_RELAY_CHUNK_SIZE);
+	if (buffer == NULL)
+	{
+		putErrmsg("No space for relay buffer.", NULL);
+		return (Object) ERROR;
+	}
+
+	if (ionRequestZcoSpace(acct, 0, 0, length, 0, 0, attendant, &ticket)
+			< 0)
+	{
+		MRELEASE(buffer);
+		putErrmsg("Can't request ZCO space for relayed data.", NULL);
+		return (Object) ERROR;
+	}
+
+	if (ticket)		/*	Space not awarded yet.		*/
+	{
+		if (attendant == NULL
+		|| sm_SemTake(attendant->semaphore) < 0
+		|| sm_SemEnded(attendant->semaphore))
+		{
+			admitted = 0;
+		}
+
+		ionShred(ticket);
+	}
+
+	while (length > 0 && !failed)
+	{
+		chunk = LTP_RELAY_CHUNK_SIZE;
+		if (length < (uvast) chunk)
+		{
+			chunk = length;
+		}
+
+		if (ltpRelayRead(fd, buffer, chunk) < 1)
+		{
+			failed = 1;
+			continue;
+		}
+
+		length -= chunk;
+		if (!admitted)
+		{
+			continue;	/*	Discard the data.	*/
+		}
+
+		/*	Space was awarded for the entire ZCO, so the
+		 *	length of each extent is passed as its additive
+		 *	inverse.					*/
+
+		if (sdr_begin_xn(sdr) == 0)
+		{
+			failed = 1;
+			continue;
+		}
+
+		extent = sdr_insert(sdr, buffer, chunk);
+		if (extent == 0)
+		{
+			sdr_cancel_xn(sdr);
+			failed = 1;
+			continue;
+		}
+
+		if (zco == 0)
+		{
+			zco = zco_create(sdr, ZcoSdrSource, extent, 0,
+					0 - chunk, acct, 0);
+		}
+		else if (zco_append_extent(sdr, zco, ZcoSdrSource, extent, 0,
+				0 - chunk) <= 0)
+		{
+			sdr_cancel_xn(sdr);
+			failed = 1;
+			continue;
+		}
+
+		if (sdr_end_xn(sdr) < 0 || zco == (Object) ERROR || zco == 0)
+		{
+			zco = 0;
+			failed = 1;
+		}
+	}
+
+	MRELEASE(buffer);
+	if (!failed)
+	{
+		return zco;
+	}
+
+	putErrmsg("Can't receive relayed data.", NULL);
+	if (zco)
+	{
+		if (sdr_begin_xn(sdr))
+		{
+			zco_destroy(sdr, zco);
+			oK(sdr_end_xn(sdr));
+		}
+	}
+
+	return (Object) ERROR;
+}
+
+/*	Posts a notice forwarded by the relay of another shard to the
+ *	local client, which owns any data of the notice from then on.	*/
+
+int	ltpRelayNotice(unsigned int clientSvcId, LtpNotice *notice)
+{
+	Sdr		sdr = getIonsdr();
+	LtpVclient	*client;
+
+	CHKERR(clientSvcId <= MAX_LTP_CLIENT_NBR);
+	CHKERR(notice);
+	CHKERR(sdr_begin_xn(sdr));
+	client = (_ltpvdb(NULL))->clients + clientSvcId;
+	if (client->pid == ERROR)
+	{
+		/*	Client has been closed; nobody to notify.	*/
+
+		if (notice->data)
+		{
+			zco_destroy(sdr, notice->data);
+		}
+	}
+	else if (enqueueNotice(client, notice->sessionId.sourceEngineId,
+			notice->sessionId.sessionNbr, notice->dataOffset,
+			notice->dataLength, notice->type,
+			notice->reasonCode, notice->endOfBlock,
+			notice->data) < 0)
+	{
+		sdr_cancel_xn(sdr);
+		putErrmsg("Can't post relayed notice.", NULL);
+		return -1;
+	}
+
+	if (sdr_end_xn(sdr) < 0)
+	{
+		putErrmsg("Can't post relayed notice.", NULL);
+		return -1;
+	}
+
+	return 0;
+}
+
+/*	Signals the local readiness FIFO of a span served by another
+ *	shard.  Descriptors for such spans aren't counted, so the FIFO
+ *	is simply written if some application has it open.		*/
+
+void	ltpRelaySpanReadiness(uvast engineId)
+{
+	Sdr	sdr = getIonsdr();
+	int	fdCount = 1;
+
+	CHKVOID(sdr_begin_xn(sdr));	/*	Just to lock memory.	*/
+	ltpSignalReadinessFifo(LTP_SPAN_FIFO, engineId, &fdCount);
+	sdr_exit_xn(sdr);
+}
+
+int	ltpGetSourceEngineId(char *buf, int length, uvast *sourceEngineId)
+{
+	unsigned char	*cursor = (unsigned char *) buf;
+	int		bytesRemaining = length;
+	uvast		engineId;
+
+	CHKERR(buf);
+	CHKERR(sourceEngineId);
+	if (length < 2 || (((*cursor) >> 4) & 0x0f) != 0)
+	{
+		return 0;		/*	Not an LTP segment.	*/
+	}
+
+	cursor++;
+	bytesRemaining--;
+
+	/*	An SDNV that runs off the end of the segment is as
+	 *	invalid as one that can't be decoded at all.		*/
+
+	if (_extractSdnv(&engineId, &cursor, &bytesRemaining, __LINE__) < 1
+	|| bytesRemaining < 0)
+	{
+		return 0;		/*	Truncated header.	*/
+	}
+
+	*sourceEngineId = engineId;
+	return 1;
+}
+
 int	ltpHandleInboundSegment(char *buf, int length)
 {
 	Sdr		sdr;
@@ -7237,8 +8944,7 @@ void	ltpStartXmit(LtpVspan *vspan)
 	CHKVOID(vspan);
 	spanObj = sdr_list_data(sdr, vspan->spanElt);
 	sdr_read(sdr, (char *) &span, spanObj, sizeof(LtpSpan));
-	sm_SemGive(vspan->bufOpenRedSemaphore);
-	sm_SemGive(vspan->bufOpenGreenSemaphore);
+	openExportBuffer(vspan);
 	if (sdr_list_length(sdr, span.segments) > 0)
 	{
 		sm_SemGive(vspan->segSemaphore);
@@ -7257,9 +8963,7 @@ void	ltpStopXmit(LtpVspan *vspan)
 
 	CHKVOID(ionLocked());
 	CHKVOID(vspan);
-	spanObj = sdr_list_data(sdr, vspan->spanElt);
-	sdr_read(sdr, (char *) &span, spanObj, sizeof(LtpSpan));
-	if (span.purge)
+	if (vspan->purge)
 	{
 		/*	At end of transmission on this span we must
 		 *	cancel all export sessions that are currently
@@ -7269,6 +8973,8 @@ void	ltpStopXmit(LtpVspan *vspan)
 		 *	of transmission on this span before those
 		 *	bundles can be successfully transmitted.	*/
 
+		spanObj = sdr_list_data(sdr, vspan->spanElt);
+		sdr_read(sdr, (char *) &span, spanObj, sizeof(LtpSpan));
 		for (elt = sdr_list_first(sdr, span.exportSessions); elt;
 				elt = nextElt)
 		{
@@ -7343,7 +9049,7 @@ int	ltpSuspendTimers(LtpVspan *vspan, PsmAddress vspanElt,
 	CHKERR(vspan);
 	spanObj = sdr_list_data(sdr, vspan->spanElt);
 	GET_OBJ_POINTER(sdr, LtpSpan, span, spanObj);
-	qTime = span->remoteQtime;
+	qTime = vspan->remoteQtime;
 
 	/*	Suspend relevant timers for import sessions.		*/
 
@@ -7512,7 +9218,7 @@ int	ltpResumeTimers(LtpVspan *vspan, PsmAddress vspanElt, time_t resumeTime,		un
 	CHKERR(vspan);
 	spanObj = sdr_list_data(sdr, vspan->spanElt);
 	GET_OBJ_POINTER(sdr, LtpSpan, span, spanObj);
-	qTime = span->remoteQtime;
+	qTime = vspan->remoteQtime;
 
 	/*	Resume relevant timers for import sessions.		*/
 
@@ -57,7 +57,7 @@ void ltpnm_spanEngineIds_get (unsigned int IdArray [], int * numIds)
     CHKVOID(maxEngines > 0);
     CHKVOID(IdArray);
     * numIds = 0;
-    CHKVOID(sdr_begin_xn(sdr));
+    CHKVOID(sdr_begin_read(sdr));
     for (sdrElt = sdr_list_first(sdr, (getLtpConstants())->spans);
          sdrElt; 
          sdrElt = sdr_list_next(sdr, sdrElt))
@@ -72,7 +72,7 @@ void ltpnm_spanEngineIds_get (unsigned int IdArray [], int * numIds)
 	}
     }
 
-    sdr_exit_xn(sdr);
+    sdr_end_read(sdr);
 }
 
 /*****************************************************************************/
@@ -115,6 +115,8 @@ void ltpnm_span_get (unsigned int   engineIdWanted,
     Object          spanObj;
     LtpSpan         span;
     LtpSpanStats    stats;
+    LtpVspan      * vspan;
+    PsmAddress      vspanElt;
     Object          elt2;
     ImportSession   isession;
     
@@ -122,7 +124,7 @@ void ltpnm_span_get (unsigned int   engineIdWanted,
     CHKVOID(results);
     CHKVOID(success);
     * success = 0;
-    CHKVOID(sdr_begin_xn(sdr));
+    CHKVOID(sdr_begin_read(sdr));
     for (eltLoop = 0, sdrElt = sdr_list_first(sdr, (getLtpConstants())->spans);
          sdrElt; 
          eltLoop++, sdrElt = sdr_list_next(sdr, sdrElt))
@@ -131,7 +133,15 @@ void ltpnm_span_get (unsigned int   engineIdWanted,
         sdr_read(sdr, (char *) & span, spanObj, sizeof(LtpSpan));
         if (engineIdWanted == span.engineId)
         {
-            sdr_read(sdr, (char *) & stats, span.stats, sizeof(LtpSpanStats));
+            findSpan(span.engineId, &vspan, &vspanElt);
+            if (vspanElt)
+            {
+                ltpReadSpanStats(vspan, &stats);
+            }
+            else
+            {
+                sdr_read(sdr, (char *) & stats, span.stats, sizeof(LtpSpanStats));
+            }
 
             /* DEBUGGING AID ONLY:  Useful for showing which fields have yet to be assigned. */
             memset_IncFillPat ( (char *) results, LTPNM_SPAN_FILLPATT, sizeof(NmltpSpan) );
@@ -145,11 +155,10 @@ void ltpnm_span_get (unsigned int   engineIdWanted,
 	    for (elt2 = sdr_list_first(sdr, span.importSessions); elt2; elt2 = sdr_list_next(sdr, elt2))
 	    {
                 sdr_read(sdr, (char *) & isession, sdr_list_data(sdr, elt2), sizeof(ImportSession));
-		results->currentInboundSegments += sdr_list_length(sdr, isession.redSegments);
+		results->currentInboundSegments += isession.redSegmentsCount;
 	    }
         
-            sdr_exit_xn(sdr);
-
+            sdr_end_read(sdr);
             results->lastResetTime           = stats.resetTime;
         
             results->outputSegQueuedCount    = stats.tallies[OUT_SEG_QUEUED].currentCount;
@@ -197,7 +206,7 @@ void ltpnm_span_get (unsigned int   engineIdWanted,
         }
     }
 
-    sdr_exit_xn(sdr);
+    sdr_end_read(sdr);
 }
 
 /****************************************************************************/
@@ -209,6 +218,8 @@ void ltpnm_span_reset (unsigned int engineIdWanted, int * success)
     Object          spanObj;
     LtpSpan         span;
     LtpSpanStats    stats;
+    LtpVspan      * vspan;
+    PsmAddress      vspanElt;
     Tally         * tally;
     int             tallyLoop;
 
@@ -224,6 +235,12 @@ void ltpnm_span_reset (unsigned int engineIdWanted, int * success)
         sdr_read(sdr, (char *) &span, spanObj, sizeof(LtpSpan));
         if (engineIdWanted == span.engineId)
         {
+            findSpan(span.engineId, &vspan, &vspanElt);
+            if (vspanElt)
+            {
+                ltpFlushSpanStats(vspan);
+            }
+
             sdr_stage(sdr, (char *) & stats, span.stats, sizeof(LtpSpanStats));
             stats.resetTime = getUTCTime();
             for (tallyLoop = 0; tallyLoop < LTP_SPAN_STATS; tallyLoop++)
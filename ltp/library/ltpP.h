@@ -31,6 +31,8 @@
 #include "zco.h"
 #include "ltp.h"
 #include "sdrhash.h"
+#include "sdrulist.h"
+#include "smbpt.h"
 
 #ifndef _LTPP_H_
 #define _LTPP_H_
@@ -55,6 +57,21 @@ extern "C" {
 #define	LTP_MEAN_SEARCH_LENGTH	4
 #endif
 
+#ifndef LTP_NOTICE_RING_SIZE
+#define	LTP_NOTICE_RING_SIZE	(256)	/*	Must be a power of 2.	*/
+#endif
+
+#define	LTP_SPAN_FIFO		"span"
+#define	LTP_CLIENT_FIFO		"client"
+
+#ifndef LTP_MAX_SHARDS
+#define	LTP_MAX_SHARDS		(64)
+#endif
+
+#ifndef LTP_RELAY_PORT_BASE
+#define	LTP_RELAY_PORT_BASE	(11130)
+#endif
+
 #ifndef LTP_SERIAL_NBR_LIMIT
 #define	LTP_SERIAL_NBR_LIMIT	(16384)
 #endif
@@ -67,12 +84,67 @@ extern "C" {
 #define MAX_CLAIMS_PER_RS	20
 #endif
 
+/*	Size of each chunk of a session's SDR arena, from which the
+ *	session's lists, claims, checkpoints and extents are
+ *	allocated and all released together when the session ends.	*/
+
+#ifndef LTP_SESSION_ARENA_CHUNK
+#define	LTP_SESSION_ARENA_CHUNK	(4096)
+#endif
+
+/*	Number of entries in each direct-mapped cache of recently
+ *	looked-up sessions.						*/
+
+#ifndef LTP_SESSION_CACHE_SIZE
+#define	LTP_SESSION_CACHE_SIZE	(8)	/*	Must be a power of 2.	*/
+#endif
+
+/*	Number of buckets in the volatile hash index of spans by
+ *	remote engine ID.						*/
+
+#ifndef LTP_SPAN_HASH_BUCKETS
+#define	LTP_SPAN_HASH_BUCKETS	(1021)	/*	Should be prime.	*/
+#endif
+
+/*	The volatile indices of each span's import sessions and of
+ *	each import session's red-part extents are red-black trees
+ *	unless LTP_BPT_INDICES is set, in which case they are B+trees
+ *	(see smbpt.h).  Neither index ever holds two entries with
+ *	the same key, and no index node is used after the index has
+ *	been modified, so the two are interchangeable here.		*/
+
+#ifndef LTP_BPT_INDICES
+#define	LTP_BPT_INDICES		0
+#endif
+
+#if LTP_BPT_INDICES
+#define	ltp_idx_create		sm_bpt_create
+#define	ltp_idx_clear		sm_bpt_clear
+#define	ltp_idx_destroy		sm_bpt_destroy
+#define	ltp_idx_insert		sm_bpt_insert
+#define	ltp_idx_delete		sm_bpt_delete
+#define	ltp_idx_search		sm_bpt_search
+#define	ltp_idx_last		sm_bpt_last
+#define	ltp_idx_prev		sm_bpt_prev
+#define	ltp_idx_data		sm_bpt_data
+#else
+#define	ltp_idx_create		sm_rbt_create
+#define	ltp_idx_clear		sm_rbt_clear
+#define	ltp_idx_destroy		sm_rbt_destroy
+#define	ltp_idx_insert		sm_rbt_insert
+#define	ltp_idx_delete		sm_rbt_delete
+#define	ltp_idx_search		sm_rbt_search
+#define	ltp_idx_last		sm_rbt_last
+#define	ltp_idx_prev		sm_rbt_prev
+#define	ltp_idx_data		sm_rbt_data
+#endif
+
 /*	LTP segment structure definitions.				*/
 
 typedef struct
 {
-	unsigned int	offset;
-	unsigned int	length;
+	uvast		offset;
+	uvast		length;
 } LtpReceptionClaim;
 
 #define	LTP_CTRL_FLAG		0x08
@@ -147,14 +219,14 @@ typedef struct
 
 	unsigned int		ohdLength;	/*	Data seg ohd.	*/
 	unsigned int		clientSvcId;	/*	Destination.	*/
-	unsigned int		offset;		/*	Within block.	*/
-	unsigned int		length;		/*	Of block data.	*/
+	uvast			offset;		/*	Within block.	*/
+	uvast			length;		/*	Of block data.	*/
 	Object			block;	/*	Session svcDataObjects.	*/
 
 	/*	Fields for report segments.				*/
 
-	unsigned int		upperBound;
-	unsigned int		lowerBound;
+	uvast			upperBound;
+	uvast			lowerBound;
 	Object			receptionClaims;/*	SDR list.	*/
 
 	/*	Fields for management segments.				*/
@@ -220,12 +292,25 @@ typedef struct
 
 /* Session structures */
 
+/*	An LtpRecvExtent is a maximal run of contiguous red-part
+ *	data that has been received for an import session.  Each
+ *	newly received red segment is coalesced with the extents
+ *	that it abuts, so the number of extents retained for a
+ *	session is bounded by the number of gaps in reception
+ *	rather than by the number of segments received.		*/
+
+typedef struct
+{
+	uvast		offset;
+	uvast		length;
+} LtpRecvExtent;
+
 typedef struct
 {
-	unsigned int	offset;
-	unsigned int	length;
+	uvast		offset;
+	uvast		length;
 	Object		sessionListElt;
-} LtpSegmentRef;
+} LtpExtentRef;
 
 /*	While the LTP specification permits a single report to
  *	comprise multiple report segments, it provides no mechanism
@@ -241,12 +326,15 @@ typedef struct
 	unsigned int	sessionNbr;	/*	Assigned by source.	*/
 	Sdnv		sessionNbrSdnv;
 	unsigned int	clientSvcId;
-	int		redPartLength;
-	int		redPartReceived;
+	uvast		redPartLength;
+	uvast		redPartReceived;
 	unsigned char	endOfBlockRecd;	/*	Boolean.		*/
 	LtpTimer	timer;		/*	For cancellation.	*/
 	int		reasonCode;	/*	For cancellation.	*/
-	Object		redSegments;	/*	SDR list of LtpRecvSegs	*/
+	Object		arena;		/*	Session-lifetime objects	*/
+	Object		redExtents;	/*	SDR list: LtpRecvExtent	*/
+	unsigned int	redSegmentsCount;
+	uvast		maxRedSegLength;
 	Object		rsSegments;	/*	SDR list of LtpXmitSegs	*/
 	unsigned int	nextRptSerialNbr;
 	unsigned int	lastRptSerialNbr;
@@ -259,7 +347,7 @@ typedef struct
 	Object		heapBufferObj;
 	Object		blockObjRef;
 	uvast		blockObjSize;
-	char		fileBufferPath[256];
+	Object		cold;		/*	ImportSessionCold	*/
 	Object		blockFileRef;
 	uvast		blockFileSize;
 
@@ -268,20 +356,53 @@ typedef struct
 	Object		span;		/*	Reception span.		*/
 } ImportSession;
 
+/*	The ImportSession is staged on receipt of every data segment,
+ *	so anything bulky that is needed only rarely is kept out of it
+ *	in this cold extension, which is created (in the session's
+ *	arena) only when the session starts buffering to a file.	*/
+
+typedef struct
+{
+	char		fileBufferPath[256];
+} ImportSessionCold;
+
 /*	The volatile import session object encapsulates the current
  *	volatile state of the corresponding ImportSession.  The main
- *	purpose of this structure is to accelerate the insertion of
- *	red-data segments into the very long redSgments list of an
- *	extremely large block; for a block comprising a small number
- *	of red-data segments, there is no performance advantage.	*/
+ *	purpose of this structure is to accelerate the location of
+ *	the received extents adjacent to a newly arrived red-data
+ *	segment when reception of an extremely large block is badly
+ *	fragmented; for a block received mostly in order there is
+ *	no performance advantage.					*/
 
 typedef struct
 {
 	unsigned int	sessionNbr;	/*	ID of ImportSession.	*/
 	Object		sessionElt;	/*	Ref. to ImportSession.	*/
-	PsmAddress	redSegmentsIdx;	/*	RBT of LtpSegmentRefs	*/
+	PsmAddress	redExtentsIdx;	/*	Index of LtpExtentRefs	*/
 } VImportSession;
 
+/*	Consecutive segments nearly always belong to the same session,
+ *	so the most recent lookups of sessions by session number are
+ *	cached in direct-mapped session caches, indexed by the low-
+ *	order bits of the session number.  An entry is forgotten when
+ *	its session is removed from the corresponding sessions hash
+ *	table, i.e., when the session is closed or canceled.		*/
+
+typedef struct
+{
+	unsigned int	sessionNbr;	/*	0 if entry is empty.	*/
+	Object		sessionObj;
+	Object		sessionElt;
+	PsmAddress	vsession;	/*	VImportSession, if any.	*/
+} LtpSessionCacheEntry;
+
+typedef struct
+{
+	LtpSessionCacheEntry	entries[LTP_SESSION_CACHE_SIZE];
+	uvast		hits;
+	uvast		misses;
+} LtpSessionCache;
+
 /*	An LtpCkpt is a reference to an export session redSegment that
  *	is a transmission checkpoint.  The list of LtpCheckpoints
  *	provides a quick way to locate the specific LtpXmitSeg, out of
@@ -306,11 +427,12 @@ typedef struct
 	Sdnv		sessionNbrSdnv;
 	unsigned int	clientSvcId;
 	Sdnv		clientSvcIdSdnv;
-	int		totalLength;
-	int		redPartLength;
+	uvast		totalLength;
+	uvast		redPartLength;
 	int		stateFlags;
 	LtpTimer	timer;		/*	For cancellation.	*/
 	int		reasonCode;	/*	For cancellation.	*/
+	Object		arena;		/*	Session-lifetime objects	*/
 	Object		svcDataObjects;	/*	SDR list of ZCOs	*/
 	Object		claims;		/*	reception claims list	*/
 	int		maxCheckpoints;	/*	Limits # of ckpoints.	*/
@@ -329,8 +451,8 @@ typedef struct
 
 typedef struct
 {
-	unsigned int	offset;
-	unsigned int	length;
+	uvast		offset;
+	uvast		length;
 } ExportExtent;
 
 
@@ -374,8 +496,6 @@ typedef struct
 
 typedef struct
 {
-	uvast		engineId;	/*	ID of remote engine.	*/
-	Sdnv		engineIdSdnv;
 	unsigned int	remoteQtime;	/*	In seconds.		*/
 	int		purge;		/*	Boolean.		*/
 	Object		lsoCmd;		/*	For starting the LSO.	*/
@@ -384,13 +504,26 @@ typedef struct
 	unsigned int	aggrSizeLimit;	/*	Bytes.			*/
 	unsigned int	aggrTimeLimit;	/*	Seconds.		*/
 	unsigned int	maxSegmentSize;	/*	MTU size, in bytes.	*/
+} LtpSpanConfig;
+
+/*	The LtpSpan itself holds only the state that changes as
+ *	blocks are sent and received; the span's configuration is
+ *	in a separate LtpSpanConfig that is read only when the span
+ *	is raised or updated (its values are mirrored in the LtpVspan)
+ *	or when the span is described.					*/
+
+typedef struct
+{
+	uvast		engineId;	/*	ID of remote engine.	*/
+	Sdnv		engineIdSdnv;
+	Object		config;		/*	LtpSpanConfig address.	*/
 	Object		stats;		/*	LtpSpanStats address.	*/
 	int		updateStats;	/*	Boolean.		*/
 
 	Object		currentExportSessionObj;
 	unsigned int	ageOfBufferedBlock;
-	unsigned int	lengthOfBufferedBlock;
-	unsigned int	redLengthOfBufferedBlock;
+	uvast		lengthOfBufferedBlock;
+	uvast		redLengthOfBufferedBlock;
 	unsigned int	clientSvcIdOfBufferedBlock;
 
 	Object		exportSessions;	/*	SDR list: ExportSession	*/
@@ -442,6 +575,7 @@ typedef struct
 typedef struct
 {
 	Object		spanElt;	/*	Reference to LtpSpan.	*/
+	PsmAddress	hashNext;	/*	Next vspan elt in bucket.	*/
 	Object		stats;		/*	LtpSpanStats address.	*/
 	int		updateStats;	/*	Boolean.		*/
 	uvast		engineId;	/*	ID of remote engine.	*/
@@ -457,15 +591,28 @@ typedef struct
 	unsigned int	owltOutbound;	/*	In seconds.		*/
 	int		meterPid;	/*	For stopping ltpmeter.	*/
 	int		lsoPid;		/*	For stopping the LSO.	*/
-	PsmAddress	importSessions;	/*	RBT of VImportSessions	*/
-	PsmAddress	avblIdxRbts;	/*	SmList of empty RBTs	*/
+	PsmAddress	importSessions;	/*	Index: VImportSessions	*/
+	PsmAddress	avblIdxRbts;	/*	SmList: empty indices	*/
+
+	/*	Mirrors of the span's LtpSpanConfig (maxXmitSegSize
+	 *	mirrors its maxSegmentSize) and of its constant
+	 *	segments list, so that per-segment and per-SDU
+	 *	processing need not stage the LtpSpan at all.		*/
+
+	Object		segments;	/*	SDR list: LtpXmitSeg	*/
+	unsigned int	remoteQtime;	/*	In seconds.		*/
+	int		purge;		/*	Boolean.		*/
+	unsigned int	maxExportSessions;
+	unsigned int	maxImportSessions;
+	unsigned int	aggrSizeLimit;	/*	Bytes.			*/
+	unsigned int	aggrTimeLimit;	/*	Seconds.		*/
 
 	/*	For detecting miscolored segments.			*/
 
 	unsigned int	redSessionNbr;
-	unsigned int	endOfRed;
+	uvast		endOfRed;
 	unsigned int	greenSessionNbr;
-	unsigned int	startOfGreen;
+	uvast		startOfGreen;
 
 	/*	*	*	Work area	*	*	*	*/
 
@@ -486,10 +633,17 @@ typedef struct
 	 *	SDU to a block differ depending on whether or not
 	 *	the SDU contains any "red" data; ltp_send will take
 	 *	the bufOpenRedSemaphore if its SDU's red length is
-	 *	greater than zero, the bufOpenGreenSemaphore if not.	*/
+	 *	greater than zero, the bufOpenGreenSemaphore if not.
+	 *
+	 *	Whenever these semaphores are given, the span's
+	 *	readiness FIFO is also signaled if any application
+	 *	has obtained a readiness file descriptor for the
+	 *	span, so that applications sending in non-blocking
+	 *	mode can poll for the reopening of the block.		*/
 
 	sm_SemId	bufOpenRedSemaphore;
 	sm_SemId	bufOpenGreenSemaphore;
+	int		readinessFdCount;
 
 	/*	The bufClosedSemaphore of an LtpVspan is given by
 	 *	the LtpSend function every time the appending of a
@@ -521,34 +675,72 @@ typedef struct
 	 *	transmit the segment via its link service protocol.	*/
 
 	sm_SemId	segSemaphore;	/*	For outbound segments.	*/
+
+	/*	Span statistics are tallied in pendingTallies, under
+	 *	the ION lock but without an SDR write; the ltpclock
+	 *	task folds them into the span's LtpSpanStats in the
+	 *	SDR once per second, and they are likewise folded in
+	 *	before the statistics are reset.  Tallies folded in
+	 *	are retained in flushedTallies until the transaction
+	 *	ends, so that they can be restored to pendingTallies
+	 *	if it is canceled.  So tallying a segment costs no
+	 *	SDR write, at the price of losing up to a second's
+	 *	worth of tallies in a crash.				*/
+
+	Tally		pendingTallies[LTP_SPAN_STATS];
+	Tally		flushedTallies[LTP_SPAN_STATS];
+	int		talliesFlushed;	/*	Boolean.		*/
+
+	LtpSessionCache	importCache;	/*	Of import sessions.	*/
 } LtpVspan;
 
 /* Client and notice structures */
 
 typedef struct
 {
-	LtpSessionId	sessionId;
-	unsigned int	dataOffset;
-	unsigned int	dataLength;
-	LtpNoticeType	type;
-	unsigned char	reasonCode;
-	unsigned char	endOfBlock;	/*	Boolean.		*/
-	Object		data;		/*	To be serialized.	*/
-} LtpNotice;
+	Object		notices;	/*	SDR ulist: LtpNotices	*/
+} LtpClient;
+
+/* Notices that carry no data are posted to a volatile ring in ION
+ * working memory rather than to the client's SDR list of notices.
+ * A notice that carries data is still appended to the SDR list, so
+ * that the data can't be lost in a restart, and is represented in
+ * the ring by a slot whose inSdr flag is set; this preserves the
+ * order in which notices are delivered.				*/
 
 typedef struct
 {
-	Object		notices;	/*	SDR list of LtpNotices	*/
-} LtpClient;
+	LtpNotice	notice;		/*	Unless inSdr.		*/
+	int		inSdr;		/*	Boolean.		*/
+} LtpNoticeSlot;
 
 /* The volatile client object encapsulates the current volatile state
- * of the corresponding LtpClient. 					*/
+ * of the corresponding LtpClient.
+ *
+ * Notices are posted only by engine tasks that hold the ION lock, and
+ * only when the transaction that posted them is committed (see
+ * enqueueNotice), and they are retrieved only by the task that owns
+ * the client, so the ring is a single-producer, single-consumer queue:
+ * ringTail is advanced only by the producer and ringHead only by the
+ * consumer, and a notice that carries no data can be retrieved without
+ * taking the ION lock.  When the ring is full, all subsequent notices
+ * are "spilled" to the SDR list until the client has retrieved every
+ * notice in both the ring and the list.
+ *
+ * If the client has obtained a readiness file descriptor for notices,
+ * every posted notice also signals the client's readiness FIFO.	*/
 
 typedef struct
 {
 	Object		notices;	/*	Copied from LtpClient.	*/
 	int		pid;
 	sm_SemId	semaphore;	/*	For notices.		*/
+	PsmAddress	ring;		/*	Array of LtpNoticeSlot.	*/
+	unsigned int	ringHead;	/*	Next slot to retrieve.	*/
+	unsigned int	ringTail;	/*	Next slot to fill.	*/
+	int		spilling;	/*	Boolean.		*/
+	unsigned int	spilled;	/*	Notices in list only.	*/
+	int		readinessFdCount;
 } LtpVclient;
 
 /* Database structure */
@@ -577,11 +769,36 @@ typedef struct
 	Object		deadExports;	/*	SDR list: ExportSession	*/
 	Object		spans;		/*	SDR list: LtpSpan	*/
 	Object		timeline;	/*	SDR list: LtpEvent	*/
+
+	/*	Transmission segments, timeline events, client
+	 *	notices, and the reception claims of outbound report
+	 *	segments are allocated from slabs of fixed-size
+	 *	objects rather than from the SDR heap.			*/
+
+	Object		xmitSegSlab;
+	Object		eventSlab;
+	Object		noticeSlab;
+	Object		claimSlab;
 	unsigned int	maxAcqInHeap;
 	unsigned long	heapBytesReserved;
 	unsigned long	heapBytesOccupied;
 	unsigned long	heapSpaceBytesReserved;
 	unsigned long	heapSpaceBytesOccupied;
+
+	/*	To spread its spans over several CPU cores, a node
+	 *	may run shardCount LTP engine instances ("shards"),
+	 *	each one a separate ION node with its own SDR, working
+	 *	memory, ltpclock and link service tasks but all with
+	 *	the same LTP engine ID.  Each shard serves only the
+	 *	spans whose remote engine IDs map to its shardNbr.
+	 *	shardCount is zero for an unsharded engine.  The
+	 *	ltprelay task of each shard listens on the loopback
+	 *	interface at relayPortBase + shardNbr, so that the
+	 *	client API can hide the sharding from applications.	*/
+
+	unsigned int	shardNbr;
+	unsigned int	shardCount;
+	unsigned short	relayPortBase;
 } LtpDB;
 
 /* The volatile database object encapsulates the current volatile state
@@ -608,8 +825,11 @@ typedef struct
 	uvast		ownEngineId;
 	int		lsiPid;		/*	For stopping the LSI.	*/
 	int		clockPid;	/*	For stopping ltpclock.	*/
+	int		relayPid;	/*	For stopping ltprelay.	*/
 	int		watching;	/*	Boolean activity watch.	*/
 	PsmAddress	spans;		/*	SM list: LtpVspan*	*/
+	PsmAddress	spanHash;	/*	Array of vspan elts.	*/
+	LtpSessionCache	exportCache;	/*	Of export sessions.	*/
 	LtpVclient	clients[LTP_MAX_NBR_OF_CLIENTS];
 } LtpVdb;
 
@@ -623,6 +843,8 @@ Object		getLtpDbObject();
 LtpDB		*getLtpConstants();
 LtpVdb		*getLtpVdb();
 
+void		ltpIndexSpan(PsmAddress vspanElt);
+void		ltpUnindexSpan(PsmAddress vspanElt);
 void		findSpan(uvast engineId, LtpVspan **vspan,
  		PsmAddress *vspanElt);
 int		addSpan(uvast engineId,
@@ -652,26 +874,96 @@ int		issueSegments(Sdr sdr, LtpSpan *span, LtpVspan *vspan,
 				Lyst extents, unsigned int reportSerialNbr,
 				unsigned int checkpointSerialNbr);
 
+int		ltpOpenReadinessFifo(char *kind, uvast id);
+void		ltpSignalReadinessFifo(char *kind, uvast id,
+				int *fdCount);
+void		ltpDrainReadinessFifo(int fd);
+
 int		ltpAttachClient(unsigned int clientSvcId);
 void		ltpDetachClient(unsigned int clientSvcId);
 
 int		enqueueNotice(LtpVclient *client,
 				uvast sourceEngineId,
 				unsigned int sessionNbr,
-				unsigned int dataOffset,
-				unsigned int dataLength,
+				uvast dataOffset,
+				uvast dataLength,
 				LtpNoticeType type,
 				unsigned char reasonCode,
 				unsigned char endOfBlock,
 				Object data);
 
 void		computeRetransmissionLimits(LtpVspan *vspan);
-int		getMaxReports(int redPartLength,
+int		getMaxReports(uvast redPartLength,
 				LtpVspan *vspan,
 				int asReceiver);
 
 int		ltpDequeueOutboundSegment(LtpVspan *vspan, char **buf);
 int		ltpHandleInboundSegment(char *buf, int length);
+int		ltpGetSourceEngineId(char *buf, int length,
+				uvast *sourceEngineId);
+unsigned int	ltpShardOf(uvast engineId, unsigned int shardCount);
+unsigned int	ltpShardSessionNbr(unsigned int sessionCount,
+				unsigned int shardNbr,
+				unsigned int shardCount);
+
+/*	An application attached to one shard of a sharded node uses
+ *	spans served by the other shards by way of their ltprelay
+ *	tasks.  Each request to a relay is an LtpRelayMsg, followed
+ *	by dataLength bytes of service data for an LTP_RELAY_SEND or
+ *	of notice data for an LTP_RELAY_NOTICE.  Relays run on the
+ *	same host, so messages are exchanged in native byte order.
+ *
+ *	LTP_RELAY_SEND:	ltp_send_many() of one SDU to span engineId,
+ *			answered by an LtpRelayReply.
+ *	LTP_RELAY_OPEN:	opening of clientSvcId on behalf of shard
+ *			shardNbr, to which the relay forwards all of
+ *			the client's notices; answered by an
+ *			LtpRelayReply.
+ *	LTP_RELAY_CLOSE: closing of clientSvcId.
+ *	LTP_RELAY_NOTICE: a notice forwarded from another shard, to
+ *			be posted to local client clientSvcId.
+ *	LTP_RELAY_WATCH: request to tell shard shardNbr whenever the
+ *			readiness FIFO of span engineId is signaled;
+ *			answered by an LtpRelayReply.
+ *	LTP_RELAY_READY: signal of the readiness FIFO of span
+ *			engineId, forwarded from another shard.	*/
+
+#define	LTP_RELAY_SEND		(1)
+#define	LTP_RELAY_OPEN		(2)
+#define	LTP_RELAY_CLOSE		(3)
+#define	LTP_RELAY_NOTICE	(4)
+#define	LTP_RELAY_WATCH		(5)
+#define	LTP_RELAY_READY		(6)
+
+typedef struct
+{
+	int		type;
+	int		flags;		/*	For LTP_RELAY_SEND.	*/
+	unsigned int	shardNbr;	/*	Of requesting shard.	*/
+	unsigned int	clientSvcId;
+	uvast		engineId;
+	uvast		redPartLength;
+	uvast		dataLength;
+	LtpNotice	notice;		/*	For LTP_RELAY_NOTICE.	*/
+} LtpRelayMsg;
+
+typedef struct
+{
+	int		result;		/*	As from ltp_send_many.	*/
+	LtpSessionId	sessionId;
+} LtpRelayReply;
+
+int		ltpRelayRequest(unsigned int shardNbr, LtpRelayMsg *msg,
+				Object zco, LtpRelayReply *reply);
+void		ltpRelayDisconnect();
+int		ltpRelayWrite(int fd, char *buffer, int length);
+int		ltpRelayRead(int fd, char *buffer, int length);
+int		ltpRelaySendZco(int fd, Object zco, uvast length);
+Object		ltpRelayReceiveZco(int fd, uvast length, ZcoAcct acct,
+				ReqAttendant *attendant);
+int		ltpRelayNotice(unsigned int clientSvcId,
+				LtpNotice *notice);
+void		ltpRelaySpanReadiness(uvast engineId);
 
 void		ltpStartXmit(LtpVspan *vspan);
 void		ltpStopXmit(LtpVspan *vspan);
@@ -690,7 +982,10 @@ int		ltpResendRecvCancel(uvast engineId,
 				unsigned int sessionNbr);
 
 void		ltpSpanTally(LtpVspan *vspan, unsigned int idx,
-				unsigned int size);
+				uvast size);
+void		ltpFlushSpanStats(LtpVspan *vspan);
+void		ltpReadSpanStats(LtpVspan *vspan,
+				LtpSpanStats *stats);
 #if CLOSED_EXPORTS_ENABLED
 void 		ltpForgetClosedExport(Object elt);
 #endif
@@ -83,46 +83,137 @@ int	sda_send(uvast destinationEngineId, unsigned int clientSvcId,
 	return 0;
 }
 
+static int	getSdaItemText(ZcoView *views, int viewCount,
+			uvast bytesHandled, unsigned char **text,
+			vast *length)
+{
+	int	i;
+
+	/*	Locate the view that contains the first unhandled
+	 *	byte of the LTP service data item.  If the text
+	 *	viewed at that point is too short to be certain of
+	 *	containing the next SDA item's client ID and the
+	 *	information needed to delimit the item (because the
+	 *	item straddles the boundary between two views), the
+	 *	text must be copied instead.				*/
+
+	for (i = 0; i < viewCount; i++)
+	{
+		if (bytesHandled < views[i].length)
+		{
+			*text = (unsigned char *) views[i].text + bytesHandled;
+			*length = views[i].length - bytesHandled;
+			return (i == viewCount - 1 || *length >= 2048);
+		}
+
+		bytesHandled -= views[i].length;
+	}
+
+	*length = 0;		/*	No more to acquire.		*/
+	return 1;
+}
+
 static int	receiveSdaItems(SdaDelimiterFn delimiter, SdaHandlerFn handler,
 			Object zco, uvast senderEngineNbr)
 {
 	Sdr		sdr = getIonsdr();
 	uvast		bytesHandled = 0;
+	ZcoView		views[2];
+	int		viewCount;
 	ZcoReader	reader;
 	vast		bytesReceived;
 	unsigned char	buffer[2048];
+	unsigned char	*text;
 	int		offset;
 	uvast		clientId;
 	vast		itemLength;
 	Object		itemZco;
+	int		result = 0;
+
+	/*	The red part of an LTP block is delivered in at most
+	 *	two extents, one in the SDR heap and one in a file;
+	 *	view them in place if possible, to avoid copying the
+	 *	leading bytes of every SDA item.			*/
+
+	viewCount = zco_map_source(sdr, zco, views, 2);
+	if (viewCount < 0)
+	{
+		putErrmsg("Can't view LTP service data item.", NULL);
+		return -1;
+	}
 
-	zco_start_receiving(zco, &reader);
 	while (1)
 	{ 
 		/*	Get the first (up to) 2048 bytes of the
 		 *	unprocessed remainder of the LTP service
-		 *	data item.					*/
+		 *	data item, in place if possible.		*/
 
-		bytesReceived = zco_receive_source(sdr, &reader, sizeof buffer,
-				(char *) buffer);
-		switch (bytesReceived)
+		if (viewCount > 0 && getSdaItemText(views, viewCount,
+				bytesHandled, &text, &bytesReceived))
 		{
-		case -1:
-			putErrmsg("Can't begin acquisition of SDA item.", NULL);
-			return -1;
+			if (bytesReceived == 0)
+			{
+				break;	/*	No more to acquire.	*/
+			}
 
-		case 0:
-			return 0;	/*	No more to acquire.	*/
+			if (bytesReceived > sizeof buffer)
+			{
+				bytesReceived = sizeof buffer;
+			}
+		}
+		else
+		{
+			/*	Copy the text, first skipping over all
+			 *	bytes of the LTP service data item that
+			 *	have already been handled.		*/
+
+			zco_start_receiving(zco, &reader);
+			if (bytesHandled > 0)
+			{
+				bytesReceived = zco_receive_source(sdr,
+						&reader, bytesHandled, NULL);
+				if (bytesReceived < 0)
+				{
+					putErrmsg("Can't skip over handled \
+items.", NULL);
+					result = -1;
+					break;
+				}
+
+				if (bytesReceived == 0)
+				{
+					putSysErrmsg("LTP-SDA block file \
+access error.", NULL);
+					break;	/*	No more to acquire.	*/
+				}
+			}
+
+			bytesReceived = zco_receive_source(sdr, &reader,
+					sizeof buffer, (char *) buffer);
+			if (bytesReceived < 0)
+			{
+				putErrmsg("Can't begin acquisition of SDA \
+item.", NULL);
+				result = -1;
+				break;
+			}
+
+			if (bytesReceived == 0)
+			{
+				break;	/*	No more to acquire.	*/
+			}
+
+			text = buffer;
 		}
 
 		/*	Get the client ID of the client data unit at
-		 *	the start of the buffer.			*/
+		 *	the start of the text.				*/
 
-		offset = decodeSdnv(&clientId, buffer);
+		offset = decodeSdnv(&clientId, text);
 		if (offset == 0)
 		{
 			writeMemo("[?] No SDA item at start of LTP block.");
-			return 0;	/*	No more to acquire.	*/
+			break;		/*	No more to acquire.	*/
 		}
 
 		/*	Skip over the client ID, then call a user
@@ -130,17 +221,19 @@ static int	receiveSdaItems(SdaDelimiterFn delimiter, SdaHandlerFn handler,
 		 *	unit.						*/
 
 		bytesHandled += offset;
-		itemLength = delimiter(clientId, buffer + offset,
+		itemLength = delimiter(clientId, text + offset,
 				bytesReceived - offset);
-		switch (itemLength)
+		if (itemLength == -1)
 		{
-		case -1:
 			putErrmsg("Failure calculating SDA item length.", NULL);
-			return -1;
+			result = -1;
+			break;
+		}
 
-		case 0:
+		if (itemLength == 0)
+		{
 			writeMemo("[?] Invalid SDA item in LTP block.");
-			return 0;	/*	No more to acquire.	*/
+			break;		/*	No more to acquire.	*/
 		}
 
 		/*	Clone the client data unit from the LTP
@@ -150,7 +243,8 @@ static int	receiveSdaItems(SdaDelimiterFn delimiter, SdaHandlerFn handler,
 		if (itemZco == 0)
 		{
 			putErrmsg("Failure extracting SDA item.", NULL);
-			return -1;
+			result = -1;
+			break;
 		}
 
 		/*	Call a user function to handle the client
@@ -159,28 +253,16 @@ static int	receiveSdaItems(SdaDelimiterFn delimiter, SdaHandlerFn handler,
 		if (handler(senderEngineNbr, clientId, itemZco) < 0)
 		{
 			putErrmsg("Failure handling SDA item.", NULL);
-			return -1;
+			result = -1;
+			break;
 		}
 
 		zco_destroy(sdr, itemZco);
 		bytesHandled += itemLength;
-
-		/*	To extract next item, first skip over all
-		 *	bytes of the LTP service data item that have
-		 *	already been handled.				*/
-
-		zco_start_receiving(zco, &reader);
-		switch (zco_receive_source(sdr, &reader, bytesHandled, NULL))
-		{
-		case -1:
-			putErrmsg("Can't skip over handled items.", NULL);
-			return -1;
-
-		case 0:
-			putSysErrmsg("LTP-SDA block file access error.", NULL);
-			return 0;	/*	No more to acquire.	*/
-		}
 	}
+
+	zco_unmap_views(views, viewCount);
+	return result;
 }
 
 int	sda_run(SdaDelimiterFn delimiter, SdaHandlerFn handler)
@@ -191,8 +273,8 @@ int	sda_run(SdaDelimiterFn delimiter, SdaHandlerFn handler)
 	LtpSessionId	sessionId;
 	unsigned char	reasonCode;
 	unsigned char	endOfBlock;
-	unsigned int	dataOffset;
-	unsigned int	dataLength;
+	uvast		dataOffset;
+	uvast		dataLength;
 	Object		data;
 
 	if (ltp_attach() < 0)
@@ -61,7 +61,19 @@ static int	_blocksReceived(int increment)
 	return count;
 
 }
-static int	_bytesReceived(int increment)
+static uvast	_bytesReceived(uvast increment)
+{
+	static uvast	count = 0;
+	
+	if (increment)
+	{
+		count += increment;
+	}
+	
+	return count;
+}
+
+static int	_blocksCorrupt(int increment)
 {
 	static int	count = 0;
 	
@@ -73,6 +85,93 @@ static int	_bytesReceived(int increment)
 	return count;
 }
 
+/*	Red parts of SPARSE_ADU_LENGTH bytes or more are presumed to
+ *	have been sent by ltpdriver from a sparse ADU file, which is
+ *	all zeros except for a landmark at the start of each
+ *	SPARSE_LANDMARK_INTERVAL bytes; such a red part is checked
+ *	byte for byte against that layout.  Keep these definitions
+ *	in step with ltpdriver.c.					*/
+
+#define	SPARSE_ADU_LENGTH		((uvast) 1 << 31)
+#define	SPARSE_LANDMARK_INTERVAL	((uvast) 1 << 28)
+#define	SPARSE_LANDMARK_LENGTH		(32)
+#define	VERIFY_BUFFER_LENGTH		(65536)
+
+static void	fillExpected(char *expected, uvast offset, int length)
+{
+	char	landmark[SPARSE_LANDMARK_LENGTH];
+	uvast	landmarkOffset;
+	uvast	from;
+	uvast	to;
+
+	memset(expected, 0, length);
+	landmarkOffset = offset - (offset % SPARSE_LANDMARK_INTERVAL);
+	while (landmarkOffset < offset + length)
+	{
+		memset(landmark, 0, sizeof landmark);
+		isprintf(landmark, sizeof landmark,
+				"landmark " UVAST_FIELDSPEC, landmarkOffset);
+		from = landmarkOffset > offset ? landmarkOffset : offset;
+		to = landmarkOffset + sizeof landmark;
+		if (to > offset + length)
+		{
+			to = offset + length;
+		}
+
+		if (from < to)
+		{
+			memcpy(expected + (from - offset),
+					landmark + (from - landmarkOffset),
+					(size_t) (to - from));
+		}
+
+		landmarkOffset += SPARSE_LANDMARK_INTERVAL;
+	}
+}
+
+static int	verifySparseBlock(Object data, uvast dataLength)
+{
+	Sdr		sdr = getIonsdr();
+	static char	received[VERIFY_BUFFER_LENGTH];
+	static char	expected[VERIFY_BUFFER_LENGTH];
+	ZcoReader	reader;
+	uvast		offset = 0;
+	vast		length;
+	char		buf[64];
+
+	zco_start_receiving(data, &reader);
+	while (offset < dataLength)
+	{
+		length = VERIFY_BUFFER_LENGTH;
+		if (dataLength - offset < (uvast) length)
+		{
+			length = (vast) (dataLength - offset);
+		}
+
+		CHKERR(sdr_begin_xn(sdr));
+		length = zco_receive_source(sdr, &reader, length, received);
+		sdr_exit_xn(sdr);
+		if (length <= 0)
+		{
+			putErrmsg("Can't read received block.", NULL);
+			return -1;
+		}
+
+		fillExpected(expected, offset, (int) length);
+		if (memcmp(received, expected, (size_t) length) != 0)
+		{
+			isprintf(buf, sizeof buf, UVAST_FIELDSPEC, offset);
+			writeMemoNote("[?] Received block differs from sent \
+block, near offset", buf);
+			return 0;
+		}
+
+		offset += length;
+	}
+
+	return 1;
+}
+
 static void	*showProgress(void *parm)
 {
 	PsmAddress	alarm = (PsmAddress) parm;
@@ -99,9 +198,13 @@ static void	handleQuit()
 
 static void	printCounts()
 {
+	char	buf[64];
+
 	PUTMEMO("Sessions canceled", itoa(_sessionsCanceled(0)));
 	PUTMEMO("Blocks received", itoa(_blocksReceived(0)));
-	PUTMEMO("Bytes received", itoa(_bytesReceived(0)));
+	PUTMEMO("Sparse blocks corrupt", itoa(_blocksCorrupt(0)));
+	isprintf(buf, sizeof buf, UVAST_FIELDSPEC, _bytesReceived(0));
+	PUTMEMO("Bytes received", buf);
 	fflush(stdout);
 }
 
@@ -110,12 +213,12 @@ int	ltpcounter(int a1, int a2, int a3, int a4, int a5,
 		int a6, int a7, int a8, int a9, int a10)
 {
 	int		clientId = a1;
-	int		maxBytes = a2;
+	uvast		maxBytes = (uvast) a2;
 #else
 int	main(int argc, char **argv)
 {
 	int		clientId = (argc > 1 ? strtol(argv[1], NULL, 0) : 0);
-	int		maxBytes = (argc > 2 ? strtol(argv[2], NULL, 0) : 0);
+	uvast		maxBytes = (argc > 2 ? strtouvast(argv[2]) : 0);
 #endif
 	PsmAddress	alarm;
 	pthread_t	progressThread;
@@ -124,8 +227,8 @@ int	main(int argc, char **argv)
 	LtpSessionId	sessionId;
 	unsigned char	reasonCode;
 	unsigned char	endOfBlock;
-	unsigned int	dataOffset;
-	unsigned int	dataLength;
+	uvast		dataOffset;
+	uvast		dataLength;
 	Object		data;
 	char		buffer[255];
 
@@ -206,7 +309,8 @@ source engine " UVAST_FIELDSPEC ", session %u, reason code %d.",
 		case LtpRecvGreenSegment:
 			isprintf(buffer, sizeof buffer, "Green segment \
 received, discarded: source engine " UVAST_FIELDSPEC ", session %u, \
-offset %u, length %u, eob=%d.", sessionId.sourceEngineId, sessionId.sessionNbr,
+offset " UVAST_FIELDSPEC ", length " UVAST_FIELDSPEC ", eob=%d.",
+					sessionId.sourceEngineId, sessionId.sessionNbr,
 					dataOffset, dataLength, endOfBlock);
 			writeMemo(buffer);
 			ltp_release_data(data);
@@ -215,6 +319,12 @@ offset %u, length %u, eob=%d.", sessionId.sourceEngineId, sessionId.sessionNbr,
 		case LtpRecvRedPart:
 			oK(_blocksReceived(1));
 			oK(_bytesReceived(dataLength));
+			if (dataLength >= SPARSE_ADU_LENGTH
+			&& verifySparseBlock(data, dataLength) == 0)
+			{
+				oK(_blocksCorrupt(1));
+			}
+
 			ltp_release_data(data);
 			break;
 
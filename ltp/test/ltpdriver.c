@@ -12,38 +12,101 @@
 #include "ltpP.h"
 
 #define	DEFAULT_ADU_LENGTH	(60000)
+#define	MAX_BATCH_SIZE		(1024)
+#define	SPARSE_ADU_LENGTH	((uvast) 1 << 31)
+
+/*	A sparse ADU file is all zeros except for a landmark at the
+ *	start of each SPARSE_LANDMARK_INTERVAL bytes of the file: the
+ *	landmark's own file offset, as text.  Any red part of at least
+ *	SPARSE_ADU_LENGTH bytes received by ltpcounter is checked
+ *	against this same layout, so a block whose data is misplaced
+ *	-- for example, by an offset truncated to 32 bits -- is
+ *	detected.  Keep these definitions in step with ltpcounter.c.	*/
+
+#define	SPARSE_LANDMARK_INTERVAL	((uvast) 1 << 28)
+#define	SPARSE_LANDMARK_LENGTH		(32)
+
+static int	writeSparseAduFile(int aduFile, uvast fileLength)
+{
+	char	landmark[SPARSE_LANDMARK_LENGTH];
+	uvast	offset;
+	uvast	length;
+
+	if (ftruncate(aduFile, (off_t) fileLength) < 0)
+	{
+		return -1;
+	}
+
+	for (offset = 0; offset < fileLength;
+			offset += SPARSE_LANDMARK_INTERVAL)
+	{
+		memset(landmark, 0, sizeof landmark);
+		isprintf(landmark, sizeof landmark,
+				"landmark " UVAST_FIELDSPEC, offset);
+		length = fileLength - offset;
+		if (length > sizeof landmark)
+		{
+			length = sizeof landmark;
+		}
+
+		if (lseek(aduFile, (off_t) offset, SEEK_SET) < 0
+		|| write(aduFile, landmark, (size_t) length) < 0)
+		{
+			return -1;
+		}
+	}
+
+	return 0;
+}
 
 static int	run_ltpdriver(uvast destEngineId, int clientId,
-			int cyclesRemaining, int greenLength, int sduLength)
+			int cyclesRemaining, int greenLength, uvast sduLength,
+			int batchSize)
 {
 	static char	buffer[DEFAULT_ADU_LENGTH] = "test...";
+	static Object	zcos[MAX_BATCH_SIZE];
+	static uvast	redLengths[MAX_BATCH_SIZE];
+	static LtpSessionId
+			sessionIds[MAX_BATCH_SIZE];
+	static uvast	sduLengths[MAX_BATCH_SIZE];
+	int		batchLength;
+	int		sduSent;
+	int		i;
 	Sdr		sdr;
 	int		running = 1;
 	int		aduFile;
 	int		randomSduLength = 0;
-	int		bytesRemaining;
+	uvast		bytesRemaining;
 	int		bytesToWrite;
 	Object		fileRef;
-	Object		zco;
-	LtpSessionId	sessionId;
-	int		bytesSent = 0;
+	uvast		bytesSent = 0;
+	char		buf[64];
 	time_t		startTime;
-	int		redLength;
 	time_t		endTime;
 	long		interval;
 	int		cycles = cyclesRemaining;
 
 	if (destEngineId == 0 || clientId < 1
-	|| cyclesRemaining < 1 || greenLength < 0 || sduLength < 1)
+	|| cyclesRemaining < 1 || greenLength < 0 || sduLength < 1
+	|| batchSize < 1 || batchSize > MAX_BATCH_SIZE)
 	{
 		PUTS("Usage: ltpdriver <destination engine ID> <client ID> \
-<number of cycles> <'green' length> [<payload size>]");
+<number of cycles> <'green' length> [<payload size> [<batch size>]]");
 		PUTS("  Payload size defaults to 60000 bytes.");
 		PUTS("");
 		PUTS("  To use payload sizes chosen at random from the");
 	       	PUTS("	range 1024 to 62464, in multiples of 1024,");
 	       	PUTS("	specify payload size 1.");
 		PUTS("");
+		PUTS("  Payload sizes of 2 GB and more are sent from a");
+		PUTS("	sparse file, of which only a small landmark in");
+		PUTS("	every 256 MB is actually written to disk.");
+		PUTS("");
+		PUTS("  Batch size defaults to 1, i.e., one SDU per call");
+		PUTS("  to ltp_send.  Batch sizes up to 1024 cause that");
+		PUTS("  many SDUs to be passed to each call to");
+		PUTS("  ltp_send_many.");
+		PUTS("");
 		PUTS("  Expected destination (receiving) application is");
 		PUTS("  ltpcounter.");
 		return 0;
@@ -61,7 +124,8 @@ static int	run_ltpdriver(uvast destEngineId, int clientId,
 		randomSduLength = 1;
 	}
 
-	aduFile = open("ltpdriverSduFile", O_WRONLY | O_CREAT, 0666);
+	aduFile = open("ltpdriverSduFile", O_WRONLY | O_CREAT | O_TRUNC,
+			0666);
 	if (aduFile < 0)
 	{
 		putSysErrmsg("Can't create ADU file", NULL);
@@ -72,6 +136,22 @@ static int	run_ltpdriver(uvast destEngineId, int clientId,
 	{
 		bytesRemaining = 65536;
 	}
+	else if (sduLength >= SPARSE_ADU_LENGTH)
+	{
+		/*	Write only landmarks and leave the rest of the
+		 *	file as holes, so that blocks whose geometry
+		 *	exceeds 32 bits can be tested without writing
+		 *	gigabytes of data to disk.			*/
+
+		if (writeSparseAduFile(aduFile, sduLength) < 0)
+		{
+			close(aduFile);
+			putSysErrmsg("Error extending sparse ADU file", NULL);
+			return 0;
+		}
+
+		bytesRemaining = 0;
+	}
 	else
 	{
 		bytesRemaining = sduLength;
@@ -81,7 +161,7 @@ static int	run_ltpdriver(uvast destEngineId, int clientId,
 	{
 		if (bytesRemaining < DEFAULT_ADU_LENGTH)
 		{
-			bytesToWrite = bytesRemaining;
+			bytesToWrite = (int) bytesRemaining;
 		}
 		else
 		{
@@ -112,49 +192,98 @@ static int	run_ltpdriver(uvast destEngineId, int clientId,
 	startTime = time(NULL);
 	while (running && cyclesRemaining > 0)
 	{
-		if (randomSduLength)
+		batchLength = 0;
+		while (batchLength < batchSize
+		&& batchLength < cyclesRemaining)
 		{
-			sduLength = ((rand() % 60) + 1) * 1024;
-		}
+			if (randomSduLength)
+			{
+				sduLength = ((rand() % 60) + 1) * 1024;
+			}
 
-		redLength = sduLength - greenLength;
-		if (redLength < 0)
-		{
-			redLength = 0;
+			sduLengths[batchLength] = sduLength;
+			redLengths[batchLength] = sduLength
+					- (uvast) greenLength;
+			if (sduLength < (uvast) greenLength)
+			{
+				redLengths[batchLength] = 0;
+			}
+
+			zcos[batchLength] = ionCreateZco(ZcoFileSource,
+					fileRef, 0, sduLength, 0, 0,
+					ZcoOutbound, NULL);
+			if (zcos[batchLength] == 0
+			|| zcos[batchLength] == (Object) ERROR)
+			{
+				putErrmsg("ltpdriver can't create ZCO.", NULL);
+				running = 0;
+				break;
+			}
+
+			batchLength++;
 		}
 
-		zco = ionCreateZco(ZcoFileSource, fileRef, 0, sduLength, 0,
-				0, ZcoOutbound, NULL);
-		if (zco == 0 || zco == (Object) ERROR)
+		if (batchLength == 0)
 		{
-			putErrmsg("ltpdriver can't create ZCO.", NULL);
-			running = 0;
 			continue;
 		}
 
-		switch (ltp_send(destEngineId, clientId, zco, redLength,
-				&sessionId))
+		if (batchSize == 1)
 		{
-		case 0:
-			putErrmsg("ltpdriver can't send SDU.",
-					itoa(sduLength));
-			break;		/*	Out of switch.		*/
+			sduSent = ltp_send(destEngineId, clientId, zcos[0],
+					redLengths[0], sessionIds);
+		}
+		else
+		{
+			sduSent = ltp_send_many(destEngineId, clientId, zcos,
+					redLengths, batchLength, sessionIds, 0);
+		}
 
-		case -1:
+		if (sduSent < 0)
+		{
 			putErrmsg("ltp_send failed.", NULL);
+			sduSent = 0;	/*	Nothing was sent.	*/
 			running = 0;
-			continue;
 		}
+		else if (sduSent < batchLength)
+		{
+			/*	Transmission on the span was stopped.	*/
 
-		bytesSent += sduLength;
+			putErrmsg("ltpdriver can't send SDU.",
+					itoa(batchLength - sduSent));
+			running = 0;
+		}
+
+		/*	LTP took ownership only of the SDUs that were
+		 *	sent, so the rest of the batch is destroyed.	*/
+
+		if (sduSent < batchLength)
+		{
+			CHKZERO(sdr_begin_xn(sdr));
+			for (i = sduSent; i < batchLength; i++)
+			{
+				zco_destroy(sdr, zcos[i]);
+			}
+
+			if (sdr_end_xn(sdr) < 0)
+			{
+				putErrmsg("ltpdriver can't destroy unsent SDUs.",
+						NULL);
+			}
+		}
+
+		for (i = 0; i < sduSent; i++)
+		{
+			bytesSent += sduLengths[i];
 //putchar('^');
 //fflush(stdout);
-		cyclesRemaining--;
-		if ((cyclesRemaining % 100) == 0)
-		{
+			cyclesRemaining--;
+			if ((cyclesRemaining % 100) == 0)
+			{
 //sdr_clear_trace(sdr);
 //sdr_print_trace(sdr, 0);
-			PUTS(itoa(cyclesRemaining));
+				PUTS(itoa(cyclesRemaining));
+			}
 		}
 	}
 
@@ -168,19 +297,23 @@ static int	run_ltpdriver(uvast destEngineId, int clientId,
 	}
 	else
 	{
-		PUTMEMO("Data size (bytes)", itoa(sduLength));
+		isprintf(buf, sizeof buf, UVAST_FIELDSPEC, sduLength);
+		PUTMEMO("Data size (bytes)", buf);
 	}
 
 	PUTMEMO("Cycles", itoa(cycles));
-	PUTMEMO("Bytes", itoa(bytesSent));
+	PUTMEMO("SDUs per call", itoa(batchSize));
+	isprintf(buf, sizeof buf, UVAST_FIELDSPEC, bytesSent);
+	PUTMEMO("Bytes", buf);
 	if (interval <= 0)
 	{
 		PUTS("Interval is too short to measure rate.");
 	}
 	else
 	{
-		PUTMEMO("Throughput (bytes per second)",
-				itoa(bytesSent / interval));
+		isprintf(buf, sizeof buf, UVAST_FIELDSPEC,
+				bytesSent / (uvast) interval);
+		PUTMEMO("Throughput (bytes per second)", buf);
 	}
 
 //sdr_stop_trace(sdr);
@@ -203,7 +336,8 @@ int	ltpdriver(int a1, int a2, int a3, int a4, int a5,
 	int		clientId = a2;
 	int		cycles = a3;
 	int		greenLen = a4;
-	int		aduLen = (a5 == 0 ? DEFAULT_ADU_LENGTH : a5);
+	uvast		aduLen = (a5 == 0 ? DEFAULT_ADU_LENGTH : (uvast) a5);
+	int		batchSize = (a6 == 0 ? 1 : a6);
 #else
 int	main(int argc, char **argv)
 {
@@ -211,13 +345,17 @@ int	main(int argc, char **argv)
 	int		clientId = 0;
 	int		cycles = 0;
 	int		greenLen = 0;
-	int		aduLen = DEFAULT_ADU_LENGTH;
+	uvast		aduLen = DEFAULT_ADU_LENGTH;
+	int		batchSize = 1;
 
-	if (argc > 6) argc = 6;
+	if (argc > 7) argc = 7;
 	switch (argc)
 	{
+	case 7:
+	  	batchSize = strtol(argv[6], NULL, 0);
+
 	case 6:
-	  	aduLen = strtol(argv[5], NULL, 0);
+	  	aduLen = strtouvast(argv[5]);
 
 	case 5:
 	  	greenLen = strtol(argv[4], NULL, 0);
@@ -235,5 +373,6 @@ int	main(int argc, char **argv)
 		break;
 	}
 #endif
-	return run_ltpdriver(destEngineId, clientId, cycles, greenLen, aduLen);
+	return run_ltpdriver(destEngineId, clientId, cycles, greenLen, aduLen,
+			batchSize);
 }
@@ -0,0 +1,334 @@
+/*
+	ltpshardtest.c:	sharded segment dispatch test.  Exercises
+			the routing of inbound segments among the
+			LTP engine instances ("shards") of a sharded
+			node, as performed by udplsi: each synthetic
+			segment is routed by its source engine ID and
+			forwarded over the loopback interface to the
+			socket of the shard that serves that engine,
+			where it must arrive unaltered.  Segments
+			with truncated or invalid headers must not be
+			routed.  Also checks that the shards number
+			their export sessions in disjoint ranges.  ION
+			need not be running.
+									*/
+
+#include "platform.h"
+#include "ltpP.h"
+
+#define	DEFAULT_PORT_BASE	(21113)
+#define	MAX_SHARDS		(8)
+#define	ENGINES			(1000)
+#define	SEGMENT_LENGTH		(64)
+
+static int	buildSegment(char *buf, uvast engineId, unsigned int sessionNbr)
+{
+	Sdnv	sdnv;
+	int	length = 0;
+	int	i;
+
+	buf[length++] = 0x00;		/*	Version 0, red data.	*/
+	encodeSdnv(&sdnv, engineId);
+	memcpy(buf + length, sdnv.text, sdnv.length);
+	length += sdnv.length;
+	encodeSdnv(&sdnv, sessionNbr);
+	memcpy(buf + length, sdnv.text, sdnv.length);
+	length += sdnv.length;
+	for (i = length; i < SEGMENT_LENGTH; i++)
+	{
+		buf[i] = (char) (i + sessionNbr);
+	}
+
+	return SEGMENT_LENGTH;
+}
+
+static int	checkUnroutable(char *buf, int length, char *what)
+{
+	uvast	engineId = 0;
+
+	if (ltpGetSourceEngineId(buf, length, &engineId) != 0)
+	{
+		putErrmsg("Unroutable segment was routed.", what);
+		return -1;
+	}
+
+	return 0;
+}
+
+static int	checkHeaders()
+{
+	char	buf[SEGMENT_LENGTH];
+	uvast	engineId;
+
+	/*	Source engine ID SDNV runs off the end of the segment.	*/
+
+	buf[0] = 0x00;
+	buf[1] = (char) 0x81;
+	buf[2] = (char) 0x82;
+	if (checkUnroutable(buf, 3, "truncated SDNV") < 0)
+	{
+		return -1;
+	}
+
+	/*	Segment too short to have a source engine ID.		*/
+
+	if (checkUnroutable(buf, 1, "no SDNV") < 0)
+	{
+		return -1;
+	}
+
+	/*	Not LTP version 0.					*/
+
+	buildSegment(buf, 7, 1);
+	buf[0] = 0x10;
+	if (checkUnroutable(buf, SEGMENT_LENGTH, "version 1") < 0)
+	{
+		return -1;
+	}
+
+	/*	Largest engine ID.					*/
+
+	buildSegment(buf, (uvast) -1, 1);
+	if (ltpGetSourceEngineId(buf, SEGMENT_LENGTH, &engineId) != 1
+	|| engineId != (uvast) -1)
+	{
+		putErrmsg("Largest engine ID was misread.", NULL);
+		return -1;
+	}
+
+	return 0;
+}
+
+/*	Every session number that a shard assigns must lie within
+ *	that shard's own range, so that no two shards ever assign the
+ *	same session number, and must be nonzero.			*/
+
+static int	checkSessionNbrs(unsigned int shardCount)
+{
+	unsigned int	samples[] = { 0, 1, 2, 1000, 65535, 65536,
+				(unsigned int) -2, (unsigned int) -1 };
+	unsigned int	range = ((unsigned int) -1) / shardCount;
+	unsigned int	shardNbr;
+	unsigned int	sessionNbr;
+	unsigned int	prevNbr;
+	unsigned int	first;
+	unsigned int	i;
+
+	for (shardNbr = 0; shardNbr < shardCount; shardNbr++)
+	{
+		first = shardNbr * range;
+		for (i = 0; i < sizeof samples / sizeof(unsigned int); i++)
+		{
+			sessionNbr = ltpShardSessionNbr(samples[i], shardNbr,
+					shardCount);
+			if (sessionNbr == 0 || sessionNbr <= first
+			|| sessionNbr - first >= range)
+			{
+				putErrmsg("Session number outside shard's \
+range.", utoa(samples[i]));
+				return -1;
+			}
+		}
+
+		/*	Consecutive session counts yield distinct
+		 *	session numbers.				*/
+
+		prevNbr = ltpShardSessionNbr(0, shardNbr, shardCount);
+		for (i = 1; i < 1000; i++)
+		{
+			sessionNbr = ltpShardSessionNbr(i, shardNbr,
+					shardCount);
+			if (sessionNbr != prevNbr + 1)
+			{
+				putErrmsg("Session numbers not consecutive.",
+						utoa(i));
+				return -1;
+			}
+
+			prevNbr = sessionNbr;
+		}
+	}
+
+	return 0;
+}
+
+static int	openShardSocket(unsigned short portNbr)
+{
+	int			fd;
+	struct sockaddr_in	name;
+	struct timeval		timeout = { 1, 0 };
+
+	fd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	if (fd < 0)
+	{
+		putSysErrmsg("Can't open shard socket", NULL);
+		return -1;
+	}
+
+	memset((char *) &name, 0, sizeof name);
+	name.sin_family = AF_INET;
+	name.sin_port = htons(portNbr);
+	name.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	if (bind(fd, (struct sockaddr *) &name, sizeof name) < 0
+	|| setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, (char *) &timeout,
+			sizeof timeout) < 0)
+	{
+		putSysErrmsg("Can't bind shard socket", itoa(portNbr));
+		close(fd);
+		return -1;
+	}
+
+	return fd;
+}
+
+static int	runDispatch(unsigned int shardCount, unsigned short portBase)
+{
+	int			sockets[MAX_SHARDS];
+	int			dispatchSocket;
+	unsigned int		i;
+	unsigned int		shardNbr;
+	uvast			engineId;
+	uvast			routedId;
+	char			sent[SEGMENT_LENGTH];
+	char			received[SEGMENT_LENGTH + 1];
+	int			length;
+	struct sockaddr_in	shardName;
+	int			result = 0;
+
+	for (i = 0; i < shardCount; i++)
+	{
+		sockets[i] = openShardSocket(portBase + i);
+		if (sockets[i] < 0)
+		{
+			while (i > 0)
+			{
+				close(sockets[--i]);
+			}
+
+			return -1;
+		}
+	}
+
+	dispatchSocket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	if (dispatchSocket < 0)
+	{
+		putSysErrmsg("Can't open dispatch socket", NULL);
+		result = -1;
+	}
+
+	/*	Engine IDs span SDNV lengths of one to ten bytes.	*/
+
+	for (i = 0; result == 0 && i < ENGINES; i++)
+	{
+		engineId = ((uvast) i * 2654435761U) << (i % 33);
+		length = buildSegment(sent, engineId, i);
+		if (ltpGetSourceEngineId(sent, length, &routedId) != 1
+		|| routedId != engineId)
+		{
+			putErrmsg("Source engine ID was misread.", utoa(i));
+			result = -1;
+			break;
+		}
+
+		shardNbr = ltpShardOf(routedId, shardCount);
+		if (shardNbr != engineId % shardCount)
+		{
+			putErrmsg("Segment routed to wrong shard.", utoa(i));
+			result = -1;
+			break;
+		}
+
+		memset((char *) &shardName, 0, sizeof shardName);
+		shardName.sin_family = AF_INET;
+		shardName.sin_port = htons(portBase + shardNbr);
+		shardName.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		if (sendto(dispatchSocket, sent, length, 0,
+				(struct sockaddr *) &shardName,
+				sizeof shardName) < 0)
+		{
+			putSysErrmsg("Can't forward segment", utoa(i));
+			result = -1;
+			break;
+		}
+
+		if (recv(sockets[shardNbr], received, sizeof received, 0)
+				!= length
+		|| memcmp(sent, received, length) != 0)
+		{
+			putErrmsg("Forwarded segment not received intact.",
+					utoa(i));
+			result = -1;
+			break;
+		}
+	}
+
+	if (dispatchSocket >= 0)
+	{
+		close(dispatchSocket);
+	}
+
+	for (i = 0; i < shardCount; i++)
+	{
+		close(sockets[i]);
+	}
+
+	return result;
+}
+
+#if defined (ION_LWT)
+int	ltpshardtest(int a1, int a2, int a3, int a4, int a5,
+		int a6, int a7, int a8, int a9, int a10)
+{
+	int		portBase = a1;
+#else
+int	main(int argc, char **argv)
+{
+	int		portBase = (argc > 1 ? atoi(argv[1]) : 0);
+#endif
+	unsigned int	shardCount;
+	int		result = 0;
+
+	if (portBase == 0)
+	{
+		portBase = DEFAULT_PORT_BASE;
+	}
+
+	if (portBase < 1024 || portBase > 65535 - MAX_SHARDS)
+	{
+		putErrmsg("Invalid shard port number base.", itoa(portBase));
+		writeErrmsgMemos();
+		return 1;
+	}
+
+	if (checkHeaders() < 0)
+	{
+		result = 1;
+	}
+
+	for (shardCount = 2; result == 0 && shardCount <= MAX_SHARDS;
+			shardCount++)
+	{
+		if (runDispatch(shardCount, portBase) < 0
+		|| checkSessionNbrs(shardCount) < 0)
+		{
+			result = 1;
+		}
+	}
+
+	if (ltpShardOf(12345, 0) != 0 || ltpShardOf(12345, 1) != 0)
+	{
+		putErrmsg("Unsharded engine routed to a shard.", NULL);
+		result = 1;
+	}
+
+	if (ltpShardSessionNbr(12345, 0, 0) != 12345)
+	{
+		putErrmsg("Unsharded engine's session number changed.", NULL);
+		result = 1;
+	}
+
+	writeErrmsgMemos();
+	PUTS(result == 0 ? "Shard dispatch test passed."
+			: "Shard dispatch test FAILED.");
+	return result;
+}
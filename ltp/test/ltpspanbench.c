@@ -0,0 +1,209 @@
+/*
+	ltpspanbench.c:	span lookup benchmark.  Measures the cost
+			of finding the span for an inbound segment's
+			source engine, which is incurred for every
+			segment received and every SDU sent, as the
+			number of spans grows.  The hashed lookup of
+			findSpan is compared with a walk of the list
+			of spans, which was how spans used to be found.
+									*/
+
+#include "platform.h"
+#include "ltpP.h"
+
+#define	DEFAULT_MAX_SPANS	(4096)
+#define	DEFAULT_LOOKUPS		(100000)
+
+/*	Engine IDs of the synthetic spans are well above any that a
+ *	real node would be configured with.				*/
+
+#define	BENCH_ENGINE_ID(i)	(((uvast) 1 << 40) + ((uvast) (i) * 7))
+
+static PsmAddress	walkSpans(uvast engineId)
+{
+	PsmPartition	ltpwm = getIonwm();
+	PsmAddress	elt;
+	LtpVspan	*vspan;
+
+	for (elt = sm_list_first(ltpwm, getLtpVdb()->spans); elt;
+			elt = sm_list_next(ltpwm, elt))
+	{
+		vspan = (LtpVspan *) psp(ltpwm, sm_list_data(ltpwm, elt));
+		if (vspan->engineId == engineId)
+		{
+			break;
+		}
+	}
+
+	return elt;
+}
+
+static int	addSyntheticSpan(unsigned int i)
+{
+	PsmPartition	ltpwm = getIonwm();
+	PsmAddress	addr;
+	LtpVspan	*vspan;
+	PsmAddress	vspanElt;
+
+	addr = psm_zalloc(ltpwm, sizeof(LtpVspan));
+	if (addr == 0)
+	{
+		return -1;
+	}
+
+	vspan = (LtpVspan *) psp(ltpwm, addr);
+	memset((char *) vspan, 0, sizeof(LtpVspan));
+	vspan->engineId = BENCH_ENGINE_ID(i);
+	vspanElt = sm_list_insert_last(ltpwm, getLtpVdb()->spans, addr);
+	if (vspanElt == 0)
+	{
+		psm_free(ltpwm, addr);
+		return -1;
+	}
+
+	ltpIndexSpan(vspanElt);
+	return 0;
+}
+
+static void	removeSyntheticSpans(unsigned int count)
+{
+	PsmPartition	ltpwm = getIonwm();
+	unsigned int	i;
+	LtpVspan	*vspan;
+	PsmAddress	vspanElt;
+	PsmAddress	addr;
+
+	for (i = 0; i < count; i++)
+	{
+		findSpan(BENCH_ENGINE_ID(i), &vspan, &vspanElt);
+		if (vspanElt == 0)
+		{
+			continue;
+		}
+
+		addr = sm_list_data(ltpwm, vspanElt);
+		ltpUnindexSpan(vspanElt);
+		oK(sm_list_delete(ltpwm, vspanElt, NULL, NULL));
+		psm_free(ltpwm, addr);
+	}
+}
+
+static double	nsecPerLookup(struct timeval *start, struct timeval *end,
+			unsigned int lookups)
+{
+	double	usec;
+
+	usec = ((end->tv_sec - start->tv_sec) * 1000000.0)
+			+ (end->tv_usec - start->tv_usec);
+	return (usec * 1000.0) / lookups;
+}
+
+#if defined (ION_LWT)
+int	ltpspanbench(int a1, int a2, int a3, int a4, int a5,
+		int a6, int a7, int a8, int a9, int a10)
+{
+	unsigned int	maxSpans = (unsigned int) a1;
+	unsigned int	lookups = (unsigned int) a2;
+#else
+int	main(int argc, char **argv)
+{
+	unsigned int	maxSpans = (argc > 1 ? strtoul(argv[1], NULL, 0) : 0);
+	unsigned int	lookups = (argc > 2 ? strtoul(argv[2], NULL, 0) : 0);
+#endif
+	Sdr		sdr;
+	unsigned int	spanCount = 0;
+	unsigned int	trialSpans;
+	unsigned int	i;
+	LtpVspan	*vspan;
+	PsmAddress	vspanElt;
+	PsmAddress	found = 0;
+	struct timeval	start;
+	struct timeval	end;
+	double		hashed;
+	double		walked;
+	int		result = 0;
+
+	if (maxSpans == 0)
+	{
+		maxSpans = DEFAULT_MAX_SPANS;
+	}
+
+	if (lookups == 0)
+	{
+		lookups = DEFAULT_LOOKUPS;
+	}
+
+	if (ltpAttach() < 0)
+	{
+		putErrmsg("ltpspanbench can't initialize LTP.", NULL);
+		return 1;
+	}
+
+	/*	The synthetic spans must never be seen by any other
+	 *	LTP task, so the ION lock is held throughout.		*/
+
+	sdr = getIonsdr();
+	if (sdr_begin_xn(sdr) == 0)
+	{
+		putErrmsg("ltpspanbench can't lock LTP.", NULL);
+		return 1;
+	}
+
+	PUTS("   spans   hashed ns/lookup   list walk ns/lookup");
+	for (trialSpans = 1; trialSpans <= maxSpans; trialSpans *= 2)
+	{
+		while (spanCount < trialSpans)
+		{
+			if (addSyntheticSpan(spanCount) < 0)
+			{
+				putErrmsg("Can't add synthetic span.",
+						utoa(spanCount));
+				result = 1;
+				break;
+			}
+
+			spanCount++;
+		}
+
+		if (result)
+		{
+			break;
+		}
+
+		/*	Look up spans in a scattered order, so that
+		 *	on average half of the list must be walked.	*/
+
+		getCurrentTime(&start);
+		for (i = 0; i < lookups; i++)
+		{
+			findSpan(BENCH_ENGINE_ID((i * 7919) % trialSpans),
+					&vspan, &vspanElt);
+			found += vspanElt;
+		}
+
+		getCurrentTime(&end);
+		hashed = nsecPerLookup(&start, &end, lookups);
+		getCurrentTime(&start);
+		for (i = 0; i < lookups; i++)
+		{
+			found += walkSpans(BENCH_ENGINE_ID((i * 7919)
+					% trialSpans));
+		}
+
+		getCurrentTime(&end);
+		walked = nsecPerLookup(&start, &end, lookups);
+		printf("%8u %18.1f %21.1f\n", trialSpans, hashed, walked);
+		fflush(stdout);
+	}
+
+	removeSyntheticSpans(spanCount);
+	sdr_exit_xn(sdr);
+	if (found == 0)		/*	Defeat optimization.		*/
+	{
+		PUTS("No spans were found.");
+	}
+
+	writeErrmsgMemos();
+	ionDetach();
+	return result;
+}
@@ -0,0 +1,432 @@
+/*
+	sdrulisttest.c:	SDR unrolled list exerciser.  Checks pushes
+			and pops at both ends of unrolled lists of
+			every length up to several chunks, traversal
+			by cursor in both directions, a long random
+			sequence of pushes and pops checked against
+			a model of the list, and destruction of a
+			list with a delete function.  The lists are
+			built in a private SDR in memory, so ION need
+			not be running.
+									*/
+
+#include "platform.h"
+#include "sdr.h"
+#include "sdrulist.h"
+
+#define	TEST_SDR_NAME		"sdrulisttest"
+#define	TEST_SDR_WM_SIZE	(4000000)
+#define	TEST_SDR_HEAP_WORDS	(500000)
+
+/*	Lists of up to MAX_BOUNDARY_ITEMS items span several chunks
+ *	of any likely size, so every way of crossing a chunk boundary
+ *	is exercised.							*/
+
+#define	MAX_BOUNDARY_ITEMS	(200)
+#define	RANDOM_OPS		(100000)
+#define	RANDOM_PHASE		(5000)
+#define	RANDOM_CHECK		(1000)
+#define	MAX_ITEMS		(RANDOM_OPS + MAX_BOUNDARY_ITEMS)
+#define	DESTROY_ITEMS		(1000)
+
+/*	The model of the list is a run of items in an array that is
+ *	large enough for the run to grow in either direction for the
+ *	whole of the test.						*/
+
+typedef struct
+{
+	Address		items[(2 * MAX_ITEMS) + 1];
+	int		head;
+	int		count;
+} ListModel;
+
+typedef struct
+{
+	long		count;
+	uvast		sum;
+} DeleteTally;
+
+static ListModel	model;
+
+static void	resetModel()
+{
+	model.head = MAX_ITEMS;
+	model.count = 0;
+}
+
+static int	pushItem(Sdr sdr, Object list, Address item, int atFront)
+{
+	if (atFront)
+	{
+		if (sdr_ulist_push_first(sdr, list, item) < 0)
+		{
+			putErrmsg("Can't push first.", NULL);
+			return -1;
+		}
+
+		model.head--;
+		model.items[model.head] = item;
+	}
+	else
+	{
+		if (sdr_ulist_push_last(sdr, list, item) < 0)
+		{
+			putErrmsg("Can't push last.", NULL);
+			return -1;
+		}
+
+		model.items[model.head + model.count] = item;
+	}
+
+	model.count++;
+	return 0;
+}
+
+static int	popItem(Sdr sdr, Object list, int atFront)
+{
+	Address	item;
+	Address	expected = 0;
+
+	if (atFront)
+	{
+		item = sdr_ulist_pop_first(sdr, list);
+		if (model.count > 0)
+		{
+			expected = model.items[model.head];
+			model.head++;
+		}
+	}
+	else
+	{
+		item = sdr_ulist_pop_last(sdr, list);
+		if (model.count > 0)
+		{
+			expected = model.items[model.head + model.count - 1];
+		}
+	}
+
+	if (item != expected)
+	{
+		putErrmsg("Popped wrong item.", itoa(model.count));
+		return -1;
+	}
+
+	if (model.count > 0)
+	{
+		model.count--;
+	}
+
+	return 0;
+}
+
+static int	checkList(Sdr sdr, Object list)
+{
+	SdrUlistCursor	cursor;
+	Address		item;
+	int		i;
+	int		j;
+
+	if (sdr_ulist_length(sdr, list) != model.count)
+	{
+		putErrmsg("Wrong list length.", itoa(model.count));
+		return -1;
+	}
+
+	/*	Forward traversal, stepping back and forth at each
+	 *	item so that the cursor crosses every chunk boundary
+	 *	in both directions.					*/
+
+	item = sdr_ulist_first(sdr, list, &cursor);
+	for (i = 0; i < model.count; i++)
+	{
+		if (item != model.items[model.head + i])
+		{
+			putErrmsg("Wrong item traversing forward.", itoa(i));
+			return -1;
+		}
+
+		if (i > 0)
+		{
+			if (sdr_ulist_prev(sdr, &cursor)
+					!= model.items[model.head + i - 1]
+			|| sdr_ulist_next(sdr, &cursor) != item)
+			{
+				putErrmsg("Cursor can't reverse.", itoa(i));
+				return -1;
+			}
+		}
+
+		item = sdr_ulist_next(sdr, &cursor);
+	}
+
+	if (item != 0)
+	{
+		putErrmsg("Item past end of list.", itoa(model.count));
+		return -1;
+	}
+
+	item = sdr_ulist_last(sdr, list, &cursor);
+	for (j = model.count - 1; j >= 0; j--)
+	{
+		if (item != model.items[model.head + j])
+		{
+			putErrmsg("Wrong item traversing backward.", itoa(j));
+			return -1;
+		}
+
+		item = sdr_ulist_prev(sdr, &cursor);
+	}
+
+	if (item != 0)
+	{
+		putErrmsg("Item before start of list.", itoa(model.count));
+		return -1;
+	}
+
+	if (sdr_ulist_first(sdr, list, NULL)
+			!= (model.count ? model.items[model.head] : 0)
+	|| sdr_ulist_last(sdr, list, NULL) != (model.count
+			? model.items[model.head + model.count - 1] : 0))
+	{
+		putErrmsg("Wrong end item.", itoa(model.count));
+		return -1;
+	}
+
+	return 0;
+}
+
+static int	runBoundaries(Sdr sdr)
+{
+	Object	list;
+	int	n;
+	int	i;
+	int	result = 0;
+
+	for (n = 0; result == 0 && n <= MAX_BOUNDARY_ITEMS; n++)
+	{
+		CHKERR(sdr_begin_xn(sdr));
+		list = sdr_ulist_create(sdr);
+		if (list == 0)
+		{
+			putErrmsg("Can't create list.", NULL);
+			sdr_cancel_xn(sdr);
+			return -1;
+		}
+
+		/*	Grow the list at both ends, then check it.	*/
+
+		resetModel();
+		for (i = 1; result == 0 && i <= n; i++)
+		{
+			result = pushItem(sdr, list, (Address) i, i & 1);
+		}
+
+		if (result == 0)
+		{
+			result = checkList(sdr, list);
+		}
+
+		/*	Shrink the list from alternate ends until it
+		 *	is empty, then pop from the empty list.		*/
+
+		for (i = 0; result == 0 && i < n; i++)
+		{
+			result = popItem(sdr, list, i & 1);
+		}
+
+		if (result == 0)
+		{
+			result = checkList(sdr, list);
+		}
+
+		if (result == 0)
+		{
+			result = popItem(sdr, list, 0);
+		}
+
+		if (result == 0)
+		{
+			result = popItem(sdr, list, 1);
+		}
+
+		sdr_ulist_destroy(sdr, list, NULL, NULL);
+		if (sdr_end_xn(sdr) < 0)
+		{
+			putErrmsg("Can't end boundary test.", itoa(n));
+			return -1;
+		}
+	}
+
+	return result;
+}
+
+static int	runRandom(Sdr sdr)
+{
+	Object	list;
+	Address	nextItem = 1;
+	int	growing = 1;
+	int	i;
+	int	result = 0;
+
+	srand(1);
+	CHKERR(sdr_begin_xn(sdr));
+	list = sdr_ulist_create(sdr);
+	if (list == 0)
+	{
+		putErrmsg("Can't create list.", NULL);
+		sdr_cancel_xn(sdr);
+		return -1;
+	}
+
+	resetModel();
+	for (i = 1; result == 0 && i <= RANDOM_OPS; i++)
+	{
+		/*	Alternate between phases in which pushes are
+		 *	more likely than pops and vice versa, so the
+		 *	list both grows long and empties out.		*/
+
+		if ((i % RANDOM_PHASE) == 0)
+		{
+			growing = !growing;
+		}
+
+		if ((rand() % 10) < (growing ? 7 : 3))
+		{
+			result = pushItem(sdr, list, nextItem++, rand() & 1);
+		}
+		else
+		{
+			result = popItem(sdr, list, rand() & 1);
+		}
+
+		if (result == 0 && (i % RANDOM_CHECK) == 0)
+		{
+			result = checkList(sdr, list);
+		}
+	}
+
+	sdr_ulist_destroy(sdr, list, NULL, NULL);
+	if (sdr_end_xn(sdr) < 0)
+	{
+		putErrmsg("Can't end random test.", NULL);
+		return -1;
+	}
+
+	return result;
+}
+
+static void	tallyItem(Sdr sdr, Address data, void *arg)
+{
+	DeleteTally	*tally = (DeleteTally *) arg;
+
+	tally->count++;
+	tally->sum += data;
+}
+
+static long	heapFree(Sdr sdr)
+{
+	SdrUsageSummary	usage;
+
+	CHKERR(sdr_begin_xn(sdr));
+	sdr_usage(sdr, &usage);
+	sdr_exit_xn(sdr);
+	return usage.smallPoolFree + usage.largePoolFree + usage.unusedSize;
+}
+
+static int	runDestroy(Sdr sdr)
+{
+	long		freeBefore;
+	Object		list;
+	DeleteTally	tally = { 0, 0 };
+	int		i;
+
+	freeBefore = heapFree(sdr);
+	CHKERR(sdr_begin_xn(sdr));
+	list = sdr_ulist_create(sdr);
+	if (list == 0)
+	{
+		putErrmsg("Can't create list.", NULL);
+		sdr_cancel_xn(sdr);
+		return -1;
+	}
+
+	for (i = 1; i <= DESTROY_ITEMS; i++)
+	{
+		if ((i & 1 ? sdr_ulist_push_first(sdr, list, (Address) i)
+				: sdr_ulist_push_last(sdr, list, (Address) i))
+				< 0)
+		{
+			putErrmsg("Can't push item.", itoa(i));
+			sdr_cancel_xn(sdr);
+			return -1;
+		}
+	}
+
+	sdr_ulist_destroy(sdr, list, tallyItem, &tally);
+	if (sdr_end_xn(sdr) < 0)
+	{
+		putErrmsg("Can't end destroy test.", NULL);
+		return -1;
+	}
+
+	if (tally.count != DESTROY_ITEMS
+	|| tally.sum != ((uvast) DESTROY_ITEMS * (DESTROY_ITEMS + 1)) / 2)
+	{
+		putErrmsg("Delete function not applied to every item.",
+				itoa(tally.count));
+		return -1;
+	}
+
+	if (heapFree(sdr) != freeBefore)
+	{
+		putErrmsg("Destroyed list's space not all freed.", NULL);
+		return -1;
+	}
+
+	return 0;
+}
+
+#if defined (ION_LWT)
+int	sdrulisttest(int a1, int a2, int a3, int a4, int a5,
+		int a6, int a7, int a8, int a9, int a10)
+{
+#else
+int	main(int argc, char **argv)
+{
+#endif
+	Sdr	sdr;
+	int	result = 0;
+
+	if (sm_ipc_init() < 0)
+	{
+		putErrmsg("sdrulisttest can't initialize IPC.", NULL);
+		return 1;
+	}
+
+	if (sdr_initialize(TEST_SDR_WM_SIZE, NULL, SM_NO_KEY, NULL) < 0
+	|| sdr_load_profile(TEST_SDR_NAME, SDR_IN_DRAM, TEST_SDR_HEAP_WORDS,
+			SM_NO_KEY, 0, SM_NO_KEY, ".", NULL) < 0
+	|| (sdr = sdr_start_using(TEST_SDR_NAME)) == NULL)
+	{
+		putErrmsg("sdrulisttest can't create test SDR.", NULL);
+		writeErrmsgMemos();
+		sdr_shutdown();
+		sm_ipc_stop();
+		return 1;
+	}
+
+	if (runBoundaries(sdr) < 0
+	|| runRandom(sdr) < 0
+	|| runDestroy(sdr) < 0)
+	{
+		result = 1;
+	}
+
+	writeErrmsgMemos();
+	PUTS(result == 0 ? "Unrolled list test passed."
+			: "Unrolled list test FAILED.");
+	sdr_destroy(sdr);
+	sdr_shutdown();
+	sm_ipc_stop();
+	return result;
+}
@@ -0,0 +1,286 @@
+/*
+	smbptbench.c:	shared-memory index benchmark.  Measures
+			the cost of insertion, search, and in-order
+			traversal in a red-black tree (smrbt) and in
+			a B+tree (smbpt) holding the same keys, for
+			tree sizes from one thousand keys up to the
+			specified maximum in multiples of ten.  The
+			trees are built in a private PSM partition,
+			so ION need not be running.
+									*/
+
+#include "platform.h"
+#include "smrbt.h"
+#include "smbpt.h"
+
+#define	DEFAULT_MAX_KEYS	(1000000)
+#define	MIN_KEYS		(1000)
+
+/*	Space needed per key, for the key itself, the red-black
+ *	tree node, and the key's share of the B+tree's nodes.		*/
+
+#define	BYTES_PER_KEY		(128)
+
+/*	Keys are inserted in a scrambled order: multiplication by an
+ *	odd constant is a permutation of the 32-bit integers.		*/
+
+#define	BENCH_KEY(i)		((uvast) (((unsigned int) (i)) \
+* 2654435761U))
+
+typedef struct
+{
+	double	insert;
+	double	search;
+	double	traverse;
+} IndexCosts;
+
+static int	compareKeys(PsmPartition partition, PsmAddress nodeData,
+			void *dataBuffer)
+{
+	uvast	key = *((uvast *) psp(partition, nodeData));
+	uvast	argKey = *((uvast *) dataBuffer);
+
+	if (key < argKey)
+	{
+		return -1;
+	}
+
+	if (key > argKey)
+	{
+		return 1;
+	}
+
+	return 0;
+}
+
+static double	nsecPerOp(struct timeval *start, struct timeval *end,
+			unsigned int ops)
+{
+	double	usec;
+
+	usec = ((end->tv_sec - start->tv_sec) * 1000000.0)
+			+ (end->tv_usec - start->tv_usec);
+	return (usec * 1000.0) / ops;
+}
+
+static int	runRbt(PsmPartition wm, PsmAddress keys, unsigned int count,
+			IndexCosts *costs, uvast *checksum)
+{
+	uvast		*keyArray = (uvast *) psp(wm, keys);
+	PsmAddress	rbt;
+	unsigned int	i;
+	PsmAddress	node;
+	struct timeval	start;
+	struct timeval	end;
+
+	rbt = sm_rbt_create(wm);
+	if (rbt == 0)
+	{
+		putErrmsg("Can't create red-black tree.", NULL);
+		return -1;
+	}
+
+	getCurrentTime(&start);
+	for (i = 0; i < count; i++)
+	{
+		if (sm_rbt_insert(wm, rbt, keys + (i * sizeof(uvast)),
+				compareKeys, keyArray + i) == 0)
+		{
+			putErrmsg("Can't insert into red-black tree.",
+					utoa(i));
+			sm_rbt_destroy(wm, rbt, NULL, NULL);
+			return -1;
+		}
+	}
+
+	getCurrentTime(&end);
+	costs->insert = nsecPerOp(&start, &end, count);
+	getCurrentTime(&start);
+	for (i = 0; i < count; i++)
+	{
+		*checksum += sm_rbt_search(wm, rbt, compareKeys,
+				keyArray + ((i * 7919) % count), NULL);
+	}
+
+	getCurrentTime(&end);
+	costs->search = nsecPerOp(&start, &end, count);
+	getCurrentTime(&start);
+	for (node = sm_rbt_first(wm, rbt); node;
+			node = sm_rbt_next(wm, node))
+	{
+		*checksum += sm_rbt_data(wm, node);
+	}
+
+	getCurrentTime(&end);
+	costs->traverse = nsecPerOp(&start, &end, count);
+	sm_rbt_destroy(wm, rbt, NULL, NULL);
+	return 0;
+}
+
+static int	runBpt(PsmPartition wm, PsmAddress keys, unsigned int count,
+			IndexCosts *costs, uvast *checksum)
+{
+	uvast		*keyArray = (uvast *) psp(wm, keys);
+	PsmAddress	bpt;
+	unsigned int	i;
+	PsmAddress	node;
+	struct timeval	start;
+	struct timeval	end;
+
+	bpt = sm_bpt_create(wm);
+	if (bpt == 0)
+	{
+		putErrmsg("Can't create B+tree.", NULL);
+		return -1;
+	}
+
+	getCurrentTime(&start);
+	for (i = 0; i < count; i++)
+	{
+		if (sm_bpt_insert(wm, bpt, keys + (i * sizeof(uvast)),
+				compareKeys, keyArray + i) == 0)
+		{
+			putErrmsg("Can't insert into B+tree.", utoa(i));
+			sm_bpt_destroy(wm, bpt, NULL, NULL);
+			return -1;
+		}
+	}
+
+	getCurrentTime(&end);
+	costs->insert = nsecPerOp(&start, &end, count);
+	getCurrentTime(&start);
+	for (i = 0; i < count; i++)
+	{
+		*checksum += sm_bpt_search(wm, bpt, compareKeys,
+				keyArray + ((i * 7919) % count), NULL);
+	}
+
+	getCurrentTime(&end);
+	costs->search = nsecPerOp(&start, &end, count);
+	getCurrentTime(&start);
+	for (node = sm_bpt_first(wm, bpt); node;
+			node = sm_bpt_next(wm, node))
+	{
+		*checksum += sm_bpt_data(wm, node);
+	}
+
+	getCurrentTime(&end);
+	costs->traverse = nsecPerOp(&start, &end, count);
+	if (sm_bpt_length(wm, bpt) != count)
+	{
+		putErrmsg("B+tree length is wrong.", utoa(count));
+		sm_bpt_destroy(wm, bpt, NULL, NULL);
+		return -1;
+	}
+
+	sm_bpt_destroy(wm, bpt, NULL, NULL);
+	return 0;
+}
+
+#if defined (ION_LWT)
+int	smbptbench(int a1, int a2, int a3, int a4, int a5,
+		int a6, int a7, int a8, int a9, int a10)
+{
+	unsigned int	maxKeys = (unsigned int) a1;
+#else
+int	main(int argc, char **argv)
+{
+	unsigned int	maxKeys = (argc > 1 ? strtoul(argv[1], NULL, 0) : 0);
+#endif
+	unsigned long	wmSize;
+	char		*wmSpace;
+	PsmPartition	wm = NULL;
+	PsmMgtOutcome	outcome;
+	PsmAddress	keys;
+	uvast		*keyArray;
+	unsigned int	count;
+	unsigned int	i;
+	IndexCosts	rbtCosts;
+	IndexCosts	bptCosts;
+	uvast		checksum = 0;
+	int		result = 0;
+
+	if (maxKeys == 0)
+	{
+		maxKeys = DEFAULT_MAX_KEYS;
+	}
+
+	if (maxKeys < MIN_KEYS)
+	{
+		maxKeys = MIN_KEYS;
+	}
+
+	if (sm_ipc_init() < 0)
+	{
+		putErrmsg("smbptbench can't initialize IPC.", NULL);
+		return 1;
+	}
+
+	wmSize = ((unsigned long) maxKeys * BYTES_PER_KEY) + 1000000;
+	wmSpace = malloc(wmSize);
+	if (wmSpace == NULL)
+	{
+		putErrmsg("Can't allocate benchmark partition.", utoa(wmSize));
+		sm_ipc_stop();
+		return 1;
+	}
+
+	if (psm_manage(wmSpace, wmSize, "smbptbench", &wm, &outcome) < 0
+	|| outcome == Refused)
+	{
+		putErrmsg("Can't manage benchmark partition.", NULL);
+		free(wmSpace);
+		sm_ipc_stop();
+		return 1;
+	}
+
+	keys = psm_malloc(wm, maxKeys * sizeof(uvast));
+	if (keys == 0)
+	{
+		putErrmsg("Can't allocate keys.", utoa(maxKeys));
+		psm_unmanage(wm);
+		free(wmSpace);
+		sm_ipc_stop();
+		return 1;
+	}
+
+	keyArray = (uvast *) psp(wm, keys);
+	for (i = 0; i < maxKeys; i++)
+	{
+		keyArray[i] = BENCH_KEY(i);
+	}
+
+	PUTS("                 insert ns/key    search ns/key  traverse ns/key");
+	PUTS("    keys         rbt      bpt      rbt      bpt      rbt      bpt");
+	for (count = MIN_KEYS; count <= maxKeys; count *= 10)
+	{
+		if (runRbt(wm, keys, count, &rbtCosts, &checksum) < 0
+		|| runBpt(wm, keys, count, &bptCosts, &checksum) < 0)
+		{
+			result = 1;
+			break;
+		}
+
+		printf("%8u %11.1f %8.1f %8.1f %8.1f %8.1f %8.1f\n", count,
+				rbtCosts.insert, bptCosts.insert,
+				rbtCosts.search, bptCosts.search,
+				rbtCosts.traverse, bptCosts.traverse);
+		fflush(stdout);
+		if (count > ((unsigned int) -1) / 10)
+		{
+			break;
+		}
+	}
+
+	if (checksum == 0)	/*	Defeat optimization.		*/
+	{
+		PUTS("No keys were found.");
+	}
+
+	writeErrmsgMemos();
+	psm_free(wm, keys);
+	psm_unmanage(wm);
+	free(wmSpace);
+	sm_ipc_stop();
+	return result;
+}
@@ -22,8 +22,55 @@ typedef struct
 {
 	int		linkSocket;
 	int		running;
+
+	/*	When the local LTP engine is one shard of a sharded
+	 *	node, this LSI may also act as the node's dispatcher:
+	 *	every segment from an engine that is served by some
+	 *	other shard is forwarded, unaltered, to the LSI of
+	 *	that shard, which listens on the loopback interface
+	 *	at port number shardPortBase + that shard's number.	*/
+
+	unsigned int	shardNbr;
+	unsigned int	shardCount;	/*	0 if not dispatching.	*/
+	unsigned short	shardPortBase;
+	int		shardSocket;
 } ReceiverThreadParms;
 
+static int	dispatchSegment(ReceiverThreadParms *rtp, char *buffer,
+			int segmentLength)
+{
+	uvast			sourceEngineId;
+	unsigned int		shardNbr;
+	struct sockaddr_in	shardName;
+
+	if (ltpGetSourceEngineId(buffer, segmentLength, &sourceEngineId) < 1)
+	{
+		return 0;	/*	Let the local engine discard it.	*/
+	}
+
+	shardNbr = ltpShardOf(sourceEngineId, rtp->shardCount);
+	if (shardNbr == rtp->shardNbr)
+	{
+		return 0;	/*	Served by the local engine.	*/
+	}
+
+	memset((char *) &shardName, 0, sizeof shardName);
+	shardName.sin_family = AF_INET;
+	shardName.sin_port = htons(rtp->shardPortBase + shardNbr);
+	shardName.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	if (sendto(rtp->shardSocket, buffer, segmentLength, 0,
+			(struct sockaddr *) &shardName, sizeof shardName) < 0)
+	{
+		/*	The segment is simply lost, as if on the link.	*/
+
+		putSysErrmsg("udplsi can't forward segment to shard",
+				itoa(shardNbr));
+		writeErrmsgMemos();
+	}
+
+	return 1;
+}
+
 static void	*handleDatagrams(void *parm)
 {
 	/*	Main loop for UDP datagram reception and handling.	*/
@@ -65,6 +112,12 @@ static void	*handleDatagrams(void *parm)
 			continue;
 		}
 
+		if (rtp->shardCount > 0
+		&& dispatchSegment(rtp, buffer, segmentLength) == 1)
+		{
+			continue;
+		}
+
 		if (ltpHandleInboundSegment(buffer, segmentLength) < 0)
 		{
 			putErrmsg("Can't handle inbound segment.", NULL);
@@ -94,12 +147,15 @@ int	udplsi(int a1, int a2, int a3, int a4, int a5,
 		int a6, int a7, int a8, int a9, int a10)
 {
 	char	*endpointSpec = (char *) a1;
+	int	shardPortBase = a2;
 #else
 int	main(int argc, char *argv[])
 {
 	char	*endpointSpec = (argc > 1 ? argv[1] : NULL);
+	int	shardPortBase = (argc > 2 ? atoi(argv[2]) : 0);
 #endif
 	LtpVdb			*vdb;
+	LtpDB			*db;
 	unsigned short		portNbr = 0;
 	unsigned int		ipAddress = INADDR_ANY;
 	struct sockaddr		socketName;
@@ -127,6 +183,21 @@ int	main(int argc, char *argv[])
 		return 1;
 	}
 
+	db = getLtpConstants();
+	if (shardPortBase < 0 || shardPortBase > 65535
+	|| shardPortBase + db->shardCount > 65536)
+	{
+		putErrmsg("Invalid shard port number base.",
+				itoa(shardPortBase));
+		return 1;
+	}
+
+	if (shardPortBase > 0 && db->shardCount == 0)
+	{
+		writeMemo("[?] LTP engine isn't sharded; not dispatching.");
+		shardPortBase = 0;
+	}
+
 	/*	All command-line arguments are now validated.		*/
 
 	if (endpointSpec)
@@ -168,6 +239,22 @@ int	main(int argc, char *argv[])
 		return 1;
 	}
 
+	rtp.shardCount = 0;
+	if (shardPortBase > 0)
+	{
+		rtp.shardNbr = db->shardNbr;
+		rtp.shardCount = db->shardCount;
+		rtp.shardPortBase = shardPortBase;
+		rtp.shardSocket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+		if (rtp.shardSocket < 0)
+		{
+			close(rtp.linkSocket);
+			putSysErrmsg("LSI can't open shard dispatch socket",
+					NULL);
+			return 1;
+		}
+	}
+
 	/*	Set up signal handling; SIGTERM is shutdown signal.	*/
 
 	ionNoteMainThread("udplsi");
@@ -178,6 +265,11 @@ int	main(int argc, char *argv[])
 	rtp.running = 1;
 	if (pthread_begin(&receiverThread, NULL, handleDatagrams, &rtp))
 	{
+		if (rtp.shardCount > 0)
+		{
+			close(rtp.shardSocket);
+		}
+
 		close(rtp.linkSocket);
 		putSysErrmsg("udplsi can't create receiver thread", NULL);
 		return 1;
@@ -193,6 +285,12 @@ int	main(int argc, char *argv[])
 			"[i] udplsi is running, spec=[%s:%d].", 
 			inet_ntoa(inetName->sin_addr), ntohs(portNbr));
 		writeMemo(txt);
+		if (rtp.shardCount > 0)
+		{
+			isprintf(txt, sizeof(txt), "[i] udplsi is dispatching \
+for %u shards, shard port base %d.", rtp.shardCount, shardPortBase);
+			writeMemo(txt);
+		}
 	}
 
 	ionPauseMainThread(-1);
@@ -212,6 +310,11 @@ int	main(int argc, char *argv[])
 	}
 
 	pthread_join(receiverThread, NULL);
+	if (rtp.shardCount > 0)
+	{
+		close(rtp.shardSocket);
+	}
+
 	close(rtp.linkSocket);
 	writeErrmsgMemos();
 	writeMemo("[i] udplsi has ended.");
@@ -85,6 +85,8 @@ See man(5) for ltprc.");
 	PUTS("\t   m screening { y | n }");
 	PUTS("\t   m ownqtime <own queuing latency, in seconds>");
 	PUTS("\t   m maxber <max expected bit error rate; default is .000001>");
+	PUTS("\t   m shard <shard number> <number of shards> <shared engine ID#> \
+[<relay port base>]");
 	PUTS("\ts\tStart");
 	PUTS("\t   s '<LSI command>'");
 	PUTS("\tx\tStop");
@@ -93,6 +95,8 @@ See man(5) for ltprc.");
 	PUTS("\t   w { 0 | 1 | <activity spec> }");
 	PUTS("\t\tActivity spec is a string of all requested activity \
 indication characters, e.g., df{].  See man(5) for ltprc.");
+	PUTS("\tp\tProfile ION database transactions");
+	PUTS("\t   p { on | off | clear | list [<number of call sites>] }");
 	PUTS("\te\tEnable or disable echo of printed output to log file");
 	PUTS("\t   e { 0 | 1 }");
 	PUTS("\t#\tComment");
@@ -308,32 +312,40 @@ static void	printSpan(LtpVspan *vspan)
 {
 	Sdr	sdr = getIonsdr();
 		OBJ_POINTER(LtpSpan, span);
+		OBJ_POINTER(LtpSpanConfig, config);
 	char	cmd[SDRSTRING_BUFSZ];
 	char	buffer[256];
 
-	CHKVOID(sdr_begin_xn(sdr));
+	CHKVOID(sdr_begin_read(sdr));
 	GET_OBJ_POINTER(sdr, LtpSpan, span, sdr_list_data(sdr, vspan->spanElt));
-	sdr_string_read(sdr, cmd, span->lsoCmd);
+	GET_OBJ_POINTER(sdr, LtpSpanConfig, config, span->config);
+	sdr_string_read(sdr, cmd, config->lsoCmd);
 	isprintf(buffer, sizeof buffer,
 			UVAST_FIELDSPEC "  pid: %d  cmd: %.128s",
 			vspan->engineId, vspan->lsoPid, cmd);
 	printText(buffer);
 	isprintf(buffer, sizeof buffer, "\tmax export sessions: %u",
-			span->maxExportSessions);
+			config->maxExportSessions);
 	printText(buffer);
 	isprintf(buffer, sizeof buffer, "\tmax import sessions: %u",
-			span->maxImportSessions);
+			config->maxImportSessions);
 	printText(buffer);
 	isprintf(buffer, sizeof buffer, "\taggregation size limit: %u  \
-aggregation time limit: %u", span->aggrSizeLimit, span->aggrTimeLimit);
+aggregation time limit: %u", config->aggrSizeLimit,
+			config->aggrTimeLimit);
 	printText(buffer);
 	isprintf(buffer, sizeof buffer, "\tmax segment size: %u  queuing \
-latency: %u  purge: %d", span->maxSegmentSize, span->remoteQtime, span->purge);
+latency: %u  purge: %d", config->maxSegmentSize, config->remoteQtime,
+			config->purge);
 	printText(buffer);
 	isprintf(buffer, sizeof buffer, "\towltOutbound: %u  localXmit: %u  \
 owltInbound: %u  remoteXmit: %u", vspan->owltOutbound, vspan->localXmitRate,
 			vspan->owltInbound, vspan->remoteXmitRate);
-	sdr_exit_xn(sdr);
+	printText(buffer);
+	isprintf(buffer, sizeof buffer, "\timport session cache hits: "
+			UVAST_FIELDSPEC "  misses: " UVAST_FIELDSPEC,
+			vspan->importCache.hits, vspan->importCache.misses);
+	sdr_end_read(sdr);
 	printText(buffer);
 }
 
@@ -351,9 +363,9 @@ static void	infoSpan(int tokenCount, char **tokens)
 	}
 
 	engineId = strtouvast(tokens[2]);
-	CHKVOID(sdr_begin_xn(sdr));	/*	Just to lock memory.	*/
+	CHKVOID(sdr_begin_read(sdr));
 	findSpan(engineId, &vspan, &vspanElt);
-	sdr_exit_xn(sdr);
+	sdr_end_read(sdr);
 	if (vspanElt == 0)
 	{
 		printText("Unknown span.");
@@ -397,11 +409,25 @@ static void	listSpans(int tokenCount, char **tokens)
 		return;
 	}
 
-	CHKVOID(sdr_begin_xn(sdr));	/*	Just to lock memory.	*/
+	CHKVOID(sdr_begin_read(sdr));
 	GET_OBJ_POINTER(sdr, LtpDB, ltpdb, ltpdbObj);
 	isprintf(buffer, sizeof buffer,"(Engine " UVAST_FIELDSPEC "  Queuing \
 latency: %u  LSI pid: %d)", ltpdb->ownEngineId, ltpdb->ownQtime, vdb->lsiPid);
 	printText(buffer);
+	isprintf(buffer, sizeof buffer, "(Export session cache hits: "
+			UVAST_FIELDSPEC "  misses: " UVAST_FIELDSPEC ")",
+			vdb->exportCache.hits, vdb->exportCache.misses);
+	printText(buffer);
+	if (ltpdb->shardCount > 0)
+	{
+		isprintf(buffer, sizeof buffer, "(Shard %u of %u  Relay \
+port: %u  Relay pid: %d)", ltpdb->shardNbr, ltpdb->shardCount,
+				(ltpdb->relayPortBase ? ltpdb->relayPortBase
+				: LTP_RELAY_PORT_BASE) + ltpdb->shardNbr,
+				vdb->relayPid);
+		printText(buffer);
+	}
+
 	for (elt = sm_list_first(ionwm, vdb->spans); elt;
 			elt = sm_list_next(ionwm, elt))
 	{
@@ -409,7 +435,7 @@ latency: %u  LSI pid: %d)", ltpdb->ownEngineId, ltpdb->ownQtime, vdb->lsiPid);
 		printSpan(vspan);
 	}
 
-	sdr_exit_xn(sdr);
+	sdr_end_read(sdr);
 }
 
 static void	executeList(int tokenCount, char **tokens)
@@ -572,6 +598,75 @@ static void	manageMaxBER(int tokenCount, char **tokens)
 	}
 }
 
+static void	manageShard(int tokenCount, char **tokens)
+{
+	Sdr		sdr = getIonsdr();
+	Object		ltpdbObj = getLtpDbObject();
+	LtpVdb		*vdb = getLtpVdb();
+	LtpDB		ltpdb;
+	unsigned int	shardNbr;
+	unsigned int	shardCount;
+	uvast		engineId;
+	unsigned long	relayPortBase = LTP_RELAY_PORT_BASE;
+
+	if (tokenCount != 5 && tokenCount != 6)
+	{
+		SYNTAX_ERROR;
+		return;
+	}
+
+	shardNbr = strtoul(tokens[2], NULL, 0);
+	shardCount = strtoul(tokens[3], NULL, 0);
+	engineId = strtouvast(tokens[4]);
+	if (shardCount < 2 || shardCount > LTP_MAX_SHARDS
+	|| shardNbr >= shardCount)
+	{
+		writeMemoNote("[?] Shard number invalid", tokens[2]);
+		return;
+	}
+
+	if (tokenCount == 6)
+	{
+		relayPortBase = strtoul(tokens[5], NULL, 0);
+	}
+
+	if (relayPortBase == 0 || relayPortBase + shardCount > 65536)
+	{
+		writeMemoNote("[?] Relay port base invalid", tokens[5]);
+		return;
+	}
+
+	if (engineId == 0)
+	{
+		writeMemoNote("[?] Shared engine ID invalid", tokens[4]);
+		return;
+	}
+
+	CHKVOID(sdr_begin_xn(sdr));
+	sdr_stage(sdr, (char *) &ltpdb, ltpdbObj, sizeof(LtpDB));
+	if (sdr_list_length(sdr, ltpdb.spans) > 0)
+	{
+		sdr_exit_xn(sdr);
+		writeMemo("[?] Can't shard an engine that already has spans.");
+		return;
+	}
+
+	/*	All shards of the node present the same engine ID
+	 *	to the remote engines.					*/
+
+	ltpdb.shardNbr = shardNbr;
+	ltpdb.shardCount = shardCount;
+	ltpdb.relayPortBase = relayPortBase;
+	ltpdb.ownEngineId = engineId;
+	encodeSdnv(&(ltpdb.ownEngineIdSdnv), engineId);
+	sdr_write(sdr, ltpdbObj, (char *) &ltpdb, sizeof(LtpDB));
+	vdb->ownEngineId = engineId;
+	if (sdr_end_xn(sdr) < 0)
+	{
+		putErrmsg("Can't change LTP shard assignment.", NULL);
+	}
+}
+
 static void	executeManage(int tokenCount, char **tokens)
 {
 	if (tokenCount < 2)
@@ -604,6 +699,12 @@ static void	executeManage(int tokenCount, char **tokens)
 		return;
 	}
 
+	if (strcmp(tokens[1], "shard") == 0)
+	{
+		manageShard(tokenCount, tokens);
+		return;
+	}
+
 	SYNTAX_ERROR;
 }
 
@@ -702,6 +803,107 @@ static void	switchWatch(int tokenCount, char **tokens)
 	}
 }
 
+#define	MAX_PROFILE_SITES	(64)
+#define	DEFAULT_PROFILE_SITES	(10)
+
+static void	listProfile(int tokenCount, char **tokens)
+{
+	Sdr		sdr = getIonsdr();
+	SdrXnProfile	sites[MAX_PROFILE_SITES];
+	SdrXnProfile	*site;
+	int		count = DEFAULT_PROFILE_SITES;
+	int		i;
+	char		buffer[128];
+
+	if (tokenCount > 3)
+	{
+		SYNTAX_ERROR;
+		return;
+	}
+
+	if (tokenCount == 3)
+	{
+		count = atoi(tokens[2]);
+		if (count < 1 || count > MAX_PROFILE_SITES)
+		{
+			count = MAX_PROFILE_SITES;
+		}
+	}
+
+	count = sdr_get_profile(sdr, sites, count);
+	if (count < 0)
+	{
+		printText("Transaction profiling is not on.");
+		return;
+	}
+
+	printText("(Times in microseconds; call sites by total hold time.)");
+	for (i = 0, site = sites; i < count; i++, site++)
+	{
+		isprintf(buffer, sizeof buffer, "%s:%d  xns: %lu  writes: %lu  \
+logged: %lu", site->sourceFileName, site->lineNbr, site->xnCount,
+				site->writeCount, site->bytesLogged);
+		printText(buffer);
+		isprintf(buffer, sizeof buffer, "\twait  total: " UVAST_FIELDSPEC
+				"  median: %lu  p99: %lu  max: %lu",
+				site->totalWait, site->medianWait,
+				site->p99Wait, site->maxWait);
+		printText(buffer);
+		isprintf(buffer, sizeof buffer, "\thold  total: " UVAST_FIELDSPEC
+				"  median: %lu  p99: %lu  max: %lu",
+				site->totalHold, site->medianHold,
+				site->p99Hold, site->maxHold);
+		printText(buffer);
+	}
+}
+
+static void	switchProfile(int tokenCount, char **tokens)
+{
+	Sdr	sdr = getIonsdr();
+
+	if (tokenCount < 2)
+	{
+		printText("Profile in what way?");
+		return;
+	}
+
+	if (strcmp(tokens[1], "list") == 0)
+	{
+		listProfile(tokenCount, tokens);
+		return;
+	}
+
+	if (tokenCount != 2)
+	{
+		SYNTAX_ERROR;
+		return;
+	}
+
+	if (strcmp(tokens[1], "on") == 0)
+	{
+		if (sdr_start_profile(sdr) < 0)
+		{
+			putErrmsg("Can't start transaction profile.", NULL);
+		}
+
+		return;
+	}
+
+	if (strcmp(tokens[1], "off") == 0)
+	{
+		sdr_stop_profile(sdr);
+		return;
+	}
+
+	if (strcmp(tokens[1], "clear") == 0)
+	{
+		sdr_clear_profile(sdr);
+		return;
+	}
+
+	SYNTAX_ERROR;
+}
+
 static void	switchEcho(int tokenCount, char **tokens)
 {
 	int	state;
@@ -926,6 +1128,14 @@ up, abandoned.");
 
 			return 0;
 
+		case 'p':
+			if (attachToLtp() == 0)
+			{
+				switchProfile(tokenCount, tokens);
+			}
+
+			return 0;
+
 		case 'e':
 			switchEcho(tokenCount, tokens);
 			return 0;